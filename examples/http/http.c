@@ -22,19 +22,6 @@
 #include <errno.h>
 #include <stdio.h> // Add for debugging
 #include <string.h>
-// Portable memmem implementation for platforms where it's missing
-static void *portable_memmem(const void *haystack, size_t haystacklen,
-    const void *needle, size_t needlelen) {
-  if (needlelen == 0)
-    return (void *)haystack;
-  if (haystacklen < needlelen)
-    return NULL;
-  for (size_t i = 0; i <= haystacklen - needlelen; ++i) {
-    if (memcmp((const char *)haystack + i, needle, needlelen) == 0)
-      return (void *)((const char *)haystack + i);
-  }
-  return NULL;
-}
 
 #ifndef CU_FREESTANDING
 
@@ -141,7 +128,8 @@ static void handle_client(cu_HttpServer *server, cu_socket_t fd) {
     full_req[total] = '\0';
 
     // Check if we reached the end of headers
-    if (total >= 4 && portable_memmem(full_req, total, "\r\n\r\n", 4)) {
+    if (total >= 4 && cu_Memory_memmem(cu_Slice_create(full_req, total),
+                          CU_SLICE_CSTR("\r\n\r\n")) != NULL) {
       break;
     }
   }
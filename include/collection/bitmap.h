@@ -34,6 +34,31 @@ void cu_Bitmap_set(cu_Bitmap *bitmap, size_t index);
 void cu_Bitmap_clear(cu_Bitmap *bitmap, size_t index);
 /** Clear all bits in the bitmap. */
 void cu_Bitmap_clear_all(cu_Bitmap *bitmap);
+/**
+ * @brief Find the first clear bit at or after @p start.
+ *
+ * The search inspects a whole word per step instead of single bits.
+ * Returns none when every remaining bit is set.
+ */
+Size_Optional cu_Bitmap_find_clear(const cu_Bitmap *bitmap, size_t start);
+/**
+ * @brief Find the first set bit at or after @p start.
+ *
+ * Returns none when every remaining bit is clear.
+ */
+Size_Optional cu_Bitmap_find_set(const cu_Bitmap *bitmap, size_t start);
+/**
+ * @brief Find the first run of @p count clear bits at or after @p start.
+ *
+ * Alternates between skipping whole words of set and clear bits, so the cost
+ * depends on the number of runs rather than the number of bits.
+ */
+Size_Optional cu_Bitmap_find_clear_run(
+    const cu_Bitmap *bitmap, size_t start, size_t count);
+/** Set @p count bits starting at @p start. */
+void cu_Bitmap_set_range(cu_Bitmap *bitmap, size_t start, size_t count);
+/** Clear @p count bits starting at @p start. */
+void cu_Bitmap_clear_range(cu_Bitmap *bitmap, size_t start, size_t count);
 /** Number of bits held by the bitmap. */
 static inline size_t cu_Bitmap_size(const cu_Bitmap *bitmap) {
   return bitmap->bitCount;
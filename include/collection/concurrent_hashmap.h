@@ -0,0 +1,124 @@
+#pragma once
+
+/** @file concurrent_hashmap.h Sharded hashmap safe for concurrent use. */
+
+#include "collection/hashmap.h"
+#include "macro.h"
+#include "memory/allocator.h"
+#include "state.h"
+#include "utility.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if !CU_FREESTANDING && !defined(__STDC_NO_ATOMICS__)
+
+#include <stdatomic.h>
+
+#define CU_CONCURRENT_HASHMAP_SHARDS 64 /**< default shard count */
+
+/** @cond INTERNAL */
+/** Table retired by a shard, kept until readers can no longer see it. */
+struct cu_ConcurrentHashMap_Retired {
+  struct cu_ConcurrentHashMap_Retired *next; /**< next retired table */
+  void *base;                                /**< start of the allocation */
+  size_t size;                               /**< size of the allocation */
+};
+
+/** One independently locked part of the keyspace. */
+typedef struct {
+  _Alignas(64) _Atomic(uint64_t) seq; /**< odd while a writer is active */
+  atomic_flag lock;                   /**< serializes writers */
+  cu_HashMap map;                     /**< entries of this shard */
+  cu_Allocator backing;               /**< allocator behind the tables */
+  struct cu_ConcurrentHashMap_Retired *retired; /**< tables to reclaim */
+} cu_ConcurrentHashMap_Shard;
+/** @endcond */
+
+/**
+ * Hashmap partitioned into shards by the top bits of the key hash.
+ *
+ * Each shard is a ::cu_HashMap guarded by a sequence lock. Writers take a
+ * per shard spin lock and bump the sequence around their update. Readers
+ * take no lock and write no shared state: they copy the value out and
+ * retry when the sequence moved, so reads scale with cores.
+ *
+ * Because readers may still walk a table after a writer has grown past
+ * it, replaced tables are only freed by cu_ConcurrentHashMap_reclaim() or
+ * cu_ConcurrentHashMap_destroy(). Readers may also observe a key while it
+ * is being written, so the equality predicate must tolerate torn keys; the
+ * result of such a comparison is always discarded.
+ */
+typedef struct {
+  cu_ConcurrentHashMap_Shard *shards; /**< shard array */
+  size_t shard_count;                 /**< number of shards, a power of two */
+  unsigned shard_shift;               /**< hash shift selecting the shard */
+  cu_Layout key_layout;               /**< layout of the key */
+  cu_Layout value_layout;             /**< layout of the value */
+  cu_Allocator allocator;             /**< backing allocator */
+  cu_HashMap_HashFn hash_fn;          /**< custom hash or NULL */
+  uint32_t seed;                      /**< seed of the shard selection */
+} cu_ConcurrentHashMap;
+
+CU_RESULT_DECL(cu_ConcurrentHashMap, cu_ConcurrentHashMap, cu_HashMap_Error)
+
+/**
+ * @brief Produce the value of a missing key for
+ * cu_ConcurrentHashMap_compute_if_absent().
+ *
+ * Runs while the shard is locked and must not touch the same map.
+ */
+typedef void (*cu_ConcurrentHashMap_ComputeFn)(
+    const void *key, void *value, void *ctx);
+
+/**
+ * @brief Create a new concurrent hashmap.
+ *
+ * @param allocator allocator used for storage, must be thread safe
+ * @param key_layout layout describing the key type
+ * @param value_layout layout describing the value type
+ * @param shard_count optional shard count, rounded up to a power of two
+ * @param hash_fn hashing function, defaults to cu_Hash_Wy64() when none
+ * @param equals_fn equality predicate, defaults to bytewise compare
+ * @param state randomization source used to seed hashes
+ */
+cu_ConcurrentHashMap_Result cu_ConcurrentHashMap_create(cu_Allocator allocator,
+    cu_Layout key_layout, cu_Layout value_layout, Size_Optional shard_count,
+    cu_HashMap_HashFn_Optional hash_fn, cu_HashMap_EqualsFn_Optional equals_fn,
+    cu_State state);
+/** Release resources held by @p map. No other thread may use it anymore. */
+void cu_ConcurrentHashMap_destroy(cu_ConcurrentHashMap *map);
+
+/** @brief Insert a key-value pair, overwriting the value of an existing key. */
+cu_HashMap_Error_Optional cu_ConcurrentHashMap_insert(
+    cu_ConcurrentHashMap *map, const void *key, const void *value);
+/**
+ * @brief Copy the value stored for @p key into @p out_value.
+ * @return false when the key is absent
+ */
+bool cu_ConcurrentHashMap_get(
+    const cu_ConcurrentHashMap *map, const void *key, void *out_value);
+/**
+ * @brief Remove @p key, copying its value to @p out_value when not NULL.
+ * @return CU_HASHMAP_ERROR_NOT_FOUND when the key is absent
+ */
+cu_HashMap_Error_Optional cu_ConcurrentHashMap_remove(
+    cu_ConcurrentHashMap *map, const void *key, void *out_value);
+/**
+ * @brief Insert the value computed by @p fn unless @p key is present.
+ *
+ * Either way the value stored for @p key afterwards is copied to
+ * @p out_value when not NULL. @p fn runs at most once, under the shard lock,
+ * so concurrent callers never compute the same key twice.
+ */
+cu_HashMap_Error_Optional cu_ConcurrentHashMap_compute_if_absent(
+    cu_ConcurrentHashMap *map, const void *key,
+    cu_ConcurrentHashMap_ComputeFn fn, void *ctx, void *out_value);
+/**
+ * @brief Free tables retired by growth.
+ *
+ * Only call this while no other thread is reading from @p map.
+ */
+void cu_ConcurrentHashMap_reclaim(cu_ConcurrentHashMap *map);
+
+#endif
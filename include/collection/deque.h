@@ -0,0 +1,107 @@
+#pragma once
+
+/** @file deque.h Double ended queue made of fixed size blocks. */
+
+#include "macro.h"
+#include "memory/allocator.h"
+#include "nostd.h"
+#include "object/destructor.h"
+#include "object/optional.h"
+#include "object/result.h"
+#include "utility.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/** target size of one block in bytes */
+#define CU_DEQUE_BLOCK_BYTES 4096
+/** fewest elements stored per block, for large elements */
+#define CU_DEQUE_MIN_BLOCK_LENGTH 16
+
+/**
+ * @brief Double ended queue with amortized constant time at both ends.
+ *
+ * Elements live in fixed size blocks that are never moved. A circular map of
+ * block pointers tracks the blocks in order, so pushing or popping at either
+ * end touches at most one block and only the small map is ever reallocated.
+ * Pointers to elements stay valid until that element is removed.
+ */
+typedef struct {
+  void **map;                        /**< circular array of block pointers */
+  size_t map_capacity;               /**< map slots, a power of two */
+  size_t map_head;                   /**< map slot of the first block */
+  size_t blocks;                     /**< blocks in use */
+  size_t head;                       /**< offset of the first element */
+  size_t length;                     /**< number of stored elements */
+  size_t block_shift;                /**< log2 of the elements per block */
+  void *spare;                       /**< emptied block kept for reuse */
+  cu_Layout layout;                  /**< element layout */
+  cu_Allocator allocator;            /**< backing allocator */
+  cu_Destructor_Optional destructor; /**< optional element destructor */
+} cu_Deque;
+
+/** Error codes returned by deque operations. */
+typedef enum {
+  CU_DEQUE_ERROR_NONE = 0,       /**< success */
+  CU_DEQUE_ERROR_OOM,            /**< out of memory */
+  CU_DEQUE_ERROR_INVALID_LAYOUT, /**< invalid element layout */
+  CU_DEQUE_ERROR_INVALID,        /**< invalid argument */
+  CU_DEQUE_ERROR_EMPTY,          /**< no element to remove */
+} cu_Deque_Error;
+
+CU_RESULT_DECL(cu_Deque, cu_Deque, cu_Deque_Error)
+CU_OPTIONAL_DECL(cu_Deque_Error, cu_Deque_Error)
+
+/** Create an empty deque, no memory is allocated until the first push. */
+cu_Deque_Result cu_Deque_create(cu_Allocator allocator, cu_Layout layout,
+    cu_Destructor_Optional destructor);
+/** Destroy the remaining elements and release all blocks. */
+void cu_Deque_destroy(cu_Deque *deque);
+
+/** Current number of elements held by the deque. */
+static inline size_t cu_Deque_size(const cu_Deque *deque) {
+  CU_IF_NULL(deque) { return 0; }
+  return deque->length;
+}
+
+static inline bool cu_Deque_is_empty(const cu_Deque *deque) {
+  CU_IF_NULL(deque) { return true; }
+  return deque->length == 0;
+}
+
+/** Append a copy of @p elem. */
+cu_Deque_Error_Optional cu_Deque_push_back(cu_Deque *deque, const void *elem);
+/** Prepend a copy of @p elem. */
+cu_Deque_Error_Optional cu_Deque_push_front(cu_Deque *deque, const void *elem);
+/** Remove the last element and copy it into @p out_elem unless NULL. */
+cu_Deque_Error_Optional cu_Deque_pop_back(cu_Deque *deque, void *out_elem);
+/** Remove the first element and copy it into @p out_elem unless NULL. */
+cu_Deque_Error_Optional cu_Deque_pop_front(cu_Deque *deque, void *out_elem);
+
+/**
+ * @brief Append @p count packed elements.
+ *
+ * Copies a block at a time. Either all elements are appended or, when
+ * memory runs out, none are.
+ */
+cu_Deque_Error_Optional cu_Deque_append(
+    cu_Deque *deque, const void *elems, size_t count);
+
+/** Destroy all elements, keeping one block for reuse. */
+void cu_Deque_clear(cu_Deque *deque);
+
+/**
+ * @brief Return a pointer to the element at @p index, counted from the front.
+ *
+ * If the index is out of bounds the optional contains none.
+ */
+Ptr_Optional cu_Deque_at(const cu_Deque *deque, size_t index);
+
+/**
+ * @brief Iterate over the elements from front to back.
+ *
+ * @param deque deque to iterate
+ * @param index current index, start with zero
+ * @param out_elem receives a pointer to the element
+ * @return true when another element was produced
+ */
+bool cu_Deque_iter(const cu_Deque *deque, size_t *index, void **out_elem);
@@ -0,0 +1,100 @@
+#pragma once
+
+/** @file frozenmap.h Read only map over a minimal perfect hash. */
+
+#include "collection/hashmap.h"
+#include "macro.h"
+#include "memory/allocator.h"
+#include "nostd.h"
+#include "object/optional.h"
+#include "object/result.h"
+#include "state.h"
+#include "utility.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** alignment of every section of a frozen map blob */
+#define CU_FROZENMAP_ALIGN 16
+/** bumped whenever the blob layout changes */
+#define CU_FROZENMAP_VERSION 1
+
+/** @cond INTERNAL */
+/** Header at the start of every blob, in native byte order. */
+typedef struct {
+  uint32_t magic;         /**< "CUFM", rejects foreign byte orders */
+  uint32_t version;       /**< ::CU_FROZENMAP_VERSION */
+  uint64_t seed;          /**< seed of the key hash */
+  uint64_t length;        /**< number of keys and slots */
+  uint64_t buckets;       /**< number of pilots */
+  uint64_t key_size;      /**< bytes per key */
+  uint64_t value_size;    /**< bytes per value */
+  uint64_t key_stride;    /**< distance between keys */
+  uint64_t value_stride;  /**< distance between values */
+  uint64_t pilots_offset; /**< offset of the uint32_t pilot array */
+  uint64_t keys_offset;   /**< offset of the key slots */
+  uint64_t values_offset; /**< offset of the value slots */
+  uint64_t size;          /**< total blob size */
+} cu_FrozenMap_Header;
+/** @endcond */
+
+/**
+ * Immutable map over a minimal perfect hash.
+ *
+ * Keys are hashed into buckets of a few keys each, and every bucket stores a
+ * pilot chosen at build time so that its keys land in distinct slots. A
+ * lookup hashes once, reads one pilot and compares one key, and the n keys
+ * fill exactly n slots. Keys are hashed and compared bytewise.
+ *
+ * The whole map is a single position independent blob that can be written
+ * to a file and used in place once mapped back in with
+ * cu_FrozenMap_from_bytes().
+ */
+typedef struct {
+  const unsigned char *blob;    /**< start of the blob */
+  const uint32_t *pilots;       /**< one pilot per bucket */
+  const unsigned char *keys;    /**< key slots */
+  const unsigned char *values;  /**< value slots */
+  size_t length;                /**< number of keys */
+  size_t buckets;               /**< number of buckets */
+  size_t key_size;              /**< bytes per key */
+  size_t value_size;            /**< bytes per value */
+  size_t key_stride;            /**< distance between keys */
+  size_t value_stride;          /**< distance between values */
+  uint64_t seed;                /**< seed of the key hash */
+  cu_Allocator_Optional owner;  /**< allocator owning the blob, if any */
+} cu_FrozenMap;
+
+CU_RESULT_DECL(cu_FrozenMap, cu_FrozenMap, cu_HashMap_Error)
+
+/**
+ * @brief Freeze the contents of @p map.
+ *
+ * @param allocator allocator for the blob and temporary build state
+ * @param map source map, which must compare keys bytewise
+ * @param state randomization source used to seed the hash
+ */
+cu_FrozenMap_Result cu_FrozenMap_build(
+    cu_Allocator allocator, const cu_HashMap *map, cu_State state);
+/**
+ * @brief Freeze @p count pairs from two packed arrays.
+ *
+ * @return CU_HASHMAP_ERROR_INVALID when a key appears twice
+ */
+cu_FrozenMap_Result cu_FrozenMap_build_arrays(cu_Allocator allocator,
+    cu_Layout key_layout, cu_Layout value_layout, const void *keys,
+    const void *values, size_t count, cu_State state);
+/**
+ * @brief Use a blob produced by cu_FrozenMap_bytes() in place.
+ *
+ * The blob is validated but not copied, it must stay alive and be aligned
+ * to ::CU_FROZENMAP_ALIGN, as file mappings are.
+ */
+cu_FrozenMap_Result cu_FrozenMap_from_bytes(cu_Slice blob);
+/** @brief The blob backing @p map, ready to be written out. */
+cu_Slice cu_FrozenMap_bytes(const cu_FrozenMap *map);
+/** Release the blob if @p map owns it. */
+void cu_FrozenMap_destroy(cu_FrozenMap *map);
+
+/** @brief Retrieve the value stored for @p key. */
+Ptr_Optional cu_FrozenMap_get(const cu_FrozenMap *map, const void *key);
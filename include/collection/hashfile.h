@@ -0,0 +1,108 @@
+#pragma once
+
+/** @file hashfile.h Hash table file served straight from a mapping. */
+
+#include "collection/hashmap.h"
+#include "io/error.h"
+#include "io/file.h"
+#include "macro.h"
+#include "memory/allocator.h"
+#include "nostd.h"
+#include "object/optional.h"
+#include "object/result.h"
+#include "utility.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if !CU_FREESTANDING
+
+/** alignment of the sections and records of a hash file */
+#define CU_HASHFILE_ALIGN 16
+/** bumped whenever the file layout changes */
+#define CU_HASHFILE_VERSION 1
+
+/** @cond INTERNAL */
+/** Header at offset 0 of every file, in native byte order. */
+typedef struct {
+  uint32_t magic;         /**< "CUHF", rejects foreign byte orders */
+  uint32_t version;       /**< ::CU_HASHFILE_VERSION */
+  uint64_t seed;          /**< seed of the key hash */
+  uint64_t length;        /**< number of records */
+  uint64_t capacity;      /**< number of slots, a power of two */
+  uint64_t key_size;      /**< bytes per key */
+  uint64_t value_size;    /**< bytes per value */
+  uint64_t value_offset;  /**< offset of the value inside a record */
+  uint64_t record_stride; /**< distance between records */
+  uint64_t slots_offset;  /**< offset of the slot array */
+  uint64_t heap_offset;   /**< offset of the record heap */
+  uint64_t size;          /**< total file size */
+} cu_HashFile_Header;
+
+/** Slot of the linear probing table, an offset of zero marks it empty. */
+typedef struct {
+  uint64_t hash;   /**< full key hash */
+  uint64_t offset; /**< file offset of the record */
+} cu_HashFile_Slot;
+/** @endcond */
+
+/**
+ * Read only hash table stored in a file.
+ *
+ * The file holds a header, a linear probing slot array and a heap of key
+ * value records. Slots refer to records by file offset, so the file is used
+ * exactly as it sits in memory: opening it maps it and checks the header,
+ * without reading or rebuilding anything. Processes mapping the same file
+ * share its pages through the page cache.
+ *
+ * Keys are hashed and compared bytewise.
+ */
+typedef struct {
+  const unsigned char *base;     /**< start of the mapped file */
+  size_t size;                   /**< bytes mapped */
+  const cu_HashFile_Slot *slots; /**< slot array */
+  size_t mask;                   /**< capacity minus one */
+  size_t length;                 /**< number of records */
+  size_t key_size;               /**< bytes per key */
+  size_t value_offset;           /**< offset of the value inside a record */
+  size_t heap_offset;            /**< offset of the first record */
+  size_t record_stride;          /**< distance between records */
+  size_t record_limit;           /**< offset of the last record */
+  uint64_t seed;                 /**< seed of the key hash */
+  bool mapped;                   /**< whether close unmaps @ref base */
+} cu_HashFile;
+
+CU_RESULT_DECL(cu_HashFile, cu_HashFile, cu_Io_Error)
+
+/**
+ * @brief Write the contents of @p map to @p file.
+ *
+ * @param file file opened for writing at offset zero
+ * @param map source map, which must compare keys bytewise
+ * @param allocator allocator for the slot array built before writing
+ */
+cu_Io_Error_Optional cu_HashFile_write(
+    cu_File *file, const cu_HashMap *map, cu_Allocator allocator);
+/**
+ * @brief Map the file at @p path and validate it.
+ *
+ * @param allocator allocator used while the file is being opened
+ */
+cu_HashFile_Result cu_HashFile_open(cu_Slice path, cu_Allocator allocator);
+/**
+ * @brief Use bytes already in memory, aligned to ::CU_HASHFILE_ALIGN.
+ *
+ * The bytes are validated but not copied and must outlive the result.
+ */
+cu_HashFile_Result cu_HashFile_from_bytes(cu_Slice bytes);
+/** Unmap the file if cu_HashFile_open() mapped it. */
+void cu_HashFile_close(cu_HashFile *file);
+
+/**
+ * @brief Retrieve the value stored for @p key.
+ *
+ * The value points into the read only mapping.
+ */
+Ptr_Optional cu_HashFile_get(const cu_HashFile *file, const void *key);
+
+#endif
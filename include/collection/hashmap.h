@@ -1,6 +1,14 @@
 #pragma once
 
-/** @file hashmap.h Simple hashmap container. */
+/**
+ * @file hashmap.h Open addressing hashmap with inline storage.
+ *
+ * Every slot owns one control byte holding seven bits of its hash, or
+ * `0x80` when it is empty. Lookups compare a window of control bytes at
+ * once (16 with SSE2, a machine word otherwise) and only touch keys whose
+ * control byte matches. Keys and values are stored inline in two slot
+ * arrays that share a single allocation with the control bytes.
+ */
 
 #include "hash/hash.h"
 #include "macro.h"
@@ -11,31 +19,47 @@
 #include "utility.h"
 #include <stdbool.h>
 #include <stddef.h>
-
-/** Bucket used internally by the hashmap. */
-typedef struct {
-  bool used;     /**< bucket contains a value */
-  bool deleted;  /**< bucket has been removed */
-  uint64_t hash; /**< cached hash of the key */
-  void *key;     /**< pointer to key storage */
-  void *value;   /**< pointer to value storage */
-} cu_HashMap_Bucket;
+#include <stdint.h>
 
 typedef uint64_t (*cu_HashMap_HashFn)(const void *key, size_t key_size);
+/** Hash function that mixes the seed of the map in itself. */
+typedef uint64_t (*cu_HashMap_SeededHashFn)(
+    const void *key, size_t key_size, uint64_t seed);
 typedef bool (*cu_HashMap_EqualsFn)(
     const void *a, const void *b, size_t key_size);
 CU_OPTIONAL_DECL(cu_HashMap_HashFn, cu_HashMap_HashFn)
 CU_OPTIONAL_DECL(cu_HashMap_EqualsFn, cu_HashMap_EqualsFn)
 
-/** Simple open addressing hashmap. */
+/** @cond INTERNAL */
+/** Slot storage of a hashmap, carved from one allocation. */
 typedef struct {
-  cu_HashMap_Bucket *buckets;    /**< bucket array */
-  size_t capacity;               /**< number of buckets */
+  uint8_t *ctrl;         /**< control bytes plus a mirrored tail window */
+  unsigned char *keys;   /**< inline keys, one stride per slot */
+  unsigned char *values; /**< inline values, one stride per slot */
+  size_t capacity;       /**< number of slots, a power of two */
+} cu_HashMap_Table;
+/** @endcond */
+
+/**
+ * Open addressing hashmap.
+ *
+ * The table grows once it is 7/8 full. Pointers returned by
+ * cu_HashMap_get() and cu_HashMap_iter() point into the table and are
+ * invalidated by the next insertion or removal.
+ */
+typedef struct {
+  cu_HashMap_Table table;        /**< slot storage */
+  cu_HashMap_Table old;          /**< table being migrated, if any */
+  cu_HashMap_Table next;         /**< table being prepared, if any */
+  size_t migrated;               /**< old slots already migrated */
+  size_t cleared;                /**< control bytes of next already emptied */
+  size_t rehash_step;            /**< old slots migrated per update, 0 = all */
   size_t length;                 /**< number of elements */
   cu_Layout key_layout;          /**< layout of the key */
   cu_Layout value_layout;        /**< layout of the value */
   cu_Allocator allocator;        /**< backing allocator */
   cu_HashMap_HashFn hash_fn;     /**< hashing function */
+  cu_HashMap_SeededHashFn seeded_hash_fn; /**< replaces hash_fn when set */
   cu_HashMap_EqualsFn equals_fn; /**< equality predicate */
   uint32_t seed;                 /**< hash seed to randomize hashes */
 } cu_HashMap;
@@ -46,6 +70,7 @@ typedef enum {
   CU_HASHMAP_ERROR_OOM,
   CU_HASHMAP_ERROR_INVALID_LAYOUT,
   CU_HASHMAP_ERROR_INVALID,
+  CU_HASHMAP_ERROR_NOT_FOUND,
 } cu_HashMap_Error;
 
 CU_RESULT_DECL(cu_HashMap, cu_HashMap, cu_HashMap_Error)
@@ -56,9 +81,11 @@ CU_OPTIONAL_DECL(cu_HashMap_Error, cu_HashMap_Error)
  *
  * @param allocator allocator used for storage
  * @param key_layout layout describing the key type
- * @param value_layout layout describing the value type
- * @param initial_capacity optional initial bucket count
- * @param hash_fn hashing function, defaults to FNV-1a when none
+ * @param value_layout layout describing the value type, an element size of
+ * zero with alignment 1 stores no values at all
+ * @param initial_capacity optional initial slot count, rounded up to a power
+ * of two
+ * @param hash_fn hashing function, defaults to cu_Hash_Wy64() when none
  * @param equals_fn equality predicate, defaults to bytewise compare
  * @param state randomization source used to seed hashes and mitigate collision
  * attacks
@@ -71,14 +98,81 @@ cu_HashMap_Result cu_HashMap_create(cu_Allocator allocator,
 void cu_HashMap_destroy(cu_HashMap *map);
 
 /**
- * @brief Insert a new key-value pair.
+ * @brief Spread growth over later updates instead of rehashing at once.
+ *
+ * When the table grows, every insert and remove first empties a bounded
+ * chunk of the new control bytes until all are set, so growth never clears
+ * the whole array at once. The previous table is then kept and every update
+ * migrates @p step of its slots, while lookups consult both tables.
+ * This bounds the worst case insertion latency at the cost of some
+ * throughput. Steps below 2 are raised to 2 so a migration always ends
+ * before the new table fills; 0 disables the mode and finishes any
+ * migration in progress.
+ *
+ * The smallest step gives the lowest tail latency. The pages of the new
+ * table are first touched while entries migrate into it, so a short
+ * migration window puts page faults into more of the inserts inside it.
+ * Larger steps end the migration sooner but raise the tail. Backing the
+ * map with huge pages, for example through a page allocator configured
+ * with `hugePages`, removes most of those faults.
+ */
+void cu_HashMap_set_incremental_rehash(cu_HashMap *map, size_t step);
+
+/**
+ * @brief Hash keys with @p hash_fn, which receives the seed of the map.
+ *
+ * A custom hash is otherwise salted only after it ran, so keys that collide
+ * without a seed keep colliding. The map must still be empty.
+ */
+cu_HashMap_Error_Optional cu_HashMap_set_seeded_hash(
+    cu_HashMap *map, cu_HashMap_SeededHashFn hash_fn);
+
+/**
+ * @brief Insert a key-value pair, overwriting the value of an existing key.
+ *
+ * Both are copied into the table.
  */
 cu_HashMap_Error_Optional cu_HashMap_insert(
     cu_HashMap *map, void *key, void *value);
+/**
+ * @brief Insert @p count pairs from two packed arrays.
+ *
+ * The table is reserved for all of them up front and keys are hashed and
+ * prefetched in batches, which pays off once the table outgrows the cache.
+ *
+ * @param keys @p count keys laid out back to back
+ * @param values @p count values laid out back to back
+ */
+cu_HashMap_Error_Optional cu_HashMap_insert_many(
+    cu_HashMap *map, const void *keys, const void *values, size_t count);
+/**
+ * @brief Grow the table so @p count elements fit without rehashing.
+ */
+cu_HashMap_Error_Optional cu_HashMap_reserve(cu_HashMap *map, size_t count);
+/**
+ * @brief Remove @p key from the map.
+ *
+ * Entries following it in the probe sequence are shifted back into the hole,
+ * so no tombstones are left behind and churn does not lengthen lookups.
+ *
+ * @param out_value receives the removed value when not NULL
+ * @return CU_HASHMAP_ERROR_NOT_FOUND when the key is absent
+ */
+cu_HashMap_Error_Optional cu_HashMap_remove(
+    cu_HashMap *map, const void *key, void *out_value);
 /**
  * @brief Retrieve the value stored for @p key.
  */
 Ptr_Optional cu_HashMap_get(const cu_HashMap *map, const void *key);
+/**
+ * @brief Look up @p count packed keys at once.
+ *
+ * Stores a pointer to each value, or NULL for missing keys, in @p values.
+ *
+ * @return number of keys found
+ */
+size_t cu_HashMap_get_many(
+    const cu_HashMap *map, const void *keys, size_t count, void **values);
 /**
  * @brief Iterate over all stored pairs.
  */
@@ -0,0 +1,58 @@
+#pragma once
+
+/** @file hashset.h Hash set built on the hashmap slot layout. */
+
+#include "collection/hashmap.h"
+#include "macro.h"
+#include "memory/allocator.h"
+#include "object/optional.h"
+#include "object/result.h"
+#include "state.h"
+#include "utility.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Set of fixed size keys.
+ *
+ * A ::cu_HashMap with zero sized values, so slots hold only a control byte
+ * and the key.
+ */
+typedef struct {
+  cu_HashMap map; /**< underlying map without value storage */
+} cu_HashSet;
+
+CU_RESULT_DECL(cu_HashSet, cu_HashSet, cu_HashMap_Error)
+
+/**
+ * @brief Create a new hash set.
+ *
+ * @param allocator allocator used for storage
+ * @param key_layout layout describing the key type
+ * @param initial_capacity optional initial slot count
+ * @param hash_fn hashing function, defaults to cu_Hash_Wy64() when none
+ * @param equals_fn equality predicate, defaults to bytewise compare
+ * @param state randomization source used to seed hashes
+ */
+cu_HashSet_Result cu_HashSet_create(cu_Allocator allocator,
+    cu_Layout key_layout, Size_Optional initial_capacity,
+    cu_HashMap_HashFn_Optional hash_fn, cu_HashMap_EqualsFn_Optional equals_fn,
+    cu_State state);
+/** Release resources held by @p set. */
+void cu_HashSet_destroy(cu_HashSet *set);
+
+/** @brief Add @p key, doing nothing when it is already present. */
+cu_HashMap_Error_Optional cu_HashSet_insert(cu_HashSet *set, const void *key);
+/** @brief Check whether @p key is present. */
+bool cu_HashSet_contains(const cu_HashSet *set, const void *key);
+/**
+ * @brief Remove @p key.
+ * @return CU_HASHMAP_ERROR_NOT_FOUND when the key is absent
+ */
+cu_HashMap_Error_Optional cu_HashSet_remove(cu_HashSet *set, const void *key);
+/** @brief Number of keys in @p set. */
+static inline size_t cu_HashSet_length(const cu_HashSet *set) {
+  return set->map.length;
+}
+/** @brief Iterate over all keys. */
+bool cu_HashSet_iter(const cu_HashSet *set, size_t *index, void **key);
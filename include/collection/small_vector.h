@@ -0,0 +1,301 @@
+#pragma once
+
+/** @file small_vector.h Vector storing its first elements inline. */
+
+#include "collection/vector.h"
+#include "macro.h"
+#include "memory/allocator.h"
+#include "object/destructor.h"
+#include "object/optional.h"
+#include "object/result.h"
+#include "utility.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @cond INTERNAL */
+/**
+ * Bookkeeping shared by every small vector type.
+ *
+ * The inline elements follow the header in the declared struct. While they
+ * are in use @ref heap is NULL, so the struct holds no pointer into itself
+ * and can be copied or returned by value.
+ */
+typedef struct {
+  unsigned char *heap;               /**< spilled storage, NULL while inline */
+  size_t length;                     /**< number of valid elements */
+  size_t capacity;                   /**< element capacity */
+  cu_Layout layout;                  /**< layout of each element */
+  cu_Allocator allocator;            /**< allocator used once spilled */
+  cu_Destructor_Optional destructor; /**< optional element destructor */
+} cu_SmallVector_Header;
+
+/* Type erased operations behind the functions of CU_SMALLVECTOR_IMPL, each
+ * taking the inline storage and its capacity next to the header. */
+void cu_SmallVector_init(cu_SmallVector_Header *header, size_t inline_cap,
+    cu_Layout layout, cu_Allocator allocator,
+    cu_Destructor_Optional destructor);
+cu_Vector_Error_Optional cu_SmallVector_set_capacity(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap,
+    size_t capacity);
+cu_Vector_Error_Optional cu_SmallVector_resize(cu_SmallVector_Header *header,
+    void *inline_data, size_t inline_cap, size_t size);
+void cu_SmallVector_destroy(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap);
+cu_Vector_Error_Optional cu_SmallVector_push_back(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap,
+    const void *elem);
+cu_Vector_Error_Optional cu_SmallVector_pop_back(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap,
+    void *out_elem);
+cu_Vector_Error_Optional cu_SmallVector_push_front(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap,
+    const void *elem);
+cu_Vector_Error_Optional cu_SmallVector_pop_front(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap,
+    void *out_elem);
+cu_Vector_Error_Optional cu_SmallVector_copy(cu_SmallVector_Header *dst,
+    void *dst_inline, const cu_SmallVector_Header *src,
+    const void *src_inline, size_t inline_cap);
+void cu_SmallVector_clear(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap);
+
+static inline unsigned char *cu_SmallVector_ptr(
+    const cu_SmallVector_Header *header, const void *inline_data) {
+  return header->heap ? header->heap : (unsigned char *)inline_data;
+}
+/** @endcond */
+
+/** Declare the helper functions for a small vector type. */
+#define CU_SMALLVECTOR_HEADER(NAME, T)                                         \
+  CU_RESULT_DECL(NAME##_SmallVector, NAME##_SmallVector, cu_Vector_Error)      \
+  NAME##_SmallVector_Result NAME##_SmallVector_create(cu_Allocator allocator,  \
+      Size_Optional initial_capacity, cu_Destructor_Optional destructor);      \
+  cu_Vector_Error_Optional NAME##_SmallVector_resize(                          \
+      NAME##_SmallVector *vector, size_t size);                                \
+  void NAME##_SmallVector_destroy(NAME##_SmallVector *vector);                 \
+  size_t NAME##_SmallVector_size(const NAME##_SmallVector *vector);            \
+  size_t NAME##_SmallVector_capacity(const NAME##_SmallVector *vector);        \
+  bool NAME##_SmallVector_is_empty(const NAME##_SmallVector *vector);          \
+  bool NAME##_SmallVector_is_inline(const NAME##_SmallVector *vector);         \
+  cu_Slice_Optional NAME##_SmallVector_data(const NAME##_SmallVector *vector); \
+  cu_Vector_Error_Optional NAME##_SmallVector_push_back(                       \
+      NAME##_SmallVector *vector, const T *elem);                              \
+  cu_Vector_Error_Optional NAME##_SmallVector_pop_back(                        \
+      NAME##_SmallVector *vector, T *out_elem);                                \
+  cu_Vector_Error_Optional NAME##_SmallVector_push_front(                      \
+      NAME##_SmallVector *vector, const T *elem);                              \
+  cu_Vector_Error_Optional NAME##_SmallVector_pop_front(                       \
+      NAME##_SmallVector *vector, T *out_elem);                                \
+  NAME##_SmallVector_Result NAME##_SmallVector_copy(                           \
+      const NAME##_SmallVector *src);                                          \
+  cu_Vector_Error_Optional NAME##_SmallVector_reserve(                         \
+      NAME##_SmallVector *vector, size_t capacity);                            \
+  cu_Vector_Error_Optional NAME##_SmallVector_shrink_to_fit(                   \
+      NAME##_SmallVector *vector);                                             \
+  void NAME##_SmallVector_clear(NAME##_SmallVector *vector);                   \
+  Ptr_Optional NAME##_SmallVector_at(                                          \
+      const NAME##_SmallVector *vector, size_t index);                         \
+  bool NAME##_SmallVector_iter(                                                \
+      const NAME##_SmallVector *vector, size_t *index, void **out_elem);       \
+  cu_Slice_Optional NAME##_SmallVector_slice(                                  \
+      const NAME##_SmallVector *vector);                                       \
+  cu_Slice_Optional NAME##_SmallVector_subslice(                               \
+      const NAME##_SmallVector *vector, size_t index, size_t count);
+
+/**
+ * @brief Declare a vector of @p T keeping up to @p N elements inline.
+ *
+ * The functions mirror ::cu_Vector and report ::cu_Vector_Error, with the
+ * element layout fixed to @p T. Nothing is allocated until the vector grows
+ * past @p N elements, and it moves back inline once it shrinks to @p N.
+ */
+#define CU_SMALLVECTOR_DECL(NAME, T, N)                                        \
+  typedef struct {                                                             \
+    cu_SmallVector_Header header; /**< shared bookkeeping */                   \
+    T items[N];                   /**< inline storage */                       \
+  } NAME##_SmallVector;                                                        \
+  CU_SMALLVECTOR_HEADER(NAME, T)
+
+/** Implement the helpers declared by \ref CU_SMALLVECTOR_DECL. */
+#define CU_SMALLVECTOR_IMPL(NAME, T, N)                                        \
+  CU_RESULT_IMPL(NAME##_SmallVector, NAME##_SmallVector, cu_Vector_Error)      \
+                                                                               \
+  NAME##_SmallVector_Result NAME##_SmallVector_create(cu_Allocator allocator,  \
+      Size_Optional initial_capacity, cu_Destructor_Optional destructor) {     \
+    NAME##_SmallVector vector;                                                 \
+    cu_SmallVector_init(                                                       \
+        &vector.header, N, CU_LAYOUT(T), allocator, destructor);               \
+    if (Size_Optional_is_some(&initial_capacity) &&                            \
+        Size_Optional_unwrap(&initial_capacity) > (N)) {                       \
+      cu_Vector_Error_Optional err = cu_SmallVector_set_capacity(              \
+          &vector.header, vector.items, N,                                     \
+          Size_Optional_unwrap(&initial_capacity));                            \
+      if (cu_Vector_Error_Optional_is_some(&err)) {                            \
+        return NAME##_SmallVector_Result_error(                                \
+            cu_Vector_Error_Optional_unwrap(&err));                            \
+      }                                                                        \
+    }                                                                          \
+    return NAME##_SmallVector_Result_ok(vector);                               \
+  }                                                                            \
+                                                                               \
+  cu_Vector_Error_Optional NAME##_SmallVector_resize(                          \
+      NAME##_SmallVector *vector, size_t size) {                               \
+    CU_IF_NULL(vector) {                                                       \
+      return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_INVALID);           \
+    }                                                                          \
+    return cu_SmallVector_resize(&vector->header, vector->items, N, size);     \
+  }                                                                            \
+                                                                               \
+  void NAME##_SmallVector_destroy(NAME##_SmallVector *vector) {                \
+    CU_IF_NULL(vector) { return; }                                             \
+    cu_SmallVector_destroy(&vector->header, vector->items, N);                 \
+  }                                                                            \
+                                                                               \
+  size_t NAME##_SmallVector_size(const NAME##_SmallVector *vector) {           \
+    CU_IF_NULL(vector) { return 0; }                                           \
+    return vector->header.length;                                              \
+  }                                                                            \
+                                                                               \
+  size_t NAME##_SmallVector_capacity(const NAME##_SmallVector *vector) {       \
+    CU_IF_NULL(vector) { return 0; }                                           \
+    return vector->header.capacity;                                            \
+  }                                                                            \
+                                                                               \
+  bool NAME##_SmallVector_is_empty(const NAME##_SmallVector *vector) {         \
+    CU_IF_NULL(vector) { return true; }                                        \
+    return vector->header.length == 0;                                         \
+  }                                                                            \
+                                                                               \
+  bool NAME##_SmallVector_is_inline(const NAME##_SmallVector *vector) {        \
+    CU_IF_NULL(vector) { return false; }                                       \
+    return vector->header.heap == NULL;                                        \
+  }                                                                            \
+                                                                               \
+  cu_Slice_Optional NAME##_SmallVector_data(                                   \
+      const NAME##_SmallVector *vector) {                                      \
+    CU_IF_NULL(vector) { return cu_Slice_Optional_none(); }                    \
+    return cu_Slice_Optional_some(                                             \
+        cu_Slice_create(cu_SmallVector_ptr(&vector->header, vector->items),    \
+            vector->header.capacity * sizeof(T)));                             \
+  }                                                                            \
+                                                                               \
+  cu_Vector_Error_Optional NAME##_SmallVector_push_back(                       \
+      NAME##_SmallVector *vector, const T *elem) {                             \
+    CU_IF_NULL(vector) {                                                       \
+      return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_INVALID);           \
+    }                                                                          \
+    return cu_SmallVector_push_back(&vector->header, vector->items, N, elem);  \
+  }                                                                            \
+                                                                               \
+  cu_Vector_Error_Optional NAME##_SmallVector_pop_back(                        \
+      NAME##_SmallVector *vector, T *out_elem) {                               \
+    CU_IF_NULL(vector) {                                                       \
+      return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_INVALID);           \
+    }                                                                          \
+    return cu_SmallVector_pop_back(                                            \
+        &vector->header, vector->items, N, out_elem);                          \
+  }                                                                            \
+                                                                               \
+  cu_Vector_Error_Optional NAME##_SmallVector_push_front(                      \
+      NAME##_SmallVector *vector, const T *elem) {                             \
+    CU_IF_NULL(vector) {                                                       \
+      return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_INVALID);           \
+    }                                                                          \
+    return cu_SmallVector_push_front(&vector->header, vector->items, N, elem); \
+  }                                                                            \
+                                                                               \
+  cu_Vector_Error_Optional NAME##_SmallVector_pop_front(                       \
+      NAME##_SmallVector *vector, T *out_elem) {                               \
+    CU_IF_NULL(vector) {                                                       \
+      return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_INVALID);           \
+    }                                                                          \
+    return cu_SmallVector_pop_front(                                           \
+        &vector->header, vector->items, N, out_elem);                          \
+  }                                                                            \
+                                                                               \
+  NAME##_SmallVector_Result NAME##_SmallVector_copy(                           \
+      const NAME##_SmallVector *src) {                                         \
+    CU_IF_NULL(src) {                                                          \
+      return NAME##_SmallVector_Result_error(CU_VECTOR_ERROR_INVALID);         \
+    }                                                                          \
+    NAME##_SmallVector vector;                                                 \
+    cu_Vector_Error_Optional err = cu_SmallVector_copy(                        \
+        &vector.header, vector.items, &src->header, src->items, N);            \
+    if (cu_Vector_Error_Optional_is_some(&err)) {                              \
+      return NAME##_SmallVector_Result_error(                                  \
+          cu_Vector_Error_Optional_unwrap(&err));                              \
+    }                                                                          \
+    return NAME##_SmallVector_Result_ok(vector);                               \
+  }                                                                            \
+                                                                               \
+  cu_Vector_Error_Optional NAME##_SmallVector_reserve(                         \
+      NAME##_SmallVector *vector, size_t capacity) {                           \
+    CU_IF_NULL(vector) {                                                       \
+      return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_INVALID);           \
+    }                                                                          \
+    if (capacity <= vector->header.capacity) {                                 \
+      return cu_Vector_Error_Optional_none();                                  \
+    }                                                                          \
+    return cu_SmallVector_set_capacity(                                        \
+        &vector->header, vector->items, N, capacity);                          \
+  }                                                                            \
+                                                                               \
+  cu_Vector_Error_Optional NAME##_SmallVector_shrink_to_fit(                   \
+      NAME##_SmallVector *vector) {                                            \
+    CU_IF_NULL(vector) {                                                       \
+      return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_INVALID);           \
+    }                                                                          \
+    return cu_SmallVector_set_capacity(                                        \
+        &vector->header, vector->items, N, vector->header.length);             \
+  }                                                                            \
+                                                                               \
+  void NAME##_SmallVector_clear(NAME##_SmallVector *vector) {                  \
+    CU_IF_NULL(vector) { return; }                                             \
+    cu_SmallVector_clear(&vector->header, vector->items, N);                   \
+  }                                                                            \
+                                                                               \
+  Ptr_Optional NAME##_SmallVector_at(                                          \
+      const NAME##_SmallVector *vector, size_t index) {                        \
+    CU_IF_NULL(vector) { return Ptr_Optional_none(); }                         \
+    if (index >= vector->header.length) {                                      \
+      return Ptr_Optional_none();                                              \
+    }                                                                          \
+    return Ptr_Optional_some(                                                  \
+        cu_SmallVector_ptr(&vector->header, vector->items) +                   \
+        index * sizeof(T));                                                    \
+  }                                                                            \
+                                                                               \
+  bool NAME##_SmallVector_iter(                                                \
+      const NAME##_SmallVector *vector, size_t *index, void **out_elem) {      \
+    CU_IF_NULL(vector) { return false; }                                       \
+    CU_IF_NULL(index) { return false; }                                        \
+    CU_IF_NULL(out_elem) { return false; }                                     \
+    if (*index >= vector->header.length) {                                     \
+      return false;                                                            \
+    }                                                                          \
+    *out_elem = cu_SmallVector_ptr(&vector->header, vector->items) +           \
+                (*index) * sizeof(T);                                          \
+    (*index)++;                                                                \
+    return true;                                                               \
+  }                                                                            \
+                                                                               \
+  cu_Slice_Optional NAME##_SmallVector_slice(                                  \
+      const NAME##_SmallVector *vector) {                                      \
+    CU_IF_NULL(vector) { return cu_Slice_Optional_none(); }                    \
+    return cu_Slice_Optional_some(                                             \
+        cu_Slice_create(cu_SmallVector_ptr(&vector->header, vector->items),    \
+            vector->header.length * sizeof(T)));                               \
+  }                                                                            \
+                                                                               \
+  cu_Slice_Optional NAME##_SmallVector_subslice(                               \
+      const NAME##_SmallVector *vector, size_t index, size_t count) {          \
+    CU_IF_NULL(vector) { return cu_Slice_Optional_none(); }                    \
+    if (index > vector->header.length) {                                       \
+      return cu_Slice_Optional_none();                                         \
+    }                                                                          \
+    count = CU_MIN(count, vector->header.length - index);                      \
+    return cu_Slice_Optional_some(cu_Slice_create(                             \
+        cu_SmallVector_ptr(&vector->header, vector->items) +                   \
+            index * sizeof(T),                                                 \
+        count * sizeof(T)));                                                   \
+  }
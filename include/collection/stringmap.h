@@ -0,0 +1,90 @@
+#pragma once
+
+/** @file stringmap.h Hashmap keyed by byte strings. */
+
+#include "collection/hashmap.h"
+#include "macro.h"
+#include "memory/allocator.h"
+#include "nostd.h"
+#include "object/optional.h"
+#include "object/result.h"
+#include "state.h"
+#include "utility.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/** keys up to this many bytes are stored inline in the slot */
+#define CU_STRINGMAP_INLINE 16
+/** size of the chunks holding longer keys */
+#define CU_STRINGMAP_CHUNK_SIZE 4096
+
+/** @cond INTERNAL */
+/** Key as stored in a slot. */
+typedef struct {
+  union {
+    unsigned char bytes[CU_STRINGMAP_INLINE]; /**< short keys, zero padded */
+    const unsigned char *ptr;                 /**< long keys, in the arena */
+  } data;
+  size_t length; /**< key length in bytes */
+} cu_StringMap_Key;
+
+/** Chunk of the key arena. */
+struct cu_StringMap_Chunk {
+  struct cu_StringMap_Chunk *next; /**< previously filled chunk */
+  size_t size;                     /**< usable bytes */
+  size_t used;                     /**< bytes handed out */
+  unsigned char data[];            /**< key bytes */
+};
+/** @endcond */
+
+/**
+ * Hashmap from byte strings to fixed size values.
+ *
+ * Keys are hashed and compared as ::cu_Slice values. Short keys are copied
+ * into the slot itself, longer ones into an arena owned by the map, so the
+ * caller's buffer may be reused right after insertion. The arena only
+ * shrinks when the map is destroyed; removing long keys does not return
+ * their bytes.
+ */
+typedef struct {
+  cu_HashMap map;                    /**< slot records mapped to values */
+  struct cu_StringMap_Chunk *chunks; /**< arena holding long keys */
+} cu_StringMap;
+
+CU_RESULT_DECL(cu_StringMap, cu_StringMap, cu_HashMap_Error)
+
+/**
+ * @brief Create a new string keyed map.
+ *
+ * @param allocator allocator used for slots and long keys
+ * @param value_layout layout describing the value type
+ * @param initial_capacity optional initial slot count
+ * @param state randomization source used to seed hashes
+ */
+cu_StringMap_Result cu_StringMap_create(cu_Allocator allocator,
+    cu_Layout value_layout, Size_Optional initial_capacity, cu_State state);
+/** Release resources held by @p map, including every key. */
+void cu_StringMap_destroy(cu_StringMap *map);
+
+/** @brief Insert a key-value pair, overwriting the value of an existing key. */
+cu_HashMap_Error_Optional cu_StringMap_insert(
+    cu_StringMap *map, cu_Slice key, const void *value);
+/** @brief Retrieve the value stored for @p key. */
+Ptr_Optional cu_StringMap_get(const cu_StringMap *map, cu_Slice key);
+/**
+ * @brief Remove @p key, copying its value to @p out_value when not NULL.
+ * @return CU_HASHMAP_ERROR_NOT_FOUND when the key is absent
+ */
+cu_HashMap_Error_Optional cu_StringMap_remove(
+    cu_StringMap *map, cu_Slice key, void *out_value);
+/** @brief Number of keys in @p map. */
+static inline size_t cu_StringMap_length(const cu_StringMap *map) {
+  return map->map.length;
+}
+/**
+ * @brief Iterate over all stored pairs.
+ *
+ * Short keys point into the table and share the lifetime of value pointers.
+ */
+bool cu_StringMap_iter(
+    const cu_StringMap *map, size_t *index, cu_Slice *key, void **value);
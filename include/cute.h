@@ -13,15 +13,25 @@ extern "C" {
 #include "memory/fixedallocator.h"
 #include "memory/gpallocator.h"
 #include "memory/page.h"
+#include "memory/poolallocator.h"
 #include "memory/slab.h"
+#include "memory/statsallocator.h"
+#include "memory/threadcacheallocator.h"
 
 #include "collection/bitmap.h"
 #include "collection/bitset.h"
+#include "collection/concurrent_hashmap.h"
+#include "collection/deque.h"
 #include "collection/dlist.h"
+#include "collection/frozenmap.h"
+#include "collection/hashfile.h"
 #include "collection/hashmap.h"
+#include "collection/hashset.h"
 #include "collection/list.h"
 #include "collection/ring_buffer.h"
 #include "collection/skip_list.h"
+#include "collection/small_vector.h"
+#include "collection/stringmap.h"
 #include "collection/vector.h"
 
 #include "hash/hash.h"
@@ -37,6 +47,7 @@ extern "C" {
 #include "io/fdfile.h"
 #include "io/file.h"
 #include "io/fstream.h"
+#include "io/hashstream.h"
 #include "io/memstream.h"
 #include "io/stream.h"
 #include "utility.h"
@@ -2,6 +2,8 @@
 
 /** @file hash.h Hashing utilities. */
 
+#include <nostd.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -35,6 +37,12 @@
 /** \brief SipHash initial v3 constant. */
 #define CU_SIPHASH_V3_INIT 0x7465646279746573ull
 
+/** \brief 128-bit hash value. */
+typedef struct {
+  uint64_t low;  /**< low 64 bits */
+  uint64_t high; /**< high 64 bits */
+} cu_Hash128;
+
 /**
  * \brief Compute a 32-bit FNV-1a hash.
  *
@@ -50,3 +58,170 @@ uint32_t cu_Hash_Murmur3_32(const void *data, size_t len, uint32_t seed);
 
 /**\brief Compute SipHash-2-4. */
 uint64_t cu_Hash_SipHash24(const uint8_t key[16], const void *data, size_t len);
+
+/**
+ * \brief Compute a seeded 64-bit hash in the wyhash family.
+ *
+ * Keys up to 16 bytes are read with at most four loads and longer inputs are
+ * consumed 48 bytes per iteration in three independent multiply lanes. This
+ * is the default hash of ::cu_HashMap.
+ *
+ * \param data input bytes
+ * \param len number of bytes
+ * \param seed value selecting one member of the family
+ */
+uint64_t cu_Hash_Wy64(const void *data, size_t len, uint64_t seed);
+
+/**
+ * \brief Compute a seeded 128-bit hash.
+ *
+ * The low half equals cu_Hash_Wy64() and the high half is an independent
+ * pass with different secrets, for fingerprints where 64 bits are too few.
+ */
+cu_Hash128 cu_Hash_Wy128(const void *data, size_t len, uint64_t seed);
+
+/**
+ * \brief Compute the CRC-32C (Castagnoli) checksum of a buffer.
+ *
+ * Uses the SSE4.2 crc32 instruction over three interleaved lanes when the CPU
+ * supports it and slicing by 8 tables otherwise.
+ */
+uint32_t cu_Hash_CRC32C(const void *data, size_t len);
+
+/**
+ * \brief Extend @p crc, the checksum of earlier bytes, with @p data.
+ *
+ * Starting from 0 gives the checksum of the concatenated input.
+ */
+uint32_t cu_Hash_CRC32C_update(uint32_t crc, const void *data, size_t len);
+
+/**
+ * \brief cu_Hash_CRC32C_update() using the slicing by 8 tables on every CPU.
+ *
+ * Gives the same result as the hardware path, which makes it a reference to
+ * check that path against.
+ */
+uint32_t cu_Hash_CRC32C_update_portable(
+    uint32_t crc, const void *data, size_t len);
+
+/**
+ * \brief Checksum of two concatenated buffers from their checksums.
+ *
+ * \param crc1 checksum of the first buffer
+ * \param crc2 checksum of the second buffer
+ * \param len2 length of the second buffer
+ */
+uint32_t cu_Hash_CRC32C_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
+/** \brief Incremental Murmur3 32-bit state. */
+typedef struct {
+  uint32_t h1;         /**< running hash */
+  uint8_t tail[4];     /**< bytes not yet forming a block */
+  size_t tailLength;   /**< valid bytes in tail */
+  size_t length;       /**< bytes consumed so far */
+} cu_Hash_Murmur3_32_State;
+
+/** \brief Start an incremental Murmur3 32-bit hash. */
+void cu_Hash_Murmur3_32_init(cu_Hash_Murmur3_32_State *state, uint32_t seed);
+/** \brief Feed @p data into the hash. */
+void cu_Hash_Murmur3_32_update(cu_Hash_Murmur3_32_State *state, cu_Slice data);
+/** \brief Result equal to cu_Hash_Murmur3_32() over all fed bytes. */
+uint32_t cu_Hash_Murmur3_32_final(const cu_Hash_Murmur3_32_State *state);
+
+/** \brief Incremental SipHash-2-4 state. */
+typedef struct {
+  uint64_t v[4];       /**< compression state */
+  uint8_t tail[8];     /**< bytes not yet forming a word */
+  size_t tailLength;   /**< valid bytes in tail */
+  size_t length;       /**< bytes consumed so far */
+} cu_Hash_SipHash24_State;
+
+/** \brief Start an incremental SipHash-2-4 with @p key. */
+void cu_Hash_SipHash24_init(
+    cu_Hash_SipHash24_State *state, const uint8_t key[16]);
+/** \brief Feed @p data into the hash. */
+void cu_Hash_SipHash24_update(cu_Hash_SipHash24_State *state, cu_Slice data);
+/** \brief Result equal to cu_Hash_SipHash24() over all fed bytes. */
+uint64_t cu_Hash_SipHash24_final(const cu_Hash_SipHash24_State *state);
+
+/** \brief Bytes of history and pending input kept by the wyhash state. */
+#define CU_HASH_WY_BUFFER 64
+
+/**
+ * \brief Incremental state of cu_Hash_Wy64().
+ *
+ * Input is consumed in 48 byte blocks. The last 16 consumed bytes are kept in
+ * front of the pending bytes because the final step may read them again.
+ */
+typedef struct {
+  uint64_t lanes[3];                  /**< block lanes */
+  uint64_t seed;                      /**< mixed seed */
+  const uint64_t *secret;             /**< secrets of this member */
+  uint8_t buffer[CU_HASH_WY_BUFFER];  /**< 16 history then pending bytes */
+  size_t pending;                     /**< pending bytes after the history */
+  size_t length;                      /**< bytes consumed so far */
+} cu_Hash_Wy64_State;
+
+/** \brief Start an incremental cu_Hash_Wy64(). */
+void cu_Hash_Wy64_init(cu_Hash_Wy64_State *state, uint64_t seed);
+/** \brief Feed @p data into the hash. */
+void cu_Hash_Wy64_update(cu_Hash_Wy64_State *state, cu_Slice data);
+/** \brief Result equal to cu_Hash_Wy64() over all fed bytes. */
+uint64_t cu_Hash_Wy64_final(const cu_Hash_Wy64_State *state);
+
+/** \brief Incremental state of cu_Hash_Wy128(). */
+typedef struct {
+  cu_Hash_Wy64_State low;  /**< pass producing the low half */
+  cu_Hash_Wy64_State high; /**< pass producing the high half */
+} cu_Hash_Wy128_State;
+
+/** \brief Start an incremental cu_Hash_Wy128(). */
+void cu_Hash_Wy128_init(cu_Hash_Wy128_State *state, uint64_t seed);
+/** \brief Feed @p data into the hash. */
+void cu_Hash_Wy128_update(cu_Hash_Wy128_State *state, cu_Slice data);
+/** \brief Result equal to cu_Hash_Wy128() over all fed bytes. */
+cu_Hash128 cu_Hash_Wy128_final(const cu_Hash_Wy128_State *state);
+
+/** \brief Algorithms available through ::cu_Hasher. */
+typedef enum {
+  CU_HASHER_MURMUR3_32,
+  CU_HASHER_SIPHASH24,
+  CU_HASHER_WY64,
+  CU_HASHER_WY128,
+  CU_HASHER_CRC32C,
+} cu_Hasher_Kind;
+
+/**
+ * \brief Incremental hasher over any supported algorithm.
+ *
+ * Lets code that moves bytes around, such as stream adapters, hash them
+ * without knowing the algorithm.
+ */
+typedef struct {
+  cu_Hasher_Kind kind; /**< selected algorithm */
+  union {
+    cu_Hash_Murmur3_32_State murmur3;
+    cu_Hash_SipHash24_State siphash;
+    cu_Hash_Wy64_State wy64;
+    cu_Hash_Wy128_State wy128;
+    uint32_t crc32c;
+  } state; /**< state of the selected algorithm */
+} cu_Hasher;
+
+/** \brief Hasher computing cu_Hash_Murmur3_32(). */
+cu_Hasher cu_Hasher_Murmur3_32(uint32_t seed);
+/** \brief Hasher computing cu_Hash_SipHash24(). */
+cu_Hasher cu_Hasher_SipHash24(const uint8_t key[16]);
+/** \brief Hasher computing cu_Hash_Wy64(). */
+cu_Hasher cu_Hasher_Wy64(uint64_t seed);
+/** \brief Hasher computing cu_Hash_Wy128(). */
+cu_Hasher cu_Hasher_Wy128(uint64_t seed);
+/** \brief Hasher computing cu_Hash_CRC32C(). */
+cu_Hasher cu_Hasher_CRC32C(void);
+/** \brief Feed @p data into the hasher. */
+void cu_Hasher_update(cu_Hasher *hasher, cu_Slice data);
+/**
+ * \brief Current digest. Results narrower than 128 bits are returned in the
+ * low half with the high half zero.
+ */
+cu_Hash128 cu_Hasher_final(const cu_Hasher *hasher);
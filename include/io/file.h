@@ -70,4 +70,14 @@ cu_Io_Error_Optional cu_File_write(cu_File *file, cu_Slice data);
 cu_Io_Error_Optional cu_File_seek(cu_File *file, cu_File_SeekTo seek_to);
 cu_IoSize_Result cu_File_tell(cu_File *file);
 
+/**
+ * @brief Map the whole file read only.
+ *
+ * The mapping is shared with the page cache and outlives the file handle,
+ * release it with cu_File_unmap(). Empty files cannot be mapped.
+ */
+cu_IoSlice_Result cu_File_map(cu_File *file);
+/** @brief Release a mapping returned by cu_File_map(). */
+void cu_File_unmap(cu_Slice mapping);
+
 #endif // CU_FREESTANDING
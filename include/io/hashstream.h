@@ -0,0 +1,42 @@
+#pragma once
+#include "hash/hash.h"
+#include "io/error.h"
+#include "io/stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @file hashstream.h Stream adapter hashing the bytes passing through. */
+
+#ifndef CU_FREESTANDING
+
+/**
+ * Wraps another stream and feeds every byte read from or written to it into
+ * a hasher. A failed read still hashes the prefix the inner stream consumed,
+ * measured with cu_Stream_tell(), so a short read at the end of the input
+ * keeps the digest complete. Failed writes are not hashed, and seeking does
+ * not rewind the hash. Once the inner stream fails to tell its position it
+ * is not asked again, and failed reads are then not hashed either.
+ */
+typedef struct {
+  cu_Stream inner;        /**< wrapped stream */
+  cu_Hasher hasher;       /**< state fed with the transferred bytes */
+  Size_Optional position; /**< inner stream position, when known */
+  bool untellable;        /**< inner stream failed to tell its position */
+} cu_HashStream;
+
+/** Create an adapter over @p inner using @p hasher. */
+cu_HashStream cu_HashStream_create(cu_Stream inner, cu_Hasher hasher);
+
+/** Stream interface of @p hs, which must outlive the returned value. */
+cu_Stream cu_HashStream_stream(cu_HashStream *hs);
+
+/** Digest of every byte transferred so far. */
+cu_Hash128 cu_HashStream_digest(const cu_HashStream *hs);
+
+#endif // CU_FREESTANDING
+
+#ifdef __cplusplus
+}
+#endif
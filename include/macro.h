@@ -103,6 +103,13 @@
 #undef noreturn
 #endif
 
+/** Storage class for per-thread variables. */
+#if CU_COMPILER_MSVC
+#define CU_THREAD_LOCAL __declspec(thread)
+#else
+#define CU_THREAD_LOCAL _Thread_local
+#endif
+
 #define UNREACHABLE(msg) cu_panic_handler("Unreachable code reached: %s", msg)
 
 #define TODO(msg) cu_panic_handler("TODO: %s", msg)
@@ -19,6 +19,12 @@ typedef cu_IoSlice_Result (*cu_Allocator_ShrinkFunc)(
     void *self, cu_Slice old_mem, cu_Layout new_layout);
 /** Free function signature. */
 typedef void (*cu_Allocator_FreeFunc)(void *self, cu_Slice mem);
+/** Batch allocation function signature, see ::cu_Allocator_AllocBatch. */
+typedef cu_Io_Error_Optional (*cu_Allocator_AllocBatchFunc)(
+    void *self, cu_Layout layout, cu_Slice *out, size_t count);
+/** Batch free function signature, see ::cu_Allocator_FreeBatch. */
+typedef void (*cu_Allocator_FreeBatchFunc)(
+    void *self, const cu_Slice *mems, size_t count);
 
 /** Generic allocator with user-provided callbacks. */
 typedef struct {
@@ -27,6 +33,8 @@ typedef struct {
   cu_Allocator_GrowFunc growFn;      /**< grow previously allocated memory */
   cu_Allocator_ShrinkFunc shrinkFn;  /**< shrink previously allocated memory */
   cu_Allocator_FreeFunc freeFn;     /**< free memory */
+  cu_Allocator_AllocBatchFunc allocBatchFn; /**< optional, may be NULL */
+  cu_Allocator_FreeBatchFunc freeBatchFn;   /**< optional, may be NULL */
 } cu_Allocator;
 CU_OPTIONAL_DECL(cu_Allocator, cu_Allocator)
 
@@ -53,6 +61,78 @@ static inline void cu_Allocator_Free(cu_Allocator allocator, cu_Slice mem) {
   allocator.freeFn(allocator.self, mem);
 }
 
+/**
+ * Allocate @p count objects of the same layout into @p out.
+ *
+ * Either every object is allocated or none is. Allocators without a batch
+ * entry point are served one object at a time.
+ */
+static inline cu_Io_Error_Optional cu_Allocator_AllocBatch(
+    cu_Allocator allocator, cu_Layout layout, cu_Slice *out, size_t count) {
+  if (allocator.allocBatchFn) {
+    return allocator.allocBatchFn(allocator.self, layout, out, count);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    cu_IoSlice_Result res = allocator.allocFn(allocator.self, layout);
+    if (!cu_IoSlice_Result_is_ok(&res)) {
+      while (i > 0) {
+        allocator.freeFn(allocator.self, out[--i]);
+      }
+      return cu_Io_Error_Optional_some(res.error);
+    }
+    out[i] = res.value;
+  }
+  return cu_Io_Error_Optional_none();
+}
+
+/** Free @p count blocks obtained from this allocator. */
+static inline void cu_Allocator_FreeBatch(
+    cu_Allocator allocator, const cu_Slice *mems, size_t count) {
+  if (allocator.freeBatchFn) {
+    allocator.freeBatchFn(allocator.self, mems, count);
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    allocator.freeFn(allocator.self, mems[i]);
+  }
+}
+
+#define CU_ALLOCATOR_FREE_BUFFER_SIZE 64 /**< frees collected per batch */
+
+/** Collects frees so they reach the allocator in batches. */
+typedef struct {
+  cu_Allocator allocator;                       /**< allocator to free into */
+  size_t count;                                 /**< pending blocks */
+  cu_Slice mems[CU_ALLOCATOR_FREE_BUFFER_SIZE]; /**< pending blocks */
+} cu_Allocator_FreeBuffer;
+
+/** Create an empty free buffer for @p allocator. */
+static inline cu_Allocator_FreeBuffer cu_Allocator_FreeBuffer_create(
+    cu_Allocator allocator) {
+  cu_Allocator_FreeBuffer buffer;
+  buffer.allocator = allocator;
+  buffer.count = 0;
+  return buffer;
+}
+
+/** Free every pending block. */
+static inline void cu_Allocator_FreeBuffer_flush(
+    cu_Allocator_FreeBuffer *buffer) {
+  if (buffer->count > 0) {
+    cu_Allocator_FreeBatch(buffer->allocator, buffer->mems, buffer->count);
+    buffer->count = 0;
+  }
+}
+
+/** Queue @p mem for freeing, flushing when the buffer is full. */
+static inline void cu_Allocator_FreeBuffer_push(
+    cu_Allocator_FreeBuffer *buffer, cu_Slice mem) {
+  buffer->mems[buffer->count++] = mem;
+  if (buffer->count == CU_ALLOCATOR_FREE_BUFFER_SIZE) {
+    cu_Allocator_FreeBuffer_flush(buffer);
+  }
+}
+
 /** System allocator backed by libc malloc/free. */
 #if !CU_FREESTANDING
 cu_Allocator cu_Allocator_CAllocator(void);
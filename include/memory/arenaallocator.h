@@ -7,11 +7,14 @@
 
 /** default size for new chunks */
 #define CU_ARENA_CHUNK_SIZE 4096
+/** default upper bound for geometric chunk growth */
+#define CU_ARENA_MAX_CHUNK_SIZE (1024 * 1024)
 
 /** @cond INTERNAL */
 /** Metadata for each arena chunk. */
 struct cu_ArenaAllocator_Chunk {
   struct cu_ArenaAllocator_Chunk *prev; /**< previous chunk */
+  struct cu_ArenaAllocator_Chunk *next; /**< next newer or spare chunk */
   size_t size;                          /**< number of usable bytes */
   size_t used;                          /**< used bytes */
   unsigned char data[];                 /**< flexible array for storage */
@@ -28,15 +31,26 @@ struct cu_ArenaAllocator_Header {
 typedef struct {
   cu_Allocator backingAllocator;           /**< chunk backing allocator */
   struct cu_ArenaAllocator_Chunk *current; /**< current active chunk */
+  struct cu_ArenaAllocator_Chunk *first;   /**< oldest chunk in use */
+  struct cu_ArenaAllocator_Chunk *spare;   /**< released chunks for reuse */
   size_t chunkSize;                        /**< requested chunk size */
+  size_t nextChunkSize;                    /**< size of the next new chunk */
+  size_t maxChunkSize;                     /**< growth limit for new chunks */
 } cu_ArenaAllocator;
 
 /** Configuration when creating an arena allocator. */
 typedef struct {
   size_t chunkSize;                       /**< desired chunk size */
+  size_t maxChunkSize;                    /**< limit for doubling chunks */
   cu_Allocator_Optional backingAllocator; /**< optional custom allocator */
 } cu_ArenaAllocator_Config;
 
+/** Saved arena position created by ::cu_ArenaAllocator_mark. */
+typedef struct {
+  struct cu_ArenaAllocator_Chunk *chunk; /**< chunk current at the mark */
+  size_t used;                           /**< used bytes of that chunk */
+} cu_ArenaAllocator_Mark;
+
 /**
  * @brief Create an arena allocator using the given configuration.
  * @param arena   Target arena allocator instance.
@@ -46,6 +60,30 @@ typedef struct {
 cu_Allocator cu_Allocator_ArenaAllocator(
     cu_ArenaAllocator *arena, cu_ArenaAllocator_Config config);
 
+/**
+ * @brief Save the current arena position.
+ * @param arena Arena to inspect.
+ * @return Mark that can later be passed to ::cu_ArenaAllocator_rewind.
+ */
+cu_ArenaAllocator_Mark cu_ArenaAllocator_mark(const cu_ArenaAllocator *arena);
+
+/**
+ * @brief Release every allocation made after @p mark.
+ *
+ * Chunks that become unused are kept for reuse instead of being returned to
+ * the backing allocator. Marks taken after @p mark become invalid.
+ * @param arena Arena to rewind.
+ * @param mark  Position previously returned by ::cu_ArenaAllocator_mark.
+ */
+void cu_ArenaAllocator_rewind(
+    cu_ArenaAllocator *arena, cu_ArenaAllocator_Mark mark);
+
+/**
+ * @brief Release all allocations while keeping the chunks for reuse.
+ * @param arena Arena to reset.
+ */
+void cu_ArenaAllocator_reset(cu_ArenaAllocator *arena);
+
 /**
  * @brief Destroy an arena allocator and free all chunks.
  * @param arena Pointer to the arena to destroy.
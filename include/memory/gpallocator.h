@@ -6,10 +6,15 @@
 #include "memory/allocator.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #define CU_GPA_BUCKET_SIZE 4096     /**< default page size for buckets */
 #define CU_GPA_NUM_SMALL_BUCKETS 16 /**< number of size classes */
 #define CU_GPA_CANARY 0x9232a6ff85dff10fULL /**< bucket canary value */
+#define CU_GPA_RETAIN_BUCKETS 2    /**< default empty buckets kept per class */
+#define CU_GPA_DECAY_TICKS 16384   /**< default frees before an empty decays */
+/** spans carved from one backing allocation, one per bit of a word */
+#define CU_GPA_REGION_SPANS (sizeof(size_t) * 8)
 
 /** @cond INTERNAL */
 struct cu_GPAllocator_BucketHeader;
@@ -21,43 +26,103 @@ struct cu_GPAllocator_ObjectPool {
   size_t objectSize;   /**< size of each object */
   size_t slotCount;    /**< total slots */
   size_t usedCount;    /**< number of used slots */
+  size_t freeHint;     /**< every slot below this index is in use */
 };
 
-/** Metadata for a single bucket of small allocations. */
+/**
+ * Backing allocation that bucket spans are carved from.
+ *
+ * Aligning a single span costs up to twice its size in most backing
+ * allocators, so spans are taken ::CU_GPA_REGION_SPANS at a time from one
+ * aligned allocation. The region is freed once none of its spans is used.
+ */
+struct cu_GPAllocator_Region {
+  struct cu_GPAllocator_Region *prev; /**< previous region with free spans */
+  struct cu_GPAllocator_Region *next; /**< next region with free spans */
+  cu_Slice memory;     /**< backing allocation */
+  unsigned char *base; /**< first span, aligned to the span size */
+  size_t freeSpans;    /**< bit i is set while span i is unused */
+};
+
+/**
+ * Metadata for a single bucket of small allocations.
+ *
+ * Every bucket occupies one span of a region, aligned to the span size. The
+ * slots fill the span and the header is allocated separately, so the pages
+ * of a retained bucket can be returned to the system as a whole. Buckets are
+ * linked into their size class while they have free slots and some are in
+ * use. Empty buckets move to the retained list of their class instead.
+ */
 struct cu_GPAllocator_BucketHeader {
-  struct cu_GPAllocator_BucketHeader *prev; /**< previous bucket */
-  struct cu_GPAllocator_BucketHeader *next; /**< next bucket */
+  struct cu_GPAllocator_BucketHeader *prev; /**< previous bucket in its list */
+  struct cu_GPAllocator_BucketHeader *next; /**< next bucket in its list */
   struct cu_GPAllocator_ObjectPool objects; /**< slot storage information */
-  size_t canary;                            /**< header corruption check */
+  struct cu_GPAllocator_Region *region; /**< region holding the span */
+  size_t emptySince; /**< allocator clock when last retained or purged */
+  bool purged;       /**< slot pages were returned to the system */
+  size_t canary;     /**< header corruption check */
 };
 
-/** Metadata for large allocations. */
-struct cu_GPAllocator_LargeAlloc {
-  struct cu_GPAllocator_LargeAlloc *prev; /**< previous entry */
-  struct cu_GPAllocator_LargeAlloc *next; /**< next entry */
-  cu_Slice slice;                         /**< allocated memory slice */
+/** Entry of an address index. */
+struct cu_GPAllocator_IndexEntry {
+  uintptr_t key;  /**< indexed address, zero marks an empty entry */
+  cu_Slice slice; /**< bucket header or large allocation */
+};
+
+/** Open addressing table mapping addresses to their metadata. */
+struct cu_GPAllocator_Index {
+  struct cu_GPAllocator_IndexEntry *entries; /**< entry storage */
+  size_t capacity;                           /**< number of entries */
+  size_t length;                             /**< occupied entries */
 };
 /** @endcond */
 
-/** Runtime state for the general purpose allocator. */
+/**
+ * Runtime state for the general purpose allocator.
+ *
+ * Buckets that become empty are retained per size class so workloads that
+ * oscillate around a bucket boundary do not create and destroy buckets over
+ * and over. Retained buckets decay on a clock advanced by every small free:
+ * after decayTicks their slot pages are returned to the system where that
+ * is supported, and after another decayTicks the bucket is released.
+ */
 typedef struct {
   cu_Allocator backingAllocator; /**< allocator used for all bookkeeping */
+  /** buckets with free and used slots, per size class */
   struct cu_GPAllocator_BucketHeader *smallBuckets[CU_GPA_NUM_SMALL_BUCKETS];
-  struct cu_GPAllocator_BucketHeader
-      *smallBucketTails[CU_GPA_NUM_SMALL_BUCKETS];
-  struct cu_GPAllocator_LargeAlloc
-      *largeAllocs;  /**< linked list of large allocations */
-  size_t bucketSize; /**< requested bucket size */
+  /** retained empty buckets, most recently emptied first, per size class */
+  struct cu_GPAllocator_BucketHeader *emptyBuckets[CU_GPA_NUM_SMALL_BUCKETS];
+  size_t emptyCount[CU_GPA_NUM_SMALL_BUCKETS]; /**< retained per class */
+  struct cu_GPAllocator_Region *regions; /**< regions with free spans */
+  struct cu_GPAllocator_Index spans; /**< span base to bucket lookup */
+  struct cu_GPAllocator_Index largeAllocs; /**< large allocation lookup */
+  size_t bucketSize;    /**< requested bytes of slots per bucket */
+  size_t spanSize;      /**< size and alignment of bucket spans */
+  size_t retainBuckets; /**< empty buckets kept per size class */
+  size_t decayTicks;    /**< clock ticks per decay step */
+  size_t clock;         /**< number of small frees so far */
+  size_t purgedPages;   /**< pages of empty spans returned so far */
 } cu_GPAllocator;
 
 typedef struct {
-  size_t bucketSize;                      /**< desired bucket size */
+  size_t bucketSize; /**< bytes of slots per bucket */
   cu_Allocator_Optional backingAllocator; /**< custom backing allocator */
+  Size_Optional retainBuckets; /**< empty buckets kept per size class */
+  Size_Optional decayTicks;    /**< small frees per decay step */
 } cu_GPAllocator_Config;
 
 /** Create a GP allocator using the given configuration. */
 cu_Allocator cu_Allocator_GPAllocator(
     cu_GPAllocator *alloc, cu_GPAllocator_Config config);
 
+/**
+ * Decay every retained empty bucket by one step right away.
+ *
+ * Buckets that still hold their pages return them to the system, the others
+ * are released. Call this periodically, for example from an idle handler,
+ * to bound memory held by an allocator that has stopped freeing.
+ */
+void cu_GPAllocator_purge(cu_GPAllocator *alloc);
+
 /** Release all buckets and large allocations. */
 void cu_GPAllocator_destroy(cu_GPAllocator *alloc);
@@ -3,16 +3,40 @@
 /** @file page.h OS backed page allocator. */
 #include "macro.h"
 #include "memory/allocator.h"
+#include <stdbool.h>
 #include <stddef.h>
 
 #if !CU_PLAT_WASM && !CU_FREESTANDING
 
+/** Size of a transparent huge page on common platforms. */
+#define CU_PAGE_HUGE_SIZE (2 * 1024 * 1024)
+
 /** Storage for a page allocator instance. */
 typedef struct {
   size_t pageSize; /**< system page size in bytes */
+  bool hugePages;  /**< request transparent huge pages for large mappings */
 } cu_PageAllocator;
 
-/** Create an allocator that allocates memory using OS pages. */
+/** Configuration for a page allocator. */
+typedef struct {
+  /**
+   * Align mappings of at least ::CU_PAGE_HUGE_SIZE to the huge page size and
+   * advise the kernel to back them with transparent huge pages. Ignored on
+   * platforms without `MADV_HUGEPAGE`.
+   */
+  bool hugePages;
+} cu_PageAllocator_Config;
+
+/**
+ * Create an allocator that allocates memory using OS pages.
+ *
+ * Shrinking releases the tail pages in place. On Linux growing remaps the
+ * pages with `mremap`, so no data is copied even when the mapping moves.
+ */
 cu_Allocator cu_Allocator_PageAllocator(cu_PageAllocator *allocator);
 
+/** Create a page allocator using the given configuration. */
+cu_Allocator cu_Allocator_PageAllocatorWithConfig(
+    cu_PageAllocator *allocator, cu_PageAllocator_Config config);
+
 #endif
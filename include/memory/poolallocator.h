@@ -0,0 +1,82 @@
+#pragma once
+
+/** @file poolallocator.h Lock free fixed size object pool. */
+
+#include "macro.h"
+#include "memory/allocator.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if !CU_FREESTANDING && !defined(__STDC_NO_ATOMICS__)
+
+#include <stdatomic.h>
+
+#define CU_POOL_MAGAZINE_SIZE 64 /**< objects held by a thread magazine */
+#define CU_POOL_CHUNK_OBJECTS 64 /**< default objects in the first chunk */
+#define CU_POOL_MAX_CHUNKS 32    /**< chunks double in size up to this count */
+
+/** @cond INTERNAL */
+/** Objects cached by a single thread. */
+struct cu_PoolAllocator_Magazine {
+  struct cu_PoolAllocator_Magazine *next; /**< next registered magazine */
+  uintptr_t owner; /**< address of the owning thread's token */
+  size_t count;                           /**< cached object count */
+  void *objects[CU_POOL_MAGAZINE_SIZE];   /**< cached objects */
+};
+/** @endcond */
+
+/**
+ * Runtime state for the pool allocator.
+ *
+ * Every object has the same layout. Objects are numbered across backing
+ * chunks whose size doubles, and the shared free list links them by index
+ * with a generation tag packed next to the head index, so a single 64-bit
+ * compare and swap updates the list without ABA problems. Threads allocate
+ * from and free into private magazines and only touch the shared list to
+ * refill or spill half a magazine at a time.
+ */
+typedef struct {
+  cu_Allocator backingAllocator; /**< allocator used for chunks and magazines */
+  atomic_flag lock;              /**< guards chunk creation and magazines */
+  _Atomic(uint64_t) freeList;    /**< tag in the high, index + 1 in low bits */
+  _Atomic(size_t) carved;        /**< objects handed out at least once */
+  _Atomic(unsigned char *) chunks[CU_POOL_MAX_CHUNKS]; /**< backing chunks */
+  struct cu_PoolAllocator_Magazine *magazines; /**< every thread magazine */
+  size_t objectSize;   /**< bytes per object, a multiple of the alignment */
+  size_t objectAlign;  /**< alignment of every object */
+  size_t chunkObjects; /**< objects in the first chunk */
+  size_t maxObjects;   /**< objects addressable by the free list */
+  uintptr_t id;        /**< identifies this instance in thread slots */
+} cu_PoolAllocator;
+
+/** Configuration for creating a pool allocator. */
+typedef struct {
+  cu_Layout layout;     /**< layout of every object */
+  size_t chunkObjects;  /**< objects in the first chunk, 0 for the default */
+  cu_Allocator_Optional backingAllocator; /**< custom backing allocator */
+} cu_PoolAllocator_Config;
+
+/**
+ * Create a pool handing out objects of @p config.layout.
+ *
+ * Requests are served when they fit the pool layout, so containers whose
+ * nodes all share one size can allocate from the pool directly. The backing
+ * allocator is only used under the pool lock and does not need to be thread
+ * safe.
+ */
+cu_Allocator cu_Allocator_PoolAllocator(
+    cu_PoolAllocator *alloc, cu_PoolAllocator_Config config);
+
+/**
+ * Return the calling thread's magazine to the shared free list.
+ *
+ * Threads should call this before exiting so their cached objects can be
+ * reused by other threads.
+ */
+void cu_PoolAllocator_flush(cu_PoolAllocator *alloc);
+
+/** Release every chunk and magazine. */
+void cu_PoolAllocator_destroy(cu_PoolAllocator *alloc);
+
+#endif /* !CU_FREESTANDING && !__STDC_NO_ATOMICS__ */
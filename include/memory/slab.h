@@ -15,6 +15,7 @@ struct cu_SlabAllocator_Slab;
 typedef struct {
   cu_Allocator backingAllocator;         /**< allocator used for slabs */
   struct cu_SlabAllocator_Slab *slabs;   /**< list of allocated slabs */
+  struct cu_SlabAllocator_Slab *available; /**< slabs with free slots */
   struct cu_SlabAllocator_Slab *current; /**< slab used for new allocations */
   size_t slabSize;                       /**< bytes per slab */
 } cu_SlabAllocator;
@@ -0,0 +1,80 @@
+#pragma once
+
+/** @file statsallocator.h Allocator decorator collecting usage statistics. */
+
+#include "io/error.h"
+#include "io/stream.h"
+#include "memory/allocator.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#if !defined(__STDC_NO_ATOMICS__)
+
+#include <stdatomic.h>
+
+/** Number of power of two size buckets in the histogram. */
+#define CU_STATS_HISTOGRAM_BUCKETS (sizeof(size_t) * 8)
+
+/** Monotonic clock used to measure latency, in arbitrary ticks. */
+typedef uint64_t (*cu_StatsAllocator_ClockFn)(void);
+
+/** Plain copy of the counters of a ::cu_StatsAllocator. */
+typedef struct {
+  uint64_t allocCount;   /**< successful allocations */
+  uint64_t freeCount;    /**< frees of non-null memory */
+  uint64_t growCount;    /**< successful grow calls */
+  uint64_t shrinkCount;  /**< successful shrink calls */
+  uint64_t failureCount; /**< failed alloc, grow or shrink calls */
+  uint64_t bytesLive;    /**< bytes currently handed out */
+  uint64_t bytesPeak;    /**< highest value of bytesLive */
+  uint64_t bytesTotal;   /**< bytes handed out by allocations */
+  uint64_t latencyTicks; /**< clock ticks spent in the inner allocator */
+  uint64_t latencyMax;   /**< slowest single call in clock ticks */
+  /** allocations whose size rounds up to 2^i bytes */
+  uint64_t histogram[CU_STATS_HISTOGRAM_BUCKETS];
+} cu_StatsAllocator_Snapshot;
+
+/**
+ * Runtime state for the statistics allocator.
+ *
+ * Every counter is updated with relaxed atomic operations, so the allocator
+ * adds no locking of its own and is as thread safe as the wrapped allocator.
+ */
+typedef struct {
+  cu_Allocator backingAllocator;     /**< allocator receiving all calls */
+  cu_StatsAllocator_ClockFn clockFn; /**< latency clock or NULL */
+  _Atomic(uint64_t) allocCount;      /**< successful allocations */
+  _Atomic(uint64_t) freeCount;       /**< frees of non-null memory */
+  _Atomic(uint64_t) growCount;       /**< successful grow calls */
+  _Atomic(uint64_t) shrinkCount;     /**< successful shrink calls */
+  _Atomic(uint64_t) failureCount;    /**< failed calls */
+  _Atomic(uint64_t) bytesLive;       /**< bytes currently handed out */
+  _Atomic(uint64_t) bytesPeak;       /**< highest value of bytesLive */
+  _Atomic(uint64_t) bytesTotal;      /**< bytes handed out by allocations */
+  _Atomic(uint64_t) latencyTicks;    /**< ticks spent in the inner allocator */
+  _Atomic(uint64_t) latencyMax;      /**< slowest single call */
+  _Atomic(uint64_t) histogram[CU_STATS_HISTOGRAM_BUCKETS]; /**< size counts */
+} cu_StatsAllocator;
+
+/** Configuration for creating a statistics allocator. */
+typedef struct {
+  cu_Allocator_Optional backingAllocator; /**< allocator to instrument */
+  cu_StatsAllocator_ClockFn clockFn; /**< measure latency when non-null */
+} cu_StatsAllocator_Config;
+
+/** Create an allocator forwarding to the backing allocator and counting. */
+cu_Allocator cu_Allocator_StatsAllocator(
+    cu_StatsAllocator *alloc, cu_StatsAllocator_Config config);
+
+/** Copy the current counters. Concurrent updates may be partially visible. */
+cu_StatsAllocator_Snapshot cu_StatsAllocator_snapshot(
+    const cu_StatsAllocator *alloc);
+
+/** Zero all counters except the live byte count. */
+void cu_StatsAllocator_reset(cu_StatsAllocator *alloc);
+
+/** Write a snapshot as `name value` lines to @p stream. */
+cu_Io_Error_Optional cu_StatsAllocator_Snapshot_write(
+    const cu_StatsAllocator_Snapshot *snapshot, cu_Stream *stream);
+
+#endif /* !__STDC_NO_ATOMICS__ */
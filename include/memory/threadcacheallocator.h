@@ -0,0 +1,138 @@
+#pragma once
+
+/** @file threadcacheallocator.h Thread caching allocator. */
+
+#include "macro.h"
+#include "memory/allocator.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if !CU_FREESTANDING && !defined(__STDC_NO_ATOMICS__)
+
+#include <stdatomic.h>
+
+#define CU_THREADCACHE_SPAN_SIZE 65536  /**< default central span size */
+#define CU_THREADCACHE_BATCH_SIZE 32    /**< default refill and flush size */
+#define CU_THREADCACHE_NUM_CLASSES 16   /**< number of size classes */
+#define CU_THREADCACHE_RADIX_BITS 12    /**< key bits per span map level */
+#define CU_THREADCACHE_CANARY 0x5c1d7e3b9a04f26dULL /**< span canary value */
+/** central spans carved from one backing allocation */
+#define CU_THREADCACHE_REGION_SPANS (sizeof(size_t) * 8)
+
+/** @cond INTERNAL */
+
+/**
+ * Backing allocation that central spans are carved from.
+ *
+ * Like the general purpose allocator, spans are taken
+ * ::CU_THREADCACHE_REGION_SPANS at a time from one aligned allocation so the
+ * alignment is not paid for every span.
+ */
+struct cu_ThreadCacheAllocator_Region {
+  struct cu_ThreadCacheAllocator_Region *prev; /**< previous in its list */
+  struct cu_ThreadCacheAllocator_Region *next; /**< next in its list */
+  cu_Slice memory;     /**< backing allocation */
+  unsigned char *base; /**< first span, aligned to the span size */
+  size_t freeSpans;    /**< bit i is set while span i is unused */
+};
+
+/**
+ * Central span carved into objects of a single size class.
+ *
+ * Every span is aligned to its size, objects start at the span base and the
+ * header sits in the tail. Free objects are chained through their first word.
+ */
+struct cu_ThreadCacheAllocator_Span {
+  struct cu_ThreadCacheAllocator_Span *prev; /**< previous partial span */
+  struct cu_ThreadCacheAllocator_Span *next; /**< next partial span */
+  void *freeList;        /**< returned objects */
+  unsigned char *data;   /**< first object */
+  size_t objectSize;     /**< size of each object */
+  size_t slotCount;      /**< total objects */
+  size_t carvedCount;    /**< objects handed out at least once */
+  size_t usedCount;      /**< objects owned by caches or users */
+  int sizeClass;         /**< index of the size class */
+  bool linked;           /**< whether the span is on its partial list */
+  struct cu_ThreadCacheAllocator_Region *region; /**< region of the span */
+  size_t canary;         /**< header corruption check */
+};
+
+/** Header stored in front of allocations too large for a size class. */
+struct cu_ThreadCacheAllocator_Large {
+  struct cu_ThreadCacheAllocator_Large *prev; /**< previous large allocation */
+  struct cu_ThreadCacheAllocator_Large *next; /**< next large allocation */
+  cu_Slice memory; /**< backing allocation */
+};
+
+/** Free objects of one size class held by a thread. */
+struct cu_ThreadCacheAllocator_Bin {
+  void *head;   /**< first cached object */
+  size_t count; /**< cached object count */
+};
+
+/** Per-thread object cache. */
+struct cu_ThreadCacheAllocator_Cache {
+  struct cu_ThreadCacheAllocator_Cache *next; /**< next registered cache */
+  uintptr_t owner; /**< address of the owning thread's token */
+  struct cu_ThreadCacheAllocator_Bin bins[CU_THREADCACHE_NUM_CLASSES];
+};
+/** @endcond */
+
+/**
+ * Runtime state for the thread caching allocator.
+ *
+ * Every thread allocates from and frees into its own cache without locking.
+ * Caches refill from the shared central spans in batches under a lock and
+ * flush surplus objects in batches through a lock free queue, so objects
+ * freed by a thread other than the one that allocated them simply migrate to
+ * the freeing thread.
+ */
+typedef struct {
+  cu_Allocator backingAllocator; /**< allocator used for spans and metadata */
+  atomic_flag lock;              /**< guards the central state */
+  /** central spans with at least one free object, per size class */
+  struct cu_ThreadCacheAllocator_Span *partial[CU_THREADCACHE_NUM_CLASSES];
+  /** regions with unused spans */
+  struct cu_ThreadCacheAllocator_Region *regions;
+  /** regions whose spans are all in use */
+  struct cu_ThreadCacheAllocator_Region *fullRegions;
+  struct cu_ThreadCacheAllocator_Large *large; /**< live large allocations */
+  struct cu_ThreadCacheAllocator_Cache *caches; /**< every thread cache */
+  _Atomic(void *) remoteFree; /**< flushed objects awaiting the central lock */
+  _Atomic(void *) *spanMap;   /**< radix tree from span address to span */
+  size_t spanMapLevels;       /**< depth of the span map */
+  size_t spanSize;            /**< size and alignment of central spans */
+  size_t spanShift;           /**< log2 of the span size */
+  size_t batchSize;           /**< objects moved per refill or flush */
+  size_t maxSmall;            /**< largest size served from a size class */
+  uintptr_t id;               /**< identifies this instance in thread slots */
+} cu_ThreadCacheAllocator;
+
+typedef struct {
+  size_t spanSize;  /**< central span size, power of two */
+  size_t batchSize; /**< objects moved per refill or flush */
+  cu_Allocator_Optional backingAllocator; /**< custom backing allocator */
+} cu_ThreadCacheAllocator_Config;
+
+/**
+ * Create a thread caching allocator using the given configuration.
+ *
+ * The backing allocator is only used under the central lock and does not
+ * need to be thread safe.
+ */
+cu_Allocator cu_Allocator_ThreadCacheAllocator(
+    cu_ThreadCacheAllocator *alloc, cu_ThreadCacheAllocator_Config config);
+
+/**
+ * Return the calling thread's cached objects to the central spans.
+ *
+ * Threads should call this before exiting so their cached memory can be
+ * reused by other threads.
+ */
+void cu_ThreadCacheAllocator_flush(cu_ThreadCacheAllocator *alloc);
+
+/** Release all spans, caches and large allocations. */
+void cu_ThreadCacheAllocator_destroy(cu_ThreadCacheAllocator *alloc);
+
+#endif /* !CU_FREESTANDING && !__STDC_NO_ATOMICS__ */
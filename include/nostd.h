@@ -52,6 +52,12 @@ void cu_Memory_memcpy(void *dest, cu_Slice src);
 void cu_Memory_smemcpy(cu_Slice dest, cu_Slice src);
 void cu_Memory_memset(void *dest, int value, size_t size);
 bool cu_Memory_memcmp(cu_Slice a, cu_Slice b);
+/** First byte equal to @p value in @p haystack, or NULL. */
+void *cu_Memory_memchr(cu_Slice haystack, int value);
+/** Last byte equal to @p value in @p haystack, or NULL. */
+void *cu_Memory_memrchr(cu_Slice haystack, int value);
+/** First occurrence of @p needle in @p haystack, or NULL. */
+void *cu_Memory_memmem(cu_Slice haystack, cu_Slice needle);
 
 size_t cu_CString_length(const char *cstr);
 int cu_CString_cmp(const char *a, const char *b);
@@ -1,8 +1,13 @@
 #pragma once
 
 /** Round up to the next power of two. */
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "macro.h"
+#if CU_COMPILER_MSVC
+#include <intrin.h>
+#endif
 static inline size_t cu_next_pow2(size_t x) {
   if (x <= 1) {
     return 1;
@@ -19,6 +24,32 @@ static inline size_t cu_next_pow2(size_t x) {
   return x + 1;
 }
 
+/** Index of the lowest set bit of @p x. @p x must not be zero. */
+static inline size_t cu_count_trailing_zeros(size_t x) {
+#if CU_COMPILER_GCC || CU_COMPILER_CLANG
+#if SIZE_MAX > UINT32_MAX
+  return (size_t)__builtin_ctzll((unsigned long long)x);
+#else
+  return (size_t)__builtin_ctz((unsigned int)x);
+#endif
+#elif CU_COMPILER_MSVC
+  unsigned long idx;
+#if SIZE_MAX > UINT32_MAX
+  _BitScanForward64(&idx, (unsigned __int64)x);
+#else
+  _BitScanForward(&idx, (unsigned long)x);
+#endif
+  return (size_t)idx;
+#else
+  size_t n = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
 typedef struct {
   size_t elem_size;
   size_t alignment;
@@ -39,6 +70,19 @@ static inline cu_Layout cu_Layout_create(size_t elem_size, size_t alignment) {
 #define CU_LAYOUT_CHECK(layout)                                                \
   if ((layout).elem_size == 0 || (layout).alignment == 0)
 
+/**
+ * Whether @p count records of @p stride bytes starting at @p offset, a
+ * multiple of @p align, lie within @p size bytes. Validates sections of
+ * serialized blobs without overflowing.
+ */
+static inline bool cu_section_fits(uint64_t offset, uint64_t count,
+    uint64_t stride, uint64_t size, uint64_t align) {
+  if (offset > size || offset % align != 0) {
+    return false;
+  }
+  return stride == 0 || count <= (size - offset) / stride;
+}
+
 #define CU_TIME_NS_PER_SEC 1000000000ULL
 #if CU_PLAT_WINDOWS
 #define CU_TIME_WINDOWS_TICKS_PER_SEC 10000000ULL
@@ -1,4 +1,6 @@
 #include "collection/bitmap.h"
+#include "macro.h"
+#include "utility.h"
 
 CU_OPTIONAL_IMPL(cu_Bitmap, cu_Bitmap)
 
@@ -70,3 +72,103 @@ void cu_Bitmap_clear_all(cu_Bitmap *bitmap) {
     bitmap->bits[i] = 0;
   }
 }
+
+Size_Optional cu_Bitmap_find_clear(const cu_Bitmap *bitmap, size_t start) {
+  const size_t word_bits = sizeof(size_t) * 8;
+  if (start >= bitmap->bitCount) {
+    return Size_Optional_none();
+  }
+  size_t size = (bitmap->bitCount + word_bits - 1) / word_bits;
+  size_t word = start / word_bits;
+  size_t free_bits = ~bitmap->bits[word] & (~(size_t)0 << (start % word_bits));
+  for (;;) {
+    if (free_bits != 0) {
+      size_t index = word * word_bits + cu_count_trailing_zeros(free_bits);
+      if (index < bitmap->bitCount) {
+        return Size_Optional_some(index);
+      }
+      return Size_Optional_none();
+    }
+    if (++word >= size) {
+      return Size_Optional_none();
+    }
+    free_bits = ~bitmap->bits[word];
+  }
+}
+
+/* Index of the first set bit at or after @p start, or the bit count. */
+static size_t cu_bitmap_find_set(const cu_Bitmap *bitmap, size_t start) {
+  const size_t word_bits = sizeof(size_t) * 8;
+  if (start >= bitmap->bitCount) {
+    return bitmap->bitCount;
+  }
+  size_t size = (bitmap->bitCount + word_bits - 1) / word_bits;
+  size_t word = start / word_bits;
+  size_t set_bits = bitmap->bits[word] & (~(size_t)0 << (start % word_bits));
+  while (set_bits == 0) {
+    if (++word >= size) {
+      return bitmap->bitCount;
+    }
+    set_bits = bitmap->bits[word];
+  }
+  size_t index = word * word_bits + cu_count_trailing_zeros(set_bits);
+  return CU_MIN(index, bitmap->bitCount);
+}
+
+Size_Optional cu_Bitmap_find_set(const cu_Bitmap *bitmap, size_t start) {
+  size_t index = cu_bitmap_find_set(bitmap, start);
+  if (index < bitmap->bitCount) {
+    return Size_Optional_some(index);
+  }
+  return Size_Optional_none();
+}
+
+Size_Optional cu_Bitmap_find_clear_run(
+    const cu_Bitmap *bitmap, size_t start, size_t count) {
+  if (count == 0 || count > bitmap->bitCount) {
+    return Size_Optional_none();
+  }
+  Size_Optional pos = cu_Bitmap_find_clear(bitmap, start);
+  while (Size_Optional_is_some(&pos)) {
+    if (bitmap->bitCount - pos.value < count) {
+      break;
+    }
+    size_t end = cu_bitmap_find_set(bitmap, pos.value);
+    if (end - pos.value >= count) {
+      return pos;
+    }
+    pos = cu_Bitmap_find_clear(bitmap, end);
+  }
+  return Size_Optional_none();
+}
+
+/* Apply @p set or clear to the bits in [start, start + count). */
+static void cu_bitmap_fill(
+    cu_Bitmap *bitmap, size_t start, size_t count, bool set) {
+  const size_t word_bits = sizeof(size_t) * 8;
+  if (start >= bitmap->bitCount) {
+    return;
+  }
+  size_t end = CU_MIN(start + count, bitmap->bitCount);
+  while (start < end) {
+    size_t word = start / word_bits;
+    size_t offset = start % word_bits;
+    size_t span = CU_MIN(word_bits - offset, end - start);
+    size_t mask = span == word_bits ? ~(size_t)0
+                                    : (((size_t)1 << span) - 1) << offset;
+    if (set) {
+      bitmap->bits[word] |= mask;
+    } else {
+      bitmap->bits[word] &= ~mask;
+    }
+    start += span;
+  }
+}
+
+void cu_Bitmap_set_range(cu_Bitmap *bitmap, size_t start, size_t count) {
+  cu_bitmap_fill(bitmap, start, count, true);
+}
+
+void cu_Bitmap_clear_range(cu_Bitmap *bitmap, size_t start, size_t count) {
+  cu_bitmap_fill(bitmap, start, count, false);
+}
@@ -0,0 +1,326 @@
+#include "collection/concurrent_hashmap.h"
+
+#if !CU_FREESTANDING && !defined(__STDC_NO_ATOMICS__)
+
+#include "hash/hash.h"
+#include "memory/allocator.h"
+#include "object/optional.h"
+#include "object/result.h"
+#include <nostd.h>
+#include <stdalign.h>
+
+CU_RESULT_IMPL(cu_ConcurrentHashMap, cu_ConcurrentHashMap, cu_HashMap_Error)
+
+#if CU_COMPILER_GCC || CU_COMPILER_CLANG
+#if defined(__x86_64__) || defined(__i386__)
+#define CU_CONCURRENT_RELAX() __builtin_ia32_pause()
+#else
+#define CU_CONCURRENT_RELAX() ((void)0)
+#endif
+#else
+#define CU_CONCURRENT_RELAX() ((void)0)
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* Shard allocator                                                            */
+/* -------------------------------------------------------------------------- */
+
+/*
+ * Shard tables are allocated through a small decorator whose free only
+ * queues the block. Every block carries its retired list node in front of
+ * the memory handed out, where readers never look.
+ */
+
+static size_t cu_concurrent_header(size_t alignment) {
+  return CU_ALIGN_UP(sizeof(struct cu_ConcurrentHashMap_Retired), alignment);
+}
+
+static cu_IoSlice_Result cu_concurrent_alloc(void *self, cu_Layout layout) {
+  cu_ConcurrentHashMap_Shard *shard = (cu_ConcurrentHashMap_Shard *)self;
+  size_t align =
+      CU_MAX(layout.alignment, alignof(struct cu_ConcurrentHashMap_Retired));
+  size_t header = cu_concurrent_header(align);
+  cu_IoSlice_Result mem = cu_Allocator_Alloc(
+      shard->backing, cu_Layout_create(header + layout.elem_size, align));
+  if (!cu_IoSlice_Result_is_ok(&mem)) {
+    return mem;
+  }
+  unsigned char *base = (unsigned char *)mem.value.ptr;
+  struct cu_ConcurrentHashMap_Retired *node =
+      (struct cu_ConcurrentHashMap_Retired *)(base + header) - 1;
+  node->next = NULL;
+  node->base = base;
+  node->size = mem.value.length;
+  return cu_IoSlice_Result_ok(cu_Slice_create(base + header, layout.elem_size));
+}
+
+static void cu_concurrent_retire(void *self, cu_Slice mem) {
+  cu_ConcurrentHashMap_Shard *shard = (cu_ConcurrentHashMap_Shard *)self;
+  if (!mem.ptr) {
+    return;
+  }
+  struct cu_ConcurrentHashMap_Retired *node =
+      (struct cu_ConcurrentHashMap_Retired *)mem.ptr - 1;
+  node->next = shard->retired;
+  shard->retired = node;
+}
+
+static cu_IoSlice_Result cu_concurrent_resize(
+    void *self, cu_Slice old_mem, cu_Layout new_layout) {
+  (void)self;
+  (void)old_mem;
+  (void)new_layout;
+  cu_Io_Error err = {
+      .kind = CU_IO_ERROR_KIND_UNSUPPORTED, .errnum = Size_Optional_none()};
+  return cu_IoSlice_Result_error(err);
+}
+
+static void cu_concurrent_reclaim_shard(cu_ConcurrentHashMap_Shard *shard) {
+  while (shard->retired) {
+    struct cu_ConcurrentHashMap_Retired *node = shard->retired;
+    shard->retired = node->next;
+    cu_Allocator_Free(shard->backing, cu_Slice_create(node->base, node->size));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+/* Sequence lock                                                              */
+/* -------------------------------------------------------------------------- */
+
+static void cu_concurrent_write_begin(cu_ConcurrentHashMap_Shard *shard) {
+  while (
+      atomic_flag_test_and_set_explicit(&shard->lock, memory_order_acquire)) {
+    CU_CONCURRENT_RELAX();
+  }
+  uint64_t seq = atomic_load_explicit(&shard->seq, memory_order_relaxed);
+  atomic_store_explicit(&shard->seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+static void cu_concurrent_write_end(cu_ConcurrentHashMap_Shard *shard) {
+  uint64_t seq = atomic_load_explicit(&shard->seq, memory_order_relaxed);
+  atomic_store_explicit(&shard->seq, seq + 1, memory_order_release);
+  atomic_flag_clear_explicit(&shard->lock, memory_order_release);
+}
+
+static uint64_t cu_concurrent_read_begin(cu_ConcurrentHashMap_Shard *shard) {
+  for (;;) {
+    uint64_t seq = atomic_load_explicit(&shard->seq, memory_order_acquire);
+    if ((seq & 1) == 0) {
+      return seq;
+    }
+    CU_CONCURRENT_RELAX();
+  }
+}
+
+static bool cu_concurrent_read_valid(
+    cu_ConcurrentHashMap_Shard *shard, uint64_t seq) {
+  atomic_thread_fence(memory_order_acquire);
+  return atomic_load_explicit(&shard->seq, memory_order_relaxed) == seq;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Map                                                                        */
+/* -------------------------------------------------------------------------- */
+
+static cu_ConcurrentHashMap_Shard *cu_concurrent_shard(
+    const cu_ConcurrentHashMap *map, const void *key) {
+  uint64_t hash;
+  if (map->hash_fn) {
+    hash = map->hash_fn(key, map->key_layout.elem_size) ^ map->seed;
+    hash *= 0x9E3779B97F4A7C15ULL;
+  } else {
+    hash = cu_Hash_Wy64(key, map->key_layout.elem_size, map->seed);
+  }
+  if (map->shard_count == 1) {
+    return map->shards;
+  }
+  return &map->shards[hash >> map->shard_shift];
+}
+
+cu_ConcurrentHashMap_Result cu_ConcurrentHashMap_create(cu_Allocator allocator,
+    cu_Layout key_layout, cu_Layout value_layout, Size_Optional shard_count,
+    cu_HashMap_HashFn_Optional hash_fn, cu_HashMap_EqualsFn_Optional equals_fn,
+    cu_State state) {
+  CU_LAYOUT_CHECK(key_layout) {
+    return cu_ConcurrentHashMap_Result_error(CU_HASHMAP_ERROR_INVALID_LAYOUT);
+  }
+  CU_LAYOUT_CHECK(value_layout) {
+    return cu_ConcurrentHashMap_Result_error(CU_HASHMAP_ERROR_INVALID_LAYOUT);
+  }
+  size_t count = CU_CONCURRENT_HASHMAP_SHARDS;
+  if (Size_Optional_is_some(&shard_count)) {
+    count = Size_Optional_unwrap(&shard_count);
+  }
+  if (count == 0 || count > ((size_t)1 << 16)) {
+    return cu_ConcurrentHashMap_Result_error(CU_HASHMAP_ERROR_INVALID);
+  }
+  count = cu_next_pow2(count);
+
+  cu_ConcurrentHashMap map = {0};
+  map.shard_count = count;
+  map.shard_shift = (unsigned)(64 - cu_count_trailing_zeros(count));
+  map.key_layout = key_layout;
+  map.value_layout = value_layout;
+  map.allocator = allocator;
+  map.hash_fn = NULL;
+  if (cu_HashMap_HashFn_Optional_is_some(&hash_fn)) {
+    map.hash_fn = cu_HashMap_HashFn_Optional_unwrap(&hash_fn);
+  }
+  map.seed = cu_State_next(&state);
+
+  cu_IoSlice_Result mem = cu_Allocator_Alloc(allocator,
+      cu_Layout_create(count * sizeof(cu_ConcurrentHashMap_Shard),
+          alignof(cu_ConcurrentHashMap_Shard)));
+  if (!cu_IoSlice_Result_is_ok(&mem)) {
+    return cu_ConcurrentHashMap_Result_error(CU_HASHMAP_ERROR_OOM);
+  }
+  map.shards = (cu_ConcurrentHashMap_Shard *)mem.value.ptr;
+
+  for (size_t i = 0; i < count; ++i) {
+    cu_ConcurrentHashMap_Shard *shard = &map.shards[i];
+    atomic_init(&shard->seq, 0);
+    atomic_flag_clear(&shard->lock);
+    shard->backing = allocator;
+    shard->retired = NULL;
+    cu_Allocator tables = {0};
+    tables.self = shard;
+    tables.allocFn = cu_concurrent_alloc;
+    tables.growFn = cu_concurrent_resize;
+    tables.shrinkFn = cu_concurrent_resize;
+    tables.freeFn = cu_concurrent_retire;
+    cu_HashMap_Result res = cu_HashMap_create(tables, key_layout, value_layout,
+        Size_Optional_none(), hash_fn, equals_fn, state);
+    if (!cu_HashMap_Result_is_ok(&res)) {
+      map.shard_count = i;
+      cu_ConcurrentHashMap_destroy(&map);
+      return cu_ConcurrentHashMap_Result_error(res.error);
+    }
+    shard->map = cu_HashMap_Result_unwrap(&res);
+  }
+  return cu_ConcurrentHashMap_Result_ok(map);
+}
+
+void cu_ConcurrentHashMap_destroy(cu_ConcurrentHashMap *map) {
+  if (!map || !map->shards) {
+    return;
+  }
+  for (size_t i = 0; i < map->shard_count; ++i) {
+    cu_HashMap_destroy(&map->shards[i].map);
+    cu_concurrent_reclaim_shard(&map->shards[i]);
+  }
+  cu_Allocator_Free(map->allocator,
+      cu_Slice_create(map->shards,
+          map->shard_count * sizeof(cu_ConcurrentHashMap_Shard)));
+  map->shards = NULL;
+  map->shard_count = 0;
+}
+
+void cu_ConcurrentHashMap_reclaim(cu_ConcurrentHashMap *map) {
+  CU_IF_NULL(map) { return; }
+  for (size_t i = 0; i < map->shard_count; ++i) {
+    cu_ConcurrentHashMap_Shard *shard = &map->shards[i];
+    cu_concurrent_write_begin(shard);
+    cu_concurrent_reclaim_shard(shard);
+    cu_concurrent_write_end(shard);
+  }
+}
+
+cu_HashMap_Error_Optional cu_ConcurrentHashMap_insert(
+    cu_ConcurrentHashMap *map, const void *key, const void *value) {
+  CU_IF_NULL(map) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
+  }
+  cu_ConcurrentHashMap_Shard *shard = cu_concurrent_shard(map, key);
+  cu_concurrent_write_begin(shard);
+  cu_HashMap_Error_Optional err =
+      cu_HashMap_insert(&shard->map, (void *)key, (void *)value);
+  cu_concurrent_write_end(shard);
+  return err;
+}
+
+bool cu_ConcurrentHashMap_get(
+    const cu_ConcurrentHashMap *map, const void *key, void *out_value) {
+  CU_IF_NULL(map) { return false; }
+  CU_IF_NULL(out_value) { return false; }
+  cu_ConcurrentHashMap_Shard *shard = cu_concurrent_shard(map, key);
+  size_t value_size = map->value_layout.elem_size;
+  for (;;) {
+    uint64_t seq = cu_concurrent_read_begin(shard);
+    /* validate the table pointers before following them */
+    cu_HashMap snapshot = shard->map;
+    if (!cu_concurrent_read_valid(shard, seq)) {
+      continue;
+    }
+    Ptr_Optional value = cu_HashMap_get(&snapshot, key);
+    bool found = Ptr_Optional_is_some(&value);
+    if (found) {
+      cu_Memory_memcpy(out_value,
+          cu_Slice_create(Ptr_Optional_unwrap(&value), value_size));
+    }
+    if (cu_concurrent_read_valid(shard, seq)) {
+      return found;
+    }
+  }
+}
+
+cu_HashMap_Error_Optional cu_ConcurrentHashMap_remove(
+    cu_ConcurrentHashMap *map, const void *key, void *out_value) {
+  CU_IF_NULL(map) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
+  }
+  cu_ConcurrentHashMap_Shard *shard = cu_concurrent_shard(map, key);
+  cu_concurrent_write_begin(shard);
+  cu_HashMap_Error_Optional err =
+      cu_HashMap_remove(&shard->map, key, out_value);
+  cu_concurrent_write_end(shard);
+  return err;
+}
+
+cu_HashMap_Error_Optional cu_ConcurrentHashMap_compute_if_absent(
+    cu_ConcurrentHashMap *map, const void *key,
+    cu_ConcurrentHashMap_ComputeFn fn, void *ctx, void *out_value) {
+  CU_IF_NULL(map) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
+  }
+  CU_IF_NULL(fn) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
+  }
+  size_t value_size = map->value_layout.elem_size;
+  /* the common hit avoids the lock entirely */
+  if (out_value && cu_ConcurrentHashMap_get(map, key, out_value)) {
+    return cu_HashMap_Error_Optional_none();
+  }
+  cu_ConcurrentHashMap_Shard *shard = cu_concurrent_shard(map, key);
+  cu_HashMap_Error_Optional err = cu_HashMap_Error_Optional_none();
+  cu_concurrent_write_begin(shard);
+  Ptr_Optional existing = cu_HashMap_get(&shard->map, key);
+  if (Ptr_Optional_is_some(&existing)) {
+    if (out_value) {
+      cu_Memory_memcpy(out_value,
+          cu_Slice_create(Ptr_Optional_unwrap(&existing), value_size));
+    }
+    cu_concurrent_write_end(shard);
+    return err;
+  }
+  /* compute straight into the caller's buffer when there is one */
+  cu_Slice scratch = cu_Slice_create(out_value, value_size);
+  if (!out_value) {
+    cu_IoSlice_Result mem = cu_Allocator_Alloc(map->allocator,
+        cu_Layout_create(value_size, map->value_layout.alignment));
+    if (!cu_IoSlice_Result_is_ok(&mem)) {
+      cu_concurrent_write_end(shard);
+      return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_OOM);
+    }
+    scratch = mem.value;
+  }
+  fn(key, scratch.ptr, ctx);
+  err = cu_HashMap_insert(&shard->map, (void *)key, scratch.ptr);
+  cu_concurrent_write_end(shard);
+  if (!out_value) {
+    cu_Allocator_Free(map->allocator, scratch);
+  }
+  return err;
+}
+
+#endif
@@ -0,0 +1,353 @@
+#include "collection/deque.h"
+#include "macro.h"
+#include "memory/allocator.h"
+#include "object/optional.h"
+#include "object/result.h"
+#include "utility.h"
+#include <nostd.h>
+#include <stddef.h>
+
+CU_RESULT_IMPL(cu_Deque, cu_Deque, cu_Deque_Error)
+CU_OPTIONAL_IMPL(cu_Deque_Error, cu_Deque_Error)
+
+/** map slots allocated with the first block */
+#define CU_DEQUE_MAP_MIN 8
+
+/*
+ * Elements occupy the positions head .. head + length - 1 of the blocks in
+ * map order, position p living in block p / block_length. The blocks in use
+ * always cover exactly those positions, so an end block is released as soon
+ * as its last element leaves and a new one is added only when an end is full.
+ */
+
+static inline size_t cu_deque_block_length(const cu_Deque *deque) {
+  return (size_t)1 << deque->block_shift;
+}
+
+static inline size_t cu_deque_block_bytes(const cu_Deque *deque) {
+  return cu_deque_block_length(deque) * deque->layout.elem_size;
+}
+
+static inline unsigned char *cu_deque_slot(
+    const cu_Deque *deque, size_t index) {
+  size_t pos = deque->head + index;
+  size_t block = (deque->map_head + (pos >> deque->block_shift)) &
+                 (deque->map_capacity - 1);
+  return (unsigned char *)deque->map[block] +
+         (pos & (cu_deque_block_length(deque) - 1)) * deque->layout.elem_size;
+}
+
+static void *cu_deque_acquire(cu_Deque *deque) {
+  if (deque->spare) {
+    void *block = deque->spare;
+    deque->spare = NULL;
+    return block;
+  }
+  cu_IoSlice_Result res = cu_Allocator_Alloc(deque->allocator,
+      cu_Layout_create(cu_deque_block_bytes(deque), deque->layout.alignment));
+  return cu_IoSlice_Result_is_ok(&res) ? res.value.ptr : NULL;
+}
+
+/* Keep one emptied block so a deque oscillating around a block boundary
+ * does not allocate on every push. */
+static void cu_deque_release(cu_Deque *deque, void *block) {
+  if (!deque->spare) {
+    deque->spare = block;
+    return;
+  }
+  cu_Allocator_Free(
+      deque->allocator, cu_Slice_create(block, cu_deque_block_bytes(deque)));
+}
+
+static bool cu_deque_reserve_map(cu_Deque *deque, size_t extra) {
+  if (extra <= deque->map_capacity - deque->blocks) {
+    return true;
+  }
+  size_t capacity = CU_MAX(deque->map_capacity, (size_t)CU_DEQUE_MAP_MIN);
+  while (capacity - deque->blocks < extra) {
+    if (capacity > SIZE_MAX / 2 / sizeof(void *)) {
+      return false;
+    }
+    capacity *= 2;
+  }
+  cu_IoSlice_Result res = cu_Allocator_Alloc(deque->allocator,
+      cu_Layout_create(capacity * sizeof(void *), _Alignof(void *)));
+  if (!cu_IoSlice_Result_is_ok(&res)) {
+    return false;
+  }
+  void **map = (void **)res.value.ptr;
+  for (size_t i = 0; i < deque->blocks; ++i) {
+    map[i] = deque->map[(deque->map_head + i) & (deque->map_capacity - 1)];
+  }
+  if (deque->map) {
+    cu_Allocator_Free(deque->allocator,
+        cu_Slice_create(deque->map, deque->map_capacity * sizeof(void *)));
+  }
+  deque->map = map;
+  deque->map_capacity = capacity;
+  deque->map_head = 0;
+  return true;
+}
+
+static bool cu_deque_add_back(cu_Deque *deque) {
+  if (!cu_deque_reserve_map(deque, 1)) {
+    return false;
+  }
+  void *block = cu_deque_acquire(deque);
+  if (!block) {
+    return false;
+  }
+  deque->map[(deque->map_head + deque->blocks) & (deque->map_capacity - 1)] =
+      block;
+  deque->blocks++;
+  return true;
+}
+
+static bool cu_deque_add_front(cu_Deque *deque) {
+  if (!cu_deque_reserve_map(deque, 1)) {
+    return false;
+  }
+  void *block = cu_deque_acquire(deque);
+  if (!block) {
+    return false;
+  }
+  deque->map_head = (deque->map_head - 1) & (deque->map_capacity - 1);
+  deque->map[deque->map_head] = block;
+  deque->blocks++;
+  return true;
+}
+
+static void cu_deque_drop_back(cu_Deque *deque) {
+  deque->blocks--;
+  cu_deque_release(deque, deque->map[(deque->map_head + deque->blocks) &
+                                     (deque->map_capacity - 1)]);
+}
+
+/* Release every block once the deque holds no element. */
+static void cu_deque_reset(cu_Deque *deque) {
+  while (deque->blocks > 0) {
+    cu_deque_drop_back(deque);
+  }
+  deque->map_head = 0;
+  deque->head = 0;
+}
+
+static void cu_deque_take(cu_Deque *deque, void *src, void *out_elem) {
+  if (out_elem) {
+    cu_Memory_memcpy(out_elem, cu_Slice_create(src, deque->layout.elem_size));
+  }
+  if (cu_Destructor_Optional_is_some(&deque->destructor)) {
+    cu_Destructor dtor = cu_Destructor_Optional_unwrap(&deque->destructor);
+    dtor(src);
+  }
+}
+
+cu_Deque_Result cu_Deque_create(cu_Allocator allocator, cu_Layout layout,
+    cu_Destructor_Optional destructor) {
+  CU_LAYOUT_CHECK(layout) {
+    return cu_Deque_Result_error(CU_DEQUE_ERROR_INVALID_LAYOUT);
+  }
+
+  size_t shift = 0;
+  while (((size_t)2 << shift) * layout.elem_size <= CU_DEQUE_BLOCK_BYTES) {
+    shift++;
+  }
+  while (((size_t)1 << shift) < CU_DEQUE_MIN_BLOCK_LENGTH) {
+    shift++;
+  }
+  if (layout.elem_size > SIZE_MAX >> shift) {
+    return cu_Deque_Result_error(CU_DEQUE_ERROR_INVALID_LAYOUT);
+  }
+
+  cu_Deque deque = {0};
+  deque.block_shift = shift;
+  deque.layout = layout;
+  deque.allocator = allocator;
+  deque.destructor = destructor;
+  return cu_Deque_Result_ok(deque);
+}
+
+void cu_Deque_destroy(cu_Deque *deque) {
+  CU_IF_NULL(deque) { return; }
+  cu_Deque_clear(deque);
+  if (deque->spare) {
+    cu_Allocator_Free(deque->allocator,
+        cu_Slice_create(deque->spare, cu_deque_block_bytes(deque)));
+    deque->spare = NULL;
+  }
+  if (deque->map) {
+    cu_Allocator_Free(deque->allocator,
+        cu_Slice_create(deque->map, deque->map_capacity * sizeof(void *)));
+    deque->map = NULL;
+  }
+  deque->map_capacity = 0;
+}
+
+cu_Deque_Error_Optional cu_Deque_push_back(cu_Deque *deque, const void *elem) {
+  CU_IF_NULL(deque) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_INVALID);
+  }
+  CU_IF_NULL(elem) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_INVALID);
+  }
+  CU_LAYOUT_CHECK(deque->layout) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_INVALID_LAYOUT);
+  }
+
+  if (deque->head + deque->length == deque->blocks << deque->block_shift &&
+      !cu_deque_add_back(deque)) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_OOM);
+  }
+  cu_Memory_memcpy(cu_deque_slot(deque, deque->length),
+      cu_Slice_create((void *)elem, deque->layout.elem_size));
+  deque->length++;
+  return cu_Deque_Error_Optional_none();
+}
+
+cu_Deque_Error_Optional cu_Deque_push_front(
+    cu_Deque *deque, const void *elem) {
+  CU_IF_NULL(deque) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_INVALID);
+  }
+  CU_IF_NULL(elem) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_INVALID);
+  }
+  CU_LAYOUT_CHECK(deque->layout) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_INVALID_LAYOUT);
+  }
+
+  if (deque->head == 0) {
+    if (!cu_deque_add_front(deque)) {
+      return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_OOM);
+    }
+    deque->head = cu_deque_block_length(deque);
+  }
+  deque->head--;
+  deque->length++;
+  cu_Memory_memcpy(cu_deque_slot(deque, 0),
+      cu_Slice_create((void *)elem, deque->layout.elem_size));
+  return cu_Deque_Error_Optional_none();
+}
+
+cu_Deque_Error_Optional cu_Deque_pop_back(cu_Deque *deque, void *out_elem) {
+  CU_IF_NULL(deque) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_INVALID);
+  }
+  if (deque->length == 0) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_EMPTY);
+  }
+
+  cu_deque_take(deque, cu_deque_slot(deque, deque->length - 1), out_elem);
+  deque->length--;
+  if (deque->length == 0) {
+    cu_deque_reset(deque);
+  } else if (((deque->head + deque->length) &
+                 (cu_deque_block_length(deque) - 1)) == 0) {
+    cu_deque_drop_back(deque);
+  }
+  return cu_Deque_Error_Optional_none();
+}
+
+cu_Deque_Error_Optional cu_Deque_pop_front(cu_Deque *deque, void *out_elem) {
+  CU_IF_NULL(deque) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_INVALID);
+  }
+  if (deque->length == 0) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_EMPTY);
+  }
+
+  cu_deque_take(deque, cu_deque_slot(deque, 0), out_elem);
+  deque->head++;
+  deque->length--;
+  if (deque->length == 0) {
+    cu_deque_reset(deque);
+  } else if (deque->head == cu_deque_block_length(deque)) {
+    cu_deque_release(deque, deque->map[deque->map_head]);
+    deque->map_head = (deque->map_head + 1) & (deque->map_capacity - 1);
+    deque->blocks--;
+    deque->head = 0;
+  }
+  return cu_Deque_Error_Optional_none();
+}
+
+cu_Deque_Error_Optional cu_Deque_append(
+    cu_Deque *deque, const void *elems, size_t count) {
+  CU_IF_NULL(deque) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_INVALID);
+  }
+  if (count == 0) {
+    return cu_Deque_Error_Optional_none();
+  }
+  CU_IF_NULL(elems) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_INVALID);
+  }
+  CU_LAYOUT_CHECK(deque->layout) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_INVALID_LAYOUT);
+  }
+
+  size_t block_length = cu_deque_block_length(deque);
+  size_t end = deque->head + deque->length;
+  if (count > SIZE_MAX - end - block_length ||
+      count > SIZE_MAX / deque->layout.elem_size) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_OOM);
+  }
+  size_t needed =
+      ((end + count + block_length - 1) >> deque->block_shift) - deque->blocks;
+  if (!cu_deque_reserve_map(deque, needed)) {
+    return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_OOM);
+  }
+  for (size_t added = 0; added < needed; ++added) {
+    if (!cu_deque_add_back(deque)) {
+      while (added-- > 0) {
+        cu_deque_drop_back(deque);
+      }
+      return cu_Deque_Error_Optional_some(CU_DEQUE_ERROR_OOM);
+    }
+  }
+
+  const unsigned char *src = (const unsigned char *)elems;
+  while (count > 0) {
+    size_t offset = (deque->head + deque->length) & (block_length - 1);
+    size_t n = CU_MIN(count, block_length - offset);
+    size_t bytes = n * deque->layout.elem_size;
+    cu_Memory_memcpy(cu_deque_slot(deque, deque->length),
+        cu_Slice_create((void *)src, bytes));
+    deque->length += n;
+    src += bytes;
+    count -= n;
+  }
+  return cu_Deque_Error_Optional_none();
+}
+
+void cu_Deque_clear(cu_Deque *deque) {
+  CU_IF_NULL(deque) { return; }
+  if (cu_Destructor_Optional_is_some(&deque->destructor)) {
+    cu_Destructor dtor = cu_Destructor_Optional_unwrap(&deque->destructor);
+    for (size_t i = 0; i < deque->length; ++i) {
+      dtor(cu_deque_slot(deque, i));
+    }
+  }
+  deque->length = 0;
+  cu_deque_reset(deque);
+}
+
+Ptr_Optional cu_Deque_at(const cu_Deque *deque, size_t index) {
+  CU_IF_NULL(deque) { return Ptr_Optional_none(); }
+  if (index >= deque->length) {
+    return Ptr_Optional_none();
+  }
+  return Ptr_Optional_some(cu_deque_slot(deque, index));
+}
+
+bool cu_Deque_iter(const cu_Deque *deque, size_t *index, void **out_elem) {
+  CU_IF_NULL(deque) { return false; }
+  CU_IF_NULL(index) { return false; }
+  CU_IF_NULL(out_elem) { return false; }
+
+  if (*index >= deque->length) {
+    return false;
+  }
+  *out_elem = cu_deque_slot(deque, *index);
+  (*index)++;
+  return true;
+}
@@ -24,6 +24,8 @@ void cu_DList_destroy(cu_DList *list) {
   if (!list) {
     return;
   }
+  cu_Allocator_FreeBuffer pending =
+      cu_Allocator_FreeBuffer_create(list->allocator);
   struct cu_DList_Node *n = list->head;
   while (n) {
     struct cu_DList_Node *next = n->next;
@@ -31,11 +33,12 @@ void cu_DList_destroy(cu_DList *list) {
       cu_Destructor dtor = cu_Destructor_Optional_unwrap(&list->destructor);
       dtor(n->data);
     }
-    cu_Allocator_Free(list->allocator,
+    cu_Allocator_FreeBuffer_push(&pending,
         cu_Slice_create(
             n, sizeof(struct cu_DList_Node) + list->layout.elem_size));
     n = next;
   }
+  cu_Allocator_FreeBuffer_flush(&pending);
   list->head = NULL;
   list->tail = NULL;
   list->length = 0;
@@ -0,0 +1,387 @@
+#include "collection/frozenmap.h"
+#include "collection/hashmap.h"
+#include "hash/hash.h"
+#include "memory/allocator.h"
+#include "object/optional.h"
+#include "object/result.h"
+#include <nostd.h>
+
+CU_RESULT_IMPL(cu_FrozenMap, cu_FrozenMap, cu_HashMap_Error)
+
+#define CU_FROZENMAP_MAGIC 0x4D465543u /* "CUFM" read back in native order */
+/** average number of keys per bucket */
+#define CU_FROZENMAP_LAMBDA 4
+/** seeds tried before a build gives up */
+#define CU_FROZENMAP_ATTEMPTS 16
+
+/*
+ * Keys are grouped into buckets by the high half of their hash. Buckets are
+ * placed largest first, each trying pilots 0, 1, 2, ... until every key of
+ * the bucket maps to a free slot. A pilot only perturbs the slot hash, so
+ * lookups redo the same computation with the stored pilot.
+ */
+
+static inline uint64_t cu_frozen_mix(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xFF51AFD7ED558CCDULL;
+  x ^= x >> 33;
+  x *= 0xC4CEB9FE1A85EC53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+static inline size_t cu_frozen_bucket(uint64_t hash, size_t buckets) {
+  return (size_t)((hash >> 32) % buckets);
+}
+
+static inline size_t cu_frozen_slot(
+    uint64_t hash, uint32_t pilot, size_t length) {
+  return (size_t)(cu_frozen_mix(hash ^ (pilot * 0x9E3779B97F4A7C15ULL)) %
+                  length);
+}
+
+static cu_FrozenMap cu_frozen_view(
+    const unsigned char *blob, const cu_FrozenMap_Header *hdr) {
+  cu_FrozenMap map;
+  map.blob = blob;
+  map.pilots = (const uint32_t *)(blob + hdr->pilots_offset);
+  map.keys = blob + hdr->keys_offset;
+  map.values = blob + hdr->values_offset;
+  map.length = (size_t)hdr->length;
+  map.buckets = (size_t)hdr->buckets;
+  map.key_size = (size_t)hdr->key_size;
+  map.value_size = (size_t)hdr->value_size;
+  map.key_stride = (size_t)hdr->key_stride;
+  map.value_stride = (size_t)hdr->value_stride;
+  map.seed = hdr->seed;
+  map.owner = cu_Allocator_Optional_none();
+  return map;
+}
+
+/** Scratch used while searching pilots, carved from one allocation. */
+typedef struct {
+  uint64_t *hashes;     /**< hash per key */
+  size_t *order;        /**< keys grouped by bucket */
+  size_t *start;        /**< first entry of each bucket in order */
+  size_t *placement;    /**< buckets, largest first */
+  size_t *by_size;      /**< counting sort buckets by size */
+  size_t *slots;        /**< final slot per key */
+  uint64_t *taken;      /**< occupied slots */
+  cu_Slice mem;         /**< the allocation itself */
+} cu_frozen_scratch;
+
+typedef enum {
+  CU_FROZEN_PLACED,
+  CU_FROZEN_RESEED,
+  CU_FROZEN_DUPLICATE,
+} cu_frozen_outcome;
+
+static bool cu_frozen_is_taken(const uint64_t *taken, size_t slot) {
+  return (taken[slot / 64] >> (slot % 64)) & 1;
+}
+
+static void cu_frozen_flip(uint64_t *taken, size_t slot) {
+  taken[slot / 64] ^= (uint64_t)1 << (slot % 64);
+}
+
+/* Try one seed, filling pilots and s->slots on success. */
+static cu_frozen_outcome cu_frozen_place(cu_frozen_scratch *s,
+    const unsigned char *const *keys, size_t key_size, size_t n,
+    size_t buckets, uint64_t seed, uint32_t *pilots) {
+  for (size_t b = 0; b <= buckets; ++b) {
+    s->start[b] = 0;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    s->hashes[i] = cu_Hash_Wy64(keys[i], key_size, seed);
+    s->start[cu_frozen_bucket(s->hashes[i], buckets) + 1]++;
+  }
+  size_t max_size = 0;
+  for (size_t b = 0; b < buckets; ++b) {
+    max_size = CU_MAX(max_size, s->start[b + 1]);
+    s->start[b + 1] += s->start[b];
+  }
+  for (size_t i = 0; i < n; ++i) {
+    size_t b = cu_frozen_bucket(s->hashes[i], buckets);
+    /* start[b] runs ahead while filling and is restored below */
+    s->order[s->start[b]++] = i;
+  }
+  for (size_t b = buckets; b > 0; --b) {
+    s->start[b] = s->start[b - 1];
+  }
+  s->start[0] = 0;
+
+  /* counting sort of the buckets, largest first */
+  for (size_t k = 0; k <= max_size + 1; ++k) {
+    s->by_size[k] = 0;
+  }
+  for (size_t b = 0; b < buckets; ++b) {
+    s->by_size[max_size - (s->start[b + 1] - s->start[b]) + 1]++;
+  }
+  for (size_t k = 0; k <= max_size; ++k) {
+    s->by_size[k + 1] += s->by_size[k];
+  }
+  for (size_t b = 0; b < buckets; ++b) {
+    size_t k = max_size - (s->start[b + 1] - s->start[b]);
+    s->placement[s->by_size[k]++] = b;
+  }
+
+  cu_Memory_memset(s->taken, 0, ((n + 63) / 64) * sizeof(uint64_t));
+  /* the last singleton bucket needs about n tries on average */
+  uint64_t limit = CU_MIN((uint64_t)UINT32_MAX, (uint64_t)n * 64 + 1024);
+  for (size_t p = 0; p < buckets; ++p) {
+    size_t b = s->placement[p];
+    const size_t *members = s->order + s->start[b];
+    size_t k = s->start[b + 1] - s->start[b];
+    pilots[b] = 0;
+    if (k == 0) {
+      continue;
+    }
+    for (size_t i = 0; i < k; ++i) {
+      for (size_t j = i + 1; j < k; ++j) {
+        if (s->hashes[members[i]] != s->hashes[members[j]]) {
+          continue;
+        }
+        if (cu_Memory_memcmp(
+                cu_Slice_create((void *)keys[members[i]], key_size),
+                cu_Slice_create((void *)keys[members[j]], key_size))) {
+          return CU_FROZEN_DUPLICATE;
+        }
+        return CU_FROZEN_RESEED;
+      }
+    }
+    uint64_t pilot = 0;
+    for (; pilot < limit; ++pilot) {
+      size_t placed = 0;
+      for (; placed < k; ++placed) {
+        size_t slot = cu_frozen_slot(
+            s->hashes[members[placed]], (uint32_t)pilot, n);
+        if (cu_frozen_is_taken(s->taken, slot)) {
+          break;
+        }
+        cu_frozen_flip(s->taken, slot);
+        s->slots[members[placed]] = slot;
+      }
+      if (placed == k) {
+        break;
+      }
+      while (placed > 0) {
+        cu_frozen_flip(s->taken, s->slots[members[--placed]]);
+      }
+    }
+    if (pilot == limit) {
+      return CU_FROZEN_RESEED;
+    }
+    pilots[b] = (uint32_t)pilot;
+  }
+  return CU_FROZEN_PLACED;
+}
+
+static cu_FrozenMap_Result cu_frozen_build(cu_Allocator allocator,
+    cu_Layout key_layout, cu_Layout value_layout,
+    const unsigned char *const *keys, const unsigned char *const *values,
+    size_t n, cu_State *state) {
+  CU_LAYOUT_CHECK(key_layout) {
+    return cu_FrozenMap_Result_error(CU_HASHMAP_ERROR_INVALID_LAYOUT);
+  }
+  if (value_layout.alignment == 0 ||
+      key_layout.alignment > CU_FROZENMAP_ALIGN ||
+      value_layout.alignment > CU_FROZENMAP_ALIGN) {
+    return cu_FrozenMap_Result_error(CU_HASHMAP_ERROR_INVALID_LAYOUT);
+  }
+  size_t buckets = n / CU_FROZENMAP_LAMBDA + 1;
+  cu_FrozenMap_Header hdr;
+  cu_Memory_memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = CU_FROZENMAP_MAGIC;
+  hdr.version = CU_FROZENMAP_VERSION;
+  hdr.length = n;
+  hdr.buckets = buckets;
+  hdr.key_size = key_layout.elem_size;
+  hdr.value_size = value_layout.elem_size;
+  hdr.key_stride = CU_ALIGN_UP(key_layout.elem_size, key_layout.alignment);
+  hdr.value_stride =
+      CU_ALIGN_UP(value_layout.elem_size, value_layout.alignment);
+  if (n > SIZE_MAX / 4 / (hdr.key_stride + hdr.value_stride + 16)) {
+    return cu_FrozenMap_Result_error(CU_HASHMAP_ERROR_OOM);
+  }
+  hdr.pilots_offset = CU_ALIGN_UP(sizeof(hdr), CU_FROZENMAP_ALIGN);
+  hdr.keys_offset = CU_ALIGN_UP(
+      hdr.pilots_offset + buckets * sizeof(uint32_t), CU_FROZENMAP_ALIGN);
+  hdr.values_offset =
+      CU_ALIGN_UP(hdr.keys_offset + n * hdr.key_stride, CU_FROZENMAP_ALIGN);
+  hdr.size =
+      CU_ALIGN_UP(hdr.values_offset + n * hdr.value_stride, CU_FROZENMAP_ALIGN);
+
+  cu_IoSlice_Result blob_mem = cu_Allocator_Alloc(
+      allocator, cu_Layout_create((size_t)hdr.size, CU_FROZENMAP_ALIGN));
+  if (!cu_IoSlice_Result_is_ok(&blob_mem)) {
+    return cu_FrozenMap_Result_error(CU_HASHMAP_ERROR_OOM);
+  }
+  unsigned char *blob = (unsigned char *)blob_mem.value.ptr;
+  cu_Memory_memset(blob, 0, (size_t)hdr.size);
+  uint32_t *pilots = (uint32_t *)(blob + hdr.pilots_offset);
+
+  cu_frozen_scratch s;
+  size_t words = (n + 63) / 64;
+  size_t scratch_size = n * sizeof(uint64_t) + words * sizeof(uint64_t) +
+                        (3 * n + 3 * buckets + 3) * sizeof(size_t);
+  cu_IoSlice_Result scratch = cu_Allocator_Alloc(
+      allocator, cu_Layout_create(scratch_size, _Alignof(uint64_t)));
+  if (!cu_IoSlice_Result_is_ok(&scratch)) {
+    cu_Allocator_Free(allocator, blob_mem.value);
+    return cu_FrozenMap_Result_error(CU_HASHMAP_ERROR_OOM);
+  }
+  s.mem = scratch.value;
+  s.hashes = (uint64_t *)s.mem.ptr;
+  s.taken = s.hashes + n;
+  s.order = (size_t *)(s.taken + words);
+  s.slots = s.order + n;
+  s.start = s.slots + n;
+  s.placement = s.start + buckets + 1;
+  /* bucket sizes never exceed n, and there are never more than n + 1 */
+  s.by_size = s.placement + buckets;
+
+  cu_frozen_outcome outcome = CU_FROZEN_RESEED;
+  for (size_t attempt = 0;
+      attempt < CU_FROZENMAP_ATTEMPTS && outcome == CU_FROZEN_RESEED;
+      ++attempt) {
+    hdr.seed = ((uint64_t)cu_State_next(state) << 32) | cu_State_next(state);
+    outcome = n == 0 ? CU_FROZEN_PLACED
+                     : cu_frozen_place(&s, keys, key_layout.elem_size, n,
+                           buckets, hdr.seed, pilots);
+  }
+  if (outcome == CU_FROZEN_PLACED) {
+    for (size_t i = 0; i < n; ++i) {
+      cu_Memory_memcpy(blob + hdr.keys_offset + s.slots[i] * hdr.key_stride,
+          cu_Slice_create((void *)keys[i], key_layout.elem_size));
+      cu_Memory_memcpy(
+          blob + hdr.values_offset + s.slots[i] * hdr.value_stride,
+          cu_Slice_create((void *)values[i], value_layout.elem_size));
+    }
+  }
+  cu_Allocator_Free(allocator, s.mem);
+  if (outcome != CU_FROZEN_PLACED) {
+    cu_Allocator_Free(allocator, blob_mem.value);
+    return cu_FrozenMap_Result_error(outcome == CU_FROZEN_DUPLICATE
+                                         ? CU_HASHMAP_ERROR_INVALID
+                                         : CU_HASHMAP_ERROR_OOM);
+  }
+  cu_Memory_memcpy(blob, cu_Slice_create(&hdr, sizeof(hdr)));
+  cu_FrozenMap map = cu_frozen_view(blob, &hdr);
+  map.owner = cu_Allocator_Optional_some(allocator);
+  return cu_FrozenMap_Result_ok(map);
+}
+
+/* Packed arrays and hashmap slots are both passed on as pointer arrays. */
+static cu_IoSlice_Result cu_frozen_pointers(
+    cu_Allocator allocator, size_t count) {
+  return cu_Allocator_Alloc(allocator,
+      cu_Layout_create(
+          (2 * count + 1) * sizeof(void *), _Alignof(const void *)));
+}
+
+cu_FrozenMap_Result cu_FrozenMap_build(
+    cu_Allocator allocator, const cu_HashMap *map, cu_State state) {
+  CU_IF_NULL(map) {
+    return cu_FrozenMap_Result_error(CU_HASHMAP_ERROR_INVALID);
+  }
+  cu_IoSlice_Result mem = cu_frozen_pointers(allocator, map->length);
+  if (!cu_IoSlice_Result_is_ok(&mem)) {
+    return cu_FrozenMap_Result_error(CU_HASHMAP_ERROR_OOM);
+  }
+  const unsigned char **keys = (const unsigned char **)mem.value.ptr;
+  const unsigned char **values = keys + map->length;
+  size_t index = 0;
+  size_t n = 0;
+  void *key;
+  void *value;
+  while (n < map->length && cu_HashMap_iter(map, &index, &key, &value)) {
+    keys[n] = (const unsigned char *)key;
+    values[n] = (const unsigned char *)value;
+    n++;
+  }
+  cu_FrozenMap_Result res = cu_frozen_build(
+      allocator, map->key_layout, map->value_layout, keys, values, n, &state);
+  cu_Allocator_Free(allocator, mem.value);
+  return res;
+}
+
+cu_FrozenMap_Result cu_FrozenMap_build_arrays(cu_Allocator allocator,
+    cu_Layout key_layout, cu_Layout value_layout, const void *keys,
+    const void *values, size_t count, cu_State state) {
+  if (count > SIZE_MAX / (2 * sizeof(void *)) - 1) {
+    return cu_FrozenMap_Result_error(CU_HASHMAP_ERROR_OOM);
+  }
+  cu_IoSlice_Result mem = cu_frozen_pointers(allocator, count);
+  if (!cu_IoSlice_Result_is_ok(&mem)) {
+    return cu_FrozenMap_Result_error(CU_HASHMAP_ERROR_OOM);
+  }
+  const unsigned char **key_ptrs = (const unsigned char **)mem.value.ptr;
+  const unsigned char **value_ptrs = key_ptrs + count;
+  for (size_t i = 0; i < count; ++i) {
+    key_ptrs[i] = (const unsigned char *)keys + i * key_layout.elem_size;
+    value_ptrs[i] =
+        (const unsigned char *)values + i * value_layout.elem_size;
+  }
+  cu_FrozenMap_Result res = cu_frozen_build(allocator, key_layout,
+      value_layout, key_ptrs, value_ptrs, count, &state);
+  cu_Allocator_Free(allocator, mem.value);
+  return res;
+}
+
+cu_FrozenMap_Result cu_FrozenMap_from_bytes(cu_Slice blob) {
+  cu_FrozenMap_Header hdr;
+  if (!blob.ptr || blob.length < sizeof(hdr) ||
+      (uintptr_t)blob.ptr % CU_FROZENMAP_ALIGN != 0) {
+    return cu_FrozenMap_Result_error(CU_HASHMAP_ERROR_INVALID);
+  }
+  cu_Memory_memcpy(&hdr, cu_Slice_create(blob.ptr, sizeof(hdr)));
+  if (hdr.magic != CU_FROZENMAP_MAGIC ||
+      hdr.version != CU_FROZENMAP_VERSION || hdr.size > blob.length ||
+      hdr.key_size == 0 || hdr.key_stride < hdr.key_size ||
+      hdr.value_stride < hdr.value_size ||
+      (hdr.length > 0 && hdr.buckets == 0) ||
+      !cu_section_fits(hdr.pilots_offset, hdr.buckets, sizeof(uint32_t),
+          hdr.size, CU_FROZENMAP_ALIGN) ||
+      !cu_section_fits(hdr.keys_offset, hdr.length, hdr.key_stride, hdr.size,
+          CU_FROZENMAP_ALIGN) ||
+      !cu_section_fits(hdr.values_offset, hdr.length, hdr.value_stride,
+          hdr.size, CU_FROZENMAP_ALIGN)) {
+    return cu_FrozenMap_Result_error(CU_HASHMAP_ERROR_INVALID);
+  }
+  return cu_FrozenMap_Result_ok(
+      cu_frozen_view((const unsigned char *)blob.ptr, &hdr));
+}
+
+cu_Slice cu_FrozenMap_bytes(const cu_FrozenMap *map) {
+  cu_FrozenMap_Header hdr;
+  cu_Memory_memcpy(&hdr, cu_Slice_create((void *)map->blob, sizeof(hdr)));
+  return cu_Slice_create((void *)map->blob, (size_t)hdr.size);
+}
+
+void cu_FrozenMap_destroy(cu_FrozenMap *map) {
+  if (!map || !map->blob) {
+    return;
+  }
+  if (cu_Allocator_Optional_is_some(&map->owner)) {
+    cu_Allocator_Free(
+        cu_Allocator_Optional_unwrap(&map->owner), cu_FrozenMap_bytes(map));
+  }
+  map->blob = NULL;
+  map->length = 0;
+}
+
+Ptr_Optional cu_FrozenMap_get(const cu_FrozenMap *map, const void *key) {
+  CU_IF_NULL(map) { return Ptr_Optional_none(); }
+  if (map->length == 0) {
+    return Ptr_Optional_none();
+  }
+  uint64_t hash = cu_Hash_Wy64(key, map->key_size, map->seed);
+  size_t slot = cu_frozen_slot(
+      hash, map->pilots[cu_frozen_bucket(hash, map->buckets)], map->length);
+  const unsigned char *stored = map->keys + slot * map->key_stride;
+  if (!cu_Memory_memcmp(cu_Slice_create((void *)stored, map->key_size),
+          cu_Slice_create((void *)key, map->key_size))) {
+    return Ptr_Optional_none();
+  }
+  return Ptr_Optional_some((void *)(map->values + slot * map->value_stride));
+}
@@ -0,0 +1,266 @@
+#include "collection/hashfile.h"
+
+#if !CU_FREESTANDING
+
+#include "collection/hashmap.h"
+#include "hash/hash.h"
+#include "io/file.h"
+#include "memory/allocator.h"
+#include "object/optional.h"
+#include "object/result.h"
+#include <nostd.h>
+
+CU_RESULT_IMPL(cu_HashFile, cu_HashFile, cu_Io_Error)
+
+#define CU_HASHFILE_MAGIC 0x46485543u /* "CUHF" read back in native order */
+/** bytes gathered before each write to the file */
+#define CU_HASHFILE_BUFFER 65536
+
+static cu_Io_Error cu_hashfile_error(cu_Io_ErrorKind kind) {
+  cu_Io_Error err = {.kind = kind, .errnum = Size_Optional_none()};
+  return err;
+}
+
+/** Buffered sequential output tracking the current file offset. */
+typedef struct {
+  cu_File *file;
+  unsigned char *buffer;
+  size_t used;
+  uint64_t offset;
+  cu_Io_Error_Optional error;
+} cu_hashfile_writer;
+
+static void cu_hashfile_flush(cu_hashfile_writer *w) {
+  if (w->used > 0 && cu_Io_Error_Optional_is_none(&w->error)) {
+    w->error = cu_File_write(w->file, cu_Slice_create(w->buffer, w->used));
+  }
+  w->used = 0;
+}
+
+/* Append @p length bytes, zeros when @p data is NULL. */
+static void cu_hashfile_emit(
+    cu_hashfile_writer *w, const void *data, size_t length) {
+  const unsigned char *src = (const unsigned char *)data;
+  w->offset += length;
+  while (length > 0) {
+    if (w->used == CU_HASHFILE_BUFFER) {
+      cu_hashfile_flush(w);
+    }
+    size_t n = CU_MIN(length, (size_t)CU_HASHFILE_BUFFER - w->used);
+    if (src) {
+      cu_Memory_memcpy(w->buffer + w->used, cu_Slice_create((void *)src, n));
+      src += n;
+    } else {
+      cu_Memory_memset(w->buffer + w->used, 0, n);
+    }
+    w->used += n;
+    length -= n;
+  }
+}
+
+static void cu_hashfile_pad(cu_hashfile_writer *w, uint64_t offset) {
+  cu_hashfile_emit(w, NULL, (size_t)(offset - w->offset));
+}
+
+cu_Io_Error_Optional cu_HashFile_write(
+    cu_File *file, const cu_HashMap *map, cu_Allocator allocator) {
+  CU_IF_NULL(map) {
+    return cu_Io_Error_Optional_some(
+        cu_hashfile_error(CU_IO_ERROR_KIND_INVALID_INPUT));
+  }
+  CU_IF_NULL(file) {
+    return cu_Io_Error_Optional_some(
+        cu_hashfile_error(CU_IO_ERROR_KIND_INVALID_INPUT));
+  }
+  cu_Layout key_layout = map->key_layout;
+  cu_Layout value_layout = map->value_layout;
+  size_t align = CU_MAX(key_layout.alignment, value_layout.alignment);
+  if (align > CU_HASHFILE_ALIGN) {
+    return cu_Io_Error_Optional_some(
+        cu_hashfile_error(CU_IO_ERROR_KIND_INVALID_INPUT));
+  }
+
+  cu_HashFile_Header hdr;
+  cu_Memory_memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = CU_HASHFILE_MAGIC;
+  hdr.version = CU_HASHFILE_VERSION;
+  hdr.seed = map->seed;
+  hdr.length = map->length;
+  /* a load of at most 3/4 keeps probe sequences short */
+  size_t capacity = 8;
+  while (capacity / 4 * 3 < map->length) {
+    if (capacity > SIZE_MAX / 2 / sizeof(cu_HashFile_Slot)) {
+      return cu_Io_Error_Optional_some(
+          cu_hashfile_error(CU_IO_ERROR_KIND_OUT_OF_MEMORY));
+    }
+    capacity *= 2;
+  }
+  hdr.capacity = capacity;
+  hdr.key_size = key_layout.elem_size;
+  hdr.value_size = value_layout.elem_size;
+  hdr.value_offset = CU_ALIGN_UP(key_layout.elem_size, value_layout.alignment);
+  hdr.record_stride = CU_ALIGN_UP(hdr.value_offset + hdr.value_size, align);
+  hdr.slots_offset = CU_ALIGN_UP(sizeof(hdr), CU_HASHFILE_ALIGN);
+  size_t slots_size = capacity * sizeof(cu_HashFile_Slot);
+  hdr.heap_offset =
+      CU_ALIGN_UP(hdr.slots_offset + slots_size, CU_HASHFILE_ALIGN);
+  hdr.size = hdr.heap_offset + hdr.length * hdr.record_stride;
+
+  cu_IoSlice_Result slots_mem = cu_Allocator_Alloc(allocator,
+      cu_Layout_create(slots_size, _Alignof(cu_HashFile_Slot)));
+  if (!cu_IoSlice_Result_is_ok(&slots_mem)) {
+    return cu_Io_Error_Optional_some(
+        cu_hashfile_error(CU_IO_ERROR_KIND_OUT_OF_MEMORY));
+  }
+  cu_IoSlice_Result buffer_mem = cu_Allocator_Alloc(
+      allocator, cu_Layout_create(CU_HASHFILE_BUFFER, CU_HASHFILE_ALIGN));
+  if (!cu_IoSlice_Result_is_ok(&buffer_mem)) {
+    cu_Allocator_Free(allocator, slots_mem.value);
+    return cu_Io_Error_Optional_some(
+        cu_hashfile_error(CU_IO_ERROR_KIND_OUT_OF_MEMORY));
+  }
+  cu_HashFile_Slot *slots = (cu_HashFile_Slot *)slots_mem.value.ptr;
+  cu_Memory_memset(slots, 0, slots_size);
+
+  /* records are laid out in iteration order, which both passes share */
+  size_t index = 0;
+  uint64_t offset = hdr.heap_offset;
+  void *key;
+  void *value;
+  while (cu_HashMap_iter(map, &index, &key, &value)) {
+    uint64_t hash = cu_Hash_Wy64(key, key_layout.elem_size, hdr.seed);
+    size_t i = (size_t)hash & (capacity - 1);
+    while (slots[i].offset != 0) {
+      i = (i + 1) & (capacity - 1);
+    }
+    slots[i].hash = hash;
+    slots[i].offset = offset;
+    offset += hdr.record_stride;
+  }
+
+  cu_hashfile_writer w = {file, (unsigned char *)buffer_mem.value.ptr, 0, 0,
+      cu_Io_Error_Optional_none()};
+  cu_hashfile_emit(&w, &hdr, sizeof(hdr));
+  cu_hashfile_pad(&w, hdr.slots_offset);
+  cu_hashfile_emit(&w, slots, slots_size);
+  cu_hashfile_pad(&w, hdr.heap_offset);
+  index = 0;
+  while (cu_HashMap_iter(map, &index, &key, &value)) {
+    uint64_t start = w.offset;
+    cu_hashfile_emit(&w, key, key_layout.elem_size);
+    cu_hashfile_pad(&w, start + hdr.value_offset);
+    cu_hashfile_emit(&w, value, value_layout.elem_size);
+    cu_hashfile_pad(&w, start + hdr.record_stride);
+  }
+  cu_hashfile_flush(&w);
+
+  cu_Allocator_Free(allocator, buffer_mem.value);
+  cu_Allocator_Free(allocator, slots_mem.value);
+  return w.error;
+}
+
+cu_HashFile_Result cu_HashFile_from_bytes(cu_Slice bytes) {
+  cu_HashFile_Header hdr;
+  cu_Io_Error invalid = cu_hashfile_error(CU_IO_ERROR_KIND_INVALID_DATA);
+  if (!bytes.ptr || bytes.length < sizeof(hdr) ||
+      (uintptr_t)bytes.ptr % CU_HASHFILE_ALIGN != 0) {
+    return cu_HashFile_Result_error(invalid);
+  }
+  cu_Memory_memcpy(&hdr, cu_Slice_create(bytes.ptr, sizeof(hdr)));
+  if (hdr.magic != CU_HASHFILE_MAGIC || hdr.version != CU_HASHFILE_VERSION ||
+      hdr.size > bytes.length || hdr.key_size == 0 ||
+      hdr.capacity <= hdr.length || (hdr.capacity & (hdr.capacity - 1)) ||
+      hdr.value_offset < hdr.key_size ||
+      hdr.record_stride < hdr.value_offset + hdr.value_size ||
+      hdr.value_size > hdr.record_stride ||
+      !cu_section_fits(hdr.slots_offset, hdr.capacity,
+          sizeof(cu_HashFile_Slot), hdr.size, CU_HASHFILE_ALIGN) ||
+      !cu_section_fits(hdr.heap_offset, hdr.length, hdr.record_stride,
+          hdr.size, CU_HASHFILE_ALIGN)) {
+    return cu_HashFile_Result_error(invalid);
+  }
+
+  cu_HashFile file;
+  cu_Memory_memset(&file, 0, sizeof(file));
+  file.base = (const unsigned char *)bytes.ptr;
+  file.size = (size_t)hdr.size;
+  file.slots = (const cu_HashFile_Slot *)(file.base + hdr.slots_offset);
+  file.mask = (size_t)hdr.capacity - 1;
+  file.length = (size_t)hdr.length;
+  file.key_size = (size_t)hdr.key_size;
+  file.value_offset = (size_t)hdr.value_offset;
+  /* slot offsets are checked on use so a corrupt slot cannot escape */
+  file.heap_offset = (size_t)hdr.heap_offset;
+  file.record_stride = (size_t)hdr.record_stride;
+  file.record_limit = hdr.length == 0
+                          ? 0
+                          : (size_t)(hdr.heap_offset +
+                                     (hdr.length - 1) * hdr.record_stride);
+  file.seed = hdr.seed;
+  file.mapped = false;
+  return cu_HashFile_Result_ok(file);
+}
+
+cu_HashFile_Result cu_HashFile_open(cu_Slice path, cu_Allocator allocator) {
+  cu_File_Options options = {0};
+  cu_File_Options_read(&options);
+  cu_File_Result fres = cu_File_open(path, options, allocator);
+  if (!cu_File_Result_is_ok(&fres)) {
+    return cu_HashFile_Result_error(cu_File_Result_unwrap_error(&fres));
+  }
+  cu_File handle = cu_File_Result_unwrap(&fres);
+  cu_IoSlice_Result map = cu_File_map(&handle);
+  cu_File_close(&handle);
+  if (!cu_IoSlice_Result_is_ok(&map)) {
+    return cu_HashFile_Result_error(cu_IoSlice_Result_unwrap_error(&map));
+  }
+  cu_HashFile_Result res = cu_HashFile_from_bytes(map.value);
+  if (!cu_HashFile_Result_is_ok(&res)) {
+    cu_File_unmap(map.value);
+    return res;
+  }
+  res.value.size = map.value.length;
+  res.value.mapped = true;
+  return res;
+}
+
+void cu_HashFile_close(cu_HashFile *file) {
+  CU_IF_NULL(file) { return; }
+  if (file->mapped) {
+    cu_File_unmap(cu_Slice_create((void *)file->base, file->size));
+  }
+  cu_Memory_memset(file, 0, sizeof(*file));
+}
+
+/* Whether @p offset is the start of one of the records in the heap. */
+static inline bool cu_hashfile_is_record(
+    const cu_HashFile *file, uint64_t offset) {
+  return offset >= file->heap_offset && offset <= file->record_limit &&
+         (offset - file->heap_offset) % file->record_stride == 0;
+}
+
+Ptr_Optional cu_HashFile_get(const cu_HashFile *file, const void *key) {
+  CU_IF_NULL(file) { return Ptr_Optional_none(); }
+  if (file->length == 0) {
+    return Ptr_Optional_none();
+  }
+  uint64_t hash = cu_Hash_Wy64(key, file->key_size, file->seed);
+  size_t i = (size_t)hash & file->mask;
+  for (size_t probes = 0; probes <= file->mask; ++probes) {
+    const cu_HashFile_Slot *slot = &file->slots[i];
+    if (slot->offset == 0) {
+      break;
+    }
+    if (slot->hash == hash && cu_hashfile_is_record(file, slot->offset)) {
+      const unsigned char *record = file->base + slot->offset;
+      if (cu_Memory_memcmp(cu_Slice_create((void *)record, file->key_size),
+              cu_Slice_create((void *)key, file->key_size))) {
+        return Ptr_Optional_some((void *)(record + file->value_offset));
+      }
+    }
+    i = (i + 1) & file->mask;
+  }
+  return Ptr_Optional_none();
+}
+
+#endif
@@ -5,16 +5,104 @@
 #include "object/result.h"
 #include "utility.h"
 #include <nostd.h>
-#include <stdalign.h>
 #include <stddef.h>
+#include <stdint.h>
 
 CU_RESULT_IMPL(cu_HashMap, cu_HashMap, cu_HashMap_Error)
 CU_OPTIONAL_IMPL(cu_HashMap_Error, cu_HashMap_Error)
 CU_OPTIONAL_IMPL(cu_HashMap_HashFn, cu_HashMap_HashFn)
 CU_OPTIONAL_IMPL(cu_HashMap_EqualsFn, cu_HashMap_EqualsFn)
 
+/*
+ * Slots are probed linearly, but a whole window of control bytes is compared
+ * per step. A window may start at any slot, so the first GROUP - 1 control
+ * bytes are mirrored past the end of the table and a window never wraps.
+ * Without tombstones the first empty slot ends every probe sequence.
+ *
+ * While an incremental rehash is in flight the previous table stays alive as
+ * map->old. A cursor sweeps it from the front, and every slot it has passed
+ * or whose entry was removed reads MOVED, which keeps probe sequences in the
+ * old table intact without matching anything.
+ *
+ * Before that the control bytes of the new table are emptied a chunk per
+ * update while it waits as map->next. Probes start anywhere, so the table
+ * only goes live once all of them are set; until then inserts keep filling
+ * the current table past its load limit, which the headroom above 7/8
+ * absorbs many times over.
+ */
+
+#if (CU_COMPILER_GCC || CU_COMPILER_CLANG) && defined(__SSE2__)
+#define CU_HASHMAP_SSE2 1
+#include <emmintrin.h>
+#define CU_HASHMAP_GROUP 16
+/** bits per slot in a match mask */
+#define CU_HASHMAP_LANE 1
+#else
+#define CU_HASHMAP_SSE2 0
+#define CU_HASHMAP_GROUP sizeof(size_t)
+#define CU_HASHMAP_LANE 8
+#define CU_HASHMAP_LO (SIZE_MAX / 0xFF)
+#define CU_HASHMAP_HI (CU_HASHMAP_LO * 0x80)
+#endif
+
+#define CU_HASHMAP_EMPTY 0x80
+/** slot of the old table whose entry was migrated or removed */
+#define CU_HASHMAP_MOVED 0xFE
+/** smallest step that finishes a migration before the new table fills */
+#define CU_HASHMAP_MIN_STEP 2
+/** control bytes of a pending table emptied per update */
+#define CU_HASHMAP_CLEAR_CHUNK 4096
+
+/** one bit (SSE2) or one byte (SWAR) per slot of a window */
+typedef size_t cu_hashmap_mask;
+
+static inline cu_hashmap_mask cu_hashmap_match(
+    const uint8_t *ctrl, uint8_t byte) {
+#if CU_HASHMAP_SSE2
+  __m128i window = _mm_loadu_si128((const __m128i *)ctrl);
+  return (cu_hashmap_mask)_mm_movemask_epi8(
+      _mm_cmpeq_epi8(window, _mm_set1_epi8((char)byte)));
+#else
+  /* assembled in address order so the lowest bit is always the first slot */
+  size_t window = 0;
+  for (size_t i = 0; i < CU_HASHMAP_GROUP; ++i) {
+    window |= (size_t)ctrl[i] << (8 * i);
+  }
+  size_t x = window ^ (CU_HASHMAP_LO * byte);
+  /* may flag a byte above a real match, never one below it */
+  return (x - CU_HASHMAP_LO) & ~x & CU_HASHMAP_HI;
+#endif
+}
+
+static inline size_t cu_hashmap_first(cu_hashmap_mask mask) {
+  return cu_count_trailing_zeros(mask) / CU_HASHMAP_LANE;
+}
+
+/* Custom hashes are often the identity, fold them so both halves are mixed. */
+static uint64_t cu_hashmap_fold(uint64_t h) {
+  h ^= h >> 32;
+  h *= 0x9E3779B97F4A7C15ULL;
+  h ^= h >> 29;
+  return h;
+}
+
 static uint64_t cu_HashMap_default_hash(const void *key, size_t key_size) {
-  return cu_Hash_FNV1a64(key, key_size);
+  return cu_Hash_Wy64(key, key_size, 0);
+}
+
+/*
+ * The default and seeded hashes take the seed directly, custom ones are
+ * salted after.
+ */
+static uint64_t cu_HashMap_hash(const cu_HashMap *map, const void *key) {
+  if (map->seeded_hash_fn) {
+    return map->seeded_hash_fn(key, map->key_layout.elem_size, map->seed);
+  }
+  if (map->hash_fn == cu_HashMap_default_hash) {
+    return cu_Hash_Wy64(key, map->key_layout.elem_size, map->seed);
+  }
+  return cu_hashmap_fold(
+      map->hash_fn(key, map->key_layout.elem_size) ^ map->seed);
 }
 
 static bool cu_HashMap_default_equals(
@@ -23,85 +111,260 @@ static bool cu_HashMap_default_equals(
              cu_Slice_create((void *)b, key_size)) == true;
 }
 
-static cu_HashMap_Bucket *cu_HashMap_lookup_bucket(
-    const cu_HashMap *map, const void *key, uint64_t hash) {
-  size_t mask = map->capacity - 1;
-  size_t idx = hash & mask;
+/** the low seven bits tag the slot, the rest pick the home slot */
+static inline uint8_t cu_hashmap_h2(uint64_t hash) {
+  return (uint8_t)(hash & 0x7F);
+}
+
+static inline size_t cu_hashmap_home(uint64_t hash, size_t capacity) {
+  return (size_t)(hash >> 7) & (capacity - 1);
+}
+
+static inline size_t cu_hashmap_key_stride(const cu_HashMap *map) {
+  return CU_ALIGN_UP(map->key_layout.elem_size, map->key_layout.alignment);
+}
+
+static inline size_t cu_hashmap_value_stride(const cu_HashMap *map) {
+  return CU_ALIGN_UP(map->value_layout.elem_size, map->value_layout.alignment);
+}
+
+static inline void *cu_hashmap_key(
+    const cu_HashMap *map, const cu_HashMap_Table *t, size_t slot) {
+  return t->keys + slot * cu_hashmap_key_stride(map);
+}
+
+static inline void *cu_hashmap_value(
+    const cu_HashMap *map, const cu_HashMap_Table *t, size_t slot) {
+  return t->values + slot * cu_hashmap_value_stride(map);
+}
+
+static inline void cu_hashmap_set_ctrl(
+    cu_HashMap_Table *t, size_t slot, uint8_t byte) {
+  t->ctrl[slot] = byte;
+  if (slot < CU_HASHMAP_GROUP - 1) {
+    t->ctrl[t->capacity + slot] = byte;
+  }
+}
+
+static inline size_t cu_hashmap_max_load(size_t capacity) {
+  return capacity - capacity / 8;
+}
+
+/* Layout of a table: [ctrl | pad | keys | pad | values]. */
+static size_t cu_hashmap_keys_offset(const cu_HashMap *map, size_t capacity) {
+  return CU_ALIGN_UP(capacity + CU_HASHMAP_GROUP, map->key_layout.alignment);
+}
+
+static size_t cu_hashmap_values_offset(
+    const cu_HashMap *map, size_t capacity) {
+  return CU_ALIGN_UP(cu_hashmap_keys_offset(map, capacity) +
+                         capacity * cu_hashmap_key_stride(map),
+      map->value_layout.alignment);
+}
+
+static cu_Layout cu_hashmap_table_layout(
+    const cu_HashMap *map, size_t capacity) {
+  return cu_Layout_create(cu_hashmap_values_offset(map, capacity) +
+                              capacity * cu_hashmap_value_stride(map),
+      CU_MAX(map->key_layout.alignment, map->value_layout.alignment));
+}
+
+static cu_HashMap_Error_Optional cu_hashmap_table_alloc(
+    const cu_HashMap *map, size_t capacity, cu_HashMap_Table *out) {
+  size_t per_slot =
+      1 + cu_hashmap_key_stride(map) + cu_hashmap_value_stride(map);
+  if (capacity > (SIZE_MAX / 2) / per_slot) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_OOM);
+  }
+  cu_IoSlice_Result mem = cu_Allocator_Alloc(
+      map->allocator, cu_hashmap_table_layout(map, capacity));
+  if (!cu_IoSlice_Result_is_ok(&mem)) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_OOM);
+  }
+  unsigned char *base = (unsigned char *)mem.value.ptr;
+  out->ctrl = base;
+  out->keys = base + cu_hashmap_keys_offset(map, capacity);
+  out->values = base + cu_hashmap_values_offset(map, capacity);
+  out->capacity = capacity;
+  return cu_HashMap_Error_Optional_none();
+}
+
+static void cu_hashmap_table_free(
+    const cu_HashMap *map, cu_HashMap_Table *t) {
+  if (t->ctrl) {
+    cu_Allocator_Free(map->allocator,
+        cu_Slice_create(
+            t->ctrl, cu_hashmap_table_layout(map, t->capacity).elem_size));
+  }
+  t->ctrl = NULL;
+  t->keys = NULL;
+  t->values = NULL;
+  t->capacity = 0;
+}
+
+/**
+ * Look @p key up in @p t. Returns true with its slot in @p slot when found,
+ * otherwise false with the first empty slot of its probe sequence.
+ */
+static bool cu_hashmap_probe(const cu_HashMap *map, const cu_HashMap_Table *t,
+    const void *key, uint64_t hash, size_t *slot) {
+  size_t mask = t->capacity - 1;
+  size_t pos = cu_hashmap_home(hash, t->capacity);
+  uint8_t h2 = cu_hashmap_h2(hash);
   for (;;) {
-    cu_HashMap_Bucket *b = &map->buckets[idx];
-    if (!b->used) {
-      return NULL;
+    const uint8_t *window = t->ctrl + pos;
+    cu_hashmap_mask empty = cu_hashmap_match(window, CU_HASHMAP_EMPTY);
+    cu_hashmap_mask match = cu_hashmap_match(window, h2);
+    if (empty) {
+      /* slots past the first empty one belong to other chains */
+      match &= (empty & (~empty + 1)) - 1;
+    }
+    while (match) {
+      size_t i = (pos + cu_hashmap_first(match)) & mask;
+      if (map->equals_fn(
+              cu_hashmap_key(map, t, i), key, map->key_layout.elem_size)) {
+        *slot = i;
+        return true;
+      }
+      match &= match - 1;
     }
-    if (!b->deleted && b->hash == hash &&
-        map->equals_fn(b->key, key, map->key_layout.elem_size)) {
-      return b;
+    if (empty) {
+      *slot = (pos + cu_hashmap_first(empty)) & mask;
+      return false;
     }
-    idx = (idx + 1) & mask;
+    pos = (pos + CU_HASHMAP_GROUP) & mask;
   }
 }
 
-static cu_HashMap_Bucket *cu_HashMap_find_slot(
-    cu_HashMap *map, const void *key, uint64_t hash) {
-  size_t mask = map->capacity - 1;
-  size_t idx = hash & mask;
-  cu_HashMap_Bucket *first_del = NULL;
+static size_t cu_hashmap_find_empty(const cu_HashMap_Table *t, uint64_t hash) {
+  size_t mask = t->capacity - 1;
+  size_t pos = cu_hashmap_home(hash, t->capacity);
   for (;;) {
-    cu_HashMap_Bucket *b = &map->buckets[idx];
-    if (!b->used) {
-      if (first_del) {
-        return first_del;
-      }
-      return b;
+    cu_hashmap_mask empty = cu_hashmap_match(t->ctrl + pos, CU_HASHMAP_EMPTY);
+    if (empty) {
+      return (pos + cu_hashmap_first(empty)) & mask;
     }
-    if (b->deleted) {
-      if (!first_del) {
-        first_del = b;
-      }
-    } else if (b->hash == hash &&
-               map->equals_fn(b->key, key, map->key_layout.elem_size)) {
-      return b;
+    pos = (pos + CU_HASHMAP_GROUP) & mask;
+  }
+}
+
+static inline bool cu_hashmap_is_full(uint8_t ctrl) {
+  return (ctrl & 0x80) == 0;
+}
+
+/*
+ * Empty @p hole and pull later entries of its cluster back into it. An entry
+ * may move when the hole lies between its home slot and where it sits now.
+ */
+static void cu_hashmap_erase_slot(
+    const cu_HashMap *map, cu_HashMap_Table *t, size_t hole) {
+  size_t mask = t->capacity - 1;
+  size_t key_size = map->key_layout.elem_size;
+  size_t value_size = map->value_layout.elem_size;
+  for (size_t next = (hole + 1) & mask; cu_hashmap_is_full(t->ctrl[next]);
+      next = (next + 1) & mask) {
+    void *key = cu_hashmap_key(map, t, next);
+    size_t home = cu_hashmap_home(cu_HashMap_hash(map, key), t->capacity);
+    if (((next - home) & mask) < ((next - hole) & mask)) {
+      continue;
+    }
+    cu_hashmap_set_ctrl(t, hole, t->ctrl[next]);
+    cu_Memory_memcpy(
+        cu_hashmap_key(map, t, hole), cu_Slice_create(key, key_size));
+    cu_Memory_memcpy(cu_hashmap_value(map, t, hole),
+        cu_Slice_create(cu_hashmap_value(map, t, next), value_size));
+    hole = next;
+  }
+  cu_hashmap_set_ctrl(t, hole, CU_HASHMAP_EMPTY);
+}
+
+static void cu_hashmap_migrate_slot(cu_HashMap *map, size_t i) {
+  cu_HashMap_Table *old = &map->old;
+  if (!cu_hashmap_is_full(old->ctrl[i])) {
+    return;
+  }
+  void *key = cu_hashmap_key(map, old, i);
+  uint64_t hash = cu_HashMap_hash(map, key);
+  size_t slot = cu_hashmap_find_empty(&map->table, hash);
+  cu_hashmap_set_ctrl(&map->table, slot, cu_hashmap_h2(hash));
+  cu_Memory_memcpy(cu_hashmap_key(map, &map->table, slot),
+      cu_Slice_create(key, map->key_layout.elem_size));
+  cu_Memory_memcpy(cu_hashmap_value(map, &map->table, slot),
+      cu_Slice_create(
+          cu_hashmap_value(map, old, i), map->value_layout.elem_size));
+  cu_hashmap_set_ctrl(old, i, CU_HASHMAP_MOVED);
+}
+
+/**
+ * Empty up to @p bytes more control bytes of the pending table and swap it
+ * in once all of them are.
+ */
+static void cu_hashmap_prepare(cu_HashMap *map, size_t bytes) {
+  size_t total = map->next.capacity + CU_HASHMAP_GROUP;
+  size_t n = CU_MIN(bytes, total - map->cleared);
+  cu_Memory_memset(map->next.ctrl + map->cleared, CU_HASHMAP_EMPTY, n);
+  map->cleared += n;
+  if (map->cleared < total) {
+    return;
+  }
+  map->old = map->table;
+  map->table = map->next;
+  map->next = (cu_HashMap_Table){0};
+  map->cleared = 0;
+  map->migrated = 0;
+}
+
+/**
+ * Move up to @p slots old slots into the current table, or take one step of
+ * preparing the next table when it is still pending.
+ */
+static void cu_hashmap_migrate(cu_HashMap *map, size_t slots) {
+  if (map->next.ctrl) {
+    if (slots != SIZE_MAX) {
+      cu_hashmap_prepare(map, CU_HASHMAP_CLEAR_CHUNK);
+      return;
     }
-    idx = (idx + 1) & mask;
+    cu_hashmap_prepare(map, SIZE_MAX);
+  }
+  if (!map->old.ctrl) {
+    return;
+  }
+  size_t end = map->old.capacity;
+  if (end - map->migrated > slots) {
+    end = map->migrated + slots;
+  }
+  for (; map->migrated < end; ++map->migrated) {
+    cu_hashmap_migrate_slot(map, map->migrated);
+  }
+  if (map->migrated == map->old.capacity) {
+    cu_hashmap_table_free(map, &map->old);
+    map->migrated = 0;
   }
 }
 
+/*
+ * Swap in a table of @p new_cap slots. The previous one is drained at once,
+ * or bit by bit on later updates when incremental rehashing is enabled, in
+ * which case the new table is also prepared over those updates first.
+ */
 static cu_HashMap_Error_Optional cu_HashMap_rehash(
     cu_HashMap *map, size_t new_cap) {
-  if (new_cap < 16) {
-    new_cap = 16;
+  if (new_cap < CU_HASHMAP_GROUP) {
+    new_cap = CU_HASHMAP_GROUP;
   }
   new_cap = cu_next_pow2(new_cap);
-  cu_IoSlice_Result mem = cu_Allocator_Alloc(
-      map->allocator, cu_Layout_create(new_cap * sizeof(cu_HashMap_Bucket),
-                          alignof(cu_HashMap_Bucket)));
-  if (!cu_IoSlice_Result_is_ok(&mem)) {
-    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_OOM);
+  cu_hashmap_migrate(map, SIZE_MAX);
+  cu_HashMap_Table next;
+  cu_HashMap_Error_Optional err = cu_hashmap_table_alloc(map, new_cap, &next);
+  if (cu_HashMap_Error_Optional_is_some(&err)) {
+    return err;
   }
-  cu_HashMap_Bucket *new_buckets = (cu_HashMap_Bucket *)mem.value.ptr;
-  cu_Memory_memset(new_buckets, 0, new_cap * sizeof(cu_HashMap_Bucket));
-
-  size_t old_cap = map->capacity;
-  cu_HashMap_Bucket *old_buckets = map->buckets;
-  map->buckets = new_buckets;
-  map->capacity = new_cap;
-  map->length = 0;
-
-  for (size_t i = 0; i < old_cap; ++i) {
-    cu_HashMap_Bucket *b = &old_buckets[i];
-    if (!b->used || b->deleted) {
-      continue;
-    }
-    cu_HashMap_Bucket *slot = cu_HashMap_find_slot(map, b->key, b->hash);
-    slot->used = true;
-    slot->deleted = false;
-    slot->hash = b->hash;
-    slot->key = b->key;
-    slot->value = b->value;
-    map->length++;
-  }
-  if (old_buckets) {
-    cu_Allocator_Free(map->allocator,
-        cu_Slice_create(old_buckets, old_cap * sizeof(cu_HashMap_Bucket)));
+  map->next = next;
+  map->cleared = 0;
+  if (map->rehash_step == 0) {
+    cu_hashmap_migrate(map, SIZE_MAX);
+  } else {
+    cu_hashmap_prepare(map, CU_HASHMAP_CLEAR_CHUNK);
   }
   return cu_HashMap_Error_Optional_none();
 }
@@ -113,26 +376,20 @@ cu_HashMap_Result cu_HashMap_create(cu_Allocator allocator,
   CU_LAYOUT_CHECK(key_layout) {
     return cu_HashMap_Result_error(CU_HASHMAP_ERROR_INVALID_LAYOUT);
   }
-  CU_LAYOUT_CHECK(value_layout) {
+  /* zero sized values are allowed, sets store nothing beside the key */
+  if (value_layout.alignment == 0) {
     return cu_HashMap_Result_error(CU_HASHMAP_ERROR_INVALID_LAYOUT);
   }
   size_t cap = 16;
   if (Size_Optional_is_some(&initial_capacity)) {
     cap = Size_Optional_unwrap(&initial_capacity);
   }
-  cap = cu_next_pow2(cap);
-  cu_IoSlice_Result mem = cu_Allocator_Alloc(
-      allocator, cu_Layout_create(cap * sizeof(cu_HashMap_Bucket),
-                     alignof(cu_HashMap_Bucket)));
-  if (!cu_IoSlice_Result_is_ok(&mem)) {
-    return cu_HashMap_Result_error(CU_HASHMAP_ERROR_OOM);
+  if (cap < CU_HASHMAP_GROUP) {
+    cap = CU_HASHMAP_GROUP;
   }
-  cu_HashMap_Bucket *buckets = (cu_HashMap_Bucket *)mem.value.ptr;
-  cu_Memory_memset(buckets, 0, cap * sizeof(cu_HashMap_Bucket));
+  cap = cu_next_pow2(cap);
 
   cu_HashMap map = {0};
-  map.buckets = buckets;
-  map.capacity = cap;
   map.length = 0;
   map.key_layout = key_layout;
   map.value_layout = value_layout;
@@ -147,6 +404,12 @@ cu_HashMap_Result cu_HashMap_create(cu_Allocator allocator,
     map.equals_fn = cu_HashMap_EqualsFn_Optional_unwrap(&equals_fn);
   }
   map.seed = cu_State_next(&state);
+
+  cu_HashMap_Error_Optional err = cu_hashmap_table_alloc(&map, cap, &map.table);
+  if (cu_HashMap_Error_Optional_is_some(&err)) {
+    return cu_HashMap_Result_error(cu_HashMap_Error_Optional_unwrap(&err));
+  }
+  cu_Memory_memset(map.table.ctrl, CU_HASHMAP_EMPTY, cap + CU_HASHMAP_GROUP);
   return cu_HashMap_Result_ok(map);
 }
 
@@ -154,87 +417,255 @@ void cu_HashMap_destroy(cu_HashMap *map) {
   if (!map) {
     return;
   }
-  for (size_t i = 0; i < map->capacity; ++i) {
-    cu_HashMap_Bucket *b = &map->buckets[i];
-    if (b->used && !b->deleted) {
-      cu_Allocator_Free(
-          map->allocator, cu_Slice_create(b->key, map->key_layout.elem_size));
-      cu_Allocator_Free(map->allocator,
-          cu_Slice_create(b->value, map->value_layout.elem_size));
+  cu_hashmap_table_free(map, &map->table);
+  cu_hashmap_table_free(map, &map->old);
+  cu_hashmap_table_free(map, &map->next);
+  map->migrated = 0;
+  map->cleared = 0;
+  map->length = 0;
+}
+
+void cu_HashMap_set_incremental_rehash(cu_HashMap *map, size_t step) {
+  CU_IF_NULL(map) { return; }
+  if (step == 0) {
+    cu_hashmap_migrate(map, SIZE_MAX);
+  } else if (step < CU_HASHMAP_MIN_STEP) {
+    step = CU_HASHMAP_MIN_STEP;
+  }
+  map->rehash_step = step;
+}
+
+cu_HashMap_Error_Optional cu_HashMap_set_seeded_hash(
+    cu_HashMap *map, cu_HashMap_SeededHashFn hash_fn) {
+  CU_IF_NULL(map) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
+  }
+  if (map->length != 0) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
+  }
+  map->seeded_hash_fn = hash_fn;
+  return cu_HashMap_Error_Optional_none();
+}
+
+static cu_HashMap_Error_Optional cu_hashmap_insert_hashed(
+    cu_HashMap *map, const void *key, const void *value, uint64_t hash) {
+  cu_hashmap_migrate(map, map->rehash_step);
+  size_t slot;
+  if (cu_hashmap_probe(map, &map->table, key, hash, &slot)) {
+    cu_Memory_memcpy(cu_hashmap_value(map, &map->table, slot),
+        cu_Slice_create((void *)value, map->value_layout.elem_size));
+    return cu_HashMap_Error_Optional_none();
+  }
+  size_t old_slot;
+  if (map->old.ctrl &&
+      cu_hashmap_probe(map, &map->old, key, hash, &old_slot)) {
+    cu_Memory_memcpy(cu_hashmap_value(map, &map->old, old_slot),
+        cu_Slice_create((void *)value, map->value_layout.elem_size));
+    return cu_HashMap_Error_Optional_none();
+  }
+  if (!map->next.ctrl &&
+      map->length + 1 > cu_hashmap_max_load(map->table.capacity)) {
+    cu_HashMap_Error_Optional err =
+        cu_HashMap_rehash(map, map->table.capacity * 2);
+    if (cu_HashMap_Error_Optional_is_some(&err)) {
+      return err;
     }
+    slot = cu_hashmap_find_empty(&map->table, hash);
   }
-  cu_Allocator_Free(map->allocator,
-      cu_Slice_create(map->buckets, map->capacity * sizeof(cu_HashMap_Bucket)));
-  map->buckets = NULL;
-  map->capacity = 0;
-  map->length = 0;
+  cu_hashmap_set_ctrl(&map->table, slot, cu_hashmap_h2(hash));
+  cu_Memory_memcpy(cu_hashmap_key(map, &map->table, slot),
+      cu_Slice_create((void *)key, map->key_layout.elem_size));
+  cu_Memory_memcpy(cu_hashmap_value(map, &map->table, slot),
+      cu_Slice_create((void *)value, map->value_layout.elem_size));
+  map->length++;
+  return cu_HashMap_Error_Optional_none();
 }
 
-cu_HashMap_Error_Optional cu_HashMap_insert(
-    cu_HashMap *map, void *key, void *value) {
+static cu_HashMap_Error_Optional cu_hashmap_check(const cu_HashMap *map) {
   CU_IF_NULL(map) {
     return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
   }
   CU_LAYOUT_CHECK(map->key_layout) {
     return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID_LAYOUT);
   }
-  CU_LAYOUT_CHECK(map->value_layout) {
+  if (map->value_layout.alignment == 0) {
     return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID_LAYOUT);
   }
-  if ((map->length + 1) * 2 >= map->capacity) {
-    cu_HashMap_Error_Optional err = cu_HashMap_rehash(map, map->capacity * 2);
-    if (cu_HashMap_Error_Optional_is_some(&err)) {
-      return err;
-    }
+  CU_IF_NULL(map->table.ctrl) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
   }
-  uint64_t hash = map->hash_fn(key, map->key_layout.elem_size) ^ map->seed;
-  cu_HashMap_Bucket *slot = cu_HashMap_find_slot(map, key, hash);
-  if (slot->used && !slot->deleted) {
-    cu_Memory_memcpy(slot->value,
-        cu_Slice_create((void *)value, map->value_layout.elem_size));
+  return cu_HashMap_Error_Optional_none();
+}
+
+cu_HashMap_Error_Optional cu_HashMap_insert(
+    cu_HashMap *map, void *key, void *value) {
+  cu_HashMap_Error_Optional err = cu_hashmap_check(map);
+  if (cu_HashMap_Error_Optional_is_some(&err)) {
+    return err;
+  }
+  return cu_hashmap_insert_hashed(map, key, value, cu_HashMap_hash(map, key));
+}
+
+cu_HashMap_Error_Optional cu_HashMap_reserve(cu_HashMap *map, size_t count) {
+  cu_HashMap_Error_Optional err = cu_hashmap_check(map);
+  if (cu_HashMap_Error_Optional_is_some(&err)) {
+    return err;
+  }
+  if (count <= cu_hashmap_max_load(map->table.capacity)) {
     return cu_HashMap_Error_Optional_none();
   }
+  if (count > SIZE_MAX / 2 - count / 7) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_OOM);
+  }
+  size_t cap = cu_next_pow2(count + count / 7 + 1);
+  if (count > cu_hashmap_max_load(cap)) {
+    cap *= 2;
+  }
+  return cu_HashMap_rehash(map, cap);
+}
 
-  slot->used = true;
-  slot->deleted = false;
-  slot->hash = hash;
+/*
+ * Batches are hashed up front and the home window of every key is
+ * prefetched before the first one is resolved, so the cache misses of a
+ * batch overlap instead of being paid one after another.
+ */
+#define CU_HASHMAP_BATCH 16
 
-  cu_IoSlice_Result key_mem = cu_Allocator_Alloc(map->allocator,
-      cu_Layout_create(map->key_layout.elem_size, map->key_layout.alignment));
-  if (!cu_IoSlice_Result_is_ok(&key_mem)) {
-    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_OOM);
+#if CU_COMPILER_GCC || CU_COMPILER_CLANG
+#define CU_HASHMAP_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+#define CU_HASHMAP_PREFETCH(ptr) ((void)(ptr))
+#endif
+
+static void cu_hashmap_hash_batch(const cu_HashMap *map,
+    const unsigned char *keys, size_t count, uint64_t *hashes) {
+  const cu_HashMap_Table *t = &map->table;
+  size_t key_size = map->key_layout.elem_size;
+  for (size_t i = 0; i < count; ++i) {
+    hashes[i] = cu_HashMap_hash(map, keys + i * key_size);
+    size_t home = cu_hashmap_home(hashes[i], t->capacity);
+    CU_HASHMAP_PREFETCH(t->ctrl + home);
+    CU_HASHMAP_PREFETCH(cu_hashmap_key(map, t, home));
+  }
+}
+
+cu_HashMap_Error_Optional cu_HashMap_insert_many(
+    cu_HashMap *map, const void *keys, const void *values, size_t count) {
+  cu_HashMap_Error_Optional err = cu_hashmap_check(map);
+  if (cu_HashMap_Error_Optional_is_some(&err)) {
+    return err;
   }
-  cu_IoSlice_Result val_mem = cu_Allocator_Alloc(
-      map->allocator, cu_Layout_create(map->value_layout.elem_size,
-                          map->value_layout.alignment));
-  if (!cu_IoSlice_Result_is_ok(&val_mem)) {
-    cu_Allocator_Free(map->allocator, key_mem.value);
+  if (count > SIZE_MAX - map->length) {
     return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_OOM);
   }
-  cu_Memory_memcpy(key_mem.value.ptr,
-      cu_Slice_create((void *)key, map->key_layout.elem_size));
-  cu_Memory_memcpy(val_mem.value.ptr,
-      cu_Slice_create((void *)value, map->value_layout.elem_size));
-  slot->key = key_mem.value.ptr;
-  slot->value = val_mem.value.ptr;
-  map->length++;
+  err = cu_HashMap_reserve(map, map->length + count);
+  if (cu_HashMap_Error_Optional_is_some(&err)) {
+    return err;
+  }
+  const unsigned char *k = (const unsigned char *)keys;
+  const unsigned char *v = (const unsigned char *)values;
+  size_t key_size = map->key_layout.elem_size;
+  size_t value_size = map->value_layout.elem_size;
+  uint64_t hashes[CU_HASHMAP_BATCH];
+  for (size_t base = 0; base < count; base += CU_HASHMAP_BATCH) {
+    size_t n = CU_MIN(count - base, (size_t)CU_HASHMAP_BATCH);
+    cu_hashmap_hash_batch(map, k + base * key_size, n, hashes);
+    for (size_t i = 0; i < n; ++i) {
+      err = cu_hashmap_insert_hashed(map, k + (base + i) * key_size,
+          v + (base + i) * value_size, hashes[i]);
+      if (cu_HashMap_Error_Optional_is_some(&err)) {
+        return err;
+      }
+    }
+  }
+  return cu_HashMap_Error_Optional_none();
+}
+
+cu_HashMap_Error_Optional cu_HashMap_remove(
+    cu_HashMap *map, const void *key, void *out_value) {
+  CU_IF_NULL(map) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
+  }
+  CU_LAYOUT_CHECK(map->key_layout) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID_LAYOUT);
+  }
+  if (map->table.capacity == 0) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_NOT_FOUND);
+  }
+  cu_hashmap_migrate(map, map->rehash_step);
+  uint64_t hash = cu_HashMap_hash(map, key);
+  size_t slot;
+  cu_HashMap_Table *t = &map->table;
+  if (!cu_hashmap_probe(map, t, key, hash, &slot)) {
+    t = &map->old;
+    if (!t->ctrl || !cu_hashmap_probe(map, t, key, hash, &slot)) {
+      return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_NOT_FOUND);
+    }
+  }
+  if (out_value) {
+    cu_Memory_memcpy(out_value, cu_Slice_create(cu_hashmap_value(map, t, slot),
+                                    map->value_layout.elem_size));
+  }
+  if (t == &map->old) {
+    /* shifting here could carry an entry behind the migration cursor */
+    cu_hashmap_set_ctrl(t, slot, CU_HASHMAP_MOVED);
+  } else {
+    cu_hashmap_erase_slot(map, t, slot);
+  }
+  map->length--;
   return cu_HashMap_Error_Optional_none();
 }
 
+static void *cu_hashmap_get_hashed(
+    const cu_HashMap *map, const void *key, uint64_t hash) {
+  size_t slot;
+  if (cu_hashmap_probe(map, &map->table, key, hash, &slot)) {
+    return cu_hashmap_value(map, &map->table, slot);
+  }
+  if (map->old.ctrl && cu_hashmap_probe(map, &map->old, key, hash, &slot)) {
+    return cu_hashmap_value(map, &map->old, slot);
+  }
+  return NULL;
+}
+
 Ptr_Optional cu_HashMap_get(const cu_HashMap *map, const void *key) {
   CU_IF_NULL(map) { return Ptr_Optional_none(); }
   CU_LAYOUT_CHECK(map->key_layout) { return Ptr_Optional_none(); }
-  if (map->capacity == 0) {
+  if (map->table.capacity == 0) {
     return Ptr_Optional_none();
   }
-  uint64_t hash = map->hash_fn(key, map->key_layout.elem_size) ^ map->seed;
-  cu_HashMap_Bucket *b = cu_HashMap_lookup_bucket(map, key, hash);
-  if (b) {
-    return Ptr_Optional_some(b->value);
+  void *value = cu_hashmap_get_hashed(map, key, cu_HashMap_hash(map, key));
+  if (value) {
+    return Ptr_Optional_some(value);
   }
   return Ptr_Optional_none();
 }
 
+size_t cu_HashMap_get_many(
+    const cu_HashMap *map, const void *keys, size_t count, void **values) {
+  CU_IF_NULL(map) { return 0; }
+  CU_IF_NULL(values) { return 0; }
+  CU_LAYOUT_CHECK(map->key_layout) { return 0; }
+  if (map->table.capacity == 0) {
+    return 0;
+  }
+  const unsigned char *k = (const unsigned char *)keys;
+  size_t key_size = map->key_layout.elem_size;
+  size_t found = 0;
+  uint64_t hashes[CU_HASHMAP_BATCH];
+  for (size_t base = 0; base < count; base += CU_HASHMAP_BATCH) {
+    size_t n = CU_MIN(count - base, (size_t)CU_HASHMAP_BATCH);
+    cu_hashmap_hash_batch(map, k + base * key_size, n, hashes);
+    for (size_t i = 0; i < n; ++i) {
+      void *value =
+          cu_hashmap_get_hashed(map, k + (base + i) * key_size, hashes[i]);
+      values[base + i] = value;
+      found += value != NULL;
+    }
+  }
+  return found;
+}
+
 bool cu_HashMap_iter(
     const cu_HashMap *map, size_t *index, void **key, void **value) {
   CU_IF_NULL(map) { return false; }
@@ -242,12 +673,17 @@ bool cu_HashMap_iter(
   CU_IF_NULL(key) { return false; }
   CU_IF_NULL(value) { return false; }
 
-  while (*index < map->capacity) {
-    cu_HashMap_Bucket *b = &map->buckets[*index];
-    (*index)++;
-    if (b->used && !b->deleted) {
-      *key = b->key;
-      *value = b->value;
+  /* indices past the current table continue into the old one */
+  while (*index < map->table.capacity + map->old.capacity) {
+    const cu_HashMap_Table *t = &map->table;
+    size_t slot = (*index)++;
+    if (slot >= t->capacity) {
+      slot -= t->capacity;
+      t = &map->old;
+    }
+    if (cu_hashmap_is_full(t->ctrl[slot])) {
+      *key = cu_hashmap_key(map, t, slot);
+      *value = cu_hashmap_value(map, t, slot);
       return true;
     }
   }
@@ -0,0 +1,56 @@
+#include "collection/hashset.h"
+#include "collection/hashmap.h"
+#include "object/optional.h"
+#include "object/result.h"
+
+CU_RESULT_IMPL(cu_HashSet, cu_HashSet, cu_HashMap_Error)
+
+/* Values are zero sized, any address serves as their source. */
+static unsigned char cu_hashset_no_value;
+
+cu_HashSet_Result cu_HashSet_create(cu_Allocator allocator,
+    cu_Layout key_layout, Size_Optional initial_capacity,
+    cu_HashMap_HashFn_Optional hash_fn, cu_HashMap_EqualsFn_Optional equals_fn,
+    cu_State state) {
+  cu_Layout no_value = {0, 1};
+  cu_HashMap_Result res = cu_HashMap_create(allocator, key_layout, no_value,
+      initial_capacity, hash_fn, equals_fn, state);
+  if (!cu_HashMap_Result_is_ok(&res)) {
+    return cu_HashSet_Result_error(res.error);
+  }
+  cu_HashSet set = {cu_HashMap_Result_unwrap(&res)};
+  return cu_HashSet_Result_ok(set);
+}
+
+void cu_HashSet_destroy(cu_HashSet *set) {
+  if (!set) {
+    return;
+  }
+  cu_HashMap_destroy(&set->map);
+}
+
+cu_HashMap_Error_Optional cu_HashSet_insert(cu_HashSet *set, const void *key) {
+  CU_IF_NULL(set) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
+  }
+  return cu_HashMap_insert(&set->map, (void *)key, &cu_hashset_no_value);
+}
+
+bool cu_HashSet_contains(const cu_HashSet *set, const void *key) {
+  CU_IF_NULL(set) { return false; }
+  Ptr_Optional found = cu_HashMap_get(&set->map, key);
+  return Ptr_Optional_is_some(&found);
+}
+
+cu_HashMap_Error_Optional cu_HashSet_remove(cu_HashSet *set, const void *key) {
+  CU_IF_NULL(set) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
+  }
+  return cu_HashMap_remove(&set->map, key, NULL);
+}
+
+bool cu_HashSet_iter(const cu_HashSet *set, size_t *index, void **key) {
+  CU_IF_NULL(set) { return false; }
+  void *value;
+  return cu_HashMap_iter(&set->map, index, key, &value);
+}
@@ -122,6 +122,8 @@ cu_SkipList_Result cu_SkipList_create(cu_Allocator allocator,
 void cu_SkipList_destroy(cu_SkipList *list) {
   if (!list)
     return;
+  cu_Allocator_FreeBuffer pending =
+      cu_Allocator_FreeBuffer_create(list->allocator);
   struct cu_SkipList_Node *node = list->head->forward[0];
   while (node) {
     struct cu_SkipList_Node *next = node->forward[0];
@@ -133,16 +135,17 @@ void cu_SkipList_destroy(cu_SkipList *list) {
       cu_Destructor vd = cu_Destructor_Optional_unwrap(&list->value_destructor);
       vd(node->value);
     }
-    cu_Allocator_Free(list->allocator,
+    cu_Allocator_FreeBuffer_push(&pending,
         cu_Slice_create(node->key, list->key_layout.elem_size));
-    cu_Allocator_Free(list->allocator,
+    cu_Allocator_FreeBuffer_push(&pending,
         cu_Slice_create(node->value, list->value_layout.elem_size));
-    cu_Allocator_Free(list->allocator,
+    cu_Allocator_FreeBuffer_push(&pending,
         cu_Slice_create(
             node, sizeof(struct cu_SkipList_Node) +
                       node->level * sizeof(struct cu_SkipList_Node *)));
     node = next;
   }
+  cu_Allocator_FreeBuffer_flush(&pending);
   cu_Allocator_Free(list->allocator,
       cu_Slice_create(
           list->head, sizeof(struct cu_SkipList_Node) +
@@ -0,0 +1,242 @@
+#include "collection/small_vector.h"
+#include "collection/vector.h"
+#include "macro.h"
+#include "memory/allocator.h"
+#include "object/optional.h"
+#include "utility.h"
+#include <nostd.h>
+#include <stddef.h>
+
+#define CU_SMALLVECTOR_GROW_FACTOR 2
+#define CU_SMALLVECTOR_SHRINK_DIV 4
+
+static void cu_SmallVector_drop(
+    cu_SmallVector_Header *header, void *inline_data, size_t from) {
+  if (!cu_Destructor_Optional_is_some(&header->destructor)) {
+    return;
+  }
+  cu_Destructor dtor = cu_Destructor_Optional_unwrap(&header->destructor);
+  unsigned char *data = cu_SmallVector_ptr(header, inline_data);
+  for (size_t i = from; i < header->length; ++i) {
+    dtor(data + i * header->layout.elem_size);
+  }
+}
+
+static void cu_SmallVector_maybe_shrink(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap) {
+  if (!header->heap) {
+    return;
+  }
+  if (header->length == 0) {
+    cu_SmallVector_set_capacity(header, inline_data, inline_cap, inline_cap);
+    return;
+  }
+  if (header->length <= header->capacity / CU_SMALLVECTOR_SHRINK_DIV) {
+    cu_SmallVector_set_capacity(
+        header, inline_data, inline_cap, header->capacity / 2);
+  }
+}
+
+static cu_Vector_Error_Optional cu_SmallVector_grow(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap) {
+  if (header->length < header->capacity) {
+    return cu_Vector_Error_Optional_none();
+  }
+  if (header->capacity > SIZE_MAX / CU_SMALLVECTOR_GROW_FACTOR) {
+    return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_OOM);
+  }
+  return cu_SmallVector_set_capacity(header, inline_data, inline_cap,
+      header->capacity * CU_SMALLVECTOR_GROW_FACTOR);
+}
+
+void cu_SmallVector_init(cu_SmallVector_Header *header, size_t inline_cap,
+    cu_Layout layout, cu_Allocator allocator,
+    cu_Destructor_Optional destructor) {
+  header->heap = NULL;
+  header->length = 0;
+  header->capacity = inline_cap;
+  header->layout = layout;
+  header->allocator = allocator;
+  header->destructor = destructor;
+}
+
+/*
+ * Capacities never drop below the inline capacity. Reaching it moves the
+ * elements back inline and frees the heap block.
+ */
+cu_Vector_Error_Optional cu_SmallVector_set_capacity(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap,
+    size_t capacity) {
+  capacity = CU_MAX(capacity, inline_cap);
+  if (capacity == header->capacity) {
+    return cu_Vector_Error_Optional_none();
+  }
+  if (capacity < header->length) {
+    return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_INVALID);
+  }
+  size_t elem_size = header->layout.elem_size;
+  if (capacity > SIZE_MAX / elem_size) {
+    return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_OOM);
+  }
+
+  if (capacity == inline_cap) {
+    cu_Memory_memcpy(inline_data,
+        cu_Slice_create(header->heap, header->length * elem_size));
+    cu_Allocator_Free(header->allocator,
+        cu_Slice_create(header->heap, header->capacity * elem_size));
+    header->heap = NULL;
+    header->capacity = inline_cap;
+    return cu_Vector_Error_Optional_none();
+  }
+
+  cu_Layout layout =
+      cu_Layout_create(capacity * elem_size, header->layout.alignment);
+  if (header->heap) {
+    cu_Slice old_mem =
+        cu_Slice_create(header->heap, header->capacity * elem_size);
+    cu_IoSlice_Result res = capacity > header->capacity
+                                ? cu_Allocator_Grow(
+                                      header->allocator, old_mem, layout)
+                                : cu_Allocator_Shrink(
+                                      header->allocator, old_mem, layout);
+    if (!cu_IoSlice_Result_is_ok(&res)) {
+      return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_OOM);
+    }
+    header->heap = (unsigned char *)res.value.ptr;
+    header->capacity = capacity;
+    return cu_Vector_Error_Optional_none();
+  }
+
+  cu_IoSlice_Result res = cu_Allocator_Alloc(header->allocator, layout);
+  if (!cu_IoSlice_Result_is_ok(&res)) {
+    return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_OOM);
+  }
+  cu_Memory_memcpy(
+      res.value.ptr, cu_Slice_create(inline_data, header->length * elem_size));
+  header->heap = (unsigned char *)res.value.ptr;
+  header->capacity = capacity;
+  return cu_Vector_Error_Optional_none();
+}
+
+cu_Vector_Error_Optional cu_SmallVector_resize(cu_SmallVector_Header *header,
+    void *inline_data, size_t inline_cap, size_t size) {
+  if (size > header->capacity) {
+    cu_Vector_Error_Optional err =
+        cu_SmallVector_set_capacity(header, inline_data, inline_cap, size);
+    if (cu_Vector_Error_Optional_is_some(&err)) {
+      return err;
+    }
+  }
+  if (size < header->length) {
+    cu_SmallVector_drop(header, inline_data, size);
+  }
+  header->length = size;
+  return cu_Vector_Error_Optional_none();
+}
+
+void cu_SmallVector_destroy(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap) {
+  cu_SmallVector_drop(header, inline_data, 0);
+  if (header->heap) {
+    cu_Allocator_Free(header->allocator,
+        cu_Slice_create(
+            header->heap, header->capacity * header->layout.elem_size));
+    header->heap = NULL;
+  }
+  header->length = 0;
+  header->capacity = inline_cap;
+}
+
+cu_Vector_Error_Optional cu_SmallVector_push_back(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap,
+    const void *elem) {
+  cu_Vector_Error_Optional err =
+      cu_SmallVector_grow(header, inline_data, inline_cap);
+  if (cu_Vector_Error_Optional_is_some(&err)) {
+    return err;
+  }
+  unsigned char *data = cu_SmallVector_ptr(header, inline_data);
+  cu_Memory_memcpy(data + header->length * header->layout.elem_size,
+      cu_Slice_create((void *)elem, header->layout.elem_size));
+  header->length++;
+  return cu_Vector_Error_Optional_none();
+}
+
+cu_Vector_Error_Optional cu_SmallVector_pop_back(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap,
+    void *out_elem) {
+  if (header->length == 0) {
+    return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_OOB);
+  }
+  header->length--;
+  unsigned char *src = cu_SmallVector_ptr(header, inline_data) +
+                       header->length * header->layout.elem_size;
+  cu_Memory_memcpy(out_elem, cu_Slice_create(src, header->layout.elem_size));
+  if (cu_Destructor_Optional_is_some(&header->destructor)) {
+    cu_Destructor dtor = cu_Destructor_Optional_unwrap(&header->destructor);
+    dtor(src);
+  }
+  cu_SmallVector_maybe_shrink(header, inline_data, inline_cap);
+  return cu_Vector_Error_Optional_none();
+}
+
+cu_Vector_Error_Optional cu_SmallVector_push_front(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap,
+    const void *elem) {
+  cu_Vector_Error_Optional err =
+      cu_SmallVector_grow(header, inline_data, inline_cap);
+  if (cu_Vector_Error_Optional_is_some(&err)) {
+    return err;
+  }
+  unsigned char *data = cu_SmallVector_ptr(header, inline_data);
+  cu_Memory_memmove(data + header->layout.elem_size,
+      cu_Slice_create(data, header->length * header->layout.elem_size));
+  cu_Memory_memcpy(
+      data, cu_Slice_create((void *)elem, header->layout.elem_size));
+  header->length++;
+  return cu_Vector_Error_Optional_none();
+}
+
+cu_Vector_Error_Optional cu_SmallVector_pop_front(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap,
+    void *out_elem) {
+  if (header->length == 0) {
+    return cu_Vector_Error_Optional_some(CU_VECTOR_ERROR_OOB);
+  }
+  unsigned char *data = cu_SmallVector_ptr(header, inline_data);
+  cu_Memory_memcpy(out_elem, cu_Slice_create(data, header->layout.elem_size));
+  if (cu_Destructor_Optional_is_some(&header->destructor)) {
+    cu_Destructor dtor = cu_Destructor_Optional_unwrap(&header->destructor);
+    dtor(data);
+  }
+  header->length--;
+  cu_Memory_memmove(data,
+      cu_Slice_create(data + header->layout.elem_size,
+          header->length * header->layout.elem_size));
+  cu_SmallVector_maybe_shrink(header, inline_data, inline_cap);
+  return cu_Vector_Error_Optional_none();
+}
+
+cu_Vector_Error_Optional cu_SmallVector_copy(cu_SmallVector_Header *dst,
+    void *dst_inline, const cu_SmallVector_Header *src,
+    const void *src_inline, size_t inline_cap) {
+  cu_SmallVector_init(
+      dst, inline_cap, src->layout, src->allocator, src->destructor);
+  cu_Vector_Error_Optional err =
+      cu_SmallVector_set_capacity(dst, dst_inline, inline_cap, src->length);
+  if (cu_Vector_Error_Optional_is_some(&err)) {
+    return err;
+  }
+  cu_Memory_memcpy(cu_SmallVector_ptr(dst, dst_inline),
+      cu_Slice_create(cu_SmallVector_ptr(src, src_inline),
+          src->length * src->layout.elem_size));
+  dst->length = src->length;
+  return cu_Vector_Error_Optional_none();
+}
+
+void cu_SmallVector_clear(
+    cu_SmallVector_Header *header, void *inline_data, size_t inline_cap) {
+  cu_SmallVector_drop(header, inline_data, 0);
+  header->length = 0;
+  cu_SmallVector_maybe_shrink(header, inline_data, inline_cap);
+}
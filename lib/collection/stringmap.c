@@ -0,0 +1,148 @@
+#include "collection/stringmap.h"
+#include "collection/hashmap.h"
+#include "hash/hash.h"
+#include "object/optional.h"
+#include "object/result.h"
+#include <nostd.h>
+
+CU_RESULT_IMPL(cu_StringMap, cu_StringMap, cu_HashMap_Error)
+
+static const unsigned char *cu_stringmap_bytes(const cu_StringMap_Key *key) {
+  return key->length <= CU_STRINGMAP_INLINE ? key->data.bytes : key->data.ptr;
+}
+
+static uint64_t cu_stringmap_hash(
+    const void *key, size_t key_size, uint64_t seed) {
+  (void)key_size;
+  const cu_StringMap_Key *k = (const cu_StringMap_Key *)key;
+  return cu_Hash_Wy64(cu_stringmap_bytes(k), k->length, seed);
+}
+
+static bool cu_stringmap_equals(const void *a, const void *b, size_t key_size) {
+  (void)key_size;
+  const cu_StringMap_Key *x = (const cu_StringMap_Key *)a;
+  const cu_StringMap_Key *y = (const cu_StringMap_Key *)b;
+  if (x->length != y->length) {
+    return false;
+  }
+  /* inline keys are zero padded, so all of them compare at once */
+  size_t n = x->length <= CU_STRINGMAP_INLINE ? CU_STRINGMAP_INLINE : x->length;
+  return cu_Memory_memcmp(cu_Slice_create((void *)cu_stringmap_bytes(x), n),
+             cu_Slice_create((void *)cu_stringmap_bytes(y), n)) == true;
+}
+
+/* Build the record looked up for @p key; long keys still point at it. */
+static cu_StringMap_Key cu_stringmap_probe(cu_Slice key) {
+  cu_StringMap_Key record;
+  cu_Memory_memset(&record, 0, sizeof(record));
+  record.length = key.length;
+  if (key.length <= CU_STRINGMAP_INLINE) {
+    cu_Memory_memcpy(record.data.bytes, key);
+  } else {
+    record.data.ptr = (const unsigned char *)key.ptr;
+  }
+  return record;
+}
+
+/* Copy a long key into the arena, starting a new chunk when it does not fit. */
+static const unsigned char *cu_stringmap_store(
+    cu_StringMap *map, cu_Slice key) {
+  struct cu_StringMap_Chunk *chunk = map->chunks;
+  if (!chunk || chunk->size - chunk->used < key.length) {
+    size_t size = CU_MAX((size_t)CU_STRINGMAP_CHUNK_SIZE, key.length);
+    cu_IoSlice_Result mem = cu_Allocator_Alloc(map->map.allocator,
+        cu_Layout_create(sizeof(struct cu_StringMap_Chunk) + size,
+            _Alignof(struct cu_StringMap_Chunk)));
+    if (!cu_IoSlice_Result_is_ok(&mem)) {
+      return NULL;
+    }
+    chunk = (struct cu_StringMap_Chunk *)mem.value.ptr;
+    chunk->next = map->chunks;
+    chunk->size = size;
+    chunk->used = 0;
+    map->chunks = chunk;
+  }
+  unsigned char *dest = chunk->data + chunk->used;
+  chunk->used += key.length;
+  cu_Memory_memcpy(dest, key);
+  return dest;
+}
+
+cu_StringMap_Result cu_StringMap_create(cu_Allocator allocator,
+    cu_Layout value_layout, Size_Optional initial_capacity, cu_State state) {
+  cu_HashMap_Result res = cu_HashMap_create(allocator,
+      CU_LAYOUT(cu_StringMap_Key), value_layout, initial_capacity,
+      cu_HashMap_HashFn_Optional_none(),
+      cu_HashMap_EqualsFn_Optional_some(cu_stringmap_equals), state);
+  if (!cu_HashMap_Result_is_ok(&res)) {
+    return cu_StringMap_Result_error(res.error);
+  }
+  cu_StringMap map;
+  map.map = cu_HashMap_Result_unwrap(&res);
+  /* cannot fail on an empty map */
+  CU_UNUSED(cu_HashMap_set_seeded_hash(&map.map, cu_stringmap_hash));
+  map.chunks = NULL;
+  return cu_StringMap_Result_ok(map);
+}
+
+void cu_StringMap_destroy(cu_StringMap *map) {
+  if (!map) {
+    return;
+  }
+  while (map->chunks) {
+    struct cu_StringMap_Chunk *chunk = map->chunks;
+    map->chunks = chunk->next;
+    cu_Allocator_Free(map->map.allocator,
+        cu_Slice_create(chunk, sizeof(*chunk) + chunk->size));
+  }
+  cu_HashMap_destroy(&map->map);
+}
+
+cu_HashMap_Error_Optional cu_StringMap_insert(
+    cu_StringMap *map, cu_Slice key, const void *value) {
+  CU_IF_NULL(map) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
+  }
+  cu_StringMap_Key record = cu_stringmap_probe(key);
+  if (key.length > CU_STRINGMAP_INLINE) {
+    Ptr_Optional existing = cu_HashMap_get(&map->map, &record);
+    if (Ptr_Optional_is_some(&existing)) {
+      cu_Memory_memcpy(Ptr_Optional_unwrap(&existing),
+          cu_Slice_create((void *)value, map->map.value_layout.elem_size));
+      return cu_HashMap_Error_Optional_none();
+    }
+    record.data.ptr = cu_stringmap_store(map, key);
+    if (!record.data.ptr) {
+      return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_OOM);
+    }
+  }
+  return cu_HashMap_insert(&map->map, &record, (void *)value);
+}
+
+Ptr_Optional cu_StringMap_get(const cu_StringMap *map, cu_Slice key) {
+  CU_IF_NULL(map) { return Ptr_Optional_none(); }
+  cu_StringMap_Key record = cu_stringmap_probe(key);
+  return cu_HashMap_get(&map->map, &record);
+}
+
+cu_HashMap_Error_Optional cu_StringMap_remove(
+    cu_StringMap *map, cu_Slice key, void *out_value) {
+  CU_IF_NULL(map) {
+    return cu_HashMap_Error_Optional_some(CU_HASHMAP_ERROR_INVALID);
+  }
+  cu_StringMap_Key record = cu_stringmap_probe(key);
+  return cu_HashMap_remove(&map->map, &record, out_value);
+}
+
+bool cu_StringMap_iter(
+    const cu_StringMap *map, size_t *index, cu_Slice *key, void **value) {
+  CU_IF_NULL(map) { return false; }
+  CU_IF_NULL(key) { return false; }
+  void *record;
+  if (!cu_HashMap_iter(&map->map, index, &record, value)) {
+    return false;
+  }
+  const cu_StringMap_Key *k = (const cu_StringMap_Key *)record;
+  *key = cu_Slice_create((void *)cu_stringmap_bytes(k), k->length);
+  return true;
+}
@@ -72,9 +72,17 @@ uint32_t cu_Hash_Murmur3_32(const void *data, size_t len, uint32_t seed) {
   return h1;
 }
 
+/* fixed size copies compile to single loads instead of a call */
+#if CU_COMPILER_GCC || CU_COMPILER_CLANG
+#define CU_HASH_LOAD(dst, src, n) __builtin_memcpy(dst, src, n)
+#else
+#define CU_HASH_LOAD(dst, src, n)                                              \
+  cu_Memory_memcpy(dst, cu_Slice_create((void *)(src), n))
+#endif
+
 static inline uint64_t cu_hash_read64(const uint8_t *p) {
   uint64_t v;
-  cu_Memory_memcpy(&v, cu_Slice_create((void *)p, 8));
+  CU_HASH_LOAD(&v, p, 8);
   return v;
 }
 
@@ -152,3 +160,411 @@ uint64_t cu_Hash_SipHash24(
   SIPROUND;
   return v0 ^ v1 ^ v2 ^ v3;
 }
+
+/* -------------------------------------------------------------------------- */
+/* Wyhash family                                                              */
+/* -------------------------------------------------------------------------- */
+
+static const uint64_t cu_hash_wy_secret[4] = {0x2d358dccaa6c78a5ull,
+    0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+static const uint64_t cu_hash_wy_secret_high[4] = {0x9e3779b97f4a7c15ull,
+    0xbf58476d1ce4e5b9ull, 0x94d049bb133111ebull, 0xd6e8feb86659fd93ull};
+
+/* 64 x 64 -> 128 bit multiply, low half in *a and high half in *b */
+static inline void cu_hash_mum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = (__uint128_t)*a * *b;
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32;
+  uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32);
+  uint64_t carry = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  carry += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+static inline uint64_t cu_hash_mix(uint64_t a, uint64_t b) {
+  cu_hash_mum(&a, &b);
+  return a ^ b;
+}
+
+static inline uint64_t cu_hash_read32(const uint8_t *p) {
+  uint32_t v;
+  CU_HASH_LOAD(&v, p, 4);
+  return v;
+}
+
+/* Consume one 48 byte block into the three lanes. */
+static inline void cu_hash_wy_block(
+    const uint8_t *p, uint64_t lanes[3], const uint64_t *secret) {
+  lanes[0] = cu_hash_mix(
+      cu_hash_read64(p) ^ secret[1], cu_hash_read64(p + 8) ^ lanes[0]);
+  lanes[1] = cu_hash_mix(
+      cu_hash_read64(p + 16) ^ secret[2], cu_hash_read64(p + 24) ^ lanes[1]);
+  lanes[2] = cu_hash_mix(
+      cu_hash_read64(p + 32) ^ secret[3], cu_hash_read64(p + 40) ^ lanes[2]);
+}
+
+/*
+ * Hash the final @p i bytes at @p p of an input of @p len bytes. Inputs over
+ * 16 bytes read their last 16 bytes, which may lie before @p p.
+ */
+static uint64_t cu_hash_wy_finish(const uint8_t *p, size_t i, size_t len,
+    uint64_t seed, const uint64_t *secret) {
+  uint64_t a;
+  uint64_t b;
+  if (len <= 16) {
+    if (len >= 4) {
+      /* two possibly overlapping pairs of 4 byte loads cover every byte */
+      size_t mid = (len >> 3) << 2;
+      a = (cu_hash_read32(p) << 32) | cu_hash_read32(p + mid);
+      b = (cu_hash_read32(p + len - 4) << 32) |
+          cu_hash_read32(p + len - 4 - mid);
+    } else if (len > 0) {
+      a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+      b = 0;
+    } else {
+      a = 0;
+      b = 0;
+    }
+  } else {
+    while (i > 16) {
+      seed = cu_hash_mix(
+          cu_hash_read64(p) ^ secret[1], cu_hash_read64(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = cu_hash_read64(p + i - 16);
+    b = cu_hash_read64(p + i - 8);
+  }
+  a ^= secret[1];
+  b ^= seed;
+  cu_hash_mum(&a, &b);
+  return cu_hash_mix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+static inline uint64_t cu_hash_wy_seed(uint64_t seed, const uint64_t *secret) {
+  return seed ^ cu_hash_mix(seed ^ secret[0], secret[1]);
+}
+
+static uint64_t cu_hash_wy(
+    const uint8_t *p, size_t len, uint64_t seed, const uint64_t *secret) {
+  seed = cu_hash_wy_seed(seed, secret);
+  size_t i = len;
+  if (i >= 48) {
+    uint64_t lanes[3] = {seed, seed, seed};
+    do {
+      cu_hash_wy_block(p, lanes, secret);
+      p += 48;
+      i -= 48;
+    } while (i >= 48);
+    seed = lanes[0] ^ lanes[1] ^ lanes[2];
+  }
+  return cu_hash_wy_finish(p, i, len, seed, secret);
+}
+
+/** Compute the seeded 64-bit wyhash style hash of a buffer. */
+uint64_t cu_Hash_Wy64(const void *data, size_t len, uint64_t seed) {
+  return cu_hash_wy((const uint8_t *)data, len, seed, cu_hash_wy_secret);
+}
+
+/** Compute the seeded 128-bit wyhash style hash of a buffer. */
+cu_Hash128 cu_Hash_Wy128(const void *data, size_t len, uint64_t seed) {
+  cu_Hash128 out;
+  out.low = cu_hash_wy((const uint8_t *)data, len, seed, cu_hash_wy_secret);
+  out.high =
+      cu_hash_wy((const uint8_t *)data, len, seed, cu_hash_wy_secret_high);
+  return out;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Incremental hashing                                                        */
+/* -------------------------------------------------------------------------- */
+
+static inline uint32_t cu_hash_murmur3_block(uint32_t h1, const uint8_t *p) {
+  uint32_t k1;
+  CU_HASH_LOAD(&k1, p, 4);
+  k1 *= CU_MURMUR3_C1;
+  k1 = (k1 << 15) | (k1 >> 17);
+  k1 *= CU_MURMUR3_C2;
+  h1 ^= k1;
+  h1 = (h1 << 13) | (h1 >> 19);
+  return h1 * 5 + CU_MURMUR3_N;
+}
+
+void cu_Hash_Murmur3_32_init(cu_Hash_Murmur3_32_State *state, uint32_t seed) {
+  state->h1 = seed;
+  state->tailLength = 0;
+  state->length = 0;
+}
+
+void cu_Hash_Murmur3_32_update(
+    cu_Hash_Murmur3_32_State *state, cu_Slice data) {
+  const uint8_t *p = (const uint8_t *)data.ptr;
+  size_t n = data.length;
+  state->length += n;
+  while (state->tailLength > 0 && state->tailLength < 4 && n > 0) {
+    state->tail[state->tailLength++] = *p++;
+    --n;
+  }
+  if (state->tailLength == 4) {
+    state->h1 = cu_hash_murmur3_block(state->h1, state->tail);
+    state->tailLength = 0;
+  }
+  for (; n >= 4; n -= 4, p += 4) {
+    state->h1 = cu_hash_murmur3_block(state->h1, p);
+  }
+  for (; n > 0; --n) {
+    state->tail[state->tailLength++] = *p++;
+  }
+}
+
+uint32_t cu_Hash_Murmur3_32_final(const cu_Hash_Murmur3_32_State *state) {
+  uint32_t h1 = state->h1;
+  const uint8_t *tail = state->tail;
+  uint32_t k1 = 0;
+  switch (state->tailLength) {
+  case 3:
+    k1 ^= (uint32_t)tail[2] << 16;
+    /* fallthrough */
+  case 2:
+    k1 ^= (uint32_t)tail[1] << 8;
+    /* fallthrough */
+  case 1:
+    k1 ^= tail[0];
+    k1 *= CU_MURMUR3_C1;
+    k1 = (k1 << 15) | (k1 >> 17);
+    k1 *= CU_MURMUR3_C2;
+    h1 ^= k1;
+  }
+
+  h1 ^= (uint32_t)state->length;
+
+  h1 ^= h1 >> 16;
+  h1 *= CU_MURMUR3_F1;
+  h1 ^= h1 >> 13;
+  h1 *= CU_MURMUR3_F2;
+  h1 ^= h1 >> 16;
+  return h1;
+}
+
+void cu_Hash_SipHash24_init(
+    cu_Hash_SipHash24_State *state, const uint8_t key[16]) {
+  uint64_t k0 = cu_hash_read64(key);
+  uint64_t k1 = cu_hash_read64(key + 8);
+  state->v[0] = CU_SIPHASH_V0_INIT ^ k0;
+  state->v[1] = CU_SIPHASH_V1_INIT ^ k1;
+  state->v[2] = CU_SIPHASH_V2_INIT ^ k0;
+  state->v[3] = CU_SIPHASH_V3_INIT ^ k1;
+  state->tailLength = 0;
+  state->length = 0;
+}
+
+static inline void cu_hash_siphash_word(uint64_t v[4], uint64_t m) {
+  uint64_t v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+  v3 ^= m;
+  SIPROUND;
+  SIPROUND;
+  v0 ^= m;
+  v[0] = v0;
+  v[1] = v1;
+  v[2] = v2;
+  v[3] = v3;
+}
+
+void cu_Hash_SipHash24_update(cu_Hash_SipHash24_State *state, cu_Slice data) {
+  const uint8_t *p = (const uint8_t *)data.ptr;
+  size_t n = data.length;
+  state->length += n;
+  while (state->tailLength > 0 && state->tailLength < 8 && n > 0) {
+    state->tail[state->tailLength++] = *p++;
+    --n;
+  }
+  if (state->tailLength == 8) {
+    cu_hash_siphash_word(state->v, cu_hash_read64(state->tail));
+    state->tailLength = 0;
+  }
+  for (; n >= 8; n -= 8, p += 8) {
+    cu_hash_siphash_word(state->v, cu_hash_read64(p));
+  }
+  for (; n > 0; --n) {
+    state->tail[state->tailLength++] = *p++;
+  }
+}
+
+uint64_t cu_Hash_SipHash24_final(const cu_Hash_SipHash24_State *state) {
+  uint64_t v0 = state->v[0], v1 = state->v[1];
+  uint64_t v2 = state->v[2], v3 = state->v[3];
+  uint64_t b = ((uint64_t)state->length) << 56;
+  for (size_t i = 0; i < state->tailLength; ++i) {
+    b |= ((uint64_t)state->tail[i]) << (8 * i);
+  }
+
+  v3 ^= b;
+  SIPROUND;
+  SIPROUND;
+  v0 ^= b;
+  v2 ^= 0xff;
+  SIPROUND;
+  SIPROUND;
+  SIPROUND;
+  SIPROUND;
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+static void cu_hash_wy_state_init(
+    cu_Hash_Wy64_State *state, uint64_t seed, const uint64_t *secret) {
+  state->seed = cu_hash_wy_seed(seed, secret);
+  state->lanes[0] = state->seed;
+  state->lanes[1] = state->seed;
+  state->lanes[2] = state->seed;
+  state->secret = secret;
+  state->pending = 0;
+  state->length = 0;
+}
+
+void cu_Hash_Wy64_init(cu_Hash_Wy64_State *state, uint64_t seed) {
+  cu_hash_wy_state_init(state, seed, cu_hash_wy_secret);
+}
+
+void cu_Hash_Wy64_update(cu_Hash_Wy64_State *state, cu_Slice data) {
+  const uint8_t *p = (const uint8_t *)data.ptr;
+  size_t n = data.length;
+  uint8_t *pending = state->buffer + 16;
+  state->length += n;
+  if (state->pending > 0) {
+    size_t take = CU_MIN(n, 48 - state->pending);
+    cu_Memory_memcpy(pending + state->pending, cu_Slice_create((void *)p, take));
+    state->pending += take;
+    p += take;
+    n -= take;
+    if (state->pending < 48) {
+      return;
+    }
+    cu_hash_wy_block(pending, state->lanes, state->secret);
+    cu_Memory_memcpy(state->buffer, cu_Slice_create(pending + 32, 16));
+    state->pending = 0;
+  }
+  if (n >= 48) {
+    for (; n >= 48; n -= 48, p += 48) {
+      cu_hash_wy_block(p, state->lanes, state->secret);
+    }
+    cu_Memory_memcpy(state->buffer, cu_Slice_create((void *)(p - 16), 16));
+  }
+  cu_Memory_memcpy(pending, cu_Slice_create((void *)p, n));
+  state->pending = n;
+}
+
+uint64_t cu_Hash_Wy64_final(const cu_Hash_Wy64_State *state) {
+  uint64_t seed = state->seed;
+  if (state->length >= 48) {
+    seed = state->lanes[0] ^ state->lanes[1] ^ state->lanes[2];
+  }
+  return cu_hash_wy_finish(state->buffer + 16, state->pending, state->length,
+      seed, state->secret);
+}
+
+void cu_Hash_Wy128_init(cu_Hash_Wy128_State *state, uint64_t seed) {
+  cu_hash_wy_state_init(&state->low, seed, cu_hash_wy_secret);
+  cu_hash_wy_state_init(&state->high, seed, cu_hash_wy_secret_high);
+}
+
+void cu_Hash_Wy128_update(cu_Hash_Wy128_State *state, cu_Slice data) {
+  cu_Hash_Wy64_update(&state->low, data);
+  cu_Hash_Wy64_update(&state->high, data);
+}
+
+cu_Hash128 cu_Hash_Wy128_final(const cu_Hash_Wy128_State *state) {
+  cu_Hash128 out;
+  out.low = cu_Hash_Wy64_final(&state->low);
+  out.high = cu_Hash_Wy64_final(&state->high);
+  return out;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Generic hasher                                                             */
+/* -------------------------------------------------------------------------- */
+
+cu_Hasher cu_Hasher_Murmur3_32(uint32_t seed) {
+  cu_Hasher h;
+  h.kind = CU_HASHER_MURMUR3_32;
+  cu_Hash_Murmur3_32_init(&h.state.murmur3, seed);
+  return h;
+}
+
+cu_Hasher cu_Hasher_SipHash24(const uint8_t key[16]) {
+  cu_Hasher h;
+  h.kind = CU_HASHER_SIPHASH24;
+  cu_Hash_SipHash24_init(&h.state.siphash, key);
+  return h;
+}
+
+cu_Hasher cu_Hasher_Wy64(uint64_t seed) {
+  cu_Hasher h;
+  h.kind = CU_HASHER_WY64;
+  cu_Hash_Wy64_init(&h.state.wy64, seed);
+  return h;
+}
+
+cu_Hasher cu_Hasher_Wy128(uint64_t seed) {
+  cu_Hasher h;
+  h.kind = CU_HASHER_WY128;
+  cu_Hash_Wy128_init(&h.state.wy128, seed);
+  return h;
+}
+
+cu_Hasher cu_Hasher_CRC32C(void) {
+  cu_Hasher h;
+  h.kind = CU_HASHER_CRC32C;
+  h.state.crc32c = 0;
+  return h;
+}
+
+void cu_Hasher_update(cu_Hasher *hasher, cu_Slice data) {
+  switch (hasher->kind) {
+  case CU_HASHER_MURMUR3_32:
+    cu_Hash_Murmur3_32_update(&hasher->state.murmur3, data);
+    break;
+  case CU_HASHER_SIPHASH24:
+    cu_Hash_SipHash24_update(&hasher->state.siphash, data);
+    break;
+  case CU_HASHER_WY64:
+    cu_Hash_Wy64_update(&hasher->state.wy64, data);
+    break;
+  case CU_HASHER_WY128:
+    cu_Hash_Wy128_update(&hasher->state.wy128, data);
+    break;
+  case CU_HASHER_CRC32C:
+    hasher->state.crc32c =
+        cu_Hash_CRC32C_update(hasher->state.crc32c, data.ptr, data.length);
+    break;
+  }
+}
+
+cu_Hash128 cu_Hasher_final(const cu_Hasher *hasher) {
+  cu_Hash128 out = {0, 0};
+  switch (hasher->kind) {
+  case CU_HASHER_MURMUR3_32:
+    out.low = cu_Hash_Murmur3_32_final(&hasher->state.murmur3);
+    break;
+  case CU_HASHER_SIPHASH24:
+    out.low = cu_Hash_SipHash24_final(&hasher->state.siphash);
+    break;
+  case CU_HASHER_WY64:
+    out.low = cu_Hash_Wy64_final(&hasher->state.wy64);
+    break;
+  case CU_HASHER_WY128:
+    out = cu_Hash_Wy128_final(&hasher->state.wy128);
+    break;
+  case CU_HASHER_CRC32C:
+    out.low = hasher->state.crc32c;
+    break;
+  }
+  return out;
+}
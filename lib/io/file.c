@@ -15,6 +15,7 @@
 #else
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #endif
@@ -104,7 +105,11 @@ cu_File_Result cu_File_open(
 
   handle = open(lpath, flags, mode);
   if (handle == -1) {
-    return cu_File_Result_error(cu_Io_Error_from_errno(errno));
+    cu_Io_Error err = cu_Io_Error_from_errno(errno);
+    if (cu_String_Result_is_ok(&pres)) {
+      cu_String_destroy(&pres.value);
+    }
+    return cu_File_Result_error(err);
   }
 
   stat = cu_File_Stat_from_handle(handle);
@@ -306,6 +311,66 @@ cu_IoSize_Result cu_File_tell(cu_File *file) {
   return cu_Fd_tell(file->handle);
 }
 
+cu_IoSlice_Result cu_File_map(cu_File *file) {
+  cu_Io_Error invalid = {
+      .kind = CU_IO_ERROR_KIND_INVALID_INPUT,
+      .errnum = Size_Optional_none(),
+  };
+  CU_IF_NULL(file) { return cu_IoSlice_Result_error(invalid); }
+  if (file->handle == CU_INVALID_HANDLE) {
+    return cu_IoSlice_Result_error(invalid);
+  }
+
+#if CU_PLAT_POSIX
+  struct stat st;
+  if (fstat(file->handle, &st) != 0) {
+    return cu_IoSlice_Result_error(cu_Io_Error_from_errno(errno));
+  }
+  if (st.st_size <= 0) {
+    return cu_IoSlice_Result_error(invalid);
+  }
+  size_t size = (size_t)st.st_size;
+  void *ptr = mmap(NULL, size, PROT_READ, MAP_SHARED, file->handle, 0);
+  if (ptr == MAP_FAILED) {
+    return cu_IoSlice_Result_error(cu_Io_Error_from_errno(errno));
+  }
+#else
+  LARGE_INTEGER st;
+  if (!GetFileSizeEx(file->handle, &st)) {
+    return cu_IoSlice_Result_error(cu_Io_Error_from_win32(GetLastError()));
+  }
+  if (st.QuadPart <= 0) {
+    return cu_IoSlice_Result_error(invalid);
+  }
+  size_t size = (size_t)st.QuadPart;
+  HANDLE mapping =
+      CreateFileMappingA(file->handle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping) {
+    return cu_IoSlice_Result_error(cu_Io_Error_from_win32(GetLastError()));
+  }
+  /* the view keeps the mapping object alive */
+  void *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  DWORD error = GetLastError();
+  CloseHandle(mapping);
+  if (!ptr) {
+    return cu_IoSlice_Result_error(cu_Io_Error_from_win32(error));
+  }
+#endif
+
+  return cu_IoSlice_Result_ok(cu_Slice_create(ptr, size));
+}
+
+void cu_File_unmap(cu_Slice mapping) {
+  if (!mapping.ptr) {
+    return;
+  }
+#if CU_PLAT_POSIX
+  munmap(mapping.ptr, mapping.length);
+#else
+  UnmapViewOfFile(mapping.ptr);
+#endif
+}
+
 cu_File_Result cu_Dir_openat(
     cu_Dir *dir, cu_Slice path, cu_File_Options options) {
   CU_IF_NULL(dir) {
@@ -0,0 +1,108 @@
+#include "io/hashstream.h"
+#include "macro.h"
+#include "nostd.h"
+
+#ifndef CU_FREESTANDING
+
+cu_HashStream cu_HashStream_create(cu_Stream inner, cu_Hasher hasher) {
+  cu_HashStream hs;
+  hs.inner = inner;
+  hs.hasher = hasher;
+  hs.position = Size_Optional_none();
+  hs.untellable = false;
+  return hs;
+}
+
+/* Advance the tracked position by @p n bytes, if it is known. */
+static void cu_HashStream_advance(cu_HashStream *hs, size_t n) {
+  if (Size_Optional_is_some(&hs->position)) {
+    hs->position = Size_Optional_some(hs->position.value + n);
+  }
+}
+
+/*
+ * A failed read may still have consumed a prefix of @p buf, as a short read
+ * at the end of the stream does. The tracked position taken before the read
+ * and the inner stream position after it tell how long that prefix is.
+ */
+static cu_Io_Error_Optional cu_HashStream_read(void *self, cu_Slice buf) {
+  cu_HashStream *hs = (cu_HashStream *)self;
+  if (Size_Optional_is_none(&hs->position) && !hs->untellable) {
+    cu_IoSize_Result pos = cu_Stream_tell(&hs->inner);
+    if (cu_IoSize_Result_is_ok(&pos)) {
+      hs->position = Size_Optional_some(pos.value);
+    } else {
+      hs->untellable = true;
+    }
+  }
+  cu_Io_Error_Optional err = cu_Stream_read(&hs->inner, buf);
+  if (cu_Io_Error_Optional_is_none(&err)) {
+    cu_Hasher_update(&hs->hasher, buf);
+    cu_HashStream_advance(hs, buf.length);
+    return err;
+  }
+  if (Size_Optional_is_some(&hs->position)) {
+    size_t before = hs->position.value;
+    cu_IoSize_Result after = cu_Stream_tell(&hs->inner);
+    hs->position = Size_Optional_none();
+    hs->untellable = !cu_IoSize_Result_is_ok(&after);
+    if (cu_IoSize_Result_is_ok(&after) && after.value >= before &&
+        after.value - before <= buf.length) {
+      cu_Hasher_update(
+          &hs->hasher, cu_Slice_create(buf.ptr, after.value - before));
+      hs->position = Size_Optional_some(after.value);
+    }
+  }
+  return err;
+}
+
+static cu_Io_Error_Optional cu_HashStream_write(void *self, cu_Slice data) {
+  cu_HashStream *hs = (cu_HashStream *)self;
+  cu_Io_Error_Optional err = cu_Stream_write(&hs->inner, data);
+  if (cu_Io_Error_Optional_is_none(&err)) {
+    cu_Hasher_update(&hs->hasher, data);
+    cu_HashStream_advance(hs, data.length);
+  } else {
+    hs->position = Size_Optional_none();
+  }
+  return err;
+}
+
+static cu_Io_Error_Optional cu_HashStream_flush(void *self) {
+  cu_HashStream *hs = (cu_HashStream *)self;
+  return cu_Stream_flush(&hs->inner);
+}
+
+static void cu_HashStream_close(void *self) {
+  cu_HashStream *hs = (cu_HashStream *)self;
+  cu_Stream_close(&hs->inner);
+}
+
+static cu_Io_Error_Optional cu_HashStream_seek(void *self, cu_File_SeekTo to) {
+  cu_HashStream *hs = (cu_HashStream *)self;
+  hs->position = Size_Optional_none();
+  return cu_Stream_seek(&hs->inner, to);
+}
+
+static cu_IoSize_Result cu_HashStream_tell(void *self) {
+  cu_HashStream *hs = (cu_HashStream *)self;
+  return cu_Stream_tell(&hs->inner);
+}
+
+cu_Stream cu_HashStream_stream(cu_HashStream *hs) {
+  cu_Stream iface;
+  iface.self = hs;
+  iface.readFn = cu_HashStream_read;
+  iface.writeFn = cu_HashStream_write;
+  iface.flushFn = cu_HashStream_flush;
+  iface.closeFn = cu_HashStream_close;
+  iface.seekFn = cu_HashStream_seek;
+  iface.tellFn = cu_HashStream_tell;
+  return iface;
+}
+
+cu_Hash128 cu_HashStream_digest(const cu_HashStream *hs) {
+  return cu_Hasher_final(&hs->hasher);
+}
+
+#endif // CU_FREESTANDING
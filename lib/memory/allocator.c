@@ -59,9 +59,13 @@ static cu_IoSlice_Result cu_CAllocator_Grow(
     alignment = sizeof(void *);
   }
   void *raw = *((void **)old_mem.ptr - 1);
+  /* realloc keeps the contents at the same offset from the raw pointer, which
+   * only fits the new block when the alignment did not shrink */
+  size_t offset = (size_t)((uintptr_t)old_mem.ptr - (uintptr_t)raw);
   size_t total = new_layout.elem_size + alignment - 1 + sizeof(void *);
-  void *new_raw = realloc(raw, total);
-  if (!new_raw && total != 0) {
+  void *new_raw =
+      offset < alignment + sizeof(void *) ? realloc(raw, total) : NULL;
+  if (!new_raw) {
     cu_IoSlice_Result alloc_res = cu_CAllocator_Alloc(self, new_layout);
     if (!cu_IoSlice_Result_is_ok(&alloc_res)) {
       return alloc_res;
@@ -74,13 +78,13 @@ static cu_IoSlice_Result cu_CAllocator_Grow(
   uintptr_t aligned_addr =
       ((uintptr_t)new_raw + sizeof(void *) + alignment - 1) &
       ~(uintptr_t)(alignment - 1);
-  void **store = (void **)aligned_addr - 1;
-  *store = new_raw;
-  if ((void *)aligned_addr != old_mem.ptr) {
+  if (aligned_addr - (uintptr_t)new_raw != offset) {
     size_t copy = CU_MIN(old_mem.length, new_layout.elem_size);
     cu_Memory_smemmove(cu_Slice_create((void *)aligned_addr, copy),
-        cu_Slice_create(old_mem.ptr, copy));
+        cu_Slice_create((unsigned char *)new_raw + offset, copy));
   }
+  void **store = (void **)aligned_addr - 1;
+  *store = new_raw;
   return cu_IoSlice_Result_ok(
       cu_Slice_create((void *)aligned_addr, new_layout.elem_size));
 }
@@ -98,9 +102,13 @@ static cu_IoSlice_Result cu_CAllocator_Shrink(
     alignment = sizeof(void *);
   }
   void *raw = *((void **)old_mem.ptr - 1);
+  /* realloc keeps the contents at the same offset from the raw pointer, which
+   * only fits the new block when the alignment did not shrink */
+  size_t offset = (size_t)((uintptr_t)old_mem.ptr - (uintptr_t)raw);
   size_t total = new_layout.elem_size + alignment - 1 + sizeof(void *);
-  void *new_raw = realloc(raw, total);
-  if (!new_raw && total != 0) {
+  void *new_raw =
+      offset < alignment + sizeof(void *) ? realloc(raw, total) : NULL;
+  if (!new_raw) {
     cu_IoSlice_Result alloc_res = cu_CAllocator_Alloc(self, new_layout);
     if (!cu_IoSlice_Result_is_ok(&alloc_res)) {
       return alloc_res;
@@ -116,13 +124,13 @@ static cu_IoSlice_Result cu_CAllocator_Shrink(
   uintptr_t aligned_addr =
       ((uintptr_t)new_raw + sizeof(void *) + alignment - 1) &
       ~(uintptr_t)(alignment - 1);
+  if (aligned_addr - (uintptr_t)new_raw != offset) {
+    size_t copy = CU_MIN(old_mem.length, new_layout.elem_size);
+    cu_Memory_smemmove(cu_Slice_create((void *)aligned_addr, copy),
+        cu_Slice_create((unsigned char *)new_raw + offset, copy));
+  }
   void **store = (void **)aligned_addr - 1;
   *store = new_raw;
-  if ((void *)aligned_addr != old_mem.ptr) {
-    size_t copy = CU_MIN(new_layout.elem_size, old_mem.length);
-    cu_Memory_smemcpy(cu_Slice_create((void *)aligned_addr, copy),
-        cu_Slice_create(old_mem.ptr, copy));
-  }
   return cu_IoSlice_Result_ok(
       cu_Slice_create((void *)aligned_addr, new_layout.elem_size));
 }
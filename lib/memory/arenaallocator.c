@@ -17,11 +17,44 @@ static struct cu_ArenaAllocator_Chunk *cu_arena_create_chunk(
   struct cu_ArenaAllocator_Chunk *chunk =
       (struct cu_ArenaAllocator_Chunk *)mem.value.ptr;
   chunk->prev = NULL;
+  chunk->next = NULL;
   chunk->size = size;
   chunk->used = 0;
   return chunk;
 }
 
+/*
+ * Make a chunk with at least @p needed bytes the current one. Spare chunks
+ * are reused in their original order, new chunks double in size up to the
+ * configured limit so the chain stays short.
+ */
+static struct cu_ArenaAllocator_Chunk *cu_arena_push_chunk(
+    cu_ArenaAllocator *arena, size_t needed) {
+  struct cu_ArenaAllocator_Chunk *chunk = arena->spare;
+  if (chunk && chunk->size >= needed) {
+    arena->spare = chunk->next;
+  } else {
+    chunk = cu_arena_create_chunk(arena, CU_MAX(needed, arena->nextChunkSize));
+    if (!chunk) {
+      return NULL;
+    }
+    if (arena->nextChunkSize < arena->maxChunkSize) {
+      arena->nextChunkSize =
+          CU_MIN(arena->nextChunkSize * 2, arena->maxChunkSize);
+    }
+  }
+  chunk->used = 0;
+  chunk->next = NULL;
+  chunk->prev = arena->current;
+  if (arena->current) {
+    arena->current->next = chunk;
+  } else {
+    arena->first = chunk;
+  }
+  arena->current = chunk;
+  return chunk;
+}
+
 static cu_IoSlice_Result cu_arena_alloc(void *self, cu_Layout layout) {
   cu_ArenaAllocator *arena = (cu_ArenaAllocator *)self;
   if (layout.elem_size == 0) {
@@ -36,36 +69,19 @@ static cu_IoSlice_Result cu_arena_alloc(void *self, cu_Layout layout) {
   }
 
   const size_t header_size = sizeof(struct cu_ArenaAllocator_Header);
-  size_t chunk_size = arena->chunkSize;
-  if (chunk_size == 0) {
-    chunk_size = CU_ARENA_CHUNK_SIZE;
-  }
   size_t needed = alignment - 1 + size + header_size;
 
   struct cu_ArenaAllocator_Chunk *chunk = arena->current;
-  struct cu_ArenaAllocator_Chunk *target = NULL;
-
-  for (struct cu_ArenaAllocator_Chunk *c = chunk; c; c = c->prev) {
-    size_t start = CU_ALIGN_UP(c->used + header_size, alignment);
-    if (start + size <= c->size) {
-      target = c;
-      break;
-    }
-  }
-
-  if (!target) {
-    size_t new_size = CU_MAX(needed, chunk_size);
-    target = cu_arena_create_chunk(arena, new_size);
-    if (!target) {
+  if (!chunk ||
+      CU_ALIGN_UP(chunk->used + header_size, alignment) + size > chunk->size) {
+    chunk = cu_arena_push_chunk(arena, needed);
+    if (!chunk) {
       cu_Io_Error err = {.kind = CU_IO_ERROR_KIND_OUT_OF_MEMORY,
           .errnum = Size_Optional_none()};
       return cu_IoSlice_Result_error(err);
     }
-    target->prev = arena->current;
-    arena->current = target;
   }
 
-  chunk = target;
   size_t start = CU_ALIGN_UP(chunk->used + header_size, alignment);
   size_t header_pos = start - header_size;
   struct cu_ArenaAllocator_Header *hdr =
@@ -190,7 +206,14 @@ cu_Allocator cu_Allocator_ArenaAllocator(
   if (arena->chunkSize == 0) {
     arena->chunkSize = CU_ARENA_CHUNK_SIZE;
   }
+  arena->maxChunkSize = config.maxChunkSize;
+  if (arena->maxChunkSize == 0) {
+    arena->maxChunkSize = CU_MAX(arena->chunkSize, CU_ARENA_MAX_CHUNK_SIZE);
+  }
+  arena->nextChunkSize = arena->chunkSize;
   arena->current = NULL;
+  arena->first = NULL;
+  arena->spare = NULL;
 
   cu_Allocator a = {0};
   a.self = arena;
@@ -201,12 +224,45 @@ cu_Allocator cu_Allocator_ArenaAllocator(
   return a;
 }
 
+cu_ArenaAllocator_Mark cu_ArenaAllocator_mark(
+    const cu_ArenaAllocator *arena) {
+  cu_ArenaAllocator_Mark mark;
+  mark.chunk = arena->current;
+  mark.used = arena->current ? arena->current->used : 0;
+  return mark;
+}
+
+void cu_ArenaAllocator_rewind(
+    cu_ArenaAllocator *arena, cu_ArenaAllocator_Mark mark) {
+  /* splice every chunk newer than the mark in front of the spare list */
+  struct cu_ArenaAllocator_Chunk *oldest =
+      mark.chunk ? mark.chunk->next : arena->first;
+  if (oldest) {
+    arena->current->next = arena->spare;
+    arena->spare = oldest;
+  }
+  if (mark.chunk) {
+    mark.chunk->next = NULL;
+    mark.chunk->used = mark.used;
+  } else {
+    arena->first = NULL;
+  }
+  arena->current = mark.chunk;
+}
+
+void cu_ArenaAllocator_reset(cu_ArenaAllocator *arena) {
+  cu_ArenaAllocator_Mark empty = {NULL, 0};
+  cu_ArenaAllocator_rewind(arena, empty);
+}
+
 void cu_ArenaAllocator_destroy(cu_ArenaAllocator *arena) {
-  struct cu_ArenaAllocator_Chunk *chunk = arena->current;
+  cu_ArenaAllocator_reset(arena);
+  struct cu_ArenaAllocator_Chunk *chunk = arena->spare;
   while (chunk) {
-    struct cu_ArenaAllocator_Chunk *prev = chunk->prev;
+    struct cu_ArenaAllocator_Chunk *next = chunk->next;
     cu_arena_destroy_chunk(arena, chunk);
-    chunk = prev;
+    chunk = next;
   }
-  arena->current = NULL;
+  arena->spare = NULL;
+  arena->nextChunkSize = arena->chunkSize;
 }
@@ -1,9 +1,17 @@
+/* macro.h is not included yet, so test the compiler macro directly */
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
 #include "memory/gpallocator.h"
 #include "io/error.h"
 #include "macro.h"
 #include "memory/wasmallocator.h"
 #include "utility.h"
 #include <nostd.h>
+#if CU_PLAT_LINUX && !CU_FREESTANDING
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 /* Helper forward declarations */
 static cu_IoSlice_Result cu_gpa_alloc(void *self, cu_Layout layout);
@@ -12,55 +20,332 @@ static cu_IoSlice_Result cu_gpa_grow(
 static cu_IoSlice_Result cu_gpa_shrink(
     void *self, cu_Slice old_mem, cu_Layout new_layout);
 static void cu_gpa_free(void *self, cu_Slice mem);
-static void cu_gpa_destroy_bucket(
-    cu_GPAllocator *gpa, struct cu_GPAllocator_BucketHeader *bucket);
+static cu_Io_Error_Optional cu_gpa_alloc_batch(
+    void *self, cu_Layout layout, cu_Slice *out, size_t count);
+static void cu_gpa_free_batch(void *self, const cu_Slice *mems, size_t count);
+static void cu_gpa_destroy_bucket(cu_GPAllocator *gpa,
+    struct cu_GPAllocator_BucketHeader *bucket, bool purge);
+
+/* -------------------------------------------------------------------------- */
+/* Address index                                                              */
+/* -------------------------------------------------------------------------- */
+
+#define CU_GPA_INDEX_MIN_CAPACITY 16
+
+static size_t cu_gpa_index_home(
+    const struct cu_GPAllocator_Index *index, uintptr_t key) {
+  uint64_t h = (uint64_t)key * 0x9e3779b97f4a7c15ull;
+  h ^= h >> 32;
+  return (size_t)h & (index->capacity - 1);
+}
+
+static struct cu_GPAllocator_IndexEntry *cu_gpa_index_find(
+    const struct cu_GPAllocator_Index *index, uintptr_t key) {
+  if (index->capacity == 0) {
+    return NULL;
+  }
+  size_t mask = index->capacity - 1;
+  size_t i = cu_gpa_index_home(index, key);
+  for (;;) {
+    struct cu_GPAllocator_IndexEntry *e = &index->entries[i];
+    if (e->key == key) {
+      return e;
+    }
+    if (e->key == 0) {
+      return NULL;
+    }
+    i = (i + 1) & mask;
+  }
+}
+
+static void cu_gpa_index_place(
+    struct cu_GPAllocator_Index *index, uintptr_t key, cu_Slice slice) {
+  size_t mask = index->capacity - 1;
+  size_t i = cu_gpa_index_home(index, key);
+  while (index->entries[i].key != 0) {
+    i = (i + 1) & mask;
+  }
+  index->entries[i].key = key;
+  index->entries[i].slice = slice;
+  index->length++;
+}
+
+static bool cu_gpa_index_grow(
+    cu_GPAllocator *gpa, struct cu_GPAllocator_Index *index) {
+  size_t new_cap = index->capacity * 2;
+  if (new_cap < CU_GPA_INDEX_MIN_CAPACITY) {
+    new_cap = CU_GPA_INDEX_MIN_CAPACITY;
+  }
+  size_t bytes = new_cap * sizeof(struct cu_GPAllocator_IndexEntry);
+  cu_IoSlice_Result mem = cu_Allocator_Alloc(gpa->backingAllocator,
+      cu_Layout_create(bytes, _Alignof(struct cu_GPAllocator_IndexEntry)));
+  if (!cu_IoSlice_Result_is_ok(&mem)) {
+    return false;
+  }
+  cu_Memory_memset(mem.value.ptr, 0, bytes);
+
+  struct cu_GPAllocator_IndexEntry *old = index->entries;
+  size_t old_cap = index->capacity;
+  index->entries = (struct cu_GPAllocator_IndexEntry *)mem.value.ptr;
+  index->capacity = new_cap;
+  index->length = 0;
+  for (size_t i = 0; i < old_cap; ++i) {
+    if (old[i].key != 0) {
+      cu_gpa_index_place(index, old[i].key, old[i].slice);
+    }
+  }
+  if (old) {
+    cu_Allocator_Free(gpa->backingAllocator,
+        cu_Slice_create(
+            old, old_cap * sizeof(struct cu_GPAllocator_IndexEntry)));
+  }
+  return true;
+}
+
+static bool cu_gpa_index_insert(cu_GPAllocator *gpa,
+    struct cu_GPAllocator_Index *index, uintptr_t key, cu_Slice slice) {
+  if ((index->length + 1) * 2 > index->capacity) {
+    if (!cu_gpa_index_grow(gpa, index)) {
+      return false;
+    }
+  }
+  cu_gpa_index_place(index, key, slice);
+  return true;
+}
+
+/* Backward-shift deletion keeps probe chains short without tombstones. */
+static void cu_gpa_index_remove(struct cu_GPAllocator_Index *index,
+    struct cu_GPAllocator_IndexEntry *entry) {
+  size_t mask = index->capacity - 1;
+  size_t hole = (size_t)(entry - index->entries);
+  size_t i = hole;
+  for (;;) {
+    i = (i + 1) & mask;
+    struct cu_GPAllocator_IndexEntry *e = &index->entries[i];
+    if (e->key == 0) {
+      break;
+    }
+    size_t home = cu_gpa_index_home(index, e->key);
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      index->entries[hole] = *e;
+      hole = i;
+    }
+  }
+  index->entries[hole].key = 0;
+  index->entries[hole].slice = cu_Slice_create(NULL, 0);
+  index->length--;
+}
+
+static void cu_gpa_index_destroy(
+    cu_GPAllocator *gpa, struct cu_GPAllocator_Index *index) {
+  if (index->entries) {
+    cu_Allocator_Free(gpa->backingAllocator,
+        cu_Slice_create(index->entries,
+            index->capacity * sizeof(struct cu_GPAllocator_IndexEntry)));
+  }
+  index->entries = NULL;
+  index->capacity = 0;
+  index->length = 0;
+}
 
 /* -------------------------------------------------------------------------- */
 /* Utility functions                                                          */
 /* -------------------------------------------------------------------------- */
 
 static size_t cu_gpa_calc_slot_count(cu_GPAllocator *gpa, size_t obj_size) {
-  size_t max_data = gpa->bucketSize;
-  if (max_data == 0) {
-    max_data = CU_GPA_BUCKET_SIZE;
-  }
-  size_t count = max_data / obj_size;
+  size_t count = gpa->spanSize / obj_size;
   if (count == 0) {
     count = 1;
   }
   return count;
 }
 
+/* -------------------------------------------------------------------------- */
+/* Spans                                                                      */
+/* -------------------------------------------------------------------------- */
+
+static void cu_gpa_link_region(
+    cu_GPAllocator *gpa, struct cu_GPAllocator_Region *region) {
+  region->prev = NULL;
+  region->next = gpa->regions;
+  if (region->next) {
+    region->next->prev = region;
+  }
+  gpa->regions = region;
+}
+
+static void cu_gpa_unlink_region(
+    cu_GPAllocator *gpa, struct cu_GPAllocator_Region *region) {
+  if (region->prev) {
+    region->prev->next = region->next;
+  } else {
+    gpa->regions = region->next;
+  }
+  if (region->next) {
+    region->next->prev = region->prev;
+  }
+  region->prev = NULL;
+  region->next = NULL;
+}
+
+/*
+ * Buckets live in spans aligned to their size so the owning bucket of a
+ * pointer is found by masking the address. Spans are carved from regions so
+ * the alignment is paid once per region rather than once per span. Backing
+ * allocators that do not honour the alignment are handled by over-allocating
+ * and aligning manually.
+ */
+static struct cu_GPAllocator_Region *cu_gpa_create_region(cu_GPAllocator *gpa) {
+  size_t span = gpa->spanSize;
+  if (span > SIZE_MAX / (CU_GPA_REGION_SPANS + 1)) {
+    return NULL;
+  }
+  size_t bytes = span * CU_GPA_REGION_SPANS;
+  cu_IoSlice_Result header = cu_Allocator_Alloc(
+      gpa->backingAllocator, CU_LAYOUT(struct cu_GPAllocator_Region));
+  if (!cu_IoSlice_Result_is_ok(&header)) {
+    return NULL;
+  }
+  struct cu_GPAllocator_Region *region =
+      (struct cu_GPAllocator_Region *)header.value.ptr;
+
+  cu_IoSlice_Result mem = cu_Allocator_Alloc(
+      gpa->backingAllocator, cu_Layout_create(bytes, span));
+  if (cu_IoSlice_Result_is_ok(&mem) &&
+      ((uintptr_t)mem.value.ptr & (span - 1)) == 0) {
+    region->base = (unsigned char *)mem.value.ptr;
+  } else {
+    if (cu_IoSlice_Result_is_ok(&mem)) {
+      cu_Allocator_Free(gpa->backingAllocator, mem.value);
+    }
+    mem = cu_Allocator_Alloc(gpa->backingAllocator,
+        cu_Layout_create(bytes + span, sizeof(void *)));
+    if (!cu_IoSlice_Result_is_ok(&mem)) {
+      cu_Allocator_Free(gpa->backingAllocator, header.value);
+      return NULL;
+    }
+    region->base =
+        (unsigned char *)CU_ALIGN_UP((uintptr_t)mem.value.ptr, span);
+  }
+  region->memory = mem.value;
+  region->freeSpans = SIZE_MAX;
+  cu_gpa_link_region(gpa, region);
+  return region;
+}
+
+static unsigned char *cu_gpa_alloc_span(
+    cu_GPAllocator *gpa, struct cu_GPAllocator_Region **region_out) {
+  struct cu_GPAllocator_Region *region = gpa->regions;
+  if (!region) {
+    region = cu_gpa_create_region(gpa);
+    if (!region) {
+      return NULL;
+    }
+  }
+  size_t i = cu_count_trailing_zeros(region->freeSpans);
+  region->freeSpans &= region->freeSpans - 1;
+  if (region->freeSpans == 0) {
+    cu_gpa_unlink_region(gpa, region);
+  }
+  *region_out = region;
+  return region->base + i * gpa->spanSize;
+}
+
+/*
+ * Return the whole pages of an unused span to the system. Purged pages read
+ * back as zero when the span is used again. Spans smaller than a page cannot
+ * be purged.
+ */
+static bool cu_gpa_purge_span(cu_GPAllocator *gpa, unsigned char *span) {
+#if CU_PLAT_LINUX && !CU_FREESTANDING && defined(MADV_DONTNEED)
+  uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+  uintptr_t start = CU_ALIGN_UP((uintptr_t)span, page);
+  uintptr_t end = ((uintptr_t)span + gpa->spanSize) & ~(page - 1);
+  if (end <= start ||
+      madvise((void *)start, end - start, MADV_DONTNEED) != 0) {
+    return false;
+  }
+  gpa->purgedPages += (end - start) / page;
+  return true;
+#else
+  CU_UNUSED(gpa);
+  CU_UNUSED(span);
+  return false;
+#endif
+}
+
+/* Give a span back to its region, freeing the region once it is unused. */
+static void cu_gpa_free_span(cu_GPAllocator *gpa,
+    struct cu_GPAllocator_Region *region, unsigned char *span, bool purge) {
+  size_t i = (size_t)(span - region->base) / gpa->spanSize;
+  if (region->freeSpans == 0) {
+    cu_gpa_link_region(gpa, region);
+  }
+  region->freeSpans |= (size_t)1 << i;
+  if (region->freeSpans == SIZE_MAX) {
+    cu_gpa_unlink_region(gpa, region);
+    cu_Allocator_Free(gpa->backingAllocator, region->memory);
+    cu_Allocator_Free(
+        gpa->backingAllocator, cu_Slice_create(region, sizeof(*region)));
+    return;
+  }
+  if (purge) {
+    cu_gpa_purge_span(gpa, span);
+  }
+}
+
 static struct cu_GPAllocator_BucketHeader *cu_gpa_create_bucket(
     cu_GPAllocator *gpa, size_t obj_size) {
   size_t slot_count = cu_gpa_calc_slot_count(gpa, obj_size);
-  size_t total =
-      sizeof(struct cu_GPAllocator_BucketHeader) + slot_count * obj_size;
-  cu_IoSlice_Result mem = cu_Allocator_Alloc(
-      gpa->backingAllocator, cu_Layout_create(total, obj_size));
-  if (!cu_IoSlice_Result_is_ok(&mem)) {
+  struct cu_GPAllocator_Region *region;
+  unsigned char *base = cu_gpa_alloc_span(gpa, &region);
+  if (!base) {
     return NULL;
   }
 
+  /* the header lives off the span so the whole span can be purged */
+  cu_IoSlice_Result header = cu_Allocator_Alloc(
+      gpa->backingAllocator, CU_LAYOUT(struct cu_GPAllocator_BucketHeader));
+  if (!cu_IoSlice_Result_is_ok(&header)) {
+    cu_gpa_free_span(gpa, region, base, false);
+    return NULL;
+  }
   struct cu_GPAllocator_BucketHeader *bucket =
-      (struct cu_GPAllocator_BucketHeader *)mem.value.ptr;
-  bucket->prev = NULL;
-  bucket->next = NULL;
+      (struct cu_GPAllocator_BucketHeader *)header.value.ptr;
+  if (!cu_gpa_index_insert(gpa, &gpa->spans, (uintptr_t)base,
+          cu_Slice_create(bucket, sizeof(*bucket)))) {
+    cu_Allocator_Free(gpa->backingAllocator, header.value);
+    cu_gpa_free_span(gpa, region, base, false);
+    return NULL;
+  }
   cu_Bitmap_Optional bits = cu_Bitmap_create(gpa->backingAllocator, slot_count);
   if (cu_Bitmap_Optional_is_none(&bits)) {
-    cu_Allocator_Free(
-        gpa->backingAllocator, cu_Slice_create(mem.value.ptr, total));
+    cu_gpa_index_remove(
+        &gpa->spans, cu_gpa_index_find(&gpa->spans, (uintptr_t)base));
+    cu_Allocator_Free(gpa->backingAllocator, header.value);
+    cu_gpa_free_span(gpa, region, base, false);
     return NULL;
   }
+  bucket->prev = NULL;
+  bucket->next = NULL;
   bucket->objects.used = bits.value;
-  bucket->objects.data = (unsigned char *)(bucket + 1);
+  bucket->objects.data = base;
   bucket->objects.objectSize = obj_size;
   bucket->objects.slotCount = slot_count;
   bucket->objects.usedCount = 0;
+  bucket->objects.freeHint = 0;
+  bucket->region = region;
+  bucket->emptySince = 0;
+  bucket->purged = false;
   bucket->canary = CU_GPA_CANARY;
   return bucket;
 }
 
+/* Whether objects of @p obj_size are served from buckets. */
+static bool cu_gpa_is_small(cu_GPAllocator *gpa, size_t obj_size, int idx) {
+  return idx >= 0 && obj_size <= gpa->bucketSize;
+}
+
 static int cu_gpa_index_from_size(size_t size) {
   int idx = 0;
   size_t s = 1;
@@ -76,73 +361,176 @@ static int cu_gpa_index_from_size(size_t size) {
 
 static struct cu_GPAllocator_BucketHeader *cu_gpa_find_bucket(
     cu_GPAllocator *gpa, void *ptr, size_t *slot_out) {
-  for (int i = 0; i < CU_GPA_NUM_SMALL_BUCKETS; ++i) {
-    struct cu_GPAllocator_BucketHeader *b = gpa->smallBuckets[i];
-    while (b) {
-      uintptr_t start = (uintptr_t)b->objects.data;
-      uintptr_t end = start + b->objects.objectSize * b->objects.slotCount;
-      if ((uintptr_t)ptr >= start && (uintptr_t)ptr < end) {
-        if (slot_out) {
-          *slot_out = ((uintptr_t)ptr - start) / b->objects.objectSize;
-        }
-        return b;
-      }
-      b = b->next;
-    }
+  uintptr_t base = (uintptr_t)ptr & ~(uintptr_t)(gpa->spanSize - 1);
+  struct cu_GPAllocator_IndexEntry *entry =
+      cu_gpa_index_find(&gpa->spans, base);
+  if (!entry) {
+    return NULL;
+  }
+  struct cu_GPAllocator_BucketHeader *b =
+      (struct cu_GPAllocator_BucketHeader *)entry->slice.ptr;
+  if (b->canary != CU_GPA_CANARY) {
+    CU_DIE("gpa bucket header corrupted");
+  }
+  size_t offset = (size_t)((uintptr_t)ptr - base);
+  if (offset >= b->objects.objectSize * b->objects.slotCount) {
+    return NULL;
+  }
+  if (slot_out) {
+    *slot_out = offset / b->objects.objectSize;
   }
-  return NULL;
+  return b;
 }
 
-static struct cu_GPAllocator_LargeAlloc *cu_gpa_find_large(
+static struct cu_GPAllocator_IndexEntry *cu_gpa_find_large(
     cu_GPAllocator *gpa, void *ptr) {
-  struct cu_GPAllocator_LargeAlloc *cur = gpa->largeAllocs;
-  while (cur) {
-    if (cur->slice.ptr == ptr) {
-      return cur;
+  return cu_gpa_index_find(&gpa->largeAllocs, (uintptr_t)ptr);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Allocation paths */
+/* -------------------------------------------------------------------------- */
+
+static void cu_gpa_link_bucket(cu_GPAllocator *gpa,
+    struct cu_GPAllocator_BucketHeader *bucket, int idx) {
+  bucket->prev = NULL;
+  bucket->next = gpa->smallBuckets[idx];
+  if (bucket->next) {
+    bucket->next->prev = bucket;
+  }
+  gpa->smallBuckets[idx] = bucket;
+}
+
+static void cu_gpa_unlink_bucket(cu_GPAllocator *gpa,
+    struct cu_GPAllocator_BucketHeader *bucket, int idx) {
+  if (bucket->prev) {
+    bucket->prev->next = bucket->next;
+  } else {
+    gpa->smallBuckets[idx] = bucket->next;
+  }
+  if (bucket->next) {
+    bucket->next->prev = bucket->prev;
+  }
+  bucket->prev = NULL;
+  bucket->next = NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Empty bucket retention */
+/* -------------------------------------------------------------------------- */
+
+static void cu_gpa_push_empty(cu_GPAllocator *gpa,
+    struct cu_GPAllocator_BucketHeader *bucket, int idx) {
+  bucket->prev = NULL;
+  bucket->next = gpa->emptyBuckets[idx];
+  if (bucket->next) {
+    bucket->next->prev = bucket;
+  }
+  gpa->emptyBuckets[idx] = bucket;
+  gpa->emptyCount[idx]++;
+}
+
+static void cu_gpa_remove_empty(cu_GPAllocator *gpa,
+    struct cu_GPAllocator_BucketHeader *bucket, int idx) {
+  if (bucket->prev) {
+    bucket->prev->next = bucket->next;
+  } else {
+    gpa->emptyBuckets[idx] = bucket->next;
+  }
+  if (bucket->next) {
+    bucket->next->prev = bucket->prev;
+  }
+  bucket->prev = NULL;
+  bucket->next = NULL;
+  gpa->emptyCount[idx]--;
+}
+
+static void cu_gpa_release_bucket(
+    cu_GPAllocator *gpa, struct cu_GPAllocator_BucketHeader *bucket) {
+  cu_gpa_index_remove(&gpa->spans,
+      cu_gpa_index_find(&gpa->spans, (uintptr_t)bucket->objects.data));
+  cu_gpa_destroy_bucket(gpa, bucket, !bucket->purged);
+}
+
+/* Advance a retained bucket by one decay step. */
+static void cu_gpa_decay_bucket(cu_GPAllocator *gpa,
+    struct cu_GPAllocator_BucketHeader *bucket, int idx) {
+  if (!bucket->purged && cu_gpa_purge_span(gpa, bucket->objects.data)) {
+    bucket->purged = true;
+    bucket->emptySince = gpa->clock;
+    return;
+  }
+  cu_gpa_remove_empty(gpa, bucket, idx);
+  cu_gpa_release_bucket(gpa, bucket);
+}
+
+static void cu_gpa_decay_class(cu_GPAllocator *gpa, int idx) {
+  struct cu_GPAllocator_BucketHeader *bucket = gpa->emptyBuckets[idx];
+  while (bucket) {
+    struct cu_GPAllocator_BucketHeader *next = bucket->next;
+    if (gpa->clock - bucket->emptySince >= gpa->decayTicks) {
+      cu_gpa_decay_bucket(gpa, bucket, idx);
     }
-    cur = cur->next;
+    bucket = next;
   }
-  return NULL;
+}
+
+static void cu_gpa_retain_bucket(cu_GPAllocator *gpa,
+    struct cu_GPAllocator_BucketHeader *bucket, int idx) {
+  cu_gpa_decay_class(gpa, idx);
+  if (gpa->emptyCount[idx] >= gpa->retainBuckets) {
+    cu_gpa_release_bucket(gpa, bucket);
+    return;
+  }
+  bucket->emptySince = gpa->clock;
+  bucket->purged = false;
+  cu_gpa_push_empty(gpa, bucket, idx);
+}
+
+static struct cu_GPAllocator_BucketHeader *cu_gpa_reuse_bucket(
+    cu_GPAllocator *gpa, int idx) {
+  struct cu_GPAllocator_BucketHeader *bucket = gpa->emptyBuckets[idx];
+  if (bucket) {
+    cu_gpa_remove_empty(gpa, bucket, idx);
+    bucket->purged = false;
+  }
+  return bucket;
 }
 
 /* -------------------------------------------------------------------------- */
-/* Allocation paths */
+/* Small allocations */
 /* -------------------------------------------------------------------------- */
 
 static cu_IoSlice_Result cu_gpa_alloc_small(cu_GPAllocator *gpa, size_t size,
     size_t alignment, size_t obj_size, int idx) {
   struct cu_GPAllocator_BucketHeader *bucket = gpa->smallBuckets[idx];
-  if (!bucket || bucket->objects.usedCount == bucket->objects.slotCount) {
-    bucket = cu_gpa_create_bucket(gpa, obj_size);
+  if (!bucket) {
+    bucket = cu_gpa_reuse_bucket(gpa, idx);
+    if (!bucket) {
+      bucket = cu_gpa_create_bucket(gpa, obj_size);
+    }
     if (!bucket) {
       cu_Io_Error err = {.kind = CU_IO_ERROR_KIND_OUT_OF_MEMORY,
           .errnum = Size_Optional_none()};
       return cu_IoSlice_Result_error(err);
     }
-    bucket->prev = gpa->smallBucketTails[idx];
-    bucket->next = NULL;
-    if (bucket->prev) {
-      bucket->prev->next = bucket;
-    } else {
-      gpa->smallBuckets[idx] = bucket;
-    }
-    gpa->smallBucketTails[idx] = bucket;
+    cu_gpa_link_bucket(gpa, bucket, idx);
   }
 
-  size_t slot = 0;
-  for (; slot < bucket->objects.slotCount; ++slot) {
-    if (!cu_Bitmap_get(&bucket->objects.used, slot)) {
-      break;
-    }
-  }
-  if (slot == bucket->objects.slotCount) {
+  Size_Optional slot =
+      cu_Bitmap_find_clear(&bucket->objects.used, bucket->objects.freeHint);
+  if (Size_Optional_is_none(&slot)) {
     cu_Io_Error err = {
         .kind = CU_IO_ERROR_KIND_OUT_OF_MEMORY, .errnum = Size_Optional_none()};
     return cu_IoSlice_Result_error(err);
   }
-  cu_Bitmap_set(&bucket->objects.used, slot);
+  cu_Bitmap_set(&bucket->objects.used, slot.value);
   bucket->objects.usedCount++;
-  void *ptr = bucket->objects.data + slot * bucket->objects.objectSize;
+  bucket->objects.freeHint = slot.value + 1;
+  if (bucket->objects.usedCount == bucket->objects.slotCount) {
+    cu_gpa_unlink_bucket(gpa, bucket, idx);
+  }
+  void *ptr = bucket->objects.data + slot.value * bucket->objects.objectSize;
   CU_UNUSED(alignment);
   return cu_IoSlice_Result_ok(cu_Slice_create(ptr, size));
 }
@@ -154,23 +542,14 @@ static cu_IoSlice_Result cu_gpa_alloc_large(
   if (!cu_IoSlice_Result_is_ok(&mem)) {
     return mem;
   }
-  cu_IoSlice_Result meta_mem = cu_Allocator_Alloc(gpa->backingAllocator,
-      cu_Layout_create(
-          sizeof(struct cu_GPAllocator_LargeAlloc), sizeof(void *)));
-  if (!cu_IoSlice_Result_is_ok(&meta_mem)) {
+  if (!cu_gpa_index_insert(
+          gpa, &gpa->largeAllocs, (uintptr_t)mem.value.ptr, mem.value)) {
     cu_Allocator_Free(gpa->backingAllocator, mem.value);
-    return meta_mem;
-  }
-  struct cu_GPAllocator_LargeAlloc *meta =
-      (struct cu_GPAllocator_LargeAlloc *)meta_mem.value.ptr;
-  meta->slice = mem.value;
-  meta->prev = NULL;
-  meta->next = gpa->largeAllocs;
-  if (meta->next) {
-    meta->next->prev = meta;
+    cu_Io_Error err = {
+        .kind = CU_IO_ERROR_KIND_OUT_OF_MEMORY, .errnum = Size_Optional_none()};
+    return cu_IoSlice_Result_error(err);
   }
-  gpa->largeAllocs = meta;
-  return cu_IoSlice_Result_ok(meta->slice);
+  return mem;
 }
 
 static cu_IoSlice_Result cu_gpa_alloc(void *self, cu_Layout layout) {
@@ -190,7 +569,7 @@ static cu_IoSlice_Result cu_gpa_alloc(void *self, cu_Layout layout) {
   size_t obj_size = cu_next_pow2(need);
 
   int idx = cu_gpa_index_from_size(obj_size);
-  if (idx < 0 || obj_size > gpa->bucketSize) {
+  if (!cu_gpa_is_small(gpa, obj_size, idx)) {
     return cu_gpa_alloc_large(gpa, size, alignment);
   }
   return cu_gpa_alloc_small(gpa, size, alignment, obj_size, idx);
@@ -200,6 +579,17 @@ static cu_IoSlice_Result cu_gpa_alloc(void *self, cu_Layout layout) {
 /* Resize and free */
 /* -------------------------------------------------------------------------- */
 
+static void cu_gpa_large_update(cu_GPAllocator *gpa,
+    struct cu_GPAllocator_IndexEntry *meta, cu_Slice resized) {
+  if (meta->key == (uintptr_t)resized.ptr) {
+    meta->slice = resized;
+    return;
+  }
+  /* removing first guarantees the insert does not need to grow the index */
+  cu_gpa_index_remove(&gpa->largeAllocs, meta);
+  cu_gpa_index_insert(gpa, &gpa->largeAllocs, (uintptr_t)resized.ptr, resized);
+}
+
 static cu_IoSlice_Result cu_gpa_grow(
     void *self, cu_Slice old_mem, cu_Layout new_layout) {
   cu_GPAllocator *gpa = (cu_GPAllocator *)self;
@@ -211,7 +601,8 @@ static cu_IoSlice_Result cu_gpa_grow(
   struct cu_GPAllocator_BucketHeader *bucket =
       cu_gpa_find_bucket(gpa, old_mem.ptr, &slot);
   if (!bucket) {
-    struct cu_GPAllocator_LargeAlloc *meta = cu_gpa_find_large(gpa, old_mem.ptr);
+    struct cu_GPAllocator_IndexEntry *meta =
+        cu_gpa_find_large(gpa, old_mem.ptr);
     if (!meta) {
       cu_Io_Error err = {.kind = CU_IO_ERROR_KIND_INVALID_INPUT,
           .errnum = Size_Optional_none()};
@@ -223,7 +614,7 @@ static cu_IoSlice_Result cu_gpa_grow(
     if (!cu_IoSlice_Result_is_ok(&resized)) {
       return resized;
     }
-    meta->slice = resized.value;
+    cu_gpa_large_update(gpa, meta, resized.value);
     return resized;
   }
 
@@ -254,7 +645,8 @@ static cu_IoSlice_Result cu_gpa_shrink(
   struct cu_GPAllocator_BucketHeader *bucket =
       cu_gpa_find_bucket(gpa, old_mem.ptr, &slot);
   if (!bucket) {
-    struct cu_GPAllocator_LargeAlloc *meta = cu_gpa_find_large(gpa, old_mem.ptr);
+    struct cu_GPAllocator_IndexEntry *meta =
+        cu_gpa_find_large(gpa, old_mem.ptr);
     if (!meta) {
       cu_Io_Error err = {.kind = CU_IO_ERROR_KIND_INVALID_INPUT,
           .errnum = Size_Optional_none()};
@@ -266,7 +658,7 @@ static cu_IoSlice_Result cu_gpa_shrink(
     if (!cu_IoSlice_Result_is_ok(&resized)) {
       return resized;
     }
-    meta->slice = resized.value;
+    cu_gpa_large_update(gpa, meta, resized.value);
     return resized;
   }
 
@@ -276,41 +668,30 @@ static cu_IoSlice_Result cu_gpa_shrink(
 
 static void cu_gpa_free_small(cu_GPAllocator *gpa,
     struct cu_GPAllocator_BucketHeader *bucket, size_t slot) {
+  if (!cu_Bitmap_get(&bucket->objects.used, slot)) {
+    return;
+  }
   cu_Bitmap_clear(&bucket->objects.used, slot);
-  if (bucket->objects.usedCount > 0) {
-    bucket->objects.usedCount--;
+  bucket->objects.usedCount--;
+  if (slot < bucket->objects.freeHint) {
+    bucket->objects.freeHint = slot;
+  }
+  gpa->clock++;
+  int idx = cu_gpa_index_from_size(bucket->objects.objectSize);
+  if (bucket->objects.usedCount + 1 == bucket->objects.slotCount) {
+    cu_gpa_link_bucket(gpa, bucket, idx);
   }
   if (bucket->objects.usedCount == 0) {
-    int idx = cu_gpa_index_from_size(bucket->objects.objectSize);
-    if (gpa->smallBuckets[idx] != bucket || bucket->next != NULL) {
-      if (bucket->prev) {
-        bucket->prev->next = bucket->next;
-      } else {
-        gpa->smallBuckets[idx] = bucket->next;
-      }
-      if (bucket->next) {
-        bucket->next->prev = bucket->prev;
-      } else {
-        gpa->smallBucketTails[idx] = bucket->prev;
-      }
-      cu_gpa_destroy_bucket(gpa, bucket);
-    }
+    cu_gpa_unlink_bucket(gpa, bucket, idx);
+    cu_gpa_retain_bucket(gpa, bucket, idx);
   }
 }
 
 static void cu_gpa_free_large(
-    cu_GPAllocator *gpa, struct cu_GPAllocator_LargeAlloc *meta) {
-  if (meta->prev) {
-    meta->prev->next = meta->next;
-  } else {
-    gpa->largeAllocs = meta->next;
-  }
-  if (meta->next) {
-    meta->next->prev = meta->prev;
-  }
-  cu_Allocator_Free(gpa->backingAllocator, meta->slice);
-  cu_Allocator_Free(gpa->backingAllocator,
-      cu_Slice_create(meta, sizeof(struct cu_GPAllocator_LargeAlloc)));
+    cu_GPAllocator *gpa, struct cu_GPAllocator_IndexEntry *meta) {
+  cu_Slice slice = meta->slice;
+  cu_gpa_index_remove(&gpa->largeAllocs, meta);
+  cu_Allocator_Free(gpa->backingAllocator, slice);
 }
 
 static void cu_gpa_free(void *self, cu_Slice mem) {
@@ -323,12 +704,82 @@ static void cu_gpa_free(void *self, cu_Slice mem) {
     cu_gpa_free_small(gpa, bucket, slot);
     return;
   }
-  struct cu_GPAllocator_LargeAlloc *meta = cu_gpa_find_large(gpa, mem.ptr);
+  struct cu_GPAllocator_IndexEntry *meta = cu_gpa_find_large(gpa, mem.ptr);
   if (meta) {
     cu_gpa_free_large(gpa, meta);
   }
 }
 
+/* -------------------------------------------------------------------------- */
+/* Batches */
+/* -------------------------------------------------------------------------- */
+
+static cu_Io_Error_Optional cu_gpa_alloc_batch(
+    void *self, cu_Layout layout, cu_Slice *out, size_t count) {
+  cu_GPAllocator *gpa = (cu_GPAllocator *)self;
+  if (layout.elem_size == 0) {
+    cu_Io_Error err = {
+        .kind = CU_IO_ERROR_KIND_INVALID_INPUT, .errnum = Size_Optional_none()};
+    return cu_Io_Error_Optional_some(err);
+  }
+  size_t size = layout.elem_size;
+  size_t alignment = layout.alignment;
+  if (alignment == 0) {
+    alignment = 1;
+  }
+  size_t obj_size = cu_next_pow2(CU_MAX(size, alignment));
+  int idx = cu_gpa_index_from_size(obj_size);
+  bool small = cu_gpa_is_small(gpa, obj_size, idx);
+
+  for (size_t i = 0; i < count; ++i) {
+    cu_IoSlice_Result res =
+        small ? cu_gpa_alloc_small(gpa, size, alignment, obj_size, idx)
+              : cu_gpa_alloc_large(gpa, size, alignment);
+    if (!cu_IoSlice_Result_is_ok(&res)) {
+      cu_gpa_free_batch(self, out, i);
+      return cu_Io_Error_Optional_some(res.error);
+    }
+    out[i] = res.value;
+  }
+  return cu_Io_Error_Optional_none();
+}
+
+/* Neighbouring blocks usually share a bucket, so skip the span lookup. */
+static void cu_gpa_free_batch(void *self, const cu_Slice *mems, size_t count) {
+  cu_GPAllocator *gpa = (cu_GPAllocator *)self;
+  struct cu_GPAllocator_BucketHeader *bucket = NULL;
+  uintptr_t bucket_base = 0;
+  for (size_t i = 0; i < count; ++i) {
+    void *ptr = mems[i].ptr;
+    if (!ptr) {
+      continue;
+    }
+    uintptr_t base = (uintptr_t)ptr & ~(uintptr_t)(gpa->spanSize - 1);
+    size_t slot = 0;
+    size_t offset = (size_t)((uintptr_t)ptr - base);
+    if (bucket && base == bucket_base &&
+        offset < bucket->objects.objectSize * bucket->objects.slotCount) {
+      slot = offset / bucket->objects.objectSize;
+    } else {
+      bucket = cu_gpa_find_bucket(gpa, ptr, &slot);
+      bucket_base = base;
+    }
+    if (!bucket) {
+      struct cu_GPAllocator_IndexEntry *meta = cu_gpa_find_large(gpa, ptr);
+      if (meta) {
+        cu_gpa_free_large(gpa, meta);
+      }
+      continue;
+    }
+    /* the last free may release the bucket */
+    bool last = bucket->objects.usedCount == 1;
+    cu_gpa_free_small(gpa, bucket, slot);
+    if (last) {
+      bucket = NULL;
+    }
+  }
+}
+
 /* -------------------------------------------------------------------------- */
 /* Public API */
 /* -------------------------------------------------------------------------- */
@@ -350,11 +801,25 @@ cu_Allocator cu_Allocator_GPAllocator(
   if (alloc->bucketSize == 0) {
     alloc->bucketSize = CU_GPA_BUCKET_SIZE;
   }
+  alloc->spanSize = cu_next_pow2(alloc->bucketSize);
+  alloc->retainBuckets = CU_GPA_RETAIN_BUCKETS;
+  if (Size_Optional_is_some(&config.retainBuckets)) {
+    alloc->retainBuckets = config.retainBuckets.value;
+  }
+  alloc->decayTicks = CU_GPA_DECAY_TICKS;
+  if (Size_Optional_is_some(&config.decayTicks)) {
+    alloc->decayTicks = config.decayTicks.value;
+  }
+  alloc->clock = 0;
+  alloc->purgedPages = 0;
   for (int i = 0; i < CU_GPA_NUM_SMALL_BUCKETS; ++i) {
     alloc->smallBuckets[i] = NULL;
-    alloc->smallBucketTails[i] = NULL;
+    alloc->emptyBuckets[i] = NULL;
+    alloc->emptyCount[i] = 0;
   }
-  alloc->largeAllocs = NULL;
+  alloc->regions = NULL;
+  alloc->spans = (struct cu_GPAllocator_Index){0};
+  alloc->largeAllocs = (struct cu_GPAllocator_Index){0};
 
   cu_Allocator a = {0};
   a.self = alloc;
@@ -362,33 +827,50 @@ cu_Allocator cu_Allocator_GPAllocator(
   a.growFn = cu_gpa_grow;
   a.shrinkFn = cu_gpa_shrink;
   a.freeFn = cu_gpa_free;
+  a.allocBatchFn = cu_gpa_alloc_batch;
+  a.freeBatchFn = cu_gpa_free_batch;
   return a;
 }
 
-static void cu_gpa_destroy_bucket(
-    cu_GPAllocator *gpa, struct cu_GPAllocator_BucketHeader *bucket) {
+static void cu_gpa_destroy_bucket(cu_GPAllocator *gpa,
+    struct cu_GPAllocator_BucketHeader *bucket, bool purge) {
   cu_Bitmap_destroy(&bucket->objects.used);
-  cu_Allocator_Free(gpa->backingAllocator,
-      cu_Slice_create(bucket, sizeof(*bucket) + bucket->objects.objectSize *
-                                                    bucket->objects.slotCount));
+  cu_gpa_free_span(gpa, bucket->region, bucket->objects.data, purge);
+  cu_Allocator_Free(
+      gpa->backingAllocator, cu_Slice_create(bucket, sizeof(*bucket)));
 }
 
-void cu_GPAllocator_destroy(cu_GPAllocator *alloc) {
+void cu_GPAllocator_purge(cu_GPAllocator *alloc) {
   for (int i = 0; i < CU_GPA_NUM_SMALL_BUCKETS; ++i) {
-    struct cu_GPAllocator_BucketHeader *b = alloc->smallBuckets[i];
-    while (b) {
-      struct cu_GPAllocator_BucketHeader *next = b->next;
-      cu_gpa_destroy_bucket(alloc, b);
-      b = next;
+    struct cu_GPAllocator_BucketHeader *bucket = alloc->emptyBuckets[i];
+    while (bucket) {
+      struct cu_GPAllocator_BucketHeader *next = bucket->next;
+      cu_gpa_decay_bucket(alloc, bucket, i);
+      bucket = next;
     }
+  }
+}
+
+void cu_GPAllocator_destroy(cu_GPAllocator *alloc) {
+  /* full buckets are not linked anywhere, the span index knows them all */
+  for (size_t i = 0; i < alloc->spans.capacity; ++i) {
+    struct cu_GPAllocator_IndexEntry *e = &alloc->spans.entries[i];
+    if (e->key != 0) {
+      cu_gpa_destroy_bucket(
+          alloc, (struct cu_GPAllocator_BucketHeader *)e->slice.ptr, false);
+    }
+  }
+  for (int i = 0; i < CU_GPA_NUM_SMALL_BUCKETS; ++i) {
     alloc->smallBuckets[i] = NULL;
-    alloc->smallBucketTails[i] = NULL;
+    alloc->emptyBuckets[i] = NULL;
+    alloc->emptyCount[i] = 0;
   }
-  struct cu_GPAllocator_LargeAlloc *la = alloc->largeAllocs;
-  while (la) {
-    struct cu_GPAllocator_LargeAlloc *next = la->next;
-    cu_gpa_free_large(alloc, la);
-    la = next;
+  for (size_t i = 0; i < alloc->largeAllocs.capacity; ++i) {
+    struct cu_GPAllocator_IndexEntry *e = &alloc->largeAllocs.entries[i];
+    if (e->key != 0) {
+      cu_Allocator_Free(alloc->backingAllocator, e->slice);
+    }
   }
-  alloc->largeAllocs = NULL;
+  cu_gpa_index_destroy(alloc, &alloc->largeAllocs);
+  cu_gpa_index_destroy(alloc, &alloc->spans);
 }
@@ -1,4 +1,5 @@
-#if CU_PLAT_LINUX
+/* macro.h is not included yet, so test the compiler macro directly */
+#if defined(__linux__)
 #define _GNU_SOURCE
 #endif
 #include "memory/page.h"
@@ -6,6 +7,7 @@
 #include "macro.h"
 #include <nostd.h>
 #include <stddef.h>
+#include <stdint.h>
 #if !CU_FREESTANDING && !CU_PLAT_WASM
 #if CU_PLAT_WINDOWS
 #include <windows.h>
@@ -17,6 +19,66 @@
 
 #if !CU_FREESTANDING && !CU_PLAT_WASM
 
+static cu_IoSlice_Result cu_page_out_of_memory(void) {
+  cu_Io_Error err = {
+      .kind = CU_IO_ERROR_KIND_OUT_OF_MEMORY, .errnum = Size_Optional_none()};
+  return cu_IoSlice_Result_error(err);
+}
+
+#if !CU_PLAT_WINDOWS
+static bool cu_page_wants_huge(cu_PageAllocator *allocator, size_t size) {
+#if defined(MADV_HUGEPAGE)
+  return allocator->hugePages && size >= CU_PAGE_HUGE_SIZE;
+#else
+  CU_UNUSED(allocator);
+  CU_UNUSED(size);
+  return false;
+#endif
+}
+
+static void cu_page_advise(
+    cu_PageAllocator *allocator, void *ptr, size_t size) {
+#if defined(MADV_HUGEPAGE)
+  if (cu_page_wants_huge(allocator, size)) {
+    madvise(ptr, size, MADV_HUGEPAGE);
+  }
+#else
+  CU_UNUSED(allocator);
+  CU_UNUSED(ptr);
+  CU_UNUSED(size);
+#endif
+}
+
+/*
+ * Map @p size bytes. Huge page candidates are aligned to the huge page size
+ * by over-mapping and trimming, otherwise the kernel cannot use huge pages
+ * for the first and last partial ranges.
+ */
+static void *cu_page_map(cu_PageAllocator *allocator, size_t size) {
+  size_t align = allocator->pageSize;
+  if (cu_page_wants_huge(allocator, size)) {
+    align = CU_PAGE_HUGE_SIZE;
+  }
+  size_t extra = align - allocator->pageSize;
+  void *mapped = mmap(NULL, size + extra, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (mapped == MAP_FAILED) {
+    return NULL;
+  }
+  unsigned char *raw = (unsigned char *)mapped;
+  unsigned char *ptr = (unsigned char *)CU_ALIGN_UP((uintptr_t)raw, align);
+  size_t head = (size_t)(ptr - raw);
+  if (head > 0) {
+    munmap(raw, head);
+  }
+  if (extra - head > 0) {
+    munmap(ptr + size, extra - head);
+  }
+  cu_page_advise(allocator, ptr, size);
+  return ptr;
+}
+#endif
+
 static void cu_PageAllocator_Free(void *self, cu_Slice mem) {
   CU_UNUSED(self);
   CU_IF_NULL(mem.ptr) { return; }
@@ -39,27 +101,35 @@ static cu_IoSlice_Result cu_PageAllocator_Alloc(void *self, cu_Layout layout) {
 #if CU_PLAT_WINDOWS
   void *ptr = VirtualAlloc(
       NULL, aligned_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-  if (!ptr) {
-    cu_Io_Error err = {
-        .kind = CU_IO_ERROR_KIND_OUT_OF_MEMORY, .errnum = Size_Optional_none()};
-    return cu_IoSlice_Result_error(err);
-  }
 #else
-  void *ptr = mmap(NULL, aligned_size, PROT_READ | PROT_WRITE,
-      MAP_PRIVATE | MAP_ANON, -1, 0);
-  if (ptr == MAP_FAILED) {
-    cu_Io_Error err = {
-        .kind = CU_IO_ERROR_KIND_OUT_OF_MEMORY, .errnum = Size_Optional_none()};
-    return cu_IoSlice_Result_error(err);
-  }
+  void *ptr = cu_page_map(allocator, aligned_size);
 #endif
+  if (!ptr) {
+    return cu_page_out_of_memory();
+  }
   return cu_IoSlice_Result_ok(cu_Slice_create(ptr, aligned_size));
 }
 
 static cu_IoSlice_Result cu_PageAllocator_Grow(
     void *self, cu_Slice old_mem, cu_Layout new_layout) {
   cu_PageAllocator *allocator = (cu_PageAllocator *)self;
+  CU_IF_NULL(old_mem.ptr) {
+    return cu_PageAllocator_Alloc(self, new_layout);
+  }
+  size_t old_size = CU_ALIGN_UP(old_mem.length, allocator->pageSize);
   size_t aligned_size = CU_ALIGN_UP(new_layout.elem_size, allocator->pageSize);
+  if (aligned_size <= old_size) {
+    return cu_IoSlice_Result_ok(cu_Slice_create(old_mem.ptr, old_size));
+  }
+#if CU_PLAT_LINUX
+  /* the kernel moves the page table entries, the data is never copied */
+  void *ptr = mremap(old_mem.ptr, old_size, aligned_size, MREMAP_MAYMOVE);
+  if (ptr == MAP_FAILED) {
+    return cu_page_out_of_memory();
+  }
+  cu_page_advise(allocator, ptr, aligned_size);
+  return cu_IoSlice_Result_ok(cu_Slice_create(ptr, aligned_size));
+#else
   cu_IoSlice_Result res = cu_PageAllocator_Alloc(
       self, cu_Layout_create(aligned_size, allocator->pageSize));
   if (!cu_IoSlice_Result_is_ok(&res)) {
@@ -68,25 +138,40 @@ static cu_IoSlice_Result cu_PageAllocator_Grow(
   cu_Memory_smemcpy(res.value, old_mem);
   cu_PageAllocator_Free(self, old_mem);
   return res;
+#endif
 }
 
 static cu_IoSlice_Result cu_PageAllocator_Shrink(
     void *self, cu_Slice old_mem, cu_Layout new_layout) {
   cu_PageAllocator *allocator = (cu_PageAllocator *)self;
+  CU_IF_NULL(old_mem.ptr) {
+    cu_Io_Error err = {
+        .kind = CU_IO_ERROR_KIND_INVALID_INPUT, .errnum = Size_Optional_none()};
+    return cu_IoSlice_Result_error(err);
+  }
+  size_t old_size = CU_ALIGN_UP(old_mem.length, allocator->pageSize);
   size_t aligned_size = CU_ALIGN_UP(new_layout.elem_size, allocator->pageSize);
-  cu_IoSlice_Result res = cu_PageAllocator_Alloc(
-      self, cu_Layout_create(aligned_size, allocator->pageSize));
-  if (!cu_IoSlice_Result_is_ok(&res)) {
-    return res;
+  if (aligned_size == 0) {
+    cu_PageAllocator_Free(self, old_mem);
+    return cu_IoSlice_Result_ok(cu_Slice_create(NULL, 0));
   }
-  size_t copy = CU_MIN(aligned_size, old_mem.length);
-  cu_Memory_smemcpy(cu_Slice_create(res.value.ptr, copy),
-      cu_Slice_create(old_mem.ptr, copy));
-  cu_PageAllocator_Free(self, old_mem);
-  return res;
+  if (aligned_size > old_size) {
+    return cu_PageAllocator_Grow(self, old_mem, new_layout);
+  }
+  /* release the tail pages and keep the head where it is */
+  unsigned char *tail = (unsigned char *)old_mem.ptr + aligned_size;
+  if (aligned_size < old_size) {
+#if CU_PLAT_WINDOWS
+    VirtualFree(tail, old_size - aligned_size, MEM_DECOMMIT);
+#else
+    munmap(tail, old_size - aligned_size);
+#endif
+  }
+  return cu_IoSlice_Result_ok(cu_Slice_create(old_mem.ptr, aligned_size));
 }
 
-cu_Allocator cu_Allocator_PageAllocator(cu_PageAllocator *allocator) {
+cu_Allocator cu_Allocator_PageAllocatorWithConfig(
+    cu_PageAllocator *allocator, cu_PageAllocator_Config config) {
 #if CU_PLAT_WINDOWS
   SYSTEM_INFO info;
   GetSystemInfo(&info);
@@ -95,6 +180,7 @@ cu_Allocator cu_Allocator_PageAllocator(cu_PageAllocator *allocator) {
   long ps = sysconf(_SC_PAGESIZE);
   allocator->pageSize = ps > 0 ? (size_t)ps : 4096;
 #endif
+  allocator->hugePages = config.hugePages;
   cu_Allocator alloc = {0};
   alloc.self = allocator;
   alloc.allocFn = cu_PageAllocator_Alloc;
@@ -104,4 +190,9 @@ cu_Allocator cu_Allocator_PageAllocator(cu_PageAllocator *allocator) {
   return alloc;
 }
 
+cu_Allocator cu_Allocator_PageAllocator(cu_PageAllocator *allocator) {
+  cu_PageAllocator_Config config = {0};
+  return cu_Allocator_PageAllocatorWithConfig(allocator, config);
+}
+
 #endif
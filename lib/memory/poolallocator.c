@@ -0,0 +1,506 @@
+#include "memory/poolallocator.h"
+#include "io/error.h"
+#include "macro.h"
+#include "memory/wasmallocator.h"
+#include "utility.h"
+#include <nostd.h>
+
+#if !CU_FREESTANDING && !defined(__STDC_NO_ATOMICS__)
+
+#define CU_POOL_THREAD_SLOTS 4
+#define CU_POOL_INDEX_MASK 0xffffffffULL
+#define CU_POOL_REFILL (CU_POOL_MAGAZINE_SIZE / 2)
+#define CU_POOL_MAX_BACKOFF 64
+
+#if (CU_COMPILER_GCC || CU_COMPILER_CLANG) &&                                 \
+    (defined(__x86_64__) || defined(__i386__))
+#define CU_POOL_RELAX() __builtin_ia32_pause()
+#else
+#define CU_POOL_RELAX() ((void)0)
+#endif
+
+/* Helper forward declarations */
+static cu_IoSlice_Result cu_pool_alloc(void *self, cu_Layout layout);
+static cu_IoSlice_Result cu_pool_grow(
+    void *self, cu_Slice old_mem, cu_Layout new_layout);
+static cu_IoSlice_Result cu_pool_shrink(
+    void *self, cu_Slice old_mem, cu_Layout new_layout);
+static void cu_pool_free(void *self, cu_Slice mem);
+static cu_Io_Error_Optional cu_pool_alloc_batch(
+    void *self, cu_Layout layout, cu_Slice *out, size_t count);
+static void cu_pool_free_batch(void *self, const cu_Slice *mems, size_t count);
+
+/*
+ * Threads find their magazine through a handful of thread local slots keyed
+ * by a process wide instance id. Ids are never reused, so slots left behind
+ * by a destroyed pool can never match again. A thread using more pools than
+ * there are slots evicts one; when it comes back to that pool it finds its
+ * registered magazine again by the address of its thread token.
+ */
+struct cu_pool_thread_slot {
+  uintptr_t id;
+  struct cu_PoolAllocator_Magazine *magazine;
+};
+
+static CU_THREAD_LOCAL struct cu_pool_thread_slot
+    cu_pool_slots[CU_POOL_THREAD_SLOTS];
+static CU_THREAD_LOCAL size_t cu_pool_victim;
+static CU_THREAD_LOCAL char cu_pool_thread_token;
+static _Atomic(uintptr_t) cu_pool_next_id = 1;
+
+static cu_Io_Error cu_pool_io_error(cu_Io_ErrorKind kind) {
+  cu_Io_Error err = {.kind = kind, .errnum = Size_Optional_none()};
+  return err;
+}
+
+static cu_IoSlice_Result cu_pool_error(cu_Io_ErrorKind kind) {
+  return cu_IoSlice_Result_error(cu_pool_io_error(kind));
+}
+
+/* Back off exponentially while the lock is contended. */
+static void cu_pool_lock(cu_PoolAllocator *alloc) {
+  unsigned spins = 1;
+  while (
+      atomic_flag_test_and_set_explicit(&alloc->lock, memory_order_acquire)) {
+    for (unsigned i = 0; i < spins; ++i) {
+      CU_POOL_RELAX();
+    }
+    if (spins < CU_POOL_MAX_BACKOFF) {
+      spins <<= 1;
+    }
+  }
+}
+
+static void cu_pool_unlock(cu_PoolAllocator *alloc) {
+  atomic_flag_clear_explicit(&alloc->lock, memory_order_release);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Chunks                                                                     */
+/* -------------------------------------------------------------------------- */
+
+/*
+ * Chunk k holds chunkObjects << k objects and starts at object index
+ * chunkObjects * (2^k - 1), so the chunk of an index is the integer log2 of
+ * index / chunkObjects + 1.
+ */
+static size_t cu_pool_chunk_of(const cu_PoolAllocator *alloc, size_t index) {
+  size_t x = index / alloc->chunkObjects + 1;
+  return cu_count_trailing_zeros(cu_next_pow2(x + 1)) - 1;
+}
+
+static size_t cu_pool_chunk_start(const cu_PoolAllocator *alloc, size_t k) {
+  return alloc->chunkObjects * (((size_t)1 << k) - 1);
+}
+
+static size_t cu_pool_chunk_bytes(const cu_PoolAllocator *alloc, size_t k) {
+  size_t objects = alloc->chunkObjects << k;
+  if (objects >> k != alloc->chunkObjects ||
+      objects > SIZE_MAX / alloc->objectSize) {
+    return 0;
+  }
+  return objects * alloc->objectSize;
+}
+
+static bool cu_pool_ensure_chunk(cu_PoolAllocator *alloc, size_t k) {
+  if (atomic_load_explicit(&alloc->chunks[k], memory_order_acquire)) {
+    return true;
+  }
+  bool ok = true;
+  cu_pool_lock(alloc);
+  if (!atomic_load_explicit(&alloc->chunks[k], memory_order_relaxed)) {
+    size_t bytes = cu_pool_chunk_bytes(alloc, k);
+    ok = false;
+    if (bytes != 0) {
+      cu_IoSlice_Result mem = cu_Allocator_Alloc(alloc->backingAllocator,
+          cu_Layout_create(bytes, alloc->objectAlign));
+      ok = cu_IoSlice_Result_is_ok(&mem);
+      if (ok) {
+        atomic_store_explicit(&alloc->chunks[k],
+            (unsigned char *)mem.value.ptr, memory_order_release);
+      }
+    }
+  }
+  cu_pool_unlock(alloc);
+  return ok;
+}
+
+static void *cu_pool_object(cu_PoolAllocator *alloc, size_t index) {
+  size_t k = cu_pool_chunk_of(alloc, index);
+  unsigned char *chunk =
+      atomic_load_explicit(&alloc->chunks[k], memory_order_acquire);
+  return chunk + (index - cu_pool_chunk_start(alloc, k)) * alloc->objectSize;
+}
+
+/* Map an object back to its index. Chunks may be created out of order. */
+static size_t cu_pool_index(cu_PoolAllocator *alloc, const void *ptr) {
+  uintptr_t addr = (uintptr_t)ptr;
+  for (size_t k = 0; k < CU_POOL_MAX_CHUNKS; ++k) {
+    unsigned char *chunk =
+        atomic_load_explicit(&alloc->chunks[k], memory_order_relaxed);
+    if (!chunk) {
+      continue;
+    }
+    uintptr_t base = (uintptr_t)chunk;
+    if (addr >= base && addr - base < cu_pool_chunk_bytes(alloc, k)) {
+      return cu_pool_chunk_start(alloc, k) +
+             (size_t)(addr - base) / alloc->objectSize;
+    }
+  }
+  CU_DIE("pool allocator freed a pointer it does not own");
+  return 0;
+}
+
+/*
+ * Hand out up to @p want never used objects. Objects are only reserved once
+ * their chunk exists, so a failed chunk allocation leaves them to be carved
+ * by a later call instead of losing them.
+ */
+static size_t cu_pool_carve(cu_PoolAllocator *alloc, void **out, size_t want) {
+  size_t done = 0;
+  size_t first = atomic_load_explicit(&alloc->carved, memory_order_relaxed);
+  while (done < want && first < alloc->maxObjects) {
+    size_t k = cu_pool_chunk_of(alloc, first);
+    if (!cu_pool_ensure_chunk(alloc, k)) {
+      break;
+    }
+    size_t chunk_left =
+        (alloc->chunkObjects << k) - (first - cu_pool_chunk_start(alloc, k));
+    size_t count =
+        CU_MIN(want - done, CU_MIN(chunk_left, alloc->maxObjects - first));
+    if (!atomic_compare_exchange_weak_explicit(&alloc->carved, &first,
+            first + count, memory_order_relaxed, memory_order_relaxed)) {
+      continue;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      out[done + i] = cu_pool_object(alloc, first + i);
+    }
+    done += count;
+    first += count;
+  }
+  return done;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Shared free list                                                           */
+/* -------------------------------------------------------------------------- */
+
+/*
+ * Free objects store the index + 1 of their successor in their first word.
+ * A popper may read that word after another thread already took the object,
+ * but the tag bump makes its compare and swap fail, so the stale value is
+ * never published.
+ */
+static _Atomic(uint32_t) *cu_pool_link(void *obj) {
+  return (_Atomic(uint32_t) *)obj;
+}
+
+static uint64_t cu_pool_head(uint64_t old, uint32_t index) {
+  return (((old >> 32) + 1) << 32) | index;
+}
+
+static void cu_pool_push(
+    cu_PoolAllocator *alloc, void **objects, size_t count) {
+  uint32_t first = (uint32_t)(cu_pool_index(alloc, objects[0]) + 1);
+  for (size_t i = 1; i < count; ++i) {
+    uint32_t next = (uint32_t)(cu_pool_index(alloc, objects[i]) + 1);
+    atomic_store_explicit(
+        cu_pool_link(objects[i - 1]), next, memory_order_relaxed);
+  }
+  _Atomic(uint32_t) *last = cu_pool_link(objects[count - 1]);
+  uint64_t old = atomic_load_explicit(&alloc->freeList, memory_order_relaxed);
+  do {
+    atomic_store_explicit(
+        last, (uint32_t)(old & CU_POOL_INDEX_MASK), memory_order_relaxed);
+  } while (!atomic_compare_exchange_weak_explicit(&alloc->freeList, &old,
+      cu_pool_head(old, first), memory_order_release, memory_order_relaxed));
+}
+
+static void *cu_pool_pop(cu_PoolAllocator *alloc) {
+  uint64_t old = atomic_load_explicit(&alloc->freeList, memory_order_acquire);
+  while ((old & CU_POOL_INDEX_MASK) != 0) {
+    void *obj = cu_pool_object(alloc, (size_t)(old & CU_POOL_INDEX_MASK) - 1);
+    uint32_t next =
+        atomic_load_explicit(cu_pool_link(obj), memory_order_relaxed);
+    if (atomic_compare_exchange_weak_explicit(&alloc->freeList, &old,
+            cu_pool_head(old, next), memory_order_acquire,
+            memory_order_acquire)) {
+      return obj;
+    }
+  }
+  return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Magazines                                                                  */
+/* -------------------------------------------------------------------------- */
+
+/* Magazine registered by the calling thread. Requires the lock. */
+static struct cu_PoolAllocator_Magazine *cu_pool_magazine_registered(
+    cu_PoolAllocator *alloc) {
+  uintptr_t owner = (uintptr_t)&cu_pool_thread_token;
+  struct cu_PoolAllocator_Magazine *mag = alloc->magazines;
+  while (mag && mag->owner != owner) {
+    mag = mag->next;
+  }
+  return mag;
+}
+
+/*
+ * Find the magazine this thread registered earlier or register a new one. A
+ * thread that exited without flushing leaves its magazine behind; a later
+ * thread whose token lands at the same address simply adopts it.
+ */
+static struct cu_PoolAllocator_Magazine *cu_pool_magazine_create(
+    cu_PoolAllocator *alloc) {
+  cu_pool_lock(alloc);
+  struct cu_PoolAllocator_Magazine *mag = cu_pool_magazine_registered(alloc);
+  if (!mag) {
+    cu_IoSlice_Result mem = cu_Allocator_Alloc(alloc->backingAllocator,
+        cu_Layout_create(sizeof(struct cu_PoolAllocator_Magazine),
+            _Alignof(struct cu_PoolAllocator_Magazine)));
+    if (!cu_IoSlice_Result_is_ok(&mem)) {
+      cu_pool_unlock(alloc);
+      return NULL;
+    }
+    mag = (struct cu_PoolAllocator_Magazine *)mem.value.ptr;
+    mag->count = 0;
+    mag->owner = (uintptr_t)&cu_pool_thread_token;
+    mag->next = alloc->magazines;
+    alloc->magazines = mag;
+  }
+  cu_pool_unlock(alloc);
+
+  size_t slot = cu_pool_victim;
+  for (size_t i = 0; i < CU_POOL_THREAD_SLOTS; ++i) {
+    if (cu_pool_slots[i].id == 0) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot == cu_pool_victim) {
+    cu_pool_victim = (cu_pool_victim + 1) % CU_POOL_THREAD_SLOTS;
+  }
+  cu_pool_slots[slot].id = alloc->id;
+  cu_pool_slots[slot].magazine = mag;
+  return mag;
+}
+
+static struct cu_PoolAllocator_Magazine *cu_pool_magazine(
+    cu_PoolAllocator *alloc, bool create) {
+  for (size_t i = 0; i < CU_POOL_THREAD_SLOTS; ++i) {
+    if (cu_pool_slots[i].id == alloc->id) {
+      return cu_pool_slots[i].magazine;
+    }
+  }
+  return create ? cu_pool_magazine_create(alloc) : NULL;
+}
+
+static void cu_pool_refill(
+    cu_PoolAllocator *alloc, struct cu_PoolAllocator_Magazine *mag) {
+  while (mag->count < CU_POOL_REFILL) {
+    void *obj = cu_pool_pop(alloc);
+    if (!obj) {
+      break;
+    }
+    mag->objects[mag->count++] = obj;
+  }
+  if (mag->count < CU_POOL_REFILL) {
+    mag->count += cu_pool_carve(
+        alloc, &mag->objects[mag->count], CU_POOL_REFILL - mag->count);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+/* Allocator interface                                                        */
+/* -------------------------------------------------------------------------- */
+
+static bool cu_pool_fits(const cu_PoolAllocator *alloc, cu_Layout layout) {
+  return layout.elem_size != 0 && layout.elem_size <= alloc->objectSize &&
+         layout.alignment <= alloc->objectAlign;
+}
+
+static cu_IoSlice_Result cu_pool_alloc(void *self, cu_Layout layout) {
+  cu_PoolAllocator *alloc = (cu_PoolAllocator *)self;
+  if (!cu_pool_fits(alloc, layout)) {
+    return cu_pool_error(CU_IO_ERROR_KIND_INVALID_INPUT);
+  }
+  struct cu_PoolAllocator_Magazine *mag = cu_pool_magazine(alloc, true);
+  if (!mag) {
+    return cu_pool_error(CU_IO_ERROR_KIND_OUT_OF_MEMORY);
+  }
+  if (mag->count == 0) {
+    cu_pool_refill(alloc, mag);
+    if (mag->count == 0) {
+      return cu_pool_error(CU_IO_ERROR_KIND_OUT_OF_MEMORY);
+    }
+  }
+  void *obj = mag->objects[--mag->count];
+  return cu_IoSlice_Result_ok(cu_Slice_create(obj, layout.elem_size));
+}
+
+static cu_IoSlice_Result cu_pool_grow(
+    void *self, cu_Slice old_mem, cu_Layout new_layout) {
+  cu_PoolAllocator *alloc = (cu_PoolAllocator *)self;
+  CU_IF_NULL(old_mem.ptr) { return cu_pool_alloc(self, new_layout); }
+  if (!cu_pool_fits(alloc, new_layout)) {
+    return cu_pool_error(CU_IO_ERROR_KIND_INVALID_INPUT);
+  }
+  return cu_IoSlice_Result_ok(
+      cu_Slice_create(old_mem.ptr, new_layout.elem_size));
+}
+
+static cu_IoSlice_Result cu_pool_shrink(
+    void *self, cu_Slice old_mem, cu_Layout new_layout) {
+  cu_PoolAllocator *alloc = (cu_PoolAllocator *)self;
+  CU_IF_NULL(old_mem.ptr) {
+    return cu_pool_error(CU_IO_ERROR_KIND_INVALID_INPUT);
+  }
+  if (!cu_pool_fits(alloc, new_layout)) {
+    return cu_pool_error(CU_IO_ERROR_KIND_INVALID_INPUT);
+  }
+  return cu_IoSlice_Result_ok(
+      cu_Slice_create(old_mem.ptr, new_layout.elem_size));
+}
+
+static void cu_pool_put(cu_PoolAllocator *alloc,
+    struct cu_PoolAllocator_Magazine *mag, void *obj) {
+  if (!mag) {
+    cu_pool_push(alloc, &obj, 1);
+    return;
+  }
+  if (mag->count == CU_POOL_MAGAZINE_SIZE) {
+    cu_pool_push(alloc, &mag->objects[CU_POOL_REFILL],
+        CU_POOL_MAGAZINE_SIZE - CU_POOL_REFILL);
+    mag->count = CU_POOL_REFILL;
+  }
+  mag->objects[mag->count++] = obj;
+}
+
+static void cu_pool_free(void *self, cu_Slice mem) {
+  cu_PoolAllocator *alloc = (cu_PoolAllocator *)self;
+  CU_IF_NULL(mem.ptr) { return; }
+  cu_pool_put(alloc, cu_pool_magazine(alloc, true), mem.ptr);
+}
+
+static cu_Io_Error_Optional cu_pool_alloc_batch(
+    void *self, cu_Layout layout, cu_Slice *out, size_t count) {
+  cu_PoolAllocator *alloc = (cu_PoolAllocator *)self;
+  if (!cu_pool_fits(alloc, layout)) {
+    return cu_Io_Error_Optional_some(
+        cu_pool_io_error(CU_IO_ERROR_KIND_INVALID_INPUT));
+  }
+  struct cu_PoolAllocator_Magazine *mag = cu_pool_magazine(alloc, true);
+  if (!mag) {
+    return cu_Io_Error_Optional_some(
+        cu_pool_io_error(CU_IO_ERROR_KIND_OUT_OF_MEMORY));
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (mag->count == 0) {
+      cu_pool_refill(alloc, mag);
+      if (mag->count == 0) {
+        cu_pool_free_batch(self, out, i);
+        return cu_Io_Error_Optional_some(
+            cu_pool_io_error(CU_IO_ERROR_KIND_OUT_OF_MEMORY));
+      }
+    }
+    out[i] = cu_Slice_create(mag->objects[--mag->count], layout.elem_size);
+  }
+  return cu_Io_Error_Optional_none();
+}
+
+static void cu_pool_free_batch(void *self, const cu_Slice *mems, size_t count) {
+  cu_PoolAllocator *alloc = (cu_PoolAllocator *)self;
+  struct cu_PoolAllocator_Magazine *mag = cu_pool_magazine(alloc, true);
+  for (size_t i = 0; i < count; ++i) {
+    if (mems[i].ptr) {
+      cu_pool_put(alloc, mag, mems[i].ptr);
+    }
+  }
+}
+
+cu_Allocator cu_Allocator_PoolAllocator(
+    cu_PoolAllocator *alloc, cu_PoolAllocator_Config config) {
+  if (cu_Allocator_Optional_is_some(&config.backingAllocator)) {
+    alloc->backingAllocator = config.backingAllocator.value;
+  } else {
+#if CU_PLAT_WASM
+    alloc->backingAllocator = cu_Allocator_WasmAllocator();
+#else
+    alloc->backingAllocator = cu_Allocator_CAllocator();
+#endif
+  }
+  if (config.layout.elem_size == 0) {
+    CU_DIE("pool allocator requires a non-empty layout");
+  }
+  alloc->objectAlign =
+      CU_MAX(config.layout.alignment, _Alignof(_Atomic(uint32_t)));
+  alloc->objectSize =
+      CU_ALIGN_UP(CU_MAX(config.layout.elem_size, sizeof(_Atomic(uint32_t))),
+          alloc->objectAlign);
+  alloc->chunkObjects = config.chunkObjects;
+  if (alloc->chunkObjects == 0) {
+    alloc->chunkObjects = CU_POOL_CHUNK_OBJECTS;
+  }
+  alloc->maxObjects = CU_MIN(
+      (size_t)CU_POOL_INDEX_MASK, SIZE_MAX / alloc->objectSize);
+
+  atomic_flag_clear(&alloc->lock);
+  atomic_init(&alloc->freeList, 0);
+  atomic_init(&alloc->carved, 0);
+  for (size_t k = 0; k < CU_POOL_MAX_CHUNKS; ++k) {
+    atomic_init(&alloc->chunks[k], NULL);
+  }
+  alloc->magazines = NULL;
+  alloc->id =
+      atomic_fetch_add_explicit(&cu_pool_next_id, 1, memory_order_relaxed);
+
+  cu_Allocator a = {0};
+  a.self = alloc;
+  a.allocFn = cu_pool_alloc;
+  a.growFn = cu_pool_grow;
+  a.shrinkFn = cu_pool_shrink;
+  a.freeFn = cu_pool_free;
+  a.allocBatchFn = cu_pool_alloc_batch;
+  a.freeBatchFn = cu_pool_free_batch;
+  return a;
+}
+
+void cu_PoolAllocator_flush(cu_PoolAllocator *alloc) {
+  struct cu_PoolAllocator_Magazine *mag = cu_pool_magazine(alloc, false);
+  if (!mag) {
+    /* the thread slot may have been evicted by another pool */
+    cu_pool_lock(alloc);
+    mag = cu_pool_magazine_registered(alloc);
+    cu_pool_unlock(alloc);
+  }
+  if (!mag || mag->count == 0) {
+    return;
+  }
+  cu_pool_push(alloc, mag->objects, mag->count);
+  mag->count = 0;
+}
+
+void cu_PoolAllocator_destroy(cu_PoolAllocator *alloc) {
+  struct cu_PoolAllocator_Magazine *mag = alloc->magazines;
+  while (mag) {
+    struct cu_PoolAllocator_Magazine *next = mag->next;
+    cu_Allocator_Free(alloc->backingAllocator,
+        cu_Slice_create(mag, sizeof(struct cu_PoolAllocator_Magazine)));
+    mag = next;
+  }
+  alloc->magazines = NULL;
+  for (size_t k = 0; k < CU_POOL_MAX_CHUNKS; ++k) {
+    unsigned char *chunk =
+        atomic_load_explicit(&alloc->chunks[k], memory_order_relaxed);
+    if (chunk) {
+      cu_Allocator_Free(alloc->backingAllocator,
+          cu_Slice_create(chunk, cu_pool_chunk_bytes(alloc, k)));
+      atomic_store_explicit(&alloc->chunks[k], NULL, memory_order_relaxed);
+    }
+  }
+  atomic_store_explicit(&alloc->freeList, 0, memory_order_relaxed);
+  atomic_store_explicit(&alloc->carved, 0, memory_order_relaxed);
+}
+
+#endif /* !CU_FREESTANDING && !__STDC_NO_ATOMICS__ */
@@ -17,14 +17,19 @@ struct cu_SlabAllocator_Header {
  * @brief Memory block managed by the slab allocator.
  *
  * Each block maintains its own bitmap sized to `slabCount` bits that
- * records which slab slots are currently in use.
+ * records which slab slots are currently in use. Blocks with at least one
+ * free slot are additionally linked into the allocator's available list.
  */
 struct cu_SlabAllocator_Slab {
-  struct cu_SlabAllocator_Slab *next; /**< next slab in the list */
-  cu_Bitmap used;                     /**< allocation bitmap */
-  size_t slabCount;                   /**< total slab slots */
-  size_t freeCount;                   /**< remaining free slots */
-  unsigned char data[];               /**< backing storage */
+  struct cu_SlabAllocator_Slab *next;     /**< next slab in the list */
+  struct cu_SlabAllocator_Slab *prevFree; /**< previous available slab */
+  struct cu_SlabAllocator_Slab *nextFree; /**< next available slab */
+  bool available;                         /**< linked into available list */
+  cu_Bitmap used;                         /**< allocation bitmap */
+  size_t slabCount;                       /**< total slab slots */
+  size_t freeCount;                       /**< remaining free slots */
+  size_t freeHint;                        /**< every slot below is in use */
+  unsigned char data[];                   /**< backing storage */
 };
 
 static cu_IoSlice_Result cu_slab_alloc(void *self, cu_Layout layout);
@@ -33,24 +38,64 @@ static cu_IoSlice_Result cu_slab_grow(
 static cu_IoSlice_Result cu_slab_shrink(
     void *self, cu_Slice old_mem, cu_Layout new_layout);
 static void cu_slab_free(void *self, cu_Slice mem);
+static void cu_slab_free_batch(void *self, const cu_Slice *mems, size_t count);
 
 static unsigned char *cu_slab_data(struct cu_SlabAllocator_Slab *slab) {
   return slab->data;
 }
 
 static size_t cu_find_run(struct cu_SlabAllocator_Slab *slab, size_t need) {
-  size_t run = 0;
-  for (size_t i = 0; i < slab->slabCount; ++i) {
-    if (!cu_Bitmap_get(&slab->used, i)) {
-      run++;
-    } else {
-      run = 0;
-    }
-    if (run == need) {
-      return i + 1 - need;
-    }
+  if (slab->freeCount < need) {
+    return (size_t)-1;
+  }
+  Size_Optional pos =
+      cu_Bitmap_find_clear_run(&slab->used, slab->freeHint, need);
+  if (Size_Optional_is_none(&pos)) {
+    return (size_t)-1;
+  }
+  return pos.value;
+}
+
+static void cu_slab_link_available(
+    cu_SlabAllocator *alloc, struct cu_SlabAllocator_Slab *slab) {
+  slab->prevFree = NULL;
+  slab->nextFree = alloc->available;
+  if (slab->nextFree) {
+    slab->nextFree->prevFree = slab;
+  }
+  alloc->available = slab;
+  slab->available = true;
+}
+
+static void cu_slab_unlink_available(
+    cu_SlabAllocator *alloc, struct cu_SlabAllocator_Slab *slab) {
+  if (slab->prevFree) {
+    slab->prevFree->nextFree = slab->nextFree;
+  } else {
+    alloc->available = slab->nextFree;
+  }
+  if (slab->nextFree) {
+    slab->nextFree->prevFree = slab->prevFree;
+  }
+  slab->prevFree = NULL;
+  slab->nextFree = NULL;
+  slab->available = false;
+  if (alloc->current == slab) {
+    alloc->current = NULL;
+  }
+}
+
+/* Mark slots in [index, index + count) as free again. */
+static void cu_slab_release(cu_SlabAllocator *alloc,
+    struct cu_SlabAllocator_Slab *slab, size_t index, size_t count) {
+  cu_Bitmap_clear_range(&slab->used, index, count);
+  slab->freeCount += count;
+  if (index < slab->freeHint) {
+    slab->freeHint = index;
+  }
+  if (!slab->available) {
+    cu_slab_link_available(alloc, slab);
   }
-  return (size_t)-1;
 }
 
 static struct cu_SlabAllocator_Slab *cu_create_slab(
@@ -69,82 +114,121 @@ static struct cu_SlabAllocator_Slab *cu_create_slab(
   struct cu_SlabAllocator_Slab *slab =
       (struct cu_SlabAllocator_Slab *)mem.value.ptr;
   slab->next = NULL;
+  slab->prevFree = NULL;
+  slab->nextFree = NULL;
+  slab->available = false;
   slab->used = bits.value;
   slab->slabCount = count;
   slab->freeCount = count;
+  slab->freeHint = 0;
   return slab;
 }
 
-static cu_IoSlice_Result cu_slab_alloc(void *self, cu_Layout layout) {
-  cu_SlabAllocator *alloc = (cu_SlabAllocator *)self;
-  if (layout.elem_size == 0) {
-    cu_Io_Error err = {
-        .kind = CU_IO_ERROR_KIND_INVALID_INPUT, .errnum = Size_Optional_none()};
-    return cu_IoSlice_Result_error(err);
+static struct cu_SlabAllocator_Slab *cu_slab_add(
+    cu_SlabAllocator *alloc, size_t count) {
+  size_t def = CU_SLAB_DEFAULT_SIZE / alloc->slabSize;
+  if (def == 0) {
+    def = 1;
+  }
+  struct cu_SlabAllocator_Slab *slab = cu_create_slab(alloc, CU_MAX(count, def));
+  if (!slab) {
+    return NULL;
   }
-  size_t size = layout.elem_size;
-  size_t alignment = layout.alignment;
-  if (alignment == 0) {
-    alignment = 1;
+  slab->next = alloc->slabs;
+  alloc->slabs = slab;
+  cu_slab_link_available(alloc, slab);
+  return slab;
+}
+
+/* Mark [index, index + count) as used and keep the lists up to date. */
+static void cu_slab_take(cu_SlabAllocator *alloc,
+    struct cu_SlabAllocator_Slab *slab, size_t index, size_t count) {
+  cu_Bitmap_set_range(&slab->used, index, count);
+  slab->freeCount -= count;
+  if (index == slab->freeHint) {
+    slab->freeHint = index + count;
+  }
+  alloc->current = slab;
+  if (slab->freeCount == 0) {
+    cu_slab_unlink_available(alloc, slab);
   }
-  if (alignment > alloc->slabSize) {
+}
+
+/* Place the header of an object occupying @p need slots from @p index. */
+static cu_Slice cu_slab_place(cu_SlabAllocator *alloc,
+    struct cu_SlabAllocator_Slab *slab, size_t index, size_t need,
+    size_t size, size_t alignment) {
+  unsigned char *data = cu_slab_data(slab);
+  size_t start = index * alloc->slabSize;
+  size_t user_pos =
+      CU_ALIGN_UP(
+          (size_t)(data + start + sizeof(struct cu_SlabAllocator_Header)),
+          alignment) -
+      (size_t)data;
+  size_t header_pos = user_pos - sizeof(struct cu_SlabAllocator_Header);
+  struct cu_SlabAllocator_Header *hdr =
+      (struct cu_SlabAllocator_Header *)(data + header_pos);
+  hdr->slab = slab;
+  hdr->index = index;
+  hdr->count = need;
+  return cu_Slice_create(data + user_pos, size);
+}
+
+/* Validate @p layout and compute the slots each object needs. */
+static Size_Optional cu_slab_slots(
+    const cu_SlabAllocator *alloc, cu_Layout layout, size_t *alignment) {
+  *alignment = layout.alignment == 0 ? 1 : layout.alignment;
+  if (layout.elem_size == 0 || *alignment > alloc->slabSize) {
+    return Size_Optional_none();
+  }
+  size_t needed =
+      *alignment - 1 + layout.elem_size + sizeof(struct cu_SlabAllocator_Header);
+  return Size_Optional_some(CU_DIV_CEIL(needed, alloc->slabSize));
+}
+
+static cu_IoSlice_Result cu_slab_alloc(void *self, cu_Layout layout) {
+  cu_SlabAllocator *alloc = (cu_SlabAllocator *)self;
+  size_t alignment;
+  Size_Optional slots = cu_slab_slots(alloc, layout, &alignment);
+  if (Size_Optional_is_none(&slots)) {
     cu_Io_Error err = {
         .kind = CU_IO_ERROR_KIND_INVALID_INPUT, .errnum = Size_Optional_none()};
     return cu_IoSlice_Result_error(err);
   }
+  size_t need = slots.value;
 
-  size_t needed = alignment - 1 + size + sizeof(struct cu_SlabAllocator_Header);
-  size_t need = CU_DIV_CEIL(needed, alloc->slabSize);
-
-  struct cu_SlabAllocator_Slab *slab = alloc->slabs;
+  struct cu_SlabAllocator_Slab *slab = NULL;
   size_t index = (size_t)-1;
-  while (slab) {
-    if (slab->freeCount >= need) {
-      size_t pos = cu_find_run(slab, need);
-      if (pos != (size_t)-1) {
-        index = pos;
-        break;
-      }
+  if (alloc->current) {
+    index = cu_find_run(alloc->current, need);
+    if (index != (size_t)-1) {
+      slab = alloc->current;
+    }
+  }
+  for (struct cu_SlabAllocator_Slab *it = alloc->available; !slab && it;
+      it = it->nextFree) {
+    if (it == alloc->current) {
+      continue;
+    }
+    index = cu_find_run(it, need);
+    if (index != (size_t)-1) {
+      slab = it;
     }
-    slab = slab->next;
   }
 
   if (!slab) {
-    size_t def = CU_SLAB_DEFAULT_SIZE / alloc->slabSize;
-    if (def == 0) {
-      def = 1;
-    }
-    size_t count = CU_MAX(need, def);
-    slab = cu_create_slab(alloc, count);
+    slab = cu_slab_add(alloc, need);
     if (!slab) {
       cu_Io_Error err = {.kind = CU_IO_ERROR_KIND_OUT_OF_MEMORY,
           .errnum = Size_Optional_none()};
       return cu_IoSlice_Result_error(err);
     }
-    slab->next = alloc->slabs;
-    alloc->slabs = slab;
     index = 0;
   }
 
-  for (size_t i = 0; i < need; ++i) {
-    cu_Bitmap_set(&slab->used, index + i);
-  }
-  slab->freeCount -= need;
-
-  unsigned char *data = cu_slab_data(slab);
-  size_t start = index * alloc->slabSize;
-  size_t user_pos =
-      CU_ALIGN_UP(
-          (size_t)(data + start + sizeof(struct cu_SlabAllocator_Header)),
-          alignment) -
-      (size_t)data;
-  size_t header_pos = user_pos - sizeof(struct cu_SlabAllocator_Header);
-  struct cu_SlabAllocator_Header *hdr =
-      (struct cu_SlabAllocator_Header *)(data + header_pos);
-  hdr->slab = slab;
-  hdr->index = index;
-  hdr->count = need;
-  return cu_IoSlice_Result_ok(cu_Slice_create(data + user_pos, size));
+  cu_slab_take(alloc, slab, index, need);
+  return cu_IoSlice_Result_ok(
+      cu_slab_place(alloc, slab, index, need, layout.elem_size, alignment));
 }
 
 static cu_IoSlice_Result cu_slab_grow(
@@ -194,10 +278,8 @@ static cu_IoSlice_Result cu_slab_shrink(
   if (new_layout.elem_size <= current) {
     size_t need = CU_DIV_CEIL(prefix + new_layout.elem_size, alloc->slabSize);
     if (need < hdr->count) {
-      for (size_t i = hdr->index + need; i < hdr->index + hdr->count; ++i) {
-        cu_Bitmap_clear(&hdr->slab->used, i);
-      }
-      hdr->slab->freeCount += hdr->count - need;
+      cu_slab_release(
+          alloc, hdr->slab, hdr->index + need, hdr->count - need);
       hdr->count = need;
     }
     return cu_IoSlice_Result_ok(
@@ -222,12 +304,108 @@ static void cu_slab_free(void *self, cu_Slice mem) {
       (struct cu_SlabAllocator_Header *)((unsigned char *)mem.ptr -
                                          sizeof(
                                              struct cu_SlabAllocator_Header));
-  struct cu_SlabAllocator_Slab *slab = hdr->slab;
-  for (size_t i = 0; i < hdr->count; ++i) {
-    cu_Bitmap_clear(&slab->used, hdr->index + i);
+  cu_slab_release(alloc, hdr->slab, hdr->index, hdr->count);
+}
+
+/*
+ * Claim whole runs of free slots in @p slab for up to @p want objects of
+ * @p need slots each. A run is found and marked once for all the objects it
+ * holds; every object still gets its own header so it can be freed alone.
+ */
+static size_t cu_slab_claim(cu_SlabAllocator *alloc,
+    struct cu_SlabAllocator_Slab *slab, size_t need, cu_Layout layout,
+    size_t alignment, cu_Slice *out, size_t want) {
+  size_t done = 0;
+  size_t start = slab->freeHint;
+  while (done < want && slab->freeCount >= need) {
+    Size_Optional pos = cu_Bitmap_find_clear_run(&slab->used, start, need);
+    if (Size_Optional_is_none(&pos)) {
+      break;
+    }
+    Size_Optional end = cu_Bitmap_find_set(&slab->used, pos.value);
+    size_t run = (Size_Optional_is_some(&end) ? end.value : slab->slabCount) -
+                 pos.value;
+    size_t objects = CU_MIN(want - done, run / need);
+    cu_slab_take(alloc, slab, pos.value, objects * need);
+    for (size_t i = 0; i < objects; ++i) {
+      out[done + i] = cu_slab_place(alloc, slab, pos.value + i * need, need,
+          layout.elem_size, alignment);
+    }
+    done += objects;
+    start = pos.value + objects * need;
+  }
+  return done;
+}
+
+static cu_Io_Error_Optional cu_slab_alloc_batch(
+    void *self, cu_Layout layout, cu_Slice *out, size_t count) {
+  cu_SlabAllocator *alloc = (cu_SlabAllocator *)self;
+  size_t alignment;
+  Size_Optional slots = cu_slab_slots(alloc, layout, &alignment);
+  if (Size_Optional_is_none(&slots)) {
+    cu_Io_Error err = {
+        .kind = CU_IO_ERROR_KIND_INVALID_INPUT, .errnum = Size_Optional_none()};
+    return cu_Io_Error_Optional_some(err);
+  }
+  size_t need = slots.value;
+
+  size_t done = 0;
+  if (alloc->current) {
+    done += cu_slab_claim(
+        alloc, alloc->current, need, layout, alignment, out, count);
+  }
+  struct cu_SlabAllocator_Slab *it = alloc->available;
+  while (done < count && it) {
+    /* claiming may unlink the slab once it is full */
+    struct cu_SlabAllocator_Slab *next = it->nextFree;
+    done += cu_slab_claim(
+        alloc, it, need, layout, alignment, out + done, count - done);
+    it = next;
+  }
+  if (done < count) {
+    /* one slab large enough for everything that is left */
+    struct cu_SlabAllocator_Slab *slab = NULL;
+    if (count - done <= SIZE_MAX / need) {
+      slab = cu_slab_add(alloc, (count - done) * need);
+    }
+    if (!slab) {
+      cu_slab_free_batch(self, out, done);
+      cu_Io_Error err = {.kind = CU_IO_ERROR_KIND_OUT_OF_MEMORY,
+          .errnum = Size_Optional_none()};
+      return cu_Io_Error_Optional_some(err);
+    }
+    done += cu_slab_claim(
+        alloc, slab, need, layout, alignment, out + done, count - done);
+  }
+  return cu_Io_Error_Optional_none();
+}
+
+/* Objects allocated together sit next to each other, so free them as runs. */
+static void cu_slab_free_batch(void *self, const cu_Slice *mems, size_t count) {
+  cu_SlabAllocator *alloc = (cu_SlabAllocator *)self;
+  struct cu_SlabAllocator_Slab *slab = NULL;
+  size_t run_start = 0;
+  size_t run_count = 0;
+  for (size_t i = 0; i < count; ++i) {
+    CU_IF_NULL(mems[i].ptr) { continue; }
+    struct cu_SlabAllocator_Header *hdr =
+        (struct cu_SlabAllocator_Header *)((unsigned char *)mems[i].ptr -
+                                           sizeof(
+                                               struct cu_SlabAllocator_Header));
+    if (hdr->slab == slab && hdr->index == run_start + run_count) {
+      run_count += hdr->count;
+      continue;
+    }
+    if (slab) {
+      cu_slab_release(alloc, slab, run_start, run_count);
+    }
+    slab = hdr->slab;
+    run_start = hdr->index;
+    run_count = hdr->count;
+  }
+  if (slab) {
+    cu_slab_release(alloc, slab, run_start, run_count);
   }
-  slab->freeCount += hdr->count;
-  CU_UNUSED(alloc);
 }
 
 cu_Allocator cu_Allocator_SlabAllocator(
@@ -244,6 +422,7 @@ cu_Allocator cu_Allocator_SlabAllocator(
 #endif
   }
   alloc->slabs = NULL;
+  alloc->available = NULL;
   alloc->current = NULL;
   alloc->slabSize = cfg.slabSize;
   if (alloc->slabSize == 0) {
@@ -256,6 +435,8 @@ cu_Allocator cu_Allocator_SlabAllocator(
   a.growFn = cu_slab_grow;
   a.shrinkFn = cu_slab_shrink;
   a.freeFn = cu_slab_free;
+  a.allocBatchFn = cu_slab_alloc_batch;
+  a.freeBatchFn = cu_slab_free_batch;
   return a;
 }
 
@@ -269,5 +450,6 @@ void cu_SlabAllocator_destroy(cu_SlabAllocator *alloc) {
     slab = next;
   }
   alloc->slabs = NULL;
+  alloc->available = NULL;
   alloc->current = NULL;
 }
@@ -0,0 +1,270 @@
+#include "memory/statsallocator.h"
+#include "macro.h"
+#include "memory/wasmallocator.h"
+#include "utility.h"
+#include <nostd.h>
+
+#if !defined(__STDC_NO_ATOMICS__)
+
+#define CU_STATS_ADD(counter, n)                                               \
+  atomic_fetch_add_explicit(&(counter), (uint64_t)(n), memory_order_relaxed)
+#define CU_STATS_LOAD(counter)                                                 \
+  atomic_load_explicit(&(counter), memory_order_relaxed)
+#define CU_STATS_STORE(counter, n)                                             \
+  atomic_store_explicit(&(counter), (uint64_t)(n), memory_order_relaxed)
+
+static void cu_stats_raise(_Atomic(uint64_t) *counter, uint64_t value) {
+  uint64_t seen = atomic_load_explicit(counter, memory_order_relaxed);
+  while (seen < value &&
+         !atomic_compare_exchange_weak_explicit(counter, &seen, value,
+             memory_order_relaxed, memory_order_relaxed)) {
+  }
+}
+
+static uint64_t cu_stats_start(cu_StatsAllocator *alloc) {
+  return alloc->clockFn ? alloc->clockFn() : 0;
+}
+
+static void cu_stats_stop(cu_StatsAllocator *alloc, uint64_t start) {
+  if (!alloc->clockFn) {
+    return;
+  }
+  uint64_t elapsed = alloc->clockFn() - start;
+  CU_STATS_ADD(alloc->latencyTicks, elapsed);
+  cu_stats_raise(&alloc->latencyMax, elapsed);
+}
+
+static void cu_stats_live_add(cu_StatsAllocator *alloc, size_t bytes) {
+  uint64_t live = CU_STATS_ADD(alloc->bytesLive, bytes) + bytes;
+  cu_stats_raise(&alloc->bytesPeak, live);
+}
+
+static void cu_stats_live_sub(cu_StatsAllocator *alloc, size_t bytes) {
+  atomic_fetch_sub_explicit(
+      &alloc->bytesLive, (uint64_t)bytes, memory_order_relaxed);
+}
+
+static size_t cu_stats_bucket(size_t size) {
+  size_t bucket = cu_count_trailing_zeros(cu_next_pow2(size));
+  return CU_MIN(bucket, CU_STATS_HISTOGRAM_BUCKETS - 1);
+}
+
+static cu_IoSlice_Result cu_stats_alloc(void *self, cu_Layout layout) {
+  cu_StatsAllocator *alloc = (cu_StatsAllocator *)self;
+  uint64_t start = cu_stats_start(alloc);
+  cu_IoSlice_Result res = cu_Allocator_Alloc(alloc->backingAllocator, layout);
+  cu_stats_stop(alloc, start);
+  if (!cu_IoSlice_Result_is_ok(&res)) {
+    CU_STATS_ADD(alloc->failureCount, 1);
+    return res;
+  }
+  CU_STATS_ADD(alloc->allocCount, 1);
+  CU_STATS_ADD(alloc->bytesTotal, res.value.length);
+  CU_STATS_ADD(alloc->histogram[cu_stats_bucket(layout.elem_size)], 1);
+  cu_stats_live_add(alloc, res.value.length);
+  return res;
+}
+
+static cu_IoSlice_Result cu_stats_grow(
+    void *self, cu_Slice old_mem, cu_Layout new_layout) {
+  cu_StatsAllocator *alloc = (cu_StatsAllocator *)self;
+  uint64_t start = cu_stats_start(alloc);
+  cu_IoSlice_Result res =
+      cu_Allocator_Grow(alloc->backingAllocator, old_mem, new_layout);
+  cu_stats_stop(alloc, start);
+  if (!cu_IoSlice_Result_is_ok(&res)) {
+    CU_STATS_ADD(alloc->failureCount, 1);
+    return res;
+  }
+  size_t old_len = old_mem.ptr ? old_mem.length : 0;
+  CU_STATS_ADD(alloc->growCount, 1);
+  if (res.value.length > old_len) {
+    cu_stats_live_add(alloc, res.value.length - old_len);
+  } else {
+    cu_stats_live_sub(alloc, old_len - res.value.length);
+  }
+  return res;
+}
+
+static cu_IoSlice_Result cu_stats_shrink(
+    void *self, cu_Slice old_mem, cu_Layout new_layout) {
+  cu_StatsAllocator *alloc = (cu_StatsAllocator *)self;
+  uint64_t start = cu_stats_start(alloc);
+  cu_IoSlice_Result res =
+      cu_Allocator_Shrink(alloc->backingAllocator, old_mem, new_layout);
+  cu_stats_stop(alloc, start);
+  if (!cu_IoSlice_Result_is_ok(&res)) {
+    CU_STATS_ADD(alloc->failureCount, 1);
+    return res;
+  }
+  CU_STATS_ADD(alloc->shrinkCount, 1);
+  if (old_mem.length > res.value.length) {
+    cu_stats_live_sub(alloc, old_mem.length - res.value.length);
+  } else {
+    cu_stats_live_add(alloc, res.value.length - old_mem.length);
+  }
+  return res;
+}
+
+static void cu_stats_free(void *self, cu_Slice mem) {
+  cu_StatsAllocator *alloc = (cu_StatsAllocator *)self;
+  CU_IF_NULL(mem.ptr) { return; }
+  uint64_t start = cu_stats_start(alloc);
+  cu_Allocator_Free(alloc->backingAllocator, mem);
+  cu_stats_stop(alloc, start);
+  CU_STATS_ADD(alloc->freeCount, 1);
+  cu_stats_live_sub(alloc, mem.length);
+}
+
+static cu_Io_Error_Optional cu_stats_alloc_batch(
+    void *self, cu_Layout layout, cu_Slice *out, size_t count) {
+  cu_StatsAllocator *alloc = (cu_StatsAllocator *)self;
+  uint64_t start = cu_stats_start(alloc);
+  cu_Io_Error_Optional err =
+      cu_Allocator_AllocBatch(alloc->backingAllocator, layout, out, count);
+  cu_stats_stop(alloc, start);
+  if (cu_Io_Error_Optional_is_some(&err)) {
+    CU_STATS_ADD(alloc->failureCount, 1);
+    return err;
+  }
+  size_t bytes = 0;
+  for (size_t i = 0; i < count; ++i) {
+    bytes += out[i].length;
+  }
+  CU_STATS_ADD(alloc->allocCount, count);
+  CU_STATS_ADD(alloc->bytesTotal, bytes);
+  CU_STATS_ADD(alloc->histogram[cu_stats_bucket(layout.elem_size)], count);
+  cu_stats_live_add(alloc, bytes);
+  return err;
+}
+
+static void cu_stats_free_batch(
+    void *self, const cu_Slice *mems, size_t count) {
+  cu_StatsAllocator *alloc = (cu_StatsAllocator *)self;
+  size_t freed = 0;
+  size_t bytes = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (mems[i].ptr) {
+      freed++;
+      bytes += mems[i].length;
+    }
+  }
+  uint64_t start = cu_stats_start(alloc);
+  cu_Allocator_FreeBatch(alloc->backingAllocator, mems, count);
+  cu_stats_stop(alloc, start);
+  CU_STATS_ADD(alloc->freeCount, freed);
+  cu_stats_live_sub(alloc, bytes);
+}
+
+cu_Allocator cu_Allocator_StatsAllocator(
+    cu_StatsAllocator *alloc, cu_StatsAllocator_Config config) {
+  if (cu_Allocator_Optional_is_some(&config.backingAllocator)) {
+    alloc->backingAllocator = config.backingAllocator.value;
+  } else {
+#if CU_PLAT_WASM
+    alloc->backingAllocator = cu_Allocator_WasmAllocator();
+#elif !CU_FREESTANDING
+    alloc->backingAllocator = cu_Allocator_CAllocator();
+#else
+    alloc->backingAllocator = cu_Allocator_NullAllocator();
+#endif
+  }
+  alloc->clockFn = config.clockFn;
+  atomic_init(&alloc->bytesLive, 0);
+  cu_StatsAllocator_reset(alloc);
+
+  cu_Allocator a = {0};
+  a.self = alloc;
+  a.allocFn = cu_stats_alloc;
+  a.growFn = cu_stats_grow;
+  a.shrinkFn = cu_stats_shrink;
+  a.freeFn = cu_stats_free;
+  a.allocBatchFn = cu_stats_alloc_batch;
+  a.freeBatchFn = cu_stats_free_batch;
+  return a;
+}
+
+cu_StatsAllocator_Snapshot cu_StatsAllocator_snapshot(
+    const cu_StatsAllocator *alloc) {
+  /* the counters are only read, casting away const keeps C11 loads happy */
+  cu_StatsAllocator *a = (cu_StatsAllocator *)alloc;
+  cu_StatsAllocator_Snapshot snap;
+  snap.allocCount = CU_STATS_LOAD(a->allocCount);
+  snap.freeCount = CU_STATS_LOAD(a->freeCount);
+  snap.growCount = CU_STATS_LOAD(a->growCount);
+  snap.shrinkCount = CU_STATS_LOAD(a->shrinkCount);
+  snap.failureCount = CU_STATS_LOAD(a->failureCount);
+  snap.bytesLive = CU_STATS_LOAD(a->bytesLive);
+  snap.bytesPeak = CU_STATS_LOAD(a->bytesPeak);
+  snap.bytesTotal = CU_STATS_LOAD(a->bytesTotal);
+  snap.latencyTicks = CU_STATS_LOAD(a->latencyTicks);
+  snap.latencyMax = CU_STATS_LOAD(a->latencyMax);
+  for (size_t i = 0; i < CU_STATS_HISTOGRAM_BUCKETS; ++i) {
+    snap.histogram[i] = CU_STATS_LOAD(a->histogram[i]);
+  }
+  return snap;
+}
+
+void cu_StatsAllocator_reset(cu_StatsAllocator *alloc) {
+  CU_STATS_STORE(alloc->allocCount, 0);
+  CU_STATS_STORE(alloc->freeCount, 0);
+  CU_STATS_STORE(alloc->growCount, 0);
+  CU_STATS_STORE(alloc->shrinkCount, 0);
+  CU_STATS_STORE(alloc->failureCount, 0);
+  CU_STATS_STORE(alloc->bytesPeak, CU_STATS_LOAD(alloc->bytesLive));
+  CU_STATS_STORE(alloc->bytesTotal, 0);
+  CU_STATS_STORE(alloc->latencyTicks, 0);
+  CU_STATS_STORE(alloc->latencyMax, 0);
+  for (size_t i = 0; i < CU_STATS_HISTOGRAM_BUCKETS; ++i) {
+    CU_STATS_STORE(alloc->histogram[i], 0);
+  }
+}
+
+static cu_Io_Error_Optional cu_stats_write_line(
+    cu_Stream *stream, const char *name, unsigned long long value) {
+  char line[96];
+  int len = cu_CString_snprintf(line, sizeof(line), "%s %llu\n", name, value);
+  return cu_Stream_write(stream, cu_Slice_create(line, (size_t)len));
+}
+
+cu_Io_Error_Optional cu_StatsAllocator_Snapshot_write(
+    const cu_StatsAllocator_Snapshot *snapshot, cu_Stream *stream) {
+  const struct {
+    const char *name;
+    uint64_t value;
+  } fields[] = {
+      {"allocs", snapshot->allocCount},
+      {"frees", snapshot->freeCount},
+      {"grows", snapshot->growCount},
+      {"shrinks", snapshot->shrinkCount},
+      {"failures", snapshot->failureCount},
+      {"bytes_live", snapshot->bytesLive},
+      {"bytes_peak", snapshot->bytesPeak},
+      {"bytes_total", snapshot->bytesTotal},
+      {"latency_ticks", snapshot->latencyTicks},
+      {"latency_max", snapshot->latencyMax},
+  };
+  for (size_t i = 0; i < CU_ARRAY_LEN(fields); ++i) {
+    cu_Io_Error_Optional err =
+        cu_stats_write_line(stream, fields[i].name, fields[i].value);
+    if (cu_Io_Error_Optional_is_some(&err)) {
+      return err;
+    }
+  }
+  for (size_t i = 0; i < CU_STATS_HISTOGRAM_BUCKETS; ++i) {
+    if (snapshot->histogram[i] == 0) {
+      continue;
+    }
+    char name[32];
+    cu_CString_snprintf(
+        name, sizeof(name), "size_le_%llu", 1ULL << i);
+    cu_Io_Error_Optional err =
+        cu_stats_write_line(stream, name, snapshot->histogram[i]);
+    if (cu_Io_Error_Optional_is_some(&err)) {
+      return err;
+    }
+  }
+  return cu_Io_Error_Optional_none();
+}
+
+#endif /* !__STDC_NO_ATOMICS__ */
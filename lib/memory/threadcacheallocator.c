@@ -0,0 +1,786 @@
+/* macro.h is not included yet, so test the compiler macro directly */
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+#include "memory/threadcacheallocator.h"
+#include "io/error.h"
+#include "macro.h"
+#include "memory/wasmallocator.h"
+#include "utility.h"
+#include <nostd.h>
+#if CU_PLAT_LINUX && !CU_FREESTANDING
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if !CU_FREESTANDING && !defined(__STDC_NO_ATOMICS__)
+
+#define CU_TC_RADIX_FANOUT ((size_t)1 << CU_THREADCACHE_RADIX_BITS)
+#define CU_TC_THREAD_SLOTS 4
+#define CU_TC_MIN_SPAN_SIZE 4096
+#define CU_TC_MAX_BACKOFF 64
+
+#if (CU_COMPILER_GCC || CU_COMPILER_CLANG) &&                                 \
+    (defined(__x86_64__) || defined(__i386__))
+#define CU_TC_RELAX() __builtin_ia32_pause()
+#else
+#define CU_TC_RELAX() ((void)0)
+#endif
+
+/* Helper forward declarations */
+static cu_IoSlice_Result cu_tc_alloc(void *self, cu_Layout layout);
+static cu_IoSlice_Result cu_tc_grow(
+    void *self, cu_Slice old_mem, cu_Layout new_layout);
+static cu_IoSlice_Result cu_tc_shrink(
+    void *self, cu_Slice old_mem, cu_Layout new_layout);
+static void cu_tc_free(void *self, cu_Slice mem);
+
+/*
+ * Threads find their cache through a handful of thread local slots keyed by
+ * a process wide instance id. Ids are never reused, so slots left behind by
+ * a destroyed allocator can never match again. A thread using more instances
+ * than there are slots evicts one; when it comes back to that instance it
+ * finds its registered cache again by the address of its thread token.
+ */
+struct cu_tc_thread_slot {
+  uintptr_t id;
+  struct cu_ThreadCacheAllocator_Cache *cache;
+};
+
+static CU_THREAD_LOCAL struct cu_tc_thread_slot
+    cu_tc_slots[CU_TC_THREAD_SLOTS];
+static CU_THREAD_LOCAL size_t cu_tc_victim;
+static CU_THREAD_LOCAL char cu_tc_thread_token;
+static _Atomic(uintptr_t) cu_tc_next_id = 1;
+
+static cu_IoSlice_Result cu_tc_out_of_memory(void) {
+  cu_Io_Error err = {
+      .kind = CU_IO_ERROR_KIND_OUT_OF_MEMORY, .errnum = Size_Optional_none()};
+  return cu_IoSlice_Result_error(err);
+}
+
+/* Back off exponentially while the central lock is contended. */
+static void cu_tc_lock(cu_ThreadCacheAllocator *alloc) {
+  unsigned spins = 1;
+  while (
+      atomic_flag_test_and_set_explicit(&alloc->lock, memory_order_acquire)) {
+    for (unsigned i = 0; i < spins; ++i) {
+      CU_TC_RELAX();
+    }
+    if (spins < CU_TC_MAX_BACKOFF) {
+      spins <<= 1;
+    }
+  }
+}
+
+static void cu_tc_unlock(cu_ThreadCacheAllocator *alloc) {
+  atomic_flag_clear_explicit(&alloc->lock, memory_order_release);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Span map                                                                   */
+/* -------------------------------------------------------------------------- */
+
+/*
+ * Radix tree from span number to span header. Nodes are only added under the
+ * central lock and are never removed before destroy, so lookups walk it
+ * without locking.
+ */
+
+static _Atomic(void *) *cu_tc_map_node_create(cu_ThreadCacheAllocator *alloc) {
+  size_t bytes = CU_TC_RADIX_FANOUT * sizeof(_Atomic(void *));
+  cu_IoSlice_Result mem = cu_Allocator_Alloc(alloc->backingAllocator,
+      cu_Layout_create(bytes, _Alignof(_Atomic(void *))));
+  if (!cu_IoSlice_Result_is_ok(&mem)) {
+    return NULL;
+  }
+  cu_Memory_memset(mem.value.ptr, 0, bytes);
+  return (_Atomic(void *) *)mem.value.ptr;
+}
+
+static size_t cu_tc_map_index(
+    cu_ThreadCacheAllocator *alloc, uintptr_t key, size_t level) {
+  size_t shift =
+      CU_THREADCACHE_RADIX_BITS * (alloc->spanMapLevels - 1 - level);
+  return (size_t)(key >> shift) & (CU_TC_RADIX_FANOUT - 1);
+}
+
+static struct cu_ThreadCacheAllocator_Span *cu_tc_map_find(
+    cu_ThreadCacheAllocator *alloc, const void *ptr) {
+  uintptr_t key = (uintptr_t)ptr >> alloc->spanShift;
+  _Atomic(void *) *node = alloc->spanMap;
+  for (size_t level = 0;; ++level) {
+    void *next = atomic_load_explicit(
+        &node[cu_tc_map_index(alloc, key, level)], memory_order_acquire);
+    if (!next || level + 1 == alloc->spanMapLevels) {
+      return (struct cu_ThreadCacheAllocator_Span *)next;
+    }
+    node = (_Atomic(void *) *)next;
+  }
+}
+
+static bool cu_tc_map_set(
+    cu_ThreadCacheAllocator *alloc, const void *base, void *value) {
+  uintptr_t key = (uintptr_t)base >> alloc->spanShift;
+  _Atomic(void *) *node = alloc->spanMap;
+  for (size_t level = 0; level + 1 < alloc->spanMapLevels; ++level) {
+    _Atomic(void *) *slot = &node[cu_tc_map_index(alloc, key, level)];
+    void *next = atomic_load_explicit(slot, memory_order_relaxed);
+    if (!next) {
+      next = cu_tc_map_node_create(alloc);
+      if (!next) {
+        return false;
+      }
+      atomic_store_explicit(slot, next, memory_order_release);
+    }
+    node = (_Atomic(void *) *)next;
+  }
+  atomic_store_explicit(&node[cu_tc_map_index(alloc, key,
+                            alloc->spanMapLevels - 1)],
+      value, memory_order_release);
+  return true;
+}
+
+static void cu_tc_map_destroy(
+    cu_ThreadCacheAllocator *alloc, _Atomic(void *) *node, size_t level) {
+  for (size_t i = 0; i < CU_TC_RADIX_FANOUT; ++i) {
+    void *entry = atomic_load_explicit(&node[i], memory_order_relaxed);
+    if (!entry) {
+      continue;
+    }
+    /* spans are freed with their regions */
+    if (level + 1 < alloc->spanMapLevels) {
+      cu_tc_map_destroy(alloc, (_Atomic(void *) *)entry, level + 1);
+    }
+  }
+  cu_Allocator_Free(alloc->backingAllocator,
+      cu_Slice_create(
+          (void *)node, CU_TC_RADIX_FANOUT * sizeof(_Atomic(void *))));
+}
+
+/* -------------------------------------------------------------------------- */
+/* Central spans                                                              */
+/* -------------------------------------------------------------------------- */
+
+static void cu_tc_link_region(struct cu_ThreadCacheAllocator_Region **list,
+    struct cu_ThreadCacheAllocator_Region *region) {
+  region->prev = NULL;
+  region->next = *list;
+  if (region->next) {
+    region->next->prev = region;
+  }
+  *list = region;
+}
+
+static void cu_tc_unlink_region(struct cu_ThreadCacheAllocator_Region **list,
+    struct cu_ThreadCacheAllocator_Region *region) {
+  if (region->prev) {
+    region->prev->next = region->next;
+  } else {
+    *list = region->next;
+  }
+  if (region->next) {
+    region->next->prev = region->prev;
+  }
+  region->prev = NULL;
+  region->next = NULL;
+}
+
+static void cu_tc_free_region(cu_ThreadCacheAllocator *alloc,
+    struct cu_ThreadCacheAllocator_Region *region) {
+  cu_Allocator_Free(alloc->backingAllocator, region->memory);
+  cu_Allocator_Free(
+      alloc->backingAllocator, cu_Slice_create(region, sizeof(*region)));
+}
+
+/* Same over-allocation fallback as the general purpose allocator regions. */
+static struct cu_ThreadCacheAllocator_Region *cu_tc_create_region(
+    cu_ThreadCacheAllocator *alloc) {
+  size_t span = alloc->spanSize;
+  if (span > SIZE_MAX / (CU_THREADCACHE_REGION_SPANS + 1)) {
+    return NULL;
+  }
+  size_t bytes = span * CU_THREADCACHE_REGION_SPANS;
+  cu_IoSlice_Result header = cu_Allocator_Alloc(alloc->backingAllocator,
+      CU_LAYOUT(struct cu_ThreadCacheAllocator_Region));
+  if (!cu_IoSlice_Result_is_ok(&header)) {
+    return NULL;
+  }
+  struct cu_ThreadCacheAllocator_Region *region =
+      (struct cu_ThreadCacheAllocator_Region *)header.value.ptr;
+
+  cu_IoSlice_Result mem = cu_Allocator_Alloc(
+      alloc->backingAllocator, cu_Layout_create(bytes, span));
+  if (cu_IoSlice_Result_is_ok(&mem) &&
+      ((uintptr_t)mem.value.ptr & (span - 1)) == 0) {
+    region->base = (unsigned char *)mem.value.ptr;
+  } else {
+    if (cu_IoSlice_Result_is_ok(&mem)) {
+      cu_Allocator_Free(alloc->backingAllocator, mem.value);
+    }
+    mem = cu_Allocator_Alloc(alloc->backingAllocator,
+        cu_Layout_create(bytes + span, sizeof(void *)));
+    if (!cu_IoSlice_Result_is_ok(&mem)) {
+      cu_Allocator_Free(alloc->backingAllocator, header.value);
+      return NULL;
+    }
+    region->base =
+        (unsigned char *)CU_ALIGN_UP((uintptr_t)mem.value.ptr, span);
+  }
+  region->memory = mem.value;
+  region->freeSpans = SIZE_MAX;
+  cu_tc_link_region(&alloc->regions, region);
+  return region;
+}
+
+static unsigned char *cu_tc_alloc_span(cu_ThreadCacheAllocator *alloc,
+    struct cu_ThreadCacheAllocator_Region **region_out) {
+  struct cu_ThreadCacheAllocator_Region *region = alloc->regions;
+  if (!region) {
+    region = cu_tc_create_region(alloc);
+    if (!region) {
+      return NULL;
+    }
+  }
+  size_t i = cu_count_trailing_zeros(region->freeSpans);
+  region->freeSpans &= region->freeSpans - 1;
+  if (region->freeSpans == 0) {
+    cu_tc_unlink_region(&alloc->regions, region);
+    cu_tc_link_region(&alloc->fullRegions, region);
+  }
+  *region_out = region;
+  return region->base + i * alloc->spanSize;
+}
+
+/*
+ * Give a span back to its region. The region is freed with its last span,
+ * otherwise the pages of the span are returned to the system where that is
+ * supported.
+ */
+static void cu_tc_free_span(cu_ThreadCacheAllocator *alloc,
+    struct cu_ThreadCacheAllocator_Region *region, unsigned char *span) {
+  size_t i = (size_t)(span - region->base) / alloc->spanSize;
+  if (region->freeSpans == 0) {
+    cu_tc_unlink_region(&alloc->fullRegions, region);
+    cu_tc_link_region(&alloc->regions, region);
+  }
+  region->freeSpans |= (size_t)1 << i;
+  if (region->freeSpans == SIZE_MAX) {
+    cu_tc_unlink_region(&alloc->regions, region);
+    cu_tc_free_region(alloc, region);
+    return;
+  }
+#if CU_PLAT_LINUX && defined(MADV_DONTNEED)
+  uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+  if (alloc->spanSize >= page) {
+    madvise(span, alloc->spanSize, MADV_DONTNEED);
+  }
+#endif
+}
+
+static void cu_tc_link_span(
+    cu_ThreadCacheAllocator *alloc, struct cu_ThreadCacheAllocator_Span *span) {
+  span->prev = NULL;
+  span->next = alloc->partial[span->sizeClass];
+  if (span->next) {
+    span->next->prev = span;
+  }
+  alloc->partial[span->sizeClass] = span;
+  span->linked = true;
+}
+
+static void cu_tc_unlink_span(
+    cu_ThreadCacheAllocator *alloc, struct cu_ThreadCacheAllocator_Span *span) {
+  if (span->prev) {
+    span->prev->next = span->next;
+  } else {
+    alloc->partial[span->sizeClass] = span->next;
+  }
+  if (span->next) {
+    span->next->prev = span->prev;
+  }
+  span->prev = NULL;
+  span->next = NULL;
+  span->linked = false;
+}
+
+static struct cu_ThreadCacheAllocator_Span *cu_tc_create_span(
+    cu_ThreadCacheAllocator *alloc, int size_class) {
+  struct cu_ThreadCacheAllocator_Region *region;
+  unsigned char *base = cu_tc_alloc_span(alloc, &region);
+  if (!base) {
+    return NULL;
+  }
+  struct cu_ThreadCacheAllocator_Span *span =
+      (struct cu_ThreadCacheAllocator_Span *)(base + alloc->spanSize -
+                                              sizeof(*span));
+  span->prev = NULL;
+  span->next = NULL;
+  span->freeList = NULL;
+  span->data = base;
+  span->objectSize = (size_t)1 << size_class;
+  span->slotCount = (alloc->spanSize - sizeof(*span)) / span->objectSize;
+  span->carvedCount = 0;
+  span->usedCount = 0;
+  span->sizeClass = size_class;
+  span->linked = false;
+  span->region = region;
+  span->canary = CU_THREADCACHE_CANARY;
+  if (!cu_tc_map_set(alloc, base, span)) {
+    cu_tc_free_span(alloc, region, base);
+    return NULL;
+  }
+  return span;
+}
+
+static void cu_tc_release_span(
+    cu_ThreadCacheAllocator *alloc, struct cu_ThreadCacheAllocator_Span *span) {
+  if (span->linked) {
+    cu_tc_unlink_span(alloc, span);
+  }
+  cu_tc_map_set(alloc, span->data, NULL);
+  cu_tc_free_span(alloc, span->region, span->data);
+}
+
+/* Detach up to @p want objects of a size class as a chain. */
+static void *cu_tc_central_take(cu_ThreadCacheAllocator *alloc,
+    int size_class, size_t want, size_t *count_out) {
+  void *chain = NULL;
+  size_t count = 0;
+  while (count < want) {
+    struct cu_ThreadCacheAllocator_Span *span = alloc->partial[size_class];
+    if (!span) {
+      span = cu_tc_create_span(alloc, size_class);
+      if (!span) {
+        break;
+      }
+      cu_tc_link_span(alloc, span);
+    }
+    while (count < want && span->usedCount < span->slotCount) {
+      void *obj;
+      if (span->freeList) {
+        obj = span->freeList;
+        span->freeList = *(void **)obj;
+      } else {
+        obj = span->data + span->carvedCount * span->objectSize;
+        span->carvedCount++;
+      }
+      *(void **)obj = chain;
+      chain = obj;
+      span->usedCount++;
+      count++;
+    }
+    if (span->usedCount == span->slotCount) {
+      cu_tc_unlink_span(alloc, span);
+    }
+  }
+  *count_out = count;
+  return chain;
+}
+
+static void cu_tc_central_put(cu_ThreadCacheAllocator *alloc, void *obj) {
+  struct cu_ThreadCacheAllocator_Span *span = cu_tc_map_find(alloc, obj);
+  if (span->canary != CU_THREADCACHE_CANARY) {
+    CU_DIE("thread cache span header corrupted");
+  }
+  *(void **)obj = span->freeList;
+  span->freeList = obj;
+  span->usedCount--;
+  if (!span->linked) {
+    cu_tc_link_span(alloc, span);
+  }
+  if (span->usedCount == 0 &&
+      (alloc->partial[span->sizeClass] != span || span->next != NULL)) {
+    cu_tc_release_span(alloc, span);
+  }
+}
+
+/* Return every object flushed by thread caches. Requires the central lock. */
+static void cu_tc_drain_remote(cu_ThreadCacheAllocator *alloc) {
+  void *obj =
+      atomic_exchange_explicit(&alloc->remoteFree, NULL, memory_order_acquire);
+  while (obj) {
+    void *next = *(void **)obj;
+    cu_tc_central_put(alloc, obj);
+    obj = next;
+  }
+}
+
+static void cu_tc_push_remote(
+    cu_ThreadCacheAllocator *alloc, void *head, void *tail) {
+  void *old = atomic_load_explicit(&alloc->remoteFree, memory_order_relaxed);
+  do {
+    *(void **)tail = old;
+  } while (!atomic_compare_exchange_weak_explicit(&alloc->remoteFree, &old,
+      head, memory_order_release, memory_order_relaxed));
+}
+
+/* -------------------------------------------------------------------------- */
+/* Thread caches                                                              */
+/* -------------------------------------------------------------------------- */
+
+/* Cache registered by the calling thread. Requires the central lock. */
+static struct cu_ThreadCacheAllocator_Cache *cu_tc_cache_registered(
+    cu_ThreadCacheAllocator *alloc) {
+  uintptr_t owner = (uintptr_t)&cu_tc_thread_token;
+  struct cu_ThreadCacheAllocator_Cache *cache = alloc->caches;
+  while (cache && cache->owner != owner) {
+    cache = cache->next;
+  }
+  return cache;
+}
+
+/*
+ * Find the cache this thread registered earlier or register a new one. A
+ * thread that exited without flushing leaves its cache behind; a later
+ * thread whose token lands at the same address simply adopts it.
+ */
+static struct cu_ThreadCacheAllocator_Cache *cu_tc_cache_create(
+    cu_ThreadCacheAllocator *alloc) {
+  cu_tc_lock(alloc);
+  struct cu_ThreadCacheAllocator_Cache *cache = cu_tc_cache_registered(alloc);
+  if (!cache) {
+    cu_IoSlice_Result mem = cu_Allocator_Alloc(alloc->backingAllocator,
+        cu_Layout_create(sizeof(struct cu_ThreadCacheAllocator_Cache),
+            _Alignof(struct cu_ThreadCacheAllocator_Cache)));
+    if (!cu_IoSlice_Result_is_ok(&mem)) {
+      cu_tc_unlock(alloc);
+      return NULL;
+    }
+    cache = (struct cu_ThreadCacheAllocator_Cache *)mem.value.ptr;
+    cu_Memory_memset(cache, 0, sizeof(*cache));
+    cache->owner = (uintptr_t)&cu_tc_thread_token;
+    cache->next = alloc->caches;
+    alloc->caches = cache;
+  }
+  cu_tc_unlock(alloc);
+
+  size_t slot = cu_tc_victim;
+  for (size_t i = 0; i < CU_TC_THREAD_SLOTS; ++i) {
+    if (cu_tc_slots[i].id == 0) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot == cu_tc_victim) {
+    cu_tc_victim = (cu_tc_victim + 1) % CU_TC_THREAD_SLOTS;
+  }
+  cu_tc_slots[slot].id = alloc->id;
+  cu_tc_slots[slot].cache = cache;
+  return cache;
+}
+
+static struct cu_ThreadCacheAllocator_Cache *cu_tc_cache(
+    cu_ThreadCacheAllocator *alloc, bool create) {
+  for (size_t i = 0; i < CU_TC_THREAD_SLOTS; ++i) {
+    if (cu_tc_slots[i].id == alloc->id) {
+      return cu_tc_slots[i].cache;
+    }
+  }
+  return create ? cu_tc_cache_create(alloc) : NULL;
+}
+
+/* Hand the first @p count objects of a bin to the central heap. */
+static void cu_tc_flush_bin(cu_ThreadCacheAllocator *alloc,
+    struct cu_ThreadCacheAllocator_Bin *bin, size_t count) {
+  void *head = bin->head;
+  void *tail = head;
+  for (size_t i = 1; i < count; ++i) {
+    tail = *(void **)tail;
+  }
+  bin->head = *(void **)tail;
+  bin->count -= count;
+  cu_tc_push_remote(alloc, head, tail);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Allocation paths                                                           */
+/* -------------------------------------------------------------------------- */
+
+static int cu_tc_size_class(
+    cu_ThreadCacheAllocator *alloc, size_t size, size_t alignment) {
+  size_t obj_size =
+      cu_next_pow2(CU_MAX(CU_MAX(size, alignment), sizeof(void *)));
+  if (obj_size > alloc->maxSmall) {
+    return -1;
+  }
+  return (int)cu_count_trailing_zeros(obj_size);
+}
+
+static cu_IoSlice_Result cu_tc_alloc_small(
+    cu_ThreadCacheAllocator *alloc, size_t size, int size_class) {
+  struct cu_ThreadCacheAllocator_Cache *cache = cu_tc_cache(alloc, true);
+  struct cu_ThreadCacheAllocator_Bin *bin = cache ? &cache->bins[size_class]
+                                                  : NULL;
+  void *obj;
+  if (bin && bin->head) {
+    obj = bin->head;
+    bin->head = *(void **)obj;
+    bin->count--;
+    return cu_IoSlice_Result_ok(cu_Slice_create(obj, size));
+  }
+
+  size_t count;
+  cu_tc_lock(alloc);
+  cu_tc_drain_remote(alloc);
+  obj = cu_tc_central_take(alloc, size_class,
+      bin ? alloc->batchSize : 1, &count);
+  cu_tc_unlock(alloc);
+  if (!obj) {
+    return cu_tc_out_of_memory();
+  }
+  if (bin) {
+    bin->head = *(void **)obj;
+    bin->count = count - 1;
+  }
+  return cu_IoSlice_Result_ok(cu_Slice_create(obj, size));
+}
+
+static cu_IoSlice_Result cu_tc_alloc_large(
+    cu_ThreadCacheAllocator *alloc, size_t size, size_t alignment) {
+  size_t align =
+      CU_MAX(alignment, _Alignof(struct cu_ThreadCacheAllocator_Large));
+  size_t header = sizeof(struct cu_ThreadCacheAllocator_Large);
+  cu_tc_lock(alloc);
+  cu_IoSlice_Result mem = cu_Allocator_Alloc(alloc->backingAllocator,
+      cu_Layout_create(size + header + align - 1,
+          _Alignof(struct cu_ThreadCacheAllocator_Large)));
+  if (!cu_IoSlice_Result_is_ok(&mem)) {
+    cu_tc_unlock(alloc);
+    return mem;
+  }
+  unsigned char *ptr = (unsigned char *)CU_ALIGN_UP(
+      (uintptr_t)mem.value.ptr + header, align);
+  struct cu_ThreadCacheAllocator_Large *large =
+      (struct cu_ThreadCacheAllocator_Large *)(ptr - header);
+  large->memory = mem.value;
+  large->prev = NULL;
+  large->next = alloc->large;
+  if (large->next) {
+    large->next->prev = large;
+  }
+  alloc->large = large;
+  cu_tc_unlock(alloc);
+  return cu_IoSlice_Result_ok(cu_Slice_create(ptr, size));
+}
+
+static cu_IoSlice_Result cu_tc_alloc(void *self, cu_Layout layout) {
+  cu_ThreadCacheAllocator *alloc = (cu_ThreadCacheAllocator *)self;
+  if (layout.elem_size == 0) {
+    cu_Io_Error err = {
+        .kind = CU_IO_ERROR_KIND_INVALID_INPUT, .errnum = Size_Optional_none()};
+    return cu_IoSlice_Result_error(err);
+  }
+  size_t alignment = layout.alignment ? layout.alignment : 1;
+  int size_class = cu_tc_size_class(alloc, layout.elem_size, alignment);
+  if (size_class < 0) {
+    return cu_tc_alloc_large(alloc, layout.elem_size, alignment);
+  }
+  return cu_tc_alloc_small(alloc, layout.elem_size, size_class);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Resize and free                                                            */
+/* -------------------------------------------------------------------------- */
+
+static void cu_tc_free_small(cu_ThreadCacheAllocator *alloc,
+    struct cu_ThreadCacheAllocator_Span *span, void *ptr) {
+  struct cu_ThreadCacheAllocator_Cache *cache = cu_tc_cache(alloc, true);
+  if (!cache) {
+    cu_tc_push_remote(alloc, ptr, ptr);
+    return;
+  }
+  struct cu_ThreadCacheAllocator_Bin *bin = &cache->bins[span->sizeClass];
+  *(void **)ptr = bin->head;
+  bin->head = ptr;
+  bin->count++;
+  if (bin->count > alloc->batchSize * 2) {
+    cu_tc_flush_bin(alloc, bin, alloc->batchSize);
+  }
+}
+
+static void cu_tc_free_large(cu_ThreadCacheAllocator *alloc, void *ptr) {
+  struct cu_ThreadCacheAllocator_Large *large =
+      (struct cu_ThreadCacheAllocator_Large *)((unsigned char *)ptr -
+                                               sizeof(*large));
+  cu_tc_lock(alloc);
+  if (large->prev) {
+    large->prev->next = large->next;
+  } else {
+    alloc->large = large->next;
+  }
+  if (large->next) {
+    large->next->prev = large->prev;
+  }
+  cu_Allocator_Free(alloc->backingAllocator, large->memory);
+  cu_tc_unlock(alloc);
+}
+
+static void cu_tc_free(void *self, cu_Slice mem) {
+  cu_ThreadCacheAllocator *alloc = (cu_ThreadCacheAllocator *)self;
+  CU_IF_NULL(mem.ptr) { return; }
+  struct cu_ThreadCacheAllocator_Span *span = cu_tc_map_find(alloc, mem.ptr);
+  if (span) {
+    cu_tc_free_small(alloc, span, mem.ptr);
+  } else {
+    cu_tc_free_large(alloc, mem.ptr);
+  }
+}
+
+static cu_IoSlice_Result cu_tc_move(
+    void *self, cu_Slice old_mem, cu_Layout new_layout) {
+  cu_IoSlice_Result new_mem = cu_tc_alloc(self, new_layout);
+  if (!cu_IoSlice_Result_is_ok(&new_mem)) {
+    return new_mem;
+  }
+  cu_Memory_smemcpy(new_mem.value, old_mem);
+  cu_tc_free(self, old_mem);
+  return new_mem;
+}
+
+static cu_IoSlice_Result cu_tc_grow(
+    void *self, cu_Slice old_mem, cu_Layout new_layout) {
+  cu_ThreadCacheAllocator *alloc = (cu_ThreadCacheAllocator *)self;
+  CU_IF_NULL(old_mem.ptr) {
+    return cu_tc_alloc(self, new_layout);
+  }
+  size_t alignment = new_layout.alignment ? new_layout.alignment : 1;
+  struct cu_ThreadCacheAllocator_Span *span =
+      cu_tc_map_find(alloc, old_mem.ptr);
+  if (span && new_layout.elem_size <= span->objectSize &&
+      ((uintptr_t)old_mem.ptr & (alignment - 1)) == 0) {
+    return cu_IoSlice_Result_ok(
+        cu_Slice_create(old_mem.ptr, new_layout.elem_size));
+  }
+  return cu_tc_move(self, old_mem, new_layout);
+}
+
+static cu_IoSlice_Result cu_tc_shrink(
+    void *self, cu_Slice old_mem, cu_Layout new_layout) {
+  CU_IF_NULL(old_mem.ptr) {
+    cu_Io_Error err = {.kind = CU_IO_ERROR_KIND_INVALID_INPUT,
+        .errnum = Size_Optional_none()};
+    return cu_IoSlice_Result_error(err);
+  }
+  size_t alignment = new_layout.alignment ? new_layout.alignment : 1;
+  if (((uintptr_t)old_mem.ptr & (alignment - 1)) == 0) {
+    return cu_IoSlice_Result_ok(
+        cu_Slice_create(old_mem.ptr, new_layout.elem_size));
+  }
+  return cu_tc_move(self, old_mem, new_layout);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Public API                                                                 */
+/* -------------------------------------------------------------------------- */
+
+cu_Allocator cu_Allocator_ThreadCacheAllocator(
+    cu_ThreadCacheAllocator *alloc, cu_ThreadCacheAllocator_Config config) {
+  if (cu_Allocator_Optional_is_some(&config.backingAllocator)) {
+    alloc->backingAllocator = config.backingAllocator.value;
+  } else {
+#if CU_PLAT_WASM
+    alloc->backingAllocator = cu_Allocator_WasmAllocator();
+#else
+    alloc->backingAllocator = cu_Allocator_CAllocator();
+#endif
+  }
+  alloc->spanSize = config.spanSize;
+  if (alloc->spanSize == 0) {
+    alloc->spanSize = CU_THREADCACHE_SPAN_SIZE;
+  }
+  alloc->spanSize = cu_next_pow2(CU_MAX(alloc->spanSize, CU_TC_MIN_SPAN_SIZE));
+  alloc->spanShift = cu_count_trailing_zeros(alloc->spanSize);
+  alloc->batchSize = config.batchSize;
+  if (alloc->batchSize == 0) {
+    alloc->batchSize = CU_THREADCACHE_BATCH_SIZE;
+  }
+  alloc->maxSmall = CU_MIN(
+      alloc->spanSize / 8, (size_t)1 << (CU_THREADCACHE_NUM_CLASSES - 1));
+
+  size_t key_bits = sizeof(uintptr_t) * 8 - alloc->spanShift;
+  alloc->spanMapLevels =
+      (key_bits + CU_THREADCACHE_RADIX_BITS - 1) / CU_THREADCACHE_RADIX_BITS;
+  alloc->spanMap = cu_tc_map_node_create(alloc);
+  if (!alloc->spanMap) {
+    CU_DIE("thread cache allocator span map allocation failed");
+  }
+
+  atomic_flag_clear(&alloc->lock);
+  for (int i = 0; i < CU_THREADCACHE_NUM_CLASSES; ++i) {
+    alloc->partial[i] = NULL;
+  }
+  alloc->regions = NULL;
+  alloc->fullRegions = NULL;
+  alloc->large = NULL;
+  alloc->caches = NULL;
+  atomic_init(&alloc->remoteFree, NULL);
+  alloc->id =
+      atomic_fetch_add_explicit(&cu_tc_next_id, 1, memory_order_relaxed);
+
+  cu_Allocator a = {0};
+  a.self = alloc;
+  a.allocFn = cu_tc_alloc;
+  a.growFn = cu_tc_grow;
+  a.shrinkFn = cu_tc_shrink;
+  a.freeFn = cu_tc_free;
+  return a;
+}
+
+void cu_ThreadCacheAllocator_flush(cu_ThreadCacheAllocator *alloc) {
+  struct cu_ThreadCacheAllocator_Cache *cache = cu_tc_cache(alloc, false);
+  if (!cache) {
+    /* the thread slot may have been evicted by another instance */
+    cu_tc_lock(alloc);
+    cache = cu_tc_cache_registered(alloc);
+    cu_tc_unlock(alloc);
+  }
+  if (!cache) {
+    return;
+  }
+  for (int i = 0; i < CU_THREADCACHE_NUM_CLASSES; ++i) {
+    if (cache->bins[i].count > 0) {
+      cu_tc_flush_bin(alloc, &cache->bins[i], cache->bins[i].count);
+    }
+  }
+}
+
+void cu_ThreadCacheAllocator_destroy(cu_ThreadCacheAllocator *alloc) {
+  struct cu_ThreadCacheAllocator_Large *large = alloc->large;
+  while (large) {
+    struct cu_ThreadCacheAllocator_Large *next = large->next;
+    cu_Allocator_Free(alloc->backingAllocator, large->memory);
+    large = next;
+  }
+  struct cu_ThreadCacheAllocator_Cache *cache = alloc->caches;
+  while (cache) {
+    struct cu_ThreadCacheAllocator_Cache *next = cache->next;
+    cu_Allocator_Free(alloc->backingAllocator,
+        cu_Slice_create(cache, sizeof(*cache)));
+    cache = next;
+  }
+  if (alloc->spanMap) {
+    cu_tc_map_destroy(alloc, alloc->spanMap, 0);
+  }
+  struct cu_ThreadCacheAllocator_Region *lists[] = {
+      alloc->regions, alloc->fullRegions};
+  for (size_t i = 0; i < 2; ++i) {
+    struct cu_ThreadCacheAllocator_Region *region = lists[i];
+    while (region) {
+      struct cu_ThreadCacheAllocator_Region *next = region->next;
+      cu_tc_free_region(alloc, region);
+      region = next;
+    }
+  }
+  alloc->regions = NULL;
+  alloc->fullRegions = NULL;
+  alloc->large = NULL;
+  alloc->caches = NULL;
+  alloc->spanMap = NULL;
+  for (int i = 0; i < CU_THREADCACHE_NUM_CLASSES; ++i) {
+    alloc->partial[i] = NULL;
+  }
+  atomic_store_explicit(&alloc->remoteFree, NULL, memory_order_relaxed);
+}
+
+#endif /* !CU_FREESTANDING && !__STDC_NO_ATOMICS__ */
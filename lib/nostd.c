@@ -6,76 +6,352 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+/* -------------------------------------------------------------------------- */
+/* Memory kernels                                                             */
+/* -------------------------------------------------------------------------- */
+
+/*
+ * The kernels move a machine word at a time, or 16 and 32 byte vectors on
+ * hosted x86-64 builds where AVX2 is picked at run time. Every block is loaded
+ * before it is stored, so the forward kernel is safe when dest is below src
+ * and the backward kernel when it is above, which is all memmove needs.
+ */
+
+#if !defined(CU_FREESTANDING) && (CU_COMPILER_GCC || CU_COMPILER_CLANG) &&    \
+    defined(__x86_64__)
+#define CU_MEMORY_X86 1
+#include <immintrin.h>
+#else
+#define CU_MEMORY_X86 0
+#endif
+
+#if CU_COMPILER_GCC || CU_COMPILER_CLANG
+typedef size_t __attribute__((may_alias, aligned(1))) cu_memory_word;
+typedef uint64_t __attribute__((may_alias, aligned(1))) cu_memory_u64;
+typedef uint32_t __attribute__((may_alias, aligned(1))) cu_memory_u32;
+#else
+/* other compilers neither exploit aliasing rules nor trap on x86 and wasm */
+typedef size_t cu_memory_word;
+typedef uint64_t cu_memory_u64;
+typedef uint32_t cu_memory_u32;
+#endif
+
+#define CU_MEMORY_WORD sizeof(size_t)
+/** copies and fills above this size bypass the cache */
+#define CU_MEMORY_STREAM_MIN ((size_t)4 << 20)
+/** smallest copy worth checking for AVX2 */
+#define CU_MEMORY_AVX2_MIN 256
+
+#if CU_MEMORY_X86
+#define CU_MEMORY_BLOCK 16
+
+/* Probed once; threads racing on the first call store the same answer. */
+static inline bool cu_memory_has_avx2(void) {
+  static int cached = -1;
+  int has = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+  if (has < 0) {
+    __builtin_cpu_init();
+    has = __builtin_cpu_supports("avx2") ? 1 : 0;
+    __atomic_store_n(&cached, has, __ATOMIC_RELAXED);
+  }
+  return has != 0;
+}
+
+__attribute__((target("avx2"))) static size_t cu_memory_forward_avx2(
+    unsigned char *d, const unsigned char *s, size_t n) {
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+    _mm256_storeu_si256((__m256i *)(d + i), v);
+  }
+  return i;
+}
+
+/* d and s point one past the end of the regions */
+__attribute__((target("avx2"))) static size_t cu_memory_backward_avx2(
+    unsigned char *d, const unsigned char *s, size_t n) {
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(s - i - 32));
+    _mm256_storeu_si256((__m256i *)(d - i - 32), v);
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) static size_t cu_memory_fill_avx2(
+    unsigned char *d, unsigned char c, size_t n) {
+  __m256i v = _mm256_set1_epi8((char)c);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    _mm256_storeu_si256((__m256i *)(d + i), v);
+  }
+  return i;
+}
+#else
+#define CU_MEMORY_BLOCK CU_MEMORY_WORD
+#endif
+
+/* Copy at most 16 bytes, loading everything before the first store. */
+static inline void cu_memory_copy_small(
+    unsigned char *d, const unsigned char *s, size_t n) {
+  if (n >= 8) {
+    uint64_t a = *(const cu_memory_u64 *)s;
+    uint64_t b = *(const cu_memory_u64 *)(s + n - 8);
+    *(cu_memory_u64 *)d = a;
+    *(cu_memory_u64 *)(d + n - 8) = b;
+  } else if (n >= 4) {
+    uint32_t a = *(const cu_memory_u32 *)s;
+    uint32_t b = *(const cu_memory_u32 *)(s + n - 4);
+    *(cu_memory_u32 *)d = a;
+    *(cu_memory_u32 *)(d + n - 4) = b;
+  } else if (n > 0) {
+    unsigned char a = s[0];
+    unsigned char b = s[n / 2];
+    unsigned char c = s[n - 1];
+    d[0] = a;
+    d[n / 2] = b;
+    d[n - 1] = c;
+  }
+}
+
+static void cu_memory_forward(
+    unsigned char *d, const unsigned char *s, size_t n) {
+#if CU_MEMORY_X86
+  if (n >= CU_MEMORY_AVX2_MIN && cu_memory_has_avx2()) {
+    size_t done = cu_memory_forward_avx2(d, s, n);
+    d += done;
+    s += done;
+    n -= done;
+  }
+  for (; n >= 16; n -= 16, d += 16, s += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)s);
+    _mm_storeu_si128((__m128i *)d, v);
+  }
+#endif
+  for (; n >= CU_MEMORY_WORD; n -= CU_MEMORY_WORD) {
+    *(cu_memory_word *)d = *(const cu_memory_word *)s;
+    d += CU_MEMORY_WORD;
+    s += CU_MEMORY_WORD;
+  }
+  while (n--) {
+    *d++ = *s++;
+  }
+}
+
+static void cu_memory_backward(
+    unsigned char *d, const unsigned char *s, size_t n) {
+  d += n;
+  s += n;
+#if CU_MEMORY_X86
+  if (n >= CU_MEMORY_AVX2_MIN && cu_memory_has_avx2()) {
+    size_t done = cu_memory_backward_avx2(d, s, n);
+    d -= done;
+    s -= done;
+    n -= done;
+  }
+  for (; n >= 16; n -= 16) {
+    d -= 16;
+    s -= 16;
+    __m128i v = _mm_loadu_si128((const __m128i *)s);
+    _mm_storeu_si128((__m128i *)d, v);
+  }
+#endif
+  for (; n >= CU_MEMORY_WORD; n -= CU_MEMORY_WORD) {
+    d -= CU_MEMORY_WORD;
+    s -= CU_MEMORY_WORD;
+    *(cu_memory_word *)d = *(const cu_memory_word *)s;
+  }
+  while (n--) {
+    *--d = *--s;
+  }
+}
+
+#if CU_MEMORY_X86
+/* Copy with non-temporal stores so huge copies do not evict the cache. */
+static void cu_memory_stream(
+    unsigned char *d, const unsigned char *s, size_t n) {
+  for (; n >= 64; n -= 64, d += 64, s += 64) {
+    __m128i a = _mm_loadu_si128((const __m128i *)s);
+    __m128i b = _mm_loadu_si128((const __m128i *)(s + 16));
+    __m128i c = _mm_loadu_si128((const __m128i *)(s + 32));
+    __m128i e = _mm_loadu_si128((const __m128i *)(s + 48));
+    _mm_stream_si128((__m128i *)d, a);
+    _mm_stream_si128((__m128i *)(d + 16), b);
+    _mm_stream_si128((__m128i *)(d + 32), c);
+    _mm_stream_si128((__m128i *)(d + 48), e);
+  }
+  _mm_sfence();
+  cu_memory_forward(d, s, n);
+}
+#endif
+
+/* Copy between regions that do not overlap. */
+static void cu_memory_copy(unsigned char *d, const unsigned char *s, size_t n) {
+  if (n <= 16) {
+    cu_memory_copy_small(d, s, n);
+    return;
+  }
+  /* align the destination, the main loop rewrites part of the head block */
+  size_t skew = (size_t)(-(uintptr_t)d) & (CU_MEMORY_BLOCK - 1);
+  if (skew) {
+    cu_memory_copy_small(d, s, CU_MEMORY_BLOCK);
+    d += skew;
+    s += skew;
+    n -= skew;
+  }
+#if CU_MEMORY_X86
+  if (n >= CU_MEMORY_STREAM_MIN) {
+    cu_memory_stream(d, s, n);
+    return;
+  }
+#endif
+  cu_memory_forward(d, s, n);
+}
+
+static void cu_memory_move(unsigned char *d, const unsigned char *s, size_t n) {
+  uintptr_t da = (uintptr_t)d;
+  uintptr_t sa = (uintptr_t)s;
+  if (n <= 16) {
+    cu_memory_copy_small(d, s, n);
+  } else if (da + n <= sa || sa + n <= da) {
+    cu_memory_copy(d, s, n);
+  } else if (da < sa) {
+    cu_memory_forward(d, s, n);
+  } else if (da > sa) {
+    cu_memory_backward(d, s, n);
+  }
+}
+
+static void cu_memory_fill(unsigned char *d, unsigned char c, size_t n) {
+  if (n < 16) {
+    uint64_t v = (UINT64_MAX / 255) * c;
+    if (n >= 8) {
+      *(cu_memory_u64 *)d = v;
+      *(cu_memory_u64 *)(d + n - 8) = v;
+    } else if (n >= 4) {
+      *(cu_memory_u32 *)d = (uint32_t)v;
+      *(cu_memory_u32 *)(d + n - 4) = (uint32_t)v;
+    } else {
+      while (n--) {
+        *d++ = c;
+      }
+    }
+    return;
+  }
+#if CU_MEMORY_X86
+  __m128i v = _mm_set1_epi8((char)c);
+  unsigned char *end = d + n;
+  _mm_storeu_si128((__m128i *)d, v);
+  size_t skew = (size_t)(-(uintptr_t)d) & 15;
+  d += skew;
+  n -= skew;
+  if (n >= CU_MEMORY_STREAM_MIN) {
+    for (; n >= 64; n -= 64, d += 64) {
+      _mm_stream_si128((__m128i *)d, v);
+      _mm_stream_si128((__m128i *)(d + 16), v);
+      _mm_stream_si128((__m128i *)(d + 32), v);
+      _mm_stream_si128((__m128i *)(d + 48), v);
+    }
+    _mm_sfence();
+  } else if (n >= CU_MEMORY_AVX2_MIN && cu_memory_has_avx2()) {
+    size_t done = cu_memory_fill_avx2(d, c, n);
+    d += done;
+    n -= done;
+  }
+  for (; n >= 16; n -= 16, d += 16) {
+    _mm_store_si128((__m128i *)d, v);
+  }
+  _mm_storeu_si128((__m128i *)(end - 16), v);
+#else
+  size_t v = (SIZE_MAX / 255) * c;
+  unsigned char *end = d + n;
+  *(cu_memory_word *)d = v;
+  size_t skew = (size_t)(-(uintptr_t)d) & (CU_MEMORY_WORD - 1);
+  d += skew;
+  n -= skew;
+  for (; n >= CU_MEMORY_WORD; n -= CU_MEMORY_WORD, d += CU_MEMORY_WORD) {
+    *(cu_memory_word *)d = v;
+  }
+  *(cu_memory_word *)(end - CU_MEMORY_WORD) = v;
+#endif
+}
+
+static bool cu_memory_equal(
+    const unsigned char *a, const unsigned char *b, size_t n) {
+  if (n < CU_MEMORY_WORD) {
+    for (size_t i = 0; i < n; ++i) {
+      if (a[i] != b[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+  const unsigned char *a_end = a + n;
+  const unsigned char *b_end = b + n;
+#if CU_MEMORY_X86
+  if (n >= 16) {
+    for (; n > 16; n -= 16, a += 16, b += 16) {
+      __m128i x = _mm_loadu_si128((const __m128i *)a);
+      __m128i y = _mm_loadu_si128((const __m128i *)b);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) {
+        return false;
+      }
+    }
+    __m128i x = _mm_loadu_si128((const __m128i *)(a_end - 16));
+    __m128i y = _mm_loadu_si128((const __m128i *)(b_end - 16));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) == 0xFFFF;
+  }
+#endif
+  for (; n > CU_MEMORY_WORD; n -= CU_MEMORY_WORD) {
+    if (*(const cu_memory_word *)a != *(const cu_memory_word *)b) {
+      return false;
+    }
+    a += CU_MEMORY_WORD;
+    b += CU_MEMORY_WORD;
+  }
+  /* the last word may overlap bytes already compared */
+  return *(const cu_memory_word *)(a_end - CU_MEMORY_WORD) ==
+         *(const cu_memory_word *)(b_end - CU_MEMORY_WORD);
+}
+
 void cu_Memory_memmove(void *dest, cu_Slice src) {
   unsigned char *d = (unsigned char *)dest;
   unsigned char *s = (unsigned char *)src.ptr;
-  size_t n = src.length;
 
   CU_IF_NULL(d) return;
   CU_IF_NULL(s) return;
 
-  if (d < s) {
-    // Forward copy when dest is before src
-    while (n--) {
-      *d++ = *s++;
-    }
-  } else {
-    // Backward copy when dest overlaps with src
-    d += n;
-    s += n;
-    while (n--) {
-      *--d = *--s;
-    }
-  }
+  cu_memory_move(d, s, src.length);
 }
 
 void cu_Memory_smemmove(cu_Slice dest, cu_Slice src) {
   unsigned char *d = (unsigned char *)dest.ptr;
   unsigned char *s = (unsigned char *)src.ptr;
-  size_t n = src.length;
 
   CU_IF_NULL(d) return;
   CU_IF_NULL(s) return;
 
-  if (d < s) {
-    // Forward copy when dest is before src
-    while (n--) {
-      *d++ = *s++;
-    }
-  } else {
-    // Backward copy when dest overlaps with src
-    d += n;
-    s += n;
-    while (n--) {
-      *--d = *--s;
-    }
-  }
+  cu_memory_move(d, s, src.length);
 }
 
 void cu_Memory_memcpy(void *dest, cu_Slice src) {
   unsigned char *d = (unsigned char *)dest;
   unsigned char *s = (unsigned char *)src.ptr;
-  size_t n = src.length;
 
   CU_IF_NULL(d) return;
   CU_IF_NULL(s) return;
 
-  while (n--) {
-    *d++ = *s++;
-  }
+  cu_memory_copy(d, s, src.length);
 }
 
 void cu_Memory_smemcpy(cu_Slice dest, cu_Slice src) {
   unsigned char *d = (unsigned char *)dest.ptr;
   unsigned char *s = (unsigned char *)src.ptr;
-  
+
   CU_IF_NULL(d) return;
   CU_IF_NULL(s) return;
-  
-  size_t n = CU_MIN(dest.length, src.length);
-  while (n--) {
-    *d++ = *s++;
-  }
+
+  cu_memory_copy(d, s, CU_MIN(dest.length, src.length));
 }
 
 void cu_Memory_memset(void *dest, int value, size_t size) {
@@ -83,20 +359,7 @@ void cu_Memory_memset(void *dest, int value, size_t size) {
 
   CU_IF_NULL(d) return;
 
-  while (size--) {
-    *d++ = (unsigned char)value;
-  }
-}
-
-size_t cu_CString_length(const char *cstr) {
-  const char *s = cstr;
-
-  CU_IF_NULL(s) return 0;
-
-  while (*s) {
-    s++;
-  }
-  return (size_t)(s - cstr);
+  cu_memory_fill(d, (unsigned char)value, size);
 }
 
 int cu_CString_cmp(const char *a, const char *b) {
@@ -133,12 +396,202 @@ bool cu_Memory_memcmp(cu_Slice a, cu_Slice b) {
   CU_IF_NULL(p1) return b.ptr == NULL; // Both NULL should be equal
   CU_IF_NULL(p2) return false;         // Only one NULL
 
-  for (size_t i = 0; i < a.length; i++) {
-    if (p1[i] != p2[i]) {
-      return false;
+  return cu_memory_equal(p1, p2, a.length);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Byte search                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define CU_MEMORY_ONES ((size_t)-1 / 255)
+#define CU_MEMORY_HIGHS (CU_MEMORY_ONES * 0x80)
+/* nonzero when some byte of the word is zero */
+#define CU_MEMORY_HAS_ZERO(w) (((w) - CU_MEMORY_ONES) & ~(w) & CU_MEMORY_HIGHS)
+
+#if (CU_COMPILER_GCC && __GNUC__ >= 8) || CU_COMPILER_CLANG
+/* reads whole aligned blocks that may extend past the terminator */
+#define CU_MEMORY_OVERREAD __attribute__((no_sanitize("address", "thread")))
+#else
+#define CU_MEMORY_OVERREAD
+#endif
+
+static const unsigned char *cu_memory_find(
+    const unsigned char *p, unsigned char c, size_t n) {
+#if CU_MEMORY_X86
+  if (n >= 16) {
+    __m128i v = _mm_set1_epi8((char)c);
+    const unsigned char *last = p + n - 16;
+    for (; p < last; p += 16) {
+      __m128i x = _mm_loadu_si128((const __m128i *)p);
+      int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, v));
+      if (mask) {
+        return p + __builtin_ctz((unsigned)mask);
+      }
+    }
+    /* the last block may overlap bytes already searched */
+    __m128i x = _mm_loadu_si128((const __m128i *)last);
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, v));
+    return mask ? last + __builtin_ctz((unsigned)mask) : NULL;
+  }
+#endif
+  size_t splat = CU_MEMORY_ONES * c;
+  for (; n >= CU_MEMORY_WORD; n -= CU_MEMORY_WORD, p += CU_MEMORY_WORD) {
+    size_t w = *(const cu_memory_word *)p ^ splat;
+    if (CU_MEMORY_HAS_ZERO(w)) {
+      break;
+    }
+  }
+  for (; n > 0; --n, ++p) {
+    if (*p == c) {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+static const unsigned char *cu_memory_find_last(
+    const unsigned char *p, unsigned char c, size_t n) {
+#if CU_MEMORY_X86
+  if (n >= 16) {
+    __m128i v = _mm_set1_epi8((char)c);
+    const unsigned char *block = p + n - 16;
+    for (; block > p; block -= 16) {
+      __m128i x = _mm_loadu_si128((const __m128i *)block);
+      int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, v));
+      if (mask) {
+        return block + 31 - __builtin_clz((unsigned)mask);
+      }
+      if ((size_t)(block - p) < 16) {
+        break;
+      }
+    }
+    __m128i x = _mm_loadu_si128((const __m128i *)p);
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, v));
+    return mask ? p + 31 - __builtin_clz((unsigned)mask) : NULL;
+  }
+#endif
+  size_t splat = CU_MEMORY_ONES * c;
+  for (; n >= CU_MEMORY_WORD; n -= CU_MEMORY_WORD) {
+    size_t w = *(const cu_memory_word *)(p + n - CU_MEMORY_WORD) ^ splat;
+    if (CU_MEMORY_HAS_ZERO(w)) {
+      break;
+    }
+  }
+  while (n-- > 0) {
+    if (p[n] == c) {
+      return p + n;
+    }
+  }
+  return NULL;
+}
+
+void *cu_Memory_memchr(cu_Slice haystack, int value) {
+  const unsigned char *p = (const unsigned char *)haystack.ptr;
+
+  CU_IF_NULL(p) return NULL;
+
+  return (void *)cu_memory_find(p, (unsigned char)value, haystack.length);
+}
+
+void *cu_Memory_memrchr(cu_Slice haystack, int value) {
+  const unsigned char *p = (const unsigned char *)haystack.ptr;
+
+  CU_IF_NULL(p) return NULL;
+
+  return (void *)cu_memory_find_last(p, (unsigned char)value, haystack.length);
+}
+
+/*
+ * Candidates are positions where both the first and the last needle byte
+ * match, which rules out almost every offset before the full comparison.
+ */
+void *cu_Memory_memmem(cu_Slice haystack, cu_Slice needle) {
+  const unsigned char *h = (const unsigned char *)haystack.ptr;
+  const unsigned char *n = (const unsigned char *)needle.ptr;
+  size_t m = needle.length;
+
+  CU_IF_NULL(h) return NULL;
+  if (m == 0) {
+    return (void *)h;
+  }
+  CU_IF_NULL(n) return NULL;
+  if (haystack.length < m) {
+    return NULL;
+  }
+  if (m == 1) {
+    return (void *)cu_memory_find(h, n[0], haystack.length);
+  }
+
+  /* every candidate start lies in [h, end] */
+  const unsigned char *end = h + haystack.length - m;
+#if CU_MEMORY_X86
+  __m128i first = _mm_set1_epi8((char)n[0]);
+  __m128i last = _mm_set1_epi8((char)n[m - 1]);
+  for (; (size_t)(end - h) >= 16; h += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)h);
+    __m128i b = _mm_loadu_si128((const __m128i *)(h + m - 1));
+    unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+    while (mask) {
+      unsigned bit = (unsigned)__builtin_ctz(mask);
+      if (cu_memory_equal(h + bit + 1, n + 1, m - 2)) {
+        return (void *)(h + bit);
+      }
+      mask &= mask - 1;
     }
   }
-  return true;
+#endif
+  while (h <= end) {
+    h = cu_memory_find(h, n[0], (size_t)(end - h) + 1);
+    if (!h) {
+      return NULL;
+    }
+    if (h[m - 1] == n[m - 1] && cu_memory_equal(h + 1, n + 1, m - 2)) {
+      return (void *)h;
+    }
+    ++h;
+  }
+  return NULL;
+}
+
+/*
+ * Scans whole aligned blocks once the pointer is aligned. An aligned block
+ * never crosses a page, so reading past the terminator cannot fault.
+ */
+CU_MEMORY_OVERREAD size_t cu_CString_length(const char *cstr) {
+  const unsigned char *s = (const unsigned char *)cstr;
+
+  CU_IF_NULL(s) return 0;
+
+#if CU_MEMORY_X86
+  for (; (uintptr_t)s & 15; ++s) {
+    if (!*s) {
+      return (size_t)(s - (const unsigned char *)cstr);
+    }
+  }
+  __m128i zero = _mm_setzero_si128();
+  for (;; s += 16) {
+    __m128i x = _mm_load_si128((const __m128i *)s);
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, zero));
+    if (mask) {
+      s += __builtin_ctz((unsigned)mask);
+      return (size_t)(s - (const unsigned char *)cstr);
+    }
+  }
+#else
+  for (; (uintptr_t)s & (CU_MEMORY_WORD - 1); ++s) {
+    if (!*s) {
+      return (size_t)(s - (const unsigned char *)cstr);
+    }
+  }
+  while (!CU_MEMORY_HAS_ZERO(*(const cu_memory_word *)s)) {
+    s += CU_MEMORY_WORD;
+  }
+  while (*s) {
+    ++s;
+  }
+  return (size_t)(s - (const unsigned char *)cstr);
+#endif
 }
 
 // Helper function to convert number to string
@@ -28,8 +28,32 @@ static void Allocator_GPABasic(void) {
   cu_GPAllocator_destroy(&gpa);
 }
 
+static void Allocator_BatchFallback(void) {
+  cu_FixedAllocator fa;
+  cu_Allocator alloc =
+      cu_Allocator_FixedAllocator(&fa, cu_Slice_create(buffer, 1024));
+  TEST_ASSERT_NULL(alloc.allocBatchFn);
+
+  cu_Slice blocks[8];
+  cu_Io_Error_Optional err =
+      cu_Allocator_AllocBatch(alloc, cu_Layout_create(64, 8), blocks, 8);
+  TEST_ASSERT_FALSE(cu_Io_Error_Optional_is_some(&err));
+  for (size_t i = 1; i < 8; ++i) {
+    TEST_ASSERT_TRUE(blocks[i].ptr != blocks[i - 1].ptr);
+  }
+
+  /* a failing batch hands back what it already took */
+  size_t used = fa.used;
+  cu_Slice too_many[32];
+  err = cu_Allocator_AllocBatch(alloc, cu_Layout_create(64, 8), too_many, 32);
+  TEST_ASSERT_TRUE(cu_Io_Error_Optional_is_some(&err));
+  TEST_ASSERT_EQUAL(used, fa.used);
+  cu_Allocator_FreeBatch(alloc, blocks, 8);
+}
+
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(Allocator_GPABasic);
+  RUN_TEST(Allocator_BatchFallback);
   return UNITY_END();
 }
@@ -1,6 +1,7 @@
 #include "collection/vector.h"
 #include "memory/arenaallocator.h"
 #include "memory/fixedallocator.h"
+#include "nostd.h"
 #include "unity.h"
 #include <unity_internals.h>
 
@@ -118,21 +119,19 @@ static void ArenaAllocator_ReuseOldChunk(void) {
   cfg.chunkSize = 128;
   cfg.backingAllocator = cu_Allocator_Optional_some(fa_alloc);
   cu_Allocator alloc = cu_Allocator_ArenaAllocator(&arena, cfg);
+  cu_ArenaAllocator_Mark start = cu_ArenaAllocator_mark(&arena);
   cu_IoSlice_Result first_res =
       cu_Allocator_Alloc(alloc, cu_Layout_create(32, 8));
   TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&first_res));
-  cu_Slice first = first_res.value;
-  void *ptr = first.ptr;
+  void *ptr = first_res.value.ptr;
 
   cu_IoSlice_Result blocks_res[20];
-  cu_Slice blocks[20];
   for (int i = 0; i < 20; ++i) {
     blocks_res[i] = cu_Allocator_Alloc(alloc, cu_Layout_create(112, 8));
     TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&blocks_res[i]));
-    blocks[i] = blocks_res[i].value;
   }
 
-  cu_Allocator_Free(alloc, first);
+  cu_ArenaAllocator_rewind(&arena, start);
 
   cu_IoSlice_Result again_res =
       cu_Allocator_Alloc(alloc, cu_Layout_create(32, 8));
@@ -140,13 +139,105 @@ static void ArenaAllocator_ReuseOldChunk(void) {
   cu_Slice again = again_res.value;
   TEST_ASSERT_EQUAL(again.ptr, ptr);
 
-  for (int i = 0; i < 20; ++i) {
-    cu_Allocator_Free(alloc, blocks[i]);
-  }
   cu_Allocator_Free(alloc, again);
   cu_ArenaAllocator_destroy(&arena);
 }
 
+static void ArenaAllocator_MarkRewind(void) {
+  cu_FixedAllocator fa;
+  cu_Allocator fa_alloc = cu_Allocator_FixedAllocator(
+      &fa, cu_Slice_create(backing, sizeof(backing)));
+
+  cu_ArenaAllocator arena;
+  cu_ArenaAllocator_Config cfg = {0};
+  cfg.chunkSize = 128;
+  cfg.backingAllocator = cu_Allocator_Optional_some(fa_alloc);
+  cu_Allocator alloc = cu_Allocator_ArenaAllocator(&arena, cfg);
+
+  cu_IoSlice_Result keep = cu_Allocator_Alloc(alloc, cu_Layout_create(16, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&keep));
+  cu_Memory_memset(keep.value.ptr, 0x5A, keep.value.length);
+
+  cu_ArenaAllocator_Mark mark = cu_ArenaAllocator_mark(&arena);
+  cu_IoSlice_Result next = cu_Allocator_Alloc(alloc, cu_Layout_create(16, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&next));
+  for (int i = 0; i < 10; ++i) {
+    cu_IoSlice_Result r = cu_Allocator_Alloc(alloc, cu_Layout_create(100, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&r));
+  }
+  struct cu_ArenaAllocator_Chunk *marked = mark.chunk;
+  TEST_ASSERT_TRUE(arena.current != marked);
+
+  cu_ArenaAllocator_rewind(&arena, mark);
+  TEST_ASSERT_EQUAL(arena.current, marked);
+  TEST_ASSERT_NOT_NULL(arena.spare);
+  TEST_ASSERT_EQUAL(((unsigned char *)keep.value.ptr)[15], 0x5A);
+
+  cu_IoSlice_Result again = cu_Allocator_Alloc(alloc, cu_Layout_create(16, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&again));
+  TEST_ASSERT_EQUAL(again.value.ptr, next.value.ptr);
+
+  cu_ArenaAllocator_destroy(&arena);
+}
+
+static void ArenaAllocator_ResetRecyclesChunks(void) {
+  cu_FixedAllocator fa;
+  cu_Allocator fa_alloc = cu_Allocator_FixedAllocator(
+      &fa, cu_Slice_create(backing, sizeof(backing)));
+
+  cu_ArenaAllocator arena;
+  cu_ArenaAllocator_Config cfg = {0};
+  cfg.chunkSize = 128;
+  cfg.backingAllocator = cu_Allocator_Optional_some(fa_alloc);
+  cu_Allocator alloc = cu_Allocator_ArenaAllocator(&arena, cfg);
+
+  /* the first round sizes the arena, later rounds must not touch the backing */
+  size_t backing_used = 0;
+  for (int round = 0; round < 5; ++round) {
+    for (int i = 0; i < 40; ++i) {
+      cu_IoSlice_Result r =
+          cu_Allocator_Alloc(alloc, cu_Layout_create(24 + i, 8));
+      TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&r));
+    }
+    cu_ArenaAllocator_reset(&arena);
+    TEST_ASSERT_NULL(arena.current);
+    if (round == 0) {
+      backing_used = fa.used;
+    }
+    TEST_ASSERT_EQUAL(fa.used, backing_used);
+  }
+
+  cu_ArenaAllocator_destroy(&arena);
+}
+
+static void ArenaAllocator_GeometricGrowth(void) {
+  cu_FixedAllocator fa;
+  cu_Allocator fa_alloc = cu_Allocator_FixedAllocator(
+      &fa, cu_Slice_create(backing, sizeof(backing)));
+
+  cu_ArenaAllocator arena;
+  cu_ArenaAllocator_Config cfg = {0};
+  cfg.chunkSize = 128;
+  cfg.maxChunkSize = 1024;
+  cfg.backingAllocator = cu_Allocator_Optional_some(fa_alloc);
+  cu_Allocator alloc = cu_Allocator_ArenaAllocator(&arena, cfg);
+
+  for (int i = 0; i < 200; ++i) {
+    cu_IoSlice_Result r = cu_Allocator_Alloc(alloc, cu_Layout_create(48, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&r));
+  }
+  size_t chunks = 0;
+  for (struct cu_ArenaAllocator_Chunk *c = arena.current; c; c = c->prev) {
+    TEST_ASSERT_TRUE(c->size <= 1024);
+    chunks++;
+  }
+  /* 200 * 64 bytes need 13 chunks of 1 KiB after 128, 256 and 512 */
+  TEST_ASSERT_TRUE(chunks <= 17);
+  TEST_ASSERT_EQUAL(arena.current->size, 1024);
+
+  cu_ArenaAllocator_destroy(&arena);
+}
+
 static void ArenaAllocator_GrowInPlace(void) {
   cu_FixedAllocator fa;
   cu_Allocator fa_alloc = cu_Allocator_FixedAllocator(
@@ -234,5 +325,8 @@ int main(void) {
   RUN_TEST(ArenaAllocator_GrowInPlace);
   RUN_TEST(ArenaAllocator_ShrinkInPlace);
   RUN_TEST(ArenaAllocator_GrowAllocNewBlock);
+  RUN_TEST(ArenaAllocator_MarkRewind);
+  RUN_TEST(ArenaAllocator_ResetRecyclesChunks);
+  RUN_TEST(ArenaAllocator_GeometricGrowth);
   return UNITY_END();
 }
@@ -20,8 +20,73 @@ static void Bitmap_Basic(void) {
   cu_Bitmap_destroy(&map);
 }
 
+static void Bitmap_FindClear(void) {
+  cu_Allocator alloc = test_allocator;
+  cu_Bitmap_Optional opt = cu_Bitmap_create(alloc, 130);
+  TEST_ASSERT_TRUE(cu_Bitmap_Optional_is_some(&opt));
+  cu_Bitmap map = opt.value;
+
+  for (size_t i = 0; i < 130; ++i) {
+    cu_Bitmap_set(&map, i);
+  }
+  Size_Optional none = cu_Bitmap_find_clear(&map, 0);
+  TEST_ASSERT_TRUE(Size_Optional_is_none(&none));
+
+  cu_Bitmap_clear(&map, 3);
+  cu_Bitmap_clear(&map, 97);
+  Size_Optional first = cu_Bitmap_find_clear(&map, 0);
+  TEST_ASSERT_TRUE(Size_Optional_is_some(&first));
+  TEST_ASSERT_EQUAL(first.value, 3);
+  Size_Optional second = cu_Bitmap_find_clear(&map, 4);
+  TEST_ASSERT_TRUE(Size_Optional_is_some(&second));
+  TEST_ASSERT_EQUAL(second.value, 97);
+  Size_Optional past = cu_Bitmap_find_clear(&map, 98);
+  TEST_ASSERT_TRUE(Size_Optional_is_none(&past));
+
+  cu_Bitmap_destroy(&map);
+}
+
+static void Bitmap_FindClearRun(void) {
+  cu_Allocator alloc = test_allocator;
+  cu_Bitmap_Optional opt = cu_Bitmap_create(alloc, 200);
+  TEST_ASSERT_TRUE(cu_Bitmap_Optional_is_some(&opt));
+  cu_Bitmap map = opt.value;
+
+  cu_Bitmap_set_range(&map, 0, 200);
+  TEST_ASSERT_TRUE(cu_Bitmap_get(&map, 0));
+  TEST_ASSERT_TRUE(cu_Bitmap_get(&map, 199));
+
+  cu_Bitmap_clear_range(&map, 10, 5);
+  cu_Bitmap_clear_range(&map, 60, 70);
+  TEST_ASSERT_FALSE(cu_Bitmap_get(&map, 64));
+  TEST_ASSERT_TRUE(cu_Bitmap_get(&map, 130));
+
+  Size_Optional small = cu_Bitmap_find_clear_run(&map, 0, 5);
+  TEST_ASSERT_TRUE(Size_Optional_is_some(&small));
+  TEST_ASSERT_EQUAL(small.value, 10);
+  Size_Optional wide = cu_Bitmap_find_clear_run(&map, 0, 6);
+  TEST_ASSERT_TRUE(Size_Optional_is_some(&wide));
+  TEST_ASSERT_EQUAL(wide.value, 60);
+  Size_Optional offset = cu_Bitmap_find_clear_run(&map, 100, 20);
+  TEST_ASSERT_TRUE(Size_Optional_is_some(&offset));
+  TEST_ASSERT_EQUAL(offset.value, 100);
+  Size_Optional none = cu_Bitmap_find_clear_run(&map, 0, 71);
+  TEST_ASSERT_TRUE(Size_Optional_is_none(&none));
+
+  Size_Optional end = cu_Bitmap_find_set(&map, 60);
+  TEST_ASSERT_TRUE(Size_Optional_is_some(&end));
+  TEST_ASSERT_EQUAL(end.value, 130);
+  cu_Bitmap_clear_range(&map, 130, 70);
+  end = cu_Bitmap_find_set(&map, 60);
+  TEST_ASSERT_TRUE(Size_Optional_is_none(&end));
+
+  cu_Bitmap_destroy(&map);
+}
+
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(Bitmap_Basic);
+  RUN_TEST(Bitmap_FindClear);
+  RUN_TEST(Bitmap_FindClearRun);
   return UNITY_END();
 }
@@ -0,0 +1,198 @@
+#include "collection/concurrent_hashmap.h"
+#include "memory/allocator.h"
+#include "test_common.h"
+#include "unity.h"
+#include <unity_internals.h>
+
+#if CU_FREESTANDING || defined(__STDC_NO_ATOMICS__)
+static void ConcurrentHashMap_Unsupported(void) {}
+#else
+#if CU_PLAT_POSIX
+#include <pthread.h>
+#endif
+
+typedef struct {
+  uint64_t a;
+  uint64_t b; /* always ~a, so torn copies are detectable */
+} Pair;
+
+static cu_ConcurrentHashMap make_map(Size_Optional shards) {
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 7);
+  cu_ConcurrentHashMap_Result res =
+      cu_ConcurrentHashMap_create(cu_Allocator_CAllocator(),
+          CU_LAYOUT(uint64_t), CU_LAYOUT(Pair), shards,
+          cu_HashMap_HashFn_Optional_none(),
+          cu_HashMap_EqualsFn_Optional_none(), st);
+  TEST_ASSERT_TRUE(cu_ConcurrentHashMap_Result_is_ok(&res));
+  return cu_ConcurrentHashMap_Result_unwrap(&res);
+}
+
+static void ConcurrentHashMap_Basic(void) {
+  cu_ConcurrentHashMap map = make_map(Size_Optional_some(3));
+  TEST_ASSERT_EQUAL_size_t(4, map.shard_count);
+
+  for (uint64_t i = 0; i < 2000; ++i) {
+    Pair p = {i, ~i};
+    cu_HashMap_Error_Optional err = cu_ConcurrentHashMap_insert(&map, &i, &p);
+    TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  }
+  for (uint64_t i = 0; i < 2000; ++i) {
+    Pair p;
+    TEST_ASSERT_TRUE(cu_ConcurrentHashMap_get(&map, &i, &p));
+    TEST_ASSERT_EQUAL_HEX64(i, p.a);
+  }
+  uint64_t key = 10;
+  Pair old;
+  cu_HashMap_Error_Optional err = cu_ConcurrentHashMap_remove(&map, &key, &old);
+  TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  TEST_ASSERT_EQUAL_HEX64(~(uint64_t)10, old.b);
+  TEST_ASSERT_FALSE(cu_ConcurrentHashMap_get(&map, &key, &old));
+  err = cu_ConcurrentHashMap_remove(&map, &key, NULL);
+  TEST_ASSERT_EQUAL(
+      CU_HASHMAP_ERROR_NOT_FOUND, cu_HashMap_Error_Optional_unwrap(&err));
+
+  /* growth retired tables, none is visible after reclaiming */
+  size_t retired = 0;
+  for (size_t i = 0; i < map.shard_count; ++i) {
+    retired += map.shards[i].retired != NULL;
+  }
+  TEST_ASSERT_GREATER_THAN(0, retired);
+  cu_ConcurrentHashMap_reclaim(&map);
+  for (size_t i = 0; i < map.shard_count; ++i) {
+    TEST_ASSERT_NULL(map.shards[i].retired);
+  }
+  TEST_ASSERT_TRUE(cu_ConcurrentHashMap_get(&map, &(uint64_t){11}, &old));
+
+  cu_ConcurrentHashMap_destroy(&map);
+}
+
+static void fill_pair(const void *key, void *value, void *ctx) {
+  uint64_t k = *(const uint64_t *)key;
+  Pair p = {k, ~k};
+  *(Pair *)value = p;
+  if (ctx) {
+    atomic_fetch_add_explicit(
+        (_Atomic(size_t) *)ctx, 1, memory_order_relaxed);
+  }
+}
+
+static void ConcurrentHashMap_ComputeIfAbsent(void) {
+  cu_ConcurrentHashMap map = make_map(Size_Optional_none());
+  _Atomic(size_t) calls;
+  atomic_init(&calls, 0);
+
+  uint64_t key = 5;
+  Pair out;
+  cu_HashMap_Error_Optional err = cu_ConcurrentHashMap_compute_if_absent(
+      &map, &key, fill_pair, &calls, &out);
+  TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  TEST_ASSERT_EQUAL_HEX64(5, out.a);
+  err = cu_ConcurrentHashMap_compute_if_absent(
+      &map, &key, fill_pair, &calls, NULL);
+  TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  key = 6;
+  err = cu_ConcurrentHashMap_compute_if_absent(
+      &map, &key, fill_pair, &calls, NULL);
+  TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  TEST_ASSERT_TRUE(cu_ConcurrentHashMap_get(&map, &key, &out));
+  TEST_ASSERT_EQUAL_HEX64(~(uint64_t)6, out.b);
+  TEST_ASSERT_EQUAL_size_t(2, atomic_load(&calls));
+
+  cu_ConcurrentHashMap_destroy(&map);
+}
+
+#if CU_PLAT_POSIX
+#define MAP_WRITERS 2
+#define MAP_READERS 4
+#define MAP_KEYS 20000
+
+struct map_worker {
+  cu_ConcurrentHashMap *map;
+  _Atomic(size_t) *calls;
+  _Atomic(int) *writers_left;
+  uint64_t first;
+  bool ok;
+};
+
+static void *map_writer_run(void *arg) {
+  struct map_worker *w = (struct map_worker *)arg;
+  for (uint64_t i = w->first; i < MAP_KEYS; i += MAP_WRITERS) {
+    Pair p = {i, ~i};
+    cu_HashMap_Error_Optional err = cu_ConcurrentHashMap_insert(w->map, &i, &p);
+    w->ok = w->ok && cu_HashMap_Error_Optional_is_none(&err);
+    if (i % 3 == 0) {
+      cu_ConcurrentHashMap_remove(w->map, &i, NULL);
+    }
+  }
+  atomic_fetch_sub(w->writers_left, 1);
+  return NULL;
+}
+
+static void *map_reader_run(void *arg) {
+  struct map_worker *w = (struct map_worker *)arg;
+  uint64_t x = w->first * 0x9E3779B97F4A7C15ULL + 1;
+  while (atomic_load(w->writers_left) > 0) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    uint64_t key = x % MAP_KEYS;
+    Pair p;
+    if (cu_ConcurrentHashMap_get(w->map, &key, &p)) {
+      w->ok = w->ok && p.a == key && p.b == ~key;
+    }
+    Pair q;
+    cu_HashMap_Error_Optional err = cu_ConcurrentHashMap_compute_if_absent(
+        w->map, &(uint64_t){MAP_KEYS + key % 64}, fill_pair, w->calls, &q);
+    w->ok = w->ok && cu_HashMap_Error_Optional_is_none(&err) && q.b == ~q.a;
+  }
+  return NULL;
+}
+
+static void ConcurrentHashMap_ReadersAndWriters(void) {
+  cu_ConcurrentHashMap map = make_map(Size_Optional_some(8));
+  _Atomic(size_t) calls;
+  atomic_init(&calls, 0);
+  _Atomic(int) writers_left;
+  atomic_init(&writers_left, MAP_WRITERS);
+
+  struct map_worker workers[MAP_WRITERS + MAP_READERS];
+  pthread_t threads[MAP_WRITERS + MAP_READERS];
+  for (size_t i = 0; i < MAP_WRITERS + MAP_READERS; ++i) {
+    workers[i].map = &map;
+    workers[i].calls = &calls;
+    workers[i].writers_left = &writers_left;
+    workers[i].first = i < MAP_WRITERS ? i : i + 1;
+    workers[i].ok = true;
+    pthread_create(&threads[i], NULL,
+        i < MAP_WRITERS ? map_writer_run : map_reader_run, &workers[i]);
+  }
+  for (size_t i = 0; i < MAP_WRITERS + MAP_READERS; ++i) {
+    pthread_join(threads[i], NULL);
+    TEST_ASSERT_TRUE(workers[i].ok);
+  }
+  /* every computed key was computed exactly once */
+  TEST_ASSERT_LESS_OR_EQUAL(64, atomic_load(&calls));
+  for (uint64_t i = 0; i < MAP_KEYS; ++i) {
+    Pair p;
+    TEST_ASSERT_EQUAL(i % 3 != 0, cu_ConcurrentHashMap_get(&map, &i, &p));
+  }
+
+  cu_ConcurrentHashMap_destroy(&map);
+}
+#endif
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+#if CU_FREESTANDING || defined(__STDC_NO_ATOMICS__)
+  RUN_TEST(ConcurrentHashMap_Unsupported);
+#else
+  RUN_TEST(ConcurrentHashMap_Basic);
+  RUN_TEST(ConcurrentHashMap_ComputeIfAbsent);
+#if CU_PLAT_POSIX
+  RUN_TEST(ConcurrentHashMap_ReadersAndWriters);
+#endif
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,146 @@
+#if CU_FREESTANDING
+#include "unity.h"
+#include <unity_internals.h>
+static void Deque_Unsupported(void) {}
+#else
+#include "collection/deque.h"
+#include "memory/allocator.h"
+#include "test_common.h"
+#include "unity.h"
+#include <unity_internals.h>
+
+static cu_Deque make_deque(cu_Layout layout, cu_Destructor_Optional dtor) {
+  cu_Deque_Result res = cu_Deque_create(test_allocator, layout, dtor);
+  TEST_ASSERT_TRUE(cu_Deque_Result_is_ok(&res));
+  return cu_Deque_Result_unwrap(&res);
+}
+
+static void Deque_BothEnds(void) {
+  cu_Deque dq = make_deque(CU_LAYOUT(int), cu_Destructor_Optional_none());
+  /* enough elements to cross several blocks in both directions */
+  for (int i = 0; i < 5000; ++i) {
+    int back = i;
+    int front = -1 - i;
+    cu_Deque_Error_Optional err = cu_Deque_push_back(&dq, &back);
+    TEST_ASSERT_TRUE(cu_Deque_Error_Optional_is_none(&err));
+    err = cu_Deque_push_front(&dq, &front);
+    TEST_ASSERT_TRUE(cu_Deque_Error_Optional_is_none(&err));
+  }
+  TEST_ASSERT_EQUAL_size_t(10000, cu_Deque_size(&dq));
+  for (int i = 0; i < 10000; ++i) {
+    Ptr_Optional opt = cu_Deque_at(&dq, (size_t)i);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+    TEST_ASSERT_EQUAL(i - 5000, *(int *)Ptr_Optional_unwrap(&opt));
+  }
+  Ptr_Optional past = cu_Deque_at(&dq, 10000);
+  TEST_ASSERT_TRUE(Ptr_Optional_is_none(&past));
+
+  for (int i = 0; i < 5000; ++i) {
+    int out = 0;
+    cu_Deque_Error_Optional err = cu_Deque_pop_front(&dq, &out);
+    TEST_ASSERT_TRUE(cu_Deque_Error_Optional_is_none(&err));
+    TEST_ASSERT_EQUAL(i - 5000, out);
+    err = cu_Deque_pop_back(&dq, &out);
+    TEST_ASSERT_TRUE(cu_Deque_Error_Optional_is_none(&err));
+    TEST_ASSERT_EQUAL(4999 - i, out);
+  }
+  TEST_ASSERT_TRUE(cu_Deque_is_empty(&dq));
+  cu_Deque_Error_Optional err = cu_Deque_pop_front(&dq, NULL);
+  TEST_ASSERT_TRUE(cu_Deque_Error_Optional_is_some(&err));
+  TEST_ASSERT_EQUAL(CU_DEQUE_ERROR_EMPTY, cu_Deque_Error_Optional_unwrap(&err));
+  cu_Deque_destroy(&dq);
+}
+
+static void Deque_SlidingWindow(void) {
+  cu_Deque dq = make_deque(CU_LAYOUT(size_t), cu_Destructor_Optional_none());
+  /* the window keeps moving through fresh blocks while staying small */
+  for (size_t i = 0; i < 100000; ++i) {
+    cu_Deque_push_back(&dq, &i);
+    if (cu_Deque_size(&dq) > 100) {
+      size_t out = 0;
+      cu_Deque_pop_front(&dq, &out);
+      TEST_ASSERT_EQUAL_size_t(i - 100, out);
+    }
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(8, dq.map_capacity);
+
+  size_t index = 0;
+  void *elem;
+  size_t expected = 100000 - 100;
+  while (cu_Deque_iter(&dq, &index, &elem)) {
+    TEST_ASSERT_EQUAL_size_t(expected++, *(size_t *)elem);
+  }
+  TEST_ASSERT_EQUAL_size_t(100000, expected);
+  cu_Deque_destroy(&dq);
+}
+
+typedef struct {
+  char bytes[1000];
+} big;
+
+static void Deque_AppendLargeElements(void) {
+  cu_Deque dq = make_deque(CU_LAYOUT(big), cu_Destructor_Optional_none());
+  /* blocks hold at least CU_DEQUE_MIN_BLOCK_LENGTH large elements */
+  TEST_ASSERT_EQUAL_size_t(
+      CU_DEQUE_MIN_BLOCK_LENGTH, (size_t)1 << dq.block_shift);
+
+  static big items[50];
+  for (int i = 0; i < 50; ++i) {
+    cu_Memory_memset(items[i].bytes, i, sizeof(items[i].bytes));
+  }
+  big first;
+  cu_Memory_memset(first.bytes, 0x7F, sizeof(first.bytes));
+  cu_Deque_push_front(&dq, &first);
+  cu_Deque_Error_Optional err = cu_Deque_append(&dq, items, 50);
+  TEST_ASSERT_TRUE(cu_Deque_Error_Optional_is_none(&err));
+  TEST_ASSERT_EQUAL_size_t(51, cu_Deque_size(&dq));
+
+  for (int i = 0; i < 51; ++i) {
+    Ptr_Optional opt = cu_Deque_at(&dq, (size_t)i);
+    const big *b = (const big *)Ptr_Optional_unwrap(&opt);
+    TEST_ASSERT_EQUAL_UINT8(i == 0 ? 0x7F : i - 1, (uint8_t)b->bytes[999]);
+  }
+  cu_Deque_destroy(&dq);
+}
+
+static int drop_count; // NOLINT
+static void dtor(void *ptr) { // NOLINT
+  (void)ptr;
+  drop_count++;
+}
+
+static void Deque_Destructor(void) {
+  cu_Deque dq = make_deque(CU_LAYOUT(int), cu_Destructor_Optional_some(dtor));
+  int values[3000];
+  for (int i = 0; i < 3000; ++i) {
+    values[i] = i;
+  }
+  cu_Deque_append(&dq, values, 3000);
+  drop_count = 0;
+  int out;
+  cu_Deque_pop_back(&dq, &out);
+  cu_Deque_pop_front(&dq, NULL);
+  TEST_ASSERT_EQUAL(2, drop_count);
+  cu_Deque_clear(&dq);
+  TEST_ASSERT_EQUAL(3000, drop_count);
+  TEST_ASSERT_TRUE(cu_Deque_is_empty(&dq));
+
+  /* a cleared deque is reusable */
+  cu_Deque_append(&dq, values, 10);
+  cu_Deque_destroy(&dq);
+  TEST_ASSERT_EQUAL(3010, drop_count);
+}
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+#if CU_FREESTANDING
+  RUN_TEST(Deque_Unsupported);
+#else
+  RUN_TEST(Deque_BothEnds);
+  RUN_TEST(Deque_SlidingWindow);
+  RUN_TEST(Deque_AppendLargeElements);
+  RUN_TEST(Deque_Destructor);
+#endif
+  return UNITY_END();
+}
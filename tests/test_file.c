@@ -183,6 +183,34 @@ static void File_Tell(void) {
   cu_File_close(&file);
 }
 
+static void File_Map(void) {
+  cu_File_Options opt = {0};
+  cu_File_Options_read(&opt);
+  cu_File_Options_write(&opt);
+  cu_File_Options_create(&opt);
+  cu_File_Options_truncate(&opt);
+
+  cu_File_Result fres = cu_File_open(
+      CU_SLICE_CSTR("map.txt"), opt, cu_Allocator_CAllocator());
+  TEST_ASSERT_TRUE(cu_File_Result_is_ok(&fres));
+  cu_File file = cu_File_Result_unwrap(&fres);
+
+  /* empty files have nothing to map */
+  cu_IoSlice_Result mres = cu_File_map(&file);
+  TEST_ASSERT_FALSE(cu_IoSlice_Result_is_ok(&mres));
+
+  const char data[] = "mapped";
+  cu_Io_Error_Optional err = cu_File_write(&file, CU_SLICE_CSTR(data));
+  TEST_ASSERT_TRUE(cu_Io_Error_Optional_is_none(&err));
+  mres = cu_File_map(&file);
+  cu_File_close(&file);
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&mres));
+  cu_Slice map = cu_IoSlice_Result_unwrap(&mres);
+  TEST_ASSERT_EQUAL_size_t(sizeof(data) - 1, map.length);
+  TEST_ASSERT_EQUAL_MEMORY(data, map.ptr, sizeof(data) - 1);
+  cu_File_unmap(map);
+}
+
 static void File_InvalidOptions(void) {
   cu_File_Options options = {0};
   const char lpath[] = "invalid.txt";
@@ -198,6 +226,7 @@ int main(void) {
   RUN_TEST(File_OpenAt);
   RUN_TEST(File_OpenAt_Tmp);
   RUN_TEST(File_Tell);
+  RUN_TEST(File_Map);
   RUN_TEST(File_InvalidOptions);
   return UNITY_END();
 }
@@ -0,0 +1,118 @@
+#if CU_FREESTANDING
+#include "unity.h"
+#include <unity_internals.h>
+static void FrozenMap_Unsupported(void) {}
+#else
+#include "collection/frozenmap.h"
+#include "memory/allocator.h"
+#include "test_common.h"
+#include "unity.h"
+#include <unity_internals.h>
+
+static void FrozenMap_FromHashMap(void) {
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 1);
+  cu_HashMap_Result res = cu_HashMap_create(test_allocator, CU_LAYOUT(int),
+      CU_LAYOUT(int), Size_Optional_none(), cu_HashMap_HashFn_Optional_none(),
+      cu_HashMap_EqualsFn_Optional_none(), st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+  for (int i = 0; i < 5000; ++i) {
+    int v = i * 3;
+    cu_HashMap_insert(&map, &i, &v);
+  }
+
+  cu_FrozenMap_Result fres = cu_FrozenMap_build(test_allocator, &map, st);
+  TEST_ASSERT_TRUE(cu_FrozenMap_Result_is_ok(&fres));
+  cu_FrozenMap frozen = cu_FrozenMap_Result_unwrap(&fres);
+  cu_HashMap_destroy(&map);
+  TEST_ASSERT_EQUAL_size_t(5000, frozen.length);
+
+  for (int i = 0; i < 5000; ++i) {
+    Ptr_Optional opt = cu_FrozenMap_get(&frozen, &i);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+    TEST_ASSERT_EQUAL(i * 3, *(int *)Ptr_Optional_unwrap(&opt));
+  }
+  for (int i = 5000; i < 6000; ++i) {
+    Ptr_Optional opt = cu_FrozenMap_get(&frozen, &i);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_none(&opt));
+  }
+  cu_FrozenMap_destroy(&frozen);
+}
+
+static void FrozenMap_BlobRoundTrip(void) {
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 7);
+  uint64_t keys[300];
+  uint16_t values[300];
+  for (int i = 0; i < 300; ++i) {
+    keys[i] = (uint64_t)i * 0x100000001ULL;
+    values[i] = (uint16_t)(i + 1);
+  }
+  cu_FrozenMap_Result fres = cu_FrozenMap_build_arrays(test_allocator,
+      CU_LAYOUT(uint64_t), CU_LAYOUT(uint16_t), keys, values, 300, st);
+  TEST_ASSERT_TRUE(cu_FrozenMap_Result_is_ok(&fres));
+  cu_FrozenMap frozen = cu_FrozenMap_Result_unwrap(&fres);
+
+  /* stands in for writing the blob to a file and mapping it back */
+  cu_Slice bytes = cu_FrozenMap_bytes(&frozen);
+  size_t size = bytes.length;
+  cu_IoSlice_Result copy = cu_Allocator_Alloc(
+      test_allocator, cu_Layout_create(bytes.length, CU_FROZENMAP_ALIGN));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&copy));
+  cu_Memory_memcpy(copy.value.ptr, bytes);
+  cu_FrozenMap_destroy(&frozen);
+
+  cu_FrozenMap_Result vres = cu_FrozenMap_from_bytes(copy.value);
+  TEST_ASSERT_TRUE(cu_FrozenMap_Result_is_ok(&vres));
+  cu_FrozenMap view = cu_FrozenMap_Result_unwrap(&vres);
+  for (int i = 0; i < 300; ++i) {
+    Ptr_Optional opt = cu_FrozenMap_get(&view, &keys[i]);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+    TEST_ASSERT_EQUAL(i + 1, *(uint16_t *)Ptr_Optional_unwrap(&opt));
+  }
+  /* views do not own their blob */
+  cu_FrozenMap_destroy(&view);
+
+  /* truncated and corrupted blobs are rejected */
+  vres = cu_FrozenMap_from_bytes(
+      cu_Slice_create(copy.value.ptr, size - 16));
+  TEST_ASSERT_FALSE(cu_FrozenMap_Result_is_ok(&vres));
+  ((unsigned char *)copy.value.ptr)[0] ^= 0xFF;
+  vres = cu_FrozenMap_from_bytes(copy.value);
+  TEST_ASSERT_FALSE(cu_FrozenMap_Result_is_ok(&vres));
+  cu_Allocator_Free(test_allocator, copy.value);
+}
+
+static void FrozenMap_DuplicatesAndEmpty(void) {
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 3);
+  int keys[] = {1, 2, 3, 2};
+  int values[] = {10, 20, 30, 40};
+  cu_FrozenMap_Result fres = cu_FrozenMap_build_arrays(test_allocator,
+      CU_LAYOUT(int), CU_LAYOUT(int), keys, values, 4, st);
+  TEST_ASSERT_FALSE(cu_FrozenMap_Result_is_ok(&fres));
+  TEST_ASSERT_EQUAL(
+      CU_HASHMAP_ERROR_INVALID, cu_FrozenMap_Result_unwrap_error(&fres));
+
+  fres = cu_FrozenMap_build_arrays(test_allocator, CU_LAYOUT(int),
+      CU_LAYOUT(int), keys, values, 0, st);
+  TEST_ASSERT_TRUE(cu_FrozenMap_Result_is_ok(&fres));
+  cu_FrozenMap empty = cu_FrozenMap_Result_unwrap(&fres);
+  Ptr_Optional opt = cu_FrozenMap_get(&empty, &keys[0]);
+  TEST_ASSERT_TRUE(Ptr_Optional_is_none(&opt));
+  cu_FrozenMap_destroy(&empty);
+}
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+#if CU_FREESTANDING
+  RUN_TEST(FrozenMap_Unsupported);
+#else
+  RUN_TEST(FrozenMap_FromHashMap);
+  RUN_TEST(FrozenMap_BlobRoundTrip);
+  RUN_TEST(FrozenMap_DuplicatesAndEmpty);
+#endif
+  return UNITY_END();
+}
@@ -2,6 +2,7 @@
 #include "memory/allocator.h"
 #include "memory/fixedallocator.h"
 #include "memory/gpallocator.h"
+#include "memory/statsallocator.h"
 #include "unity.h"
 #include "utility.h"
 #include <stdlib.h>
@@ -146,6 +147,329 @@ static void Allocator_Exhaustion(void) {
   TEST_ASSERT_EQUAL(cu_IoSlice_Result_unwrap_error(&res).kind,
       CU_IO_ERROR_KIND_OUT_OF_MEMORY);
 }
+static void Allocator_FreeOrderIndependent(void) {
+  cu_FixedAllocator fa;
+  cu_Allocator fa_alloc = cu_Allocator_FixedAllocator(
+      &fa, cu_Slice_create(backing, sizeof(backing)));
+
+  cu_GPAllocator gpa;
+  cu_GPAllocator_Config cfg = {0};
+  cfg.backingAllocator = cu_Allocator_Optional_some(fa_alloc);
+  cu_Allocator alloc = cu_Allocator_GPAllocator(&gpa, cfg);
+
+  const size_t count = 20000;
+  cu_Slice *blocks = malloc(sizeof(cu_Slice) * count);
+  for (size_t i = 0; i < count; ++i) {
+    size_t size = 8 + (i % 7) * 24;
+    if (i % 97 == 0) {
+      size = 64 * 1024;
+    }
+    cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(size, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    blocks[i] = res.value;
+    cu_Memory_memset(blocks[i].ptr, (int)(i & 0xff), blocks[i].length);
+  }
+
+  srand(42);
+  for (size_t i = count - 1; i > 0; --i) {
+    size_t j = (size_t)rand() % (i + 1);
+    cu_Slice tmp = blocks[i];
+    blocks[i] = blocks[j];
+    blocks[j] = tmp;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    cu_Allocator_Free(alloc, blocks[i]);
+  }
+  for (size_t i = 0; i < CU_GPA_NUM_SMALL_BUCKETS; ++i) {
+    struct cu_GPAllocator_BucketHeader *b = gpa.smallBuckets[i];
+    if (b) {
+      TEST_ASSERT_EQUAL(b->objects.usedCount, 0);
+      TEST_ASSERT_NULL(b->next);
+    }
+  }
+  TEST_ASSERT_EQUAL(gpa.largeAllocs.length, 0);
+  free(blocks);
+
+  cu_GPAllocator_destroy(&gpa);
+}
+
+static void Allocator_LargeGrowKeepsTracking(void) {
+  cu_FixedAllocator fa;
+  cu_Allocator fa_alloc = cu_Allocator_FixedAllocator(
+      &fa, cu_Slice_create(backing, sizeof(backing)));
+
+  cu_GPAllocator gpa;
+  cu_GPAllocator_Config cfg = {0};
+  cfg.backingAllocator = cu_Allocator_Optional_some(fa_alloc);
+  cu_Allocator alloc = cu_Allocator_GPAllocator(&gpa, cfg);
+
+  cu_IoSlice_Result a = cu_Allocator_Alloc(alloc, cu_Layout_create(8192, 16));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&a));
+  cu_IoSlice_Result b = cu_Allocator_Alloc(alloc, cu_Layout_create(8192, 16));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&b));
+  cu_Memory_memset(a.value.ptr, 0x5A, a.value.length);
+
+  cu_IoSlice_Result grown =
+      cu_Allocator_Grow(alloc, a.value, cu_Layout_create(32768, 16));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&grown));
+  TEST_ASSERT_EQUAL(((unsigned char *)grown.value.ptr)[8191], 0x5A);
+  TEST_ASSERT_EQUAL(gpa.largeAllocs.length, 2);
+
+  cu_Allocator_Free(alloc, grown.value);
+  cu_Allocator_Free(alloc, b.value);
+  TEST_ASSERT_EQUAL(gpa.largeAllocs.length, 0);
+
+  cu_GPAllocator_destroy(&gpa);
+}
+
+static void Allocator_ReusesOlderBucketSlots(void) {
+  cu_FixedAllocator fa;
+  cu_Allocator fa_alloc = cu_Allocator_FixedAllocator(
+      &fa, cu_Slice_create(backing, sizeof(backing)));
+
+  cu_GPAllocator gpa;
+  cu_GPAllocator_Config cfg = {0};
+  cfg.backingAllocator = cu_Allocator_Optional_some(fa_alloc);
+  cu_Allocator alloc = cu_Allocator_GPAllocator(&gpa, cfg);
+
+  cu_IoSlice_Result first = cu_Allocator_Alloc(alloc, cu_Layout_create(64, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&first));
+  size_t slots = gpa.smallBuckets[6]->objects.slotCount;
+
+  cu_Slice *blocks = malloc(sizeof(cu_Slice) * slots * 2);
+  blocks[0] = first.value;
+  for (size_t i = 1; i < slots * 2; ++i) {
+    cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(64, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    blocks[i] = res.value;
+  }
+  TEST_ASSERT_NULL(gpa.smallBuckets[6]);
+
+  void *hole = blocks[slots / 2].ptr;
+  cu_Allocator_Free(alloc, blocks[slots / 2]);
+  TEST_ASSERT_NOT_NULL(gpa.smallBuckets[6]);
+
+  cu_IoSlice_Result again = cu_Allocator_Alloc(alloc, cu_Layout_create(64, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&again));
+  TEST_ASSERT_EQUAL(again.value.ptr, hole);
+  blocks[slots / 2] = again.value;
+
+  for (size_t i = 0; i < slots * 2; ++i) {
+    cu_Allocator_Free(alloc, blocks[i]);
+  }
+  free(blocks);
+  cu_GPAllocator_destroy(&gpa);
+}
+
+static void Allocator_BatchAllocFree(void) {
+  cu_FixedAllocator fa;
+  cu_Allocator fa_alloc = cu_Allocator_FixedAllocator(
+      &fa, cu_Slice_create(backing, sizeof(backing)));
+
+  cu_GPAllocator gpa;
+  cu_GPAllocator_Config cfg = {0};
+  cfg.backingAllocator = cu_Allocator_Optional_some(fa_alloc);
+  cfg.retainBuckets = Size_Optional_some(0);
+  cu_Allocator alloc = cu_Allocator_GPAllocator(&gpa, cfg);
+
+  cu_IoSlice_Result first = cu_Allocator_Alloc(alloc, cu_Layout_create(64, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&first));
+  size_t count = gpa.smallBuckets[6]->objects.slotCount * 3;
+  cu_Allocator_Free(alloc, first.value);
+
+  /* spans several buckets */
+  cu_Slice *blocks = malloc(sizeof(cu_Slice) * count);
+  cu_Io_Error_Optional err =
+      cu_Allocator_AllocBatch(alloc, cu_Layout_create(64, 8), blocks, count);
+  TEST_ASSERT_FALSE(cu_Io_Error_Optional_is_some(&err));
+  for (size_t i = 0; i < count; ++i) {
+    TEST_ASSERT_EQUAL(64, blocks[i].length);
+    cu_Memory_memset(blocks[i].ptr, (int)i, blocks[i].length);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    unsigned char *p = (unsigned char *)blocks[i].ptr;
+    TEST_ASSERT_EQUAL_UINT8((unsigned char)i, p[63]);
+  }
+  TEST_ASSERT_EQUAL(3, gpa.spans.length);
+
+  cu_Allocator_FreeBatch(alloc, blocks, count);
+  TEST_ASSERT_EQUAL(0, gpa.spans.length);
+
+  cu_Slice big[4];
+  err = cu_Allocator_AllocBatch(
+      alloc, cu_Layout_create(1024 * 1024, 16), big, 4);
+  TEST_ASSERT_FALSE(cu_Io_Error_Optional_is_some(&err));
+  TEST_ASSERT_EQUAL(4, gpa.largeAllocs.length);
+  cu_Allocator_FreeBatch(alloc, big, 4);
+  TEST_ASSERT_EQUAL(0, gpa.largeAllocs.length);
+
+  free(blocks);
+  cu_GPAllocator_destroy(&gpa);
+}
+
+static void Allocator_RetainsEmptyBuckets(void) {
+  cu_GPAllocator gpa;
+  cu_GPAllocator_Config cfg = {0};
+  cfg.decayTicks = Size_Optional_some(64);
+  cu_Allocator alloc = cu_Allocator_GPAllocator(&gpa, cfg);
+
+  cu_IoSlice_Result first = cu_Allocator_Alloc(alloc, cu_Layout_create(64, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&first));
+  size_t slots = gpa.smallBuckets[6]->objects.slotCount;
+  cu_Allocator_Free(alloc, first.value);
+  TEST_ASSERT_EQUAL(1, gpa.spans.length);
+  TEST_ASSERT_EQUAL(1, gpa.emptyCount[6]);
+  TEST_ASSERT_NULL(gpa.smallBuckets[6]);
+
+  /* oscillating across a bucket boundary reuses the retained buckets */
+  cu_Slice *blocks = malloc(sizeof(cu_Slice) * (slots + 1));
+  for (size_t round = 0; round < 4; ++round) {
+    for (size_t i = 0; i <= slots; ++i) {
+      cu_IoSlice_Result res =
+          cu_Allocator_Alloc(alloc, cu_Layout_create(64, 8));
+      TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+      blocks[i] = res.value;
+    }
+    TEST_ASSERT_EQUAL(2, gpa.spans.length);
+    for (size_t i = 0; i <= slots; ++i) {
+      cu_Allocator_Free(alloc, blocks[i]);
+    }
+    TEST_ASSERT_EQUAL(2, gpa.spans.length);
+    TEST_ASSERT_EQUAL(2, gpa.emptyCount[6]);
+  }
+
+  /* an idle bucket is purged, then released once it decays again */
+  for (size_t round = 0; round < 2; ++round) {
+    for (size_t i = 0; i < 128; ++i) {
+      cu_IoSlice_Result res =
+          cu_Allocator_Alloc(alloc, cu_Layout_create(8, 8));
+      TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+      cu_Allocator_Free(alloc, res.value);
+    }
+    cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(64, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    cu_Allocator_Free(alloc, res.value);
+  }
+  TEST_ASSERT_EQUAL(1, gpa.emptyCount[6]);
+
+  cu_GPAllocator_purge(&gpa);
+  cu_GPAllocator_purge(&gpa);
+  for (int i = 0; i < CU_GPA_NUM_SMALL_BUCKETS; ++i) {
+    TEST_ASSERT_EQUAL(0, gpa.emptyCount[i]);
+  }
+  TEST_ASSERT_EQUAL(0, gpa.spans.length);
+
+  free(blocks);
+  cu_GPAllocator_destroy(&gpa);
+}
+
+static void Allocator_SpanFootprint(void) {
+  cu_GPAllocator gpa;
+  cu_GPAllocator_Config cfg = {0};
+  cu_Allocator alloc = cu_Allocator_GPAllocator(&gpa, cfg);
+  TEST_ASSERT_EQUAL(CU_GPA_BUCKET_SIZE, gpa.spanSize);
+
+  /* the header is kept off the span, the slots fill all of it */
+  cu_IoSlice_Result small = cu_Allocator_Alloc(alloc, cu_Layout_create(64, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&small));
+  struct cu_GPAllocator_BucketHeader *bucket = gpa.smallBuckets[6];
+  uintptr_t base = (uintptr_t)bucket->objects.data;
+  TEST_ASSERT_TRUE((uintptr_t)bucket < base ||
+                   (uintptr_t)bucket >= base + CU_GPA_BUCKET_SIZE);
+  TEST_ASSERT_EQUAL(CU_GPA_BUCKET_SIZE,
+      bucket->objects.slotCount * bucket->objects.objectSize);
+
+  /* a whole bucket is still a small object */
+  cu_IoSlice_Result page = cu_Allocator_Alloc(
+      alloc, cu_Layout_create(CU_GPA_BUCKET_SIZE, 16));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&page));
+  TEST_ASSERT_EQUAL(2, gpa.spans.length);
+  TEST_ASSERT_EQUAL(0, gpa.largeAllocs.length);
+
+  cu_Allocator_Free(alloc, page.value);
+  cu_Allocator_Free(alloc, small.value);
+  cu_GPAllocator_destroy(&gpa);
+}
+
+static void Allocator_PurgesRetainedPages(void) {
+  cu_GPAllocator gpa;
+  cu_GPAllocator_Config cfg = {0};
+  cu_Allocator alloc = cu_Allocator_GPAllocator(&gpa, cfg);
+
+  cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(64, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+  cu_Memory_memset(res.value.ptr, 0xab, 64);
+  void *first = res.value.ptr;
+  cu_Allocator_Free(alloc, res.value);
+  TEST_ASSERT_EQUAL(1, gpa.emptyCount[6]);
+
+  /* the first decay step returns the retained span to the system */
+  cu_GPAllocator_purge(&gpa);
+  TEST_ASSERT_EQUAL(1, gpa.emptyCount[6]);
+  res = cu_Allocator_Alloc(alloc, cu_Layout_create(64, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+  TEST_ASSERT_EQUAL_PTR(first, res.value.ptr);
+#if CU_PLAT_LINUX && !CU_FREESTANDING
+  TEST_ASSERT_TRUE(gpa.purgedPages > 0);
+  TEST_ASSERT_EQUAL(0, ((unsigned char *)res.value.ptr)[0]);
+#endif
+  cu_Allocator_Free(alloc, res.value);
+  cu_GPAllocator_destroy(&gpa);
+}
+
+static void Allocator_SpansShareRegions(void) {
+  cu_StatsAllocator stats;
+  cu_StatsAllocator_Config scfg = {0};
+  scfg.backingAllocator = cu_Allocator_Optional_some(cu_Allocator_CAllocator());
+  cu_Allocator backing = cu_Allocator_StatsAllocator(&stats, scfg);
+
+  cu_GPAllocator gpa;
+  cu_GPAllocator_Config cfg = {0};
+  cfg.backingAllocator = cu_Allocator_Optional_some(backing);
+  cfg.retainBuckets = Size_Optional_some(0);
+  cu_Allocator alloc = cu_Allocator_GPAllocator(&gpa, cfg);
+
+  /* one bucket per block, all carved from a single aligned allocation */
+  cu_Slice blocks[CU_GPA_REGION_SPANS + 1];
+  for (size_t i = 0; i <= CU_GPA_REGION_SPANS; ++i) {
+    cu_IoSlice_Result res = cu_Allocator_Alloc(
+        alloc, cu_Layout_create(CU_GPA_BUCKET_SIZE, 16));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    blocks[i] = res.value;
+  }
+  TEST_ASSERT_EQUAL(CU_GPA_REGION_SPANS + 1, gpa.spans.length);
+  struct cu_GPAllocator_Region *first = NULL;
+  size_t shared = 0;
+  for (size_t i = 0; i < gpa.spans.capacity; ++i) {
+    struct cu_GPAllocator_IndexEntry *e = &gpa.spans.entries[i];
+    if (e->key == 0) {
+      continue;
+    }
+    struct cu_GPAllocator_BucketHeader *bucket =
+        (struct cu_GPAllocator_BucketHeader *)e->slice.ptr;
+    if (!first || bucket->region == first) {
+      first = bucket->region;
+      shared++;
+    }
+  }
+  TEST_ASSERT_TRUE(shared == CU_GPA_REGION_SPANS || shared == 1);
+  TEST_ASSERT_LESS_OR_EQUAL(
+      (CU_GPA_REGION_SPANS + 1) * CU_GPA_BUCKET_SIZE, first->memory.length);
+  TEST_ASSERT_NOT_NULL(gpa.regions);
+  TEST_ASSERT_NULL(gpa.regions->next);
+
+  /* regions are freed with their last span */
+  for (size_t i = 0; i <= CU_GPA_REGION_SPANS; ++i) {
+    cu_Allocator_Free(alloc, blocks[i]);
+  }
+  TEST_ASSERT_NULL(gpa.regions);
+  TEST_ASSERT_EQUAL(0, gpa.spans.length);
+  cu_GPAllocator_destroy(&gpa);
+  cu_StatsAllocator_Snapshot snap = cu_StatsAllocator_snapshot(&stats);
+  TEST_ASSERT_EQUAL(0, snap.bytesLive);
+}
+
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(Allocator_GPALargeAllocFree);
@@ -153,5 +477,13 @@ int main(void) {
   RUN_TEST(Allocator_DoubleFree);
   RUN_TEST(Allocator_GrowInPlaceSmall);
   RUN_TEST(Allocator_Exhaustion);
+  RUN_TEST(Allocator_FreeOrderIndependent);
+  RUN_TEST(Allocator_LargeGrowKeepsTracking);
+  RUN_TEST(Allocator_ReusesOlderBucketSlots);
+  RUN_TEST(Allocator_BatchAllocFree);
+  RUN_TEST(Allocator_RetainsEmptyBuckets);
+  RUN_TEST(Allocator_SpanFootprint);
+  RUN_TEST(Allocator_PurgesRetainedPages);
+  RUN_TEST(Allocator_SpansShareRegions);
   return UNITY_END();
 }
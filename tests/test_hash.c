@@ -1,5 +1,11 @@
 #include "hash/hash.h"
+#include "io/hashstream.h"
+#include "io/memstream.h"
+#include "memory/allocator.h"
 #include "unity.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unity_internals.h>
 
 static void Hash_FNV1a32(void) {
@@ -14,9 +20,279 @@ static void Hash_Murmur3(void) {
   TEST_ASSERT_TRUE((0u) != (h));
 }
 
+static void Hash_Wy64_LengthsAndSeeds(void) {
+  uint8_t data[256];
+  for (size_t i = 0; i < sizeof(data); ++i) {
+    data[i] = (uint8_t)(i * 7 + 1);
+  }
+  /* every prefix hashes differently and reproducibly */
+  static uint64_t seen[257];
+  for (size_t len = 0; len <= sizeof(data); ++len) {
+    uint64_t h = cu_Hash_Wy64(data, len, 42);
+    TEST_ASSERT_EQUAL_HEX64(h, cu_Hash_Wy64(data, len, 42));
+    TEST_ASSERT_TRUE(h != cu_Hash_Wy64(data, len, 43));
+    for (size_t j = 0; j < len; ++j) {
+      TEST_ASSERT_TRUE(seen[j] != h);
+    }
+    seen[len] = h;
+  }
+}
+
+static void Hash_Wy64_Avalanche(void) {
+  uint8_t data[100] = {0};
+  size_t lens[] = {3, 8, 16, 17, 47, 48, 100};
+  for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); ++l) {
+    size_t len = lens[l];
+    uint64_t base = cu_Hash_Wy64(data, len, 0);
+    for (size_t bit = 0; bit < len * 8; ++bit) {
+      data[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+      uint64_t diff = base ^ cu_Hash_Wy64(data, len, 0);
+      data[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+      int flipped = 0;
+      for (; diff; diff &= diff - 1) {
+        flipped++;
+      }
+      TEST_ASSERT_GREATER_THAN(12, flipped);
+      TEST_ASSERT_LESS_THAN(52, flipped);
+    }
+  }
+}
+
+static void Hash_Wy128(void) {
+  const char *data = "the quick brown fox jumps over the lazy dog";
+  cu_Hash128 h = cu_Hash_Wy128(data, 43, 7);
+  TEST_ASSERT_EQUAL_HEX64(cu_Hash_Wy64(data, 43, 7), h.low);
+  TEST_ASSERT_TRUE(h.low != h.high);
+  cu_Hash128 other = cu_Hash_Wy128(data, 42, 7);
+  TEST_ASSERT_TRUE(other.high != h.high);
+}
+
+static void Hash_IncrementalMatchesOneShot(void) {
+  static uint8_t data[300];
+  for (size_t i = 0; i < sizeof(data); ++i) {
+    data[i] = (uint8_t)(i * 13 + 5);
+  }
+  const uint8_t key[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+      15};
+  size_t lens[] = {0, 1, 3, 4, 7, 8, 15, 16, 17, 47, 48, 49, 95, 96, 97, 300};
+  size_t steps[] = {1, 3, 7, 16, 47, 48, 100};
+  for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); ++l) {
+    size_t len = lens[l];
+    for (size_t st = 0; st < sizeof(steps) / sizeof(steps[0]); ++st) {
+      cu_Hasher hashers[4] = {cu_Hasher_Murmur3_32(99),
+          cu_Hasher_SipHash24(key), cu_Hasher_Wy64(99), cu_Hasher_Wy128(99)};
+      for (size_t off = 0; off < len; off += steps[st]) {
+        size_t n = CU_MIN(steps[st], len - off);
+        for (size_t h = 0; h < 4; ++h) {
+          cu_Hasher_update(&hashers[h], cu_Slice_create(data + off, n));
+        }
+      }
+      TEST_ASSERT_EQUAL_HEX64(cu_Hash_Murmur3_32(data, len, 99),
+          cu_Hasher_final(&hashers[0]).low);
+      TEST_ASSERT_EQUAL_HEX64(cu_Hash_SipHash24(key, data, len),
+          cu_Hasher_final(&hashers[1]).low);
+      TEST_ASSERT_EQUAL_HEX64(
+          cu_Hash_Wy64(data, len, 99), cu_Hasher_final(&hashers[2]).low);
+      cu_Hash128 wide = cu_Hash_Wy128(data, len, 99);
+      cu_Hash128 got = cu_Hasher_final(&hashers[3]);
+      TEST_ASSERT_EQUAL_HEX64(wide.low, got.low);
+      TEST_ASSERT_EQUAL_HEX64(wide.high, got.high);
+    }
+  }
+}
+
+static uint32_t crc32c_bitwise(const uint8_t *p, size_t len) {
+  uint32_t crc = 0xffffffffu;
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= p[i];
+    for (int k = 0; k < 8; ++k) {
+      crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78u : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+
+static void Hash_CRC32C_KnownValues(void) {
+  TEST_ASSERT_EQUAL_HEX32(0xe3069283u, cu_Hash_CRC32C("123456789", 9));
+  TEST_ASSERT_EQUAL_HEX32(0u, cu_Hash_CRC32C("", 0));
+  uint8_t buf[32] = {0};
+  TEST_ASSERT_EQUAL_HEX32(0x8a9136aau, cu_Hash_CRC32C(buf, sizeof(buf)));
+  for (size_t i = 0; i < sizeof(buf); ++i) {
+    buf[i] = 0xff;
+  }
+  TEST_ASSERT_EQUAL_HEX32(0x62a8ab43u, cu_Hash_CRC32C(buf, sizeof(buf)));
+}
+
+static void Hash_CRC32C_LargeIncrementalCombine(void) {
+  /* long enough for both interleaved block sizes */
+  size_t len = 3 * 8192 * 2 + 3 * 256 + 77;
+  uint8_t *data = malloc(len + 1);
+  TEST_ASSERT_NOT_NULL(data);
+  uint32_t x = 2463534242u;
+  for (size_t i = 0; i <= len; ++i) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    data[i] = (uint8_t)x;
+  }
+  /* unaligned start */
+  uint32_t want = crc32c_bitwise(data + 1, len);
+  TEST_ASSERT_EQUAL_HEX32(want, cu_Hash_CRC32C(data + 1, len));
+
+  size_t cuts[] = {0, 1, 9, 1000, 24576, len};
+  for (size_t c = 0; c < sizeof(cuts) / sizeof(cuts[0]); ++c) {
+    size_t cut = cuts[c];
+    uint32_t head = cu_Hash_CRC32C(data + 1, cut);
+    uint32_t tail = cu_Hash_CRC32C(data + 1 + cut, len - cut);
+    TEST_ASSERT_EQUAL_HEX32(want, cu_Hash_CRC32C_combine(head, tail, len - cut));
+    TEST_ASSERT_EQUAL_HEX32(
+        want, cu_Hash_CRC32C_update(head, data + 1 + cut, len - cut));
+  }
+
+  cu_Hasher hasher = cu_Hasher_CRC32C();
+  for (size_t off = 0; off < len; off += 1000) {
+    cu_Hasher_update(
+        &hasher, cu_Slice_create(data + 1 + off, CU_MIN(1000, len - off)));
+  }
+  TEST_ASSERT_EQUAL_HEX64(want, cu_Hasher_final(&hasher).low);
+
+  /* the table kernel stays covered on hosts with SSE4.2 */
+  TEST_ASSERT_EQUAL_HEX32(
+      want, cu_Hash_CRC32C_update_portable(0, data + 1, len));
+  for (size_t n = 0; n < 64; ++n) {
+    TEST_ASSERT_EQUAL_HEX32(crc32c_bitwise(data + 3, n),
+        cu_Hash_CRC32C_update_portable(0, data + 3, n));
+  }
+  free(data);
+}
+
+static void Hash_CRC32C_CombineLongTail(void) {
+  /*
+   * Appending zeros multiplies by x^(8 * len2), so a long tail equals many
+   * short ones. Steps of 2^28 bytes stay inside the first period of the
+   * x^(2^n) table while the full lengths wrap around it.
+   */
+  uint32_t crc = cu_Hash_CRC32C("123456789", 9);
+  size_t step = (size_t)1 << 28;
+  size_t lens[] = {step << 1, (step << 2) + 12345, (size_t)0xfffffff7u};
+  for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i) {
+    uint32_t want = crc;
+    size_t left = lens[i];
+    for (; left >= step; left -= step) {
+      want = cu_Hash_CRC32C_combine(want, 0, step);
+    }
+    want = cu_Hash_CRC32C_combine(want, 0, left);
+    TEST_ASSERT_EQUAL_HEX32(want, cu_Hash_CRC32C_combine(crc, 0, lens[i]));
+  }
+}
+
+#ifndef CU_FREESTANDING
+static void Hash_Stream(void) {
+  cu_MemStream_Result res = cu_MemStream_create(16, cu_Allocator_CAllocator());
+  TEST_ASSERT_TRUE(cu_MemStream_Result_is_ok(&res));
+  cu_MemStream ms = cu_MemStream_Result_unwrap(&res);
+
+  const char text[] = "hashed while it is written and read back again";
+  size_t len = sizeof(text) - 1;
+  cu_HashStream writer =
+      cu_HashStream_create(cu_MemStream_stream(&ms), cu_Hasher_Wy64(1));
+  cu_Stream out = cu_HashStream_stream(&writer);
+  for (size_t off = 0; off < len; off += 5) {
+    cu_Io_Error_Optional err = cu_Stream_write(
+        &out, cu_Slice_create((void *)(text + off), CU_MIN(5, len - off)));
+    TEST_ASSERT_TRUE(cu_Io_Error_Optional_is_none(&err));
+  }
+  TEST_ASSERT_EQUAL_HEX64(
+      cu_Hash_Wy64(text, len, 1), cu_HashStream_digest(&writer).low);
+
+  cu_File_SeekTo start = {
+      .whence = CU_FILE_SEEK_START, .offset = Size_Optional_none()};
+  cu_MemStream_seek(&ms, start);
+  cu_HashStream reader =
+      cu_HashStream_create(cu_MemStream_stream(&ms), cu_Hasher_Wy64(1));
+  cu_Stream in = cu_HashStream_stream(&reader);
+  char buf[16];
+  for (size_t off = 0; off + sizeof(buf) <= len; off += sizeof(buf)) {
+    cu_Io_Error_Optional err =
+        cu_Stream_read(&in, cu_Slice_create(buf, sizeof(buf)));
+    TEST_ASSERT_TRUE(cu_Io_Error_Optional_is_none(&err));
+  }
+  /* a short read fails but the bytes it consumed are still hashed */
+  cu_Io_Error_Optional err =
+      cu_Stream_read(&in, cu_Slice_create(buf, sizeof(buf)));
+  TEST_ASSERT_TRUE(cu_Io_Error_Optional_is_some(&err));
+  TEST_ASSERT_EQUAL_HEX64(
+      cu_Hash_Wy64(text, len, 1), cu_HashStream_digest(&reader).low);
+  cu_Stream_close(&in);
+}
+
+typedef struct {
+  const char *data;
+  size_t length;
+  size_t offset;
+  size_t tells;
+} untellable_source;
+
+static cu_Io_Error_Optional untellable_read(void *self, cu_Slice buf) {
+  untellable_source *src = (untellable_source *)self;
+  if (buf.length > src->length - src->offset) {
+    src->offset = src->length;
+    return cu_Io_Error_Optional_some((cu_Io_Error){
+        .kind = CU_IO_ERROR_KIND_UNEXPECTED_EOF,
+        .errnum = Size_Optional_none()});
+  }
+  memcpy(buf.ptr, src->data + src->offset, buf.length);
+  src->offset += buf.length;
+  return cu_Io_Error_Optional_none();
+}
+
+static cu_IoSize_Result untellable_tell(void *self) {
+  untellable_source *src = (untellable_source *)self;
+  src->tells++;
+  return cu_IoSize_Result_error((cu_Io_Error){
+      .kind = CU_IO_ERROR_KIND_UNSUPPORTED, .errnum = Size_Optional_none()});
+}
+
+static void Hash_StreamUntellable(void) {
+  const char text[] = "read from a stream that cannot tell its position";
+  size_t len = sizeof(text) - 1;
+  untellable_source src = {.data = text, .length = len};
+  cu_Stream inner = {.self = &src,
+      .readFn = untellable_read,
+      .tellFn = untellable_tell};
+  cu_HashStream reader = cu_HashStream_create(inner, cu_Hasher_Wy64(1));
+  cu_Stream in = cu_HashStream_stream(&reader);
+  char buf[4];
+  size_t off = 0;
+  for (; off + sizeof(buf) <= len; off += sizeof(buf)) {
+    cu_Io_Error_Optional err =
+        cu_Stream_read(&in, cu_Slice_create(buf, sizeof(buf)));
+    TEST_ASSERT_TRUE(cu_Io_Error_Optional_is_none(&err));
+  }
+  cu_Io_Error_Optional err =
+      cu_Stream_read(&in, cu_Slice_create(buf, sizeof(buf)));
+  TEST_ASSERT_TRUE(cu_Io_Error_Optional_is_some(&err));
+  /* the first failure is remembered instead of asked again per read */
+  TEST_ASSERT_EQUAL_size_t(1, src.tells);
+  TEST_ASSERT_EQUAL_HEX64(
+      cu_Hash_Wy64(text, off, 1), cu_HashStream_digest(&reader).low);
+}
+#endif
+
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(Hash_FNV1a32);
   RUN_TEST(Hash_Murmur3);
+  RUN_TEST(Hash_Wy64_LengthsAndSeeds);
+  RUN_TEST(Hash_Wy64_Avalanche);
+  RUN_TEST(Hash_Wy128);
+  RUN_TEST(Hash_IncrementalMatchesOneShot);
+  RUN_TEST(Hash_CRC32C_KnownValues);
+  RUN_TEST(Hash_CRC32C_LargeIncrementalCombine);
+  RUN_TEST(Hash_CRC32C_CombineLongTail);
+#ifndef CU_FREESTANDING
+  RUN_TEST(Hash_Stream);
+  RUN_TEST(Hash_StreamUntellable);
+#endif
   return UNITY_END();
 }
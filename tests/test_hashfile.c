@@ -0,0 +1,184 @@
+#if CU_FREESTANDING
+#include "unity.h"
+#include <unity_internals.h>
+static void HashFile_Unsupported(void) {}
+#else
+#include "collection/hashfile.h"
+#include "memory/allocator.h"
+#include "test_common.h"
+#include "unity.h"
+#include <unity_internals.h>
+
+static cu_File open_for_write(const char *path) {
+  cu_File_Options opt = {0};
+  cu_File_Options_write(&opt);
+  cu_File_Options_create(&opt);
+  cu_File_Options_truncate(&opt);
+  cu_File_Result fres =
+      cu_File_open(CU_SLICE_CSTR(path), opt, cu_Allocator_CAllocator());
+  TEST_ASSERT_TRUE(cu_File_Result_is_ok(&fres));
+  return cu_File_Result_unwrap(&fres);
+}
+
+static void HashFile_WriteAndOpen(void) {
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 1);
+  cu_HashMap_Result res = cu_HashMap_create(test_allocator,
+      CU_LAYOUT(uint32_t), CU_LAYOUT(uint64_t), Size_Optional_none(),
+      cu_HashMap_HashFn_Optional_none(), cu_HashMap_EqualsFn_Optional_none(),
+      st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+  /* enough records to spill over several write buffers */
+  for (uint32_t i = 0; i < 20000; ++i) {
+    uint64_t v = (uint64_t)i << 32 | i;
+    cu_HashMap_insert(&map, &i, &v);
+  }
+
+  cu_File file = open_for_write("hashfile.bin");
+  cu_Io_Error_Optional err = cu_HashFile_write(&file, &map, test_allocator);
+  TEST_ASSERT_TRUE(cu_Io_Error_Optional_is_none(&err));
+  cu_File_close(&file);
+  cu_HashMap_destroy(&map);
+
+  cu_HashFile_Result hres = cu_HashFile_open(
+      CU_SLICE_CSTR("hashfile.bin"), cu_Allocator_CAllocator());
+  TEST_ASSERT_TRUE(cu_HashFile_Result_is_ok(&hres));
+  cu_HashFile table = cu_HashFile_Result_unwrap(&hres);
+  TEST_ASSERT_EQUAL_size_t(20000, table.length);
+  for (uint32_t i = 0; i < 20000; ++i) {
+    Ptr_Optional opt = cu_HashFile_get(&table, &i);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+    TEST_ASSERT_EQUAL_HEX64(
+        (uint64_t)i << 32 | i, *(const uint64_t *)Ptr_Optional_unwrap(&opt));
+  }
+  for (uint32_t i = 20000; i < 21000; ++i) {
+    Ptr_Optional opt = cu_HashFile_get(&table, &i);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_none(&opt));
+  }
+  cu_HashFile_close(&table);
+  TEST_ASSERT_NULL(table.base);
+}
+
+static void HashFile_RejectsBadInput(void) {
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 2);
+  cu_HashMap_Result res = cu_HashMap_create(test_allocator, CU_LAYOUT(int),
+      CU_LAYOUT(int), Size_Optional_none(), cu_HashMap_HashFn_Optional_none(),
+      cu_HashMap_EqualsFn_Optional_none(), st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+
+  /* an empty map still produces a valid file */
+  cu_File file = open_for_write("hashfile_empty.bin");
+  cu_Io_Error_Optional err = cu_HashFile_write(&file, &map, test_allocator);
+  TEST_ASSERT_TRUE(cu_Io_Error_Optional_is_none(&err));
+  cu_File_close(&file);
+  cu_HashMap_destroy(&map);
+  cu_HashFile_Result hres = cu_HashFile_open(
+      CU_SLICE_CSTR("hashfile_empty.bin"), cu_Allocator_CAllocator());
+  TEST_ASSERT_TRUE(cu_HashFile_Result_is_ok(&hres));
+  cu_HashFile table = cu_HashFile_Result_unwrap(&hres);
+  int key = 1;
+  Ptr_Optional opt = cu_HashFile_get(&table, &key);
+  TEST_ASSERT_TRUE(Ptr_Optional_is_none(&opt));
+  cu_HashFile_close(&table);
+
+  /* foreign files are rejected instead of being trusted */
+  file = open_for_write("hashfile_bogus.bin");
+  char junk[256];
+  cu_Memory_memset(junk, 'x', sizeof(junk));
+  cu_File_write(&file, cu_Slice_create(junk, sizeof(junk)));
+  cu_File_close(&file);
+  hres = cu_HashFile_open(
+      CU_SLICE_CSTR("hashfile_bogus.bin"), cu_Allocator_CAllocator());
+  TEST_ASSERT_FALSE(cu_HashFile_Result_is_ok(&hres));
+  TEST_ASSERT_EQUAL(CU_IO_ERROR_KIND_INVALID_DATA,
+      cu_HashFile_Result_unwrap_error(&hres).kind);
+
+  hres = cu_HashFile_open(
+      CU_SLICE_CSTR("hashfile_missing.bin"), cu_Allocator_CAllocator());
+  TEST_ASSERT_FALSE(cu_HashFile_Result_is_ok(&hres));
+}
+
+static void HashFile_IgnoresStraySlots(void) {
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 3);
+  cu_HashMap_Result res = cu_HashMap_create(test_allocator, CU_LAYOUT(int),
+      CU_LAYOUT(int), Size_Optional_none(), cu_HashMap_HashFn_Optional_none(),
+      cu_HashMap_EqualsFn_Optional_none(), st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+  for (int i = 0; i < 16; ++i) {
+    int v = i * 10;
+    cu_HashMap_insert(&map, &i, &v);
+  }
+  cu_File file = open_for_write("hashfile_stray.bin");
+  cu_Io_Error_Optional err = cu_HashFile_write(&file, &map, test_allocator);
+  TEST_ASSERT_TRUE(cu_Io_Error_Optional_is_none(&err));
+  cu_File_close(&file);
+  cu_HashMap_destroy(&map);
+
+  cu_HashFile_Result hres = cu_HashFile_open(
+      CU_SLICE_CSTR("hashfile_stray.bin"), cu_Allocator_CAllocator());
+  TEST_ASSERT_TRUE(cu_HashFile_Result_is_ok(&hres));
+  cu_HashFile mapped = cu_HashFile_Result_unwrap(&hres);
+  size_t size = mapped.size;
+  cu_IoSlice_Result copy = cu_Allocator_Alloc(
+      test_allocator, cu_Layout_create(size, CU_HASHFILE_ALIGN));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&copy));
+  cu_Memory_memcpy(copy.value.ptr, cu_Slice_create((void *)mapped.base, size));
+  cu_HashFile_close(&mapped);
+  hres = cu_HashFile_from_bytes(cu_Slice_create(copy.value.ptr, size));
+  TEST_ASSERT_TRUE(cu_HashFile_Result_is_ok(&hres));
+  cu_HashFile table = cu_HashFile_Result_unwrap(&hres);
+
+  int key = 5;
+  Ptr_Optional opt = cu_HashFile_get(&table, &key);
+  TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+  TEST_ASSERT_EQUAL(50, *(const int *)Ptr_Optional_unwrap(&opt));
+
+  /* redirect the slot of the key to forged copies of it */
+  unsigned char *bytes = (unsigned char *)copy.value.ptr;
+  cu_HashFile_Slot *slots = (cu_HashFile_Slot *)(bytes +
+      ((const unsigned char *)table.slots - table.base));
+  cu_HashFile_Slot *slot = NULL;
+  for (size_t i = 0; i <= table.mask; ++i) {
+    if (slots[i].offset != 0 &&
+        cu_Memory_memcmp(cu_Slice_create(bytes + slots[i].offset, sizeof(key)),
+            cu_Slice_create(&key, sizeof(key)))) {
+      slot = &slots[i];
+    }
+  }
+  TEST_ASSERT_NOT_NULL(slot);
+
+  /* in between two records */
+  uint64_t forged = slot->offset + table.value_offset;
+  cu_Memory_memcpy(bytes + forged, cu_Slice_create(&key, sizeof(key)));
+  slot->offset = forged;
+  opt = cu_HashFile_get(&table, &key);
+  TEST_ASSERT_TRUE(Ptr_Optional_is_none(&opt));
+
+  /* in front of the record heap */
+  forged = CU_HASHFILE_ALIGN;
+  cu_Memory_memcpy(bytes + forged, cu_Slice_create(&key, sizeof(key)));
+  slot->offset = forged;
+  opt = cu_HashFile_get(&table, &key);
+  TEST_ASSERT_TRUE(Ptr_Optional_is_none(&opt));
+
+  cu_HashFile_close(&table);
+  cu_Allocator_Free(test_allocator, copy.value);
+}
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+#if CU_FREESTANDING
+  RUN_TEST(HashFile_Unsupported);
+#else
+  RUN_TEST(HashFile_WriteAndOpen);
+  RUN_TEST(HashFile_RejectsBadInput);
+  RUN_TEST(HashFile_IgnoresStraySlots);
+#endif
+  return UNITY_END();
+}
@@ -113,6 +113,402 @@ static void HashMap_StressRandomAccess(void) {
 
   cu_HashMap_destroy(&map);
 }
+
+static uint64_t const_hash(const void *key, size_t key_size) {
+  (void)key;
+  (void)key_size;
+  return 42;
+}
+
+static void HashMap_CollidingUpdates(void) {
+  cu_Allocator alloc = test_allocator;
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 1);
+
+  cu_HashMap_Result res =
+      cu_HashMap_create(alloc, CU_LAYOUT(int), CU_LAYOUT(int),
+          Size_Optional_none(), cu_HashMap_HashFn_Optional_some(const_hash),
+          cu_HashMap_EqualsFn_Optional_some(int_eq), st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+
+  const int count = 100;
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 0; i < count; ++i) {
+      int v = i * 10 + round;
+      cu_HashMap_Error_Optional err = cu_HashMap_insert(&map, &i, &v);
+      TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+    }
+  }
+  TEST_ASSERT_EQUAL_size_t(count, map.length);
+  for (int i = 0; i < count; ++i) {
+    Ptr_Optional opt = cu_HashMap_get(&map, &i);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+    TEST_ASSERT_EQUAL(i * 10 + 1, *(int *)Ptr_Optional_unwrap(&opt));
+  }
+  int missing = count;
+  Ptr_Optional none = cu_HashMap_get(&map, &missing);
+  TEST_ASSERT_TRUE(Ptr_Optional_is_none(&none));
+
+  cu_HashMap_destroy(&map);
+}
+
+typedef struct {
+  char tag[3];
+} OddKey;
+
+typedef struct {
+  _Alignas(16) double a;
+  double b;
+} WideValue;
+
+static void HashMap_InlineLayouts(void) {
+  cu_Allocator alloc = test_allocator;
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 1);
+
+  cu_HashMap_Result res = cu_HashMap_create(alloc, CU_LAYOUT(OddKey),
+      CU_LAYOUT(WideValue), Size_Optional_some(1),
+      cu_HashMap_HashFn_Optional_none(), cu_HashMap_EqualsFn_Optional_none(),
+      st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+
+  for (int i = 0; i < 1000; ++i) {
+    OddKey k = {{(char)i, (char)(i >> 8), 'k'}};
+    WideValue v = {(double)i, (double)-i};
+    cu_HashMap_Error_Optional err = cu_HashMap_insert(&map, &k, &v);
+    TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  }
+  TEST_ASSERT_EQUAL_size_t(1000, map.length);
+  TEST_ASSERT_LESS_OR_EQUAL(
+      map.table.capacity - map.table.capacity / 8, map.length);
+
+  size_t idx = 0;
+  void *k;
+  void *v;
+  size_t seen = 0;
+  while (cu_HashMap_iter(&map, &idx, &k, &v)) {
+    TEST_ASSERT_EQUAL_size_t(0, (uintptr_t)v % 16);
+    WideValue *wv = (WideValue *)v;
+    TEST_ASSERT_TRUE(wv->a == -wv->b);
+    seen++;
+  }
+  TEST_ASSERT_EQUAL_size_t(1000, seen);
+
+  for (int i = 0; i < 1000; ++i) {
+    OddKey key = {{(char)i, (char)(i >> 8), 'k'}};
+    Ptr_Optional opt = cu_HashMap_get(&map, &key);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+    TEST_ASSERT_TRUE(((WideValue *)Ptr_Optional_unwrap(&opt))->a == i);
+  }
+
+  cu_HashMap_destroy(&map);
+}
+
+static void HashMap_RemoveReturnsValue(void) {
+  cu_Allocator alloc = test_allocator;
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 1);
+
+  cu_HashMap_Result res = cu_HashMap_create(alloc, CU_LAYOUT(int),
+      CU_LAYOUT(int), Size_Optional_none(), cu_HashMap_HashFn_Optional_none(),
+      cu_HashMap_EqualsFn_Optional_none(), st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+
+  for (int i = 0; i < 200; ++i) {
+    int v = i * 3;
+    cu_HashMap_insert(&map, &i, &v);
+  }
+  for (int i = 0; i < 200; i += 2) {
+    int old = -1;
+    cu_HashMap_Error_Optional err = cu_HashMap_remove(&map, &i, &old);
+    TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+    TEST_ASSERT_EQUAL(i * 3, old);
+  }
+  TEST_ASSERT_EQUAL_size_t(100, map.length);
+  for (int i = 0; i < 200; ++i) {
+    Ptr_Optional opt = cu_HashMap_get(&map, &i);
+    TEST_ASSERT_EQUAL(i % 2 == 1, Ptr_Optional_is_some(&opt));
+  }
+  int gone = 0;
+  cu_HashMap_Error_Optional err = cu_HashMap_remove(&map, &gone, NULL);
+  TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_some(&err));
+  TEST_ASSERT_EQUAL(
+      CU_HASHMAP_ERROR_NOT_FOUND, cu_HashMap_Error_Optional_unwrap(&err));
+
+  cu_HashMap_destroy(&map);
+}
+
+static void HashMap_RemoveCollidingChain(void) {
+  cu_Allocator alloc = test_allocator;
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 1);
+
+  cu_HashMap_Result res =
+      cu_HashMap_create(alloc, CU_LAYOUT(int), CU_LAYOUT(int),
+          Size_Optional_none(), cu_HashMap_HashFn_Optional_some(const_hash),
+          cu_HashMap_EqualsFn_Optional_some(int_eq), st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+
+  /* a single cluster covering most of the table */
+  for (int i = 0; i < 12; ++i) {
+    cu_HashMap_insert(&map, &i, &i);
+  }
+  int order[] = {5, 0, 11, 6, 1, 7};
+  for (size_t n = 0; n < sizeof(order) / sizeof(order[0]); ++n) {
+    cu_HashMap_Error_Optional err = cu_HashMap_remove(&map, &order[n], NULL);
+    TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+    for (int i = 0; i < 12; ++i) {
+      bool removed = false;
+      for (size_t m = 0; m <= n; ++m) {
+        removed = removed || order[m] == i;
+      }
+      Ptr_Optional opt = cu_HashMap_get(&map, &i);
+      TEST_ASSERT_EQUAL(!removed, Ptr_Optional_is_some(&opt));
+    }
+  }
+
+  cu_HashMap_destroy(&map);
+}
+
+static void HashMap_ChurnKeepsCapacity(void) {
+  cu_Allocator alloc = test_allocator;
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 1);
+
+  cu_HashMap_Result res = cu_HashMap_create(alloc, CU_LAYOUT(int),
+      CU_LAYOUT(int), Size_Optional_some(256),
+      cu_HashMap_HashFn_Optional_none(), cu_HashMap_EqualsFn_Optional_none(),
+      st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+
+  const int live = 200;
+  for (int i = 0; i < live; ++i) {
+    cu_HashMap_insert(&map, &i, &i);
+  }
+  for (int i = live; i < 50000; ++i) {
+    int old = i - live;
+    int out = -1;
+    cu_HashMap_Error_Optional err = cu_HashMap_remove(&map, &old, &out);
+    TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+    TEST_ASSERT_EQUAL(old, out);
+    cu_HashMap_insert(&map, &i, &i);
+  }
+  TEST_ASSERT_EQUAL_size_t(256, map.table.capacity);
+  TEST_ASSERT_EQUAL_size_t((size_t)live, map.length);
+  for (int i = 50000 - live; i < 50000; ++i) {
+    Ptr_Optional opt = cu_HashMap_get(&map, &i);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+    TEST_ASSERT_EQUAL(i, *(int *)Ptr_Optional_unwrap(&opt));
+  }
+
+  cu_HashMap_destroy(&map);
+}
+
+static void HashMap_IncrementalRehash(void) {
+  cu_Allocator alloc = test_allocator;
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 1);
+
+  cu_HashMap_Result res = cu_HashMap_create(alloc, CU_LAYOUT(int),
+      CU_LAYOUT(int), Size_Optional_none(), cu_HashMap_HashFn_Optional_none(),
+      cu_HashMap_EqualsFn_Optional_none(), st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+  cu_HashMap_set_incremental_rehash(&map, 1);
+  TEST_ASSERT_EQUAL_size_t(2, map.rehash_step);
+
+  const int count = 5000;
+  bool migrating = false;
+  for (int i = 0; i < count; ++i) {
+    int v = -i;
+    cu_HashMap_Error_Optional err = cu_HashMap_insert(&map, &i, &v);
+    TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+    if (map.old.ctrl == NULL) {
+      continue;
+    }
+    migrating = true;
+    /* both tables are live, every key must still be visible */
+    if (i % 3 == 0) {
+      int gone = i / 2;
+      err = cu_HashMap_remove(&map, &gone, NULL);
+      TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+      cu_HashMap_insert(&map, &gone, &(int){-gone});
+    }
+    size_t idx = 0;
+    void *k;
+    void *v2;
+    size_t seen = 0;
+    while (cu_HashMap_iter(&map, &idx, &k, &v2)) {
+      TEST_ASSERT_EQUAL(-*(int *)k, *(int *)v2);
+      seen++;
+    }
+    TEST_ASSERT_EQUAL_size_t(map.length, seen);
+  }
+  TEST_ASSERT_TRUE(migrating);
+  TEST_ASSERT_EQUAL_size_t((size_t)count, map.length);
+  for (int i = 0; i < count; ++i) {
+    Ptr_Optional opt = cu_HashMap_get(&map, &i);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+    TEST_ASSERT_EQUAL(-i, *(int *)Ptr_Optional_unwrap(&opt));
+  }
+
+  cu_HashMap_set_incremental_rehash(&map, 0);
+  TEST_ASSERT_NULL(map.old.ctrl);
+  for (int i = 0; i < count; ++i) {
+    Ptr_Optional opt = cu_HashMap_get(&map, &i);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+  }
+
+  cu_HashMap_destroy(&map);
+}
+
+static void HashMap_IncrementalRehashClearsInChunks(void) {
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 2);
+  cu_HashMap_Result res = cu_HashMap_create(test_allocator, CU_LAYOUT(int),
+      CU_LAYOUT(int), Size_Optional_some(16384),
+      cu_HashMap_HashFn_Optional_none(), cu_HashMap_EqualsFn_Optional_none(),
+      st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+  cu_HashMap_set_incremental_rehash(&map, 2);
+
+  int i = 0;
+  while (map.next.ctrl == NULL) {
+    cu_HashMap_Error_Optional err = cu_HashMap_insert(&map, &i, &(int){-i});
+    TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+    ++i;
+  }
+  /* growth emptied one chunk of the new control bytes, not all of them */
+  TEST_ASSERT_EQUAL_size_t(32768, map.next.capacity);
+  TEST_ASSERT_TRUE(map.cleared < map.next.capacity);
+  TEST_ASSERT_EQUAL_size_t(16384, map.table.capacity);
+
+  int updates = 0;
+  while (map.next.ctrl != NULL) {
+    size_t cleared = map.cleared;
+    cu_HashMap_Error_Optional err = cu_HashMap_insert(&map, &i, &(int){-i});
+    TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+    ++i;
+    ++updates;
+    if (map.next.ctrl != NULL) {
+      TEST_ASSERT_TRUE(map.cleared > cleared);
+    }
+    /* the current table keeps serving every key past its load limit */
+    for (int j = 0; j < i; j += 97) {
+      Ptr_Optional opt = cu_HashMap_get(&map, &j);
+      TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+    }
+  }
+  TEST_ASSERT_TRUE(updates > 1);
+  TEST_ASSERT_EQUAL_size_t(32768, map.table.capacity);
+  TEST_ASSERT_NOT_NULL(map.old.ctrl);
+
+  cu_HashMap_set_incremental_rehash(&map, 0);
+  TEST_ASSERT_EQUAL_size_t((size_t)i, map.length);
+  for (int j = 0; j < i; ++j) {
+    Ptr_Optional opt = cu_HashMap_get(&map, &j);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+    TEST_ASSERT_EQUAL(-j, *(int *)Ptr_Optional_unwrap(&opt));
+  }
+  cu_HashMap_destroy(&map);
+}
+
+static uint64_t seeded_seen;
+
+static uint64_t seeded_hash(const void *key, size_t key_size, uint64_t seed) {
+  seeded_seen = seed;
+  return cu_Hash_Wy64(key, key_size, seed);
+}
+
+static void HashMap_SeededHash(void) {
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 5);
+  cu_HashMap_Result res = cu_HashMap_create(test_allocator, CU_LAYOUT(int),
+      CU_LAYOUT(int), Size_Optional_none(), cu_HashMap_HashFn_Optional_none(),
+      cu_HashMap_EqualsFn_Optional_none(), st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+
+  cu_HashMap_Error_Optional err = cu_HashMap_set_seeded_hash(&map, seeded_hash);
+  TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  for (int i = 0; i < 100; ++i) {
+    err = cu_HashMap_insert(&map, &i, &i);
+    TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  }
+  /* the hash sees the seed of the map itself */
+  TEST_ASSERT_EQUAL_HEX64(map.seed, seeded_seen);
+  for (int i = 0; i < 100; ++i) {
+    Ptr_Optional opt = cu_HashMap_get(&map, &i);
+    TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+    TEST_ASSERT_EQUAL(i, *(int *)Ptr_Optional_unwrap(&opt));
+  }
+  /* switching hashes would strand the stored keys */
+  err = cu_HashMap_set_seeded_hash(&map, seeded_hash);
+  TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_some(&err));
+  cu_HashMap_destroy(&map);
+}
+
+static void HashMap_BatchedOps(void) {
+  cu_Allocator alloc = test_allocator;
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 1);
+
+  cu_HashMap_Result res = cu_HashMap_create(alloc, CU_LAYOUT(int),
+      CU_LAYOUT(int), Size_Optional_none(), cu_HashMap_HashFn_Optional_none(),
+      cu_HashMap_EqualsFn_Optional_none(), st);
+  TEST_ASSERT_TRUE(cu_HashMap_Result_is_ok(&res));
+  cu_HashMap map = cu_HashMap_Result_unwrap(&res);
+
+  enum { COUNT = 1000 };
+  cu_HashMap_Error_Optional err = cu_HashMap_reserve(&map, COUNT);
+  TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  size_t cap = map.table.capacity;
+  TEST_ASSERT_GREATER_OR_EQUAL(COUNT, cap - cap / 8);
+
+  int keys[COUNT];
+  int values[COUNT];
+  for (int i = 0; i < COUNT; ++i) {
+    keys[i] = i * 7;
+    values[i] = i;
+  }
+  err = cu_HashMap_insert_many(&map, keys, values, COUNT);
+  TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  TEST_ASSERT_EQUAL_size_t(COUNT, map.length);
+  TEST_ASSERT_EQUAL_size_t(cap, map.table.capacity);
+
+  /* every other probe misses */
+  int probe[COUNT];
+  void *found[COUNT];
+  for (int i = 0; i < COUNT; ++i) {
+    probe[i] = i % 2 ? i * 7 : i * 7 + 1;
+  }
+  size_t hits = cu_HashMap_get_many(&map, probe, COUNT, found);
+  TEST_ASSERT_EQUAL_size_t(COUNT / 2, hits);
+  for (int i = 0; i < COUNT; ++i) {
+    if (i % 2) {
+      TEST_ASSERT_NOT_NULL(found[i]);
+      TEST_ASSERT_EQUAL(i, *(int *)found[i]);
+    } else {
+      TEST_ASSERT_NULL(found[i]);
+    }
+  }
+
+  /* inserting again only overwrites */
+  err = cu_HashMap_insert_many(&map, keys, keys, COUNT);
+  TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  TEST_ASSERT_EQUAL_size_t(COUNT, map.length);
+  hits = cu_HashMap_get_many(&map, keys, COUNT, found);
+  TEST_ASSERT_EQUAL_size_t(COUNT, hits);
+  TEST_ASSERT_EQUAL(7 * 5, *(int *)found[5]);
+
+  cu_HashMap_destroy(&map);
+}
 #endif
 
 int main(void) {
@@ -123,6 +519,15 @@ int main(void) {
   RUN_TEST(HashMap_BasicInsertGet);
   RUN_TEST(HashMap_CustomHashIter);
   RUN_TEST(HashMap_StressRandomAccess);
+  RUN_TEST(HashMap_CollidingUpdates);
+  RUN_TEST(HashMap_InlineLayouts);
+  RUN_TEST(HashMap_RemoveReturnsValue);
+  RUN_TEST(HashMap_RemoveCollidingChain);
+  RUN_TEST(HashMap_ChurnKeepsCapacity);
+  RUN_TEST(HashMap_IncrementalRehash);
+  RUN_TEST(HashMap_IncrementalRehashClearsInChunks);
+  RUN_TEST(HashMap_BatchedOps);
+  RUN_TEST(HashMap_SeededHash);
 #endif
   return UNITY_END();
 }
@@ -0,0 +1,58 @@
+#if CU_FREESTANDING
+#include "unity.h"
+#include <unity_internals.h>
+static void HashSet_Unsupported(void) {}
+#else
+#include "collection/hashset.h"
+#include "memory/allocator.h"
+#include "test_common.h"
+#include "unity.h"
+#include <unity_internals.h>
+
+static void HashSet_InsertContainsRemove(void) {
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 1);
+  cu_HashSet_Result res = cu_HashSet_create(test_allocator, CU_LAYOUT(int),
+      Size_Optional_none(), cu_HashMap_HashFn_Optional_none(),
+      cu_HashMap_EqualsFn_Optional_none(), st);
+  TEST_ASSERT_TRUE(cu_HashSet_Result_is_ok(&res));
+  cu_HashSet set = cu_HashSet_Result_unwrap(&res);
+
+  for (int i = 0; i < 500; ++i) {
+    int k = i % 250;
+    cu_HashMap_Error_Optional err = cu_HashSet_insert(&set, &k);
+    TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  }
+  TEST_ASSERT_EQUAL_size_t(250, cu_HashSet_length(&set));
+  /* slots carry no value storage */
+  TEST_ASSERT_EQUAL_size_t(0, set.map.value_layout.elem_size);
+
+  for (int i = 0; i < 250; i += 2) {
+    cu_HashMap_Error_Optional err = cu_HashSet_remove(&set, &i);
+    TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  }
+  for (int i = 0; i < 300; ++i) {
+    TEST_ASSERT_EQUAL(i < 250 && i % 2 == 1, cu_HashSet_contains(&set, &i));
+  }
+
+  size_t idx = 0;
+  void *key;
+  int sum = 0;
+  while (cu_HashSet_iter(&set, &idx, &key)) {
+    sum += *(int *)key;
+  }
+  TEST_ASSERT_EQUAL(125 * 125, sum);
+
+  cu_HashSet_destroy(&set);
+}
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+#if CU_FREESTANDING
+  RUN_TEST(HashSet_Unsupported);
+#else
+  RUN_TEST(HashSet_InsertContainsRemove);
+#endif
+  return UNITY_END();
+}
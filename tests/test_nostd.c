@@ -0,0 +1,213 @@
+#include "nostd.h"
+#include "unity.h"
+#include <stdlib.h>
+#include <unity_internals.h>
+
+#define BUF_SIZE 1024
+
+static unsigned char src_buf[BUF_SIZE];
+static unsigned char dst_buf[BUF_SIZE];
+static unsigned char ref_buf[BUF_SIZE];
+
+static void fill_pattern(unsigned char *buf, size_t len, unsigned seed) {
+  for (size_t i = 0; i < len; ++i) {
+    buf[i] = (unsigned char)(i * 31u + seed);
+  }
+}
+
+static void assert_bytes(
+    const unsigned char *want, const unsigned char *got, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    TEST_ASSERT_EQUAL_UINT8(want[i], got[i]);
+  }
+}
+
+static void Memory_CopySizesAndOffsets(void) {
+  fill_pattern(src_buf, BUF_SIZE, 7);
+  for (size_t off = 0; off < 32; off += 3) {
+    for (size_t n = 0; n + off + 64 < BUF_SIZE; n += n < 40 ? 1 : 37) {
+      cu_Memory_memset(dst_buf, 0xEE, BUF_SIZE);
+      size_t start = 64 - off % 7;
+      cu_Memory_memcpy(dst_buf + start, cu_Slice_create(src_buf + off, n));
+      for (size_t i = 0; i < BUF_SIZE; ++i) {
+        unsigned char want =
+            i >= start && i < start + n ? src_buf[off + i - start] : 0xEE;
+        TEST_ASSERT_EQUAL_UINT8(want, dst_buf[i]);
+      }
+    }
+  }
+}
+
+static void Memory_MoveOverlapping(void) {
+  for (size_t n = 0; n < 700; n += n < 40 ? 1 : 29) {
+    for (size_t shift = 1; shift < 70; shift += 5) {
+      /* dest above src */
+      unsigned char *buf = malloc(n + shift);
+      fill_pattern(buf, n + shift, 3);
+      unsigned char *ref = malloc(n + shift);
+      for (size_t i = 0; i < n + shift; ++i) {
+        ref[i] = buf[i];
+      }
+      for (size_t i = n; i-- > 0;) {
+        ref[i + shift] = ref[i];
+      }
+      cu_Memory_memmove(buf + shift, cu_Slice_create(buf, n));
+      assert_bytes(ref, buf, n + shift);
+
+      /* dest below src */
+      fill_pattern(buf, n + shift, 11);
+      for (size_t i = 0; i < n + shift; ++i) {
+        ref[i] = buf[i];
+      }
+      for (size_t i = 0; i < n; ++i) {
+        ref[i] = ref[i + shift];
+      }
+      cu_Memory_memmove(buf, cu_Slice_create(buf + shift, n));
+      assert_bytes(ref, buf, n + shift);
+      free(ref);
+      free(buf);
+    }
+  }
+}
+
+static void Memory_SetSizesAndOffsets(void) {
+  for (size_t off = 0; off < 32; ++off) {
+    for (size_t n = 0; n + off < 600; n += n < 40 ? 1 : 53) {
+      for (size_t i = 0; i < BUF_SIZE; ++i) {
+        dst_buf[i] = 0x11;
+      }
+      cu_Memory_memset(dst_buf + off, 0xA5, n);
+      for (size_t i = 0; i < BUF_SIZE; ++i) {
+        unsigned char want = i >= off && i < off + n ? 0xA5 : 0x11;
+        TEST_ASSERT_EQUAL_UINT8(want, dst_buf[i]);
+      }
+    }
+  }
+}
+
+static void Memory_CompareEveryPosition(void) {
+  fill_pattern(src_buf, BUF_SIZE, 5);
+  fill_pattern(ref_buf, BUF_SIZE, 5);
+  for (size_t n = 0; n < 300; n += n < 40 ? 1 : 17) {
+    TEST_ASSERT_TRUE(cu_Memory_memcmp(
+        cu_Slice_create(src_buf + 1, n), cu_Slice_create(ref_buf + 1, n)));
+    for (size_t i = 0; i < n; ++i) {
+      ref_buf[1 + i] ^= 0x40;
+      TEST_ASSERT_FALSE(cu_Memory_memcmp(
+          cu_Slice_create(src_buf + 1, n), cu_Slice_create(ref_buf + 1, n)));
+      ref_buf[1 + i] ^= 0x40;
+    }
+  }
+  TEST_ASSERT_FALSE(cu_Memory_memcmp(
+      cu_Slice_create(src_buf, 8), cu_Slice_create(ref_buf, 9)));
+}
+
+static void Memory_LargeCopyAndFill(void) {
+  /* large enough for the cache bypassing path */
+  size_t n = (size_t)9 << 20;
+  unsigned char *a = malloc(n + 64);
+  unsigned char *b = malloc(n + 64);
+  TEST_ASSERT_NOT_NULL(a);
+  TEST_ASSERT_NOT_NULL(b);
+  cu_Memory_memset(a + 3, 0x5A, n);
+  TEST_ASSERT_EQUAL_UINT8(0x5A, a[3]);
+  TEST_ASSERT_EQUAL_UINT8(0x5A, a[n + 2]);
+  for (size_t i = 0; i < n; i += 4093) {
+    a[3 + i] = (unsigned char)i;
+  }
+  cu_Memory_memcpy(b + 1, cu_Slice_create(a + 3, n));
+  TEST_ASSERT_TRUE(
+      cu_Memory_memcmp(cu_Slice_create(b + 1, n), cu_Slice_create(a + 3, n)));
+  b[1 + n - 1] ^= 1;
+  TEST_ASSERT_FALSE(
+      cu_Memory_memcmp(cu_Slice_create(b + 1, n), cu_Slice_create(a + 3, n)));
+  free(b);
+  free(a);
+}
+
+static void Memory_FindByte(void) {
+  for (size_t n = 0; n < 200; ++n) {
+    for (size_t i = 0; i < BUF_SIZE; ++i) {
+      src_buf[i] = 'a';
+    }
+    cu_Slice hay = cu_Slice_create(src_buf + 3, n);
+    TEST_ASSERT_NULL(cu_Memory_memchr(hay, 'x'));
+    TEST_ASSERT_NULL(cu_Memory_memrchr(hay, 'x'));
+    for (size_t i = 0; i < n; i += 1 + i / 8) {
+      src_buf[3 + i] = 'x';
+      src_buf[3 + n - 1 - i] = 'x';
+      TEST_ASSERT_EQUAL_PTR(src_buf + 3 + CU_MIN(i, n - 1 - i),
+          cu_Memory_memchr(hay, 'x'));
+      TEST_ASSERT_EQUAL_PTR(src_buf + 3 + CU_MAX(i, n - 1 - i),
+          cu_Memory_memrchr(hay, 'x'));
+      src_buf[3 + i] = 'a';
+      src_buf[3 + n - 1 - i] = 'a';
+    }
+    /* bytes just outside the slice are never reported */
+    src_buf[2] = 'x';
+    src_buf[3 + n] = 'x';
+    TEST_ASSERT_NULL(cu_Memory_memchr(hay, 'x'));
+    TEST_ASSERT_NULL(cu_Memory_memrchr(hay, 'x'));
+  }
+}
+
+static void Memory_FindSubsequence(void) {
+  const char *text = "GET /index.html HTTP/1.1\r\nHost: a\r\n\r\nbody";
+  cu_Slice hay = CU_SLICE_CSTR(text);
+  TEST_ASSERT_EQUAL_PTR(
+      text + 33, cu_Memory_memmem(hay, CU_SLICE_CSTR("\r\n\r\n")));
+  TEST_ASSERT_EQUAL_PTR(text + 4, cu_Memory_memmem(hay, CU_SLICE_CSTR("/")));
+  TEST_ASSERT_EQUAL_PTR(text, cu_Memory_memmem(hay, CU_SLICE_CSTR("")));
+  TEST_ASSERT_EQUAL_PTR(text, cu_Memory_memmem(hay, hay));
+  TEST_ASSERT_NULL(cu_Memory_memmem(hay, CU_SLICE_CSTR("HTTP/2")));
+  TEST_ASSERT_NULL(
+      cu_Memory_memmem(CU_SLICE_CSTR("abc"), CU_SLICE_CSTR("abcd")));
+
+  /* repetitive input full of partial matches */
+  for (size_t i = 0; i < BUF_SIZE; ++i) {
+    src_buf[i] = 'a';
+  }
+  unsigned char needle[40];
+  for (size_t m = 2; m < sizeof(needle); m += 5) {
+    for (size_t i = 0; i < m; ++i) {
+      needle[i] = 'a';
+    }
+    needle[m - 1] = 'b';
+    for (size_t pos = 0; pos + m <= 300; pos += 13) {
+      src_buf[pos + m - 1] = 'b';
+      cu_Slice hay_buf = cu_Slice_create(src_buf, 300);
+      TEST_ASSERT_EQUAL_PTR(
+          src_buf + pos, cu_Memory_memmem(hay_buf, cu_Slice_create(needle, m)));
+      TEST_ASSERT_NULL(cu_Memory_memmem(
+          cu_Slice_create(src_buf, pos + m - 1), cu_Slice_create(needle, m)));
+      src_buf[pos + m - 1] = 'a';
+    }
+  }
+}
+
+static void CString_LengthAtEveryAlignment(void) {
+  char buf[128];
+  for (size_t off = 0; off < 32; ++off) {
+    for (size_t len = 0; len + off < sizeof(buf) - 1; ++len) {
+      for (size_t i = 0; i < len; ++i) {
+        buf[off + i] = (char)('a' + i % 26);
+      }
+      buf[off + len] = '\0';
+      TEST_ASSERT_EQUAL_size_t(len, cu_CString_length(buf + off));
+    }
+  }
+  TEST_ASSERT_EQUAL_size_t(0, cu_CString_length(NULL));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(Memory_CopySizesAndOffsets);
+  RUN_TEST(Memory_MoveOverlapping);
+  RUN_TEST(Memory_SetSizesAndOffsets);
+  RUN_TEST(Memory_CompareEveryPosition);
+  RUN_TEST(Memory_LargeCopyAndFill);
+  RUN_TEST(Memory_FindByte);
+  RUN_TEST(Memory_FindSubsequence);
+  RUN_TEST(CString_LengthAtEveryAlignment);
+  return UNITY_END();
+}
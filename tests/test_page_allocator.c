@@ -24,6 +24,50 @@ static void PageAllocator_Basic(void) {
   TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&shrunk));
   cu_Allocator_Free(a, shrunk.value);
 }
+
+static void PageAllocator_ResizeKeepsData(void) {
+  cu_PageAllocator palloc;
+  cu_Allocator a = cu_Allocator_PageAllocator(&palloc);
+  const size_t small = 4 * 1024 * 1024;
+  cu_IoSlice_Result mem_res = cu_Allocator_Alloc(a, cu_Layout_create(small, 1));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&mem_res));
+  unsigned char *p = (unsigned char *)mem_res.value.ptr;
+  p[0] = 0x11;
+  p[small - 1] = 0x22;
+
+  cu_IoSlice_Result grown =
+      cu_Allocator_Grow(a, mem_res.value, cu_Layout_create(small * 16, 1));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&grown));
+  TEST_ASSERT_TRUE(grown.value.length >= small * 16);
+  p = (unsigned char *)grown.value.ptr;
+  TEST_ASSERT_EQUAL(p[0], 0x11);
+  TEST_ASSERT_EQUAL(p[small - 1], 0x22);
+  p[small * 16 - 1] = 0x33;
+
+  /* shrinking keeps the head in place */
+  cu_IoSlice_Result shrunk =
+      cu_Allocator_Shrink(a, grown.value, cu_Layout_create(small, 1));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&shrunk));
+  TEST_ASSERT_EQUAL(shrunk.value.ptr, grown.value.ptr);
+  TEST_ASSERT_EQUAL(shrunk.value.length, small);
+  TEST_ASSERT_EQUAL(p[small - 1], 0x22);
+  cu_Allocator_Free(a, shrunk.value);
+}
+
+static void PageAllocator_HugePageAlignment(void) {
+  cu_PageAllocator palloc;
+  cu_PageAllocator_Config cfg = {0};
+  cfg.hugePages = true;
+  cu_Allocator a = cu_Allocator_PageAllocatorWithConfig(&palloc, cfg);
+  cu_IoSlice_Result mem_res =
+      cu_Allocator_Alloc(a, cu_Layout_create(CU_PAGE_HUGE_SIZE * 2, 1));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&mem_res));
+#if CU_PLAT_LINUX
+  TEST_ASSERT_EQUAL((uintptr_t)mem_res.value.ptr % CU_PAGE_HUGE_SIZE, 0);
+#endif
+  cu_Memory_memset(mem_res.value.ptr, 0x7F, mem_res.value.length);
+  cu_Allocator_Free(a, mem_res.value);
+}
 #endif
 
 int main(void) {
@@ -32,6 +76,8 @@ int main(void) {
   RUN_TEST(PageAllocator_Unsupported);
 #else
   RUN_TEST(PageAllocator_Basic);
+  RUN_TEST(PageAllocator_ResizeKeepsData);
+  RUN_TEST(PageAllocator_HugePageAlignment);
 #endif
   return UNITY_END();
 }
@@ -0,0 +1,315 @@
+#include "collection/dlist.h"
+#include "memory/allocator.h"
+#include "memory/poolallocator.h"
+#include "nostd.h"
+#include "unity.h"
+#include <unity_internals.h>
+
+#if CU_FREESTANDING || defined(__STDC_NO_ATOMICS__)
+static void PoolAllocator_Unsupported(void) {}
+#else
+#if CU_PLAT_POSIX
+#include <pthread.h>
+#endif
+
+static void PoolAllocator_ReuseAndGrowth(void) {
+  cu_PoolAllocator pool;
+  cu_PoolAllocator_Config cfg = {0};
+  cfg.layout = cu_Layout_create(24, 8);
+  cfg.chunkObjects = 4;
+  cu_Allocator alloc = cu_Allocator_PoolAllocator(&pool, cfg);
+
+  /* spans several doubling chunks */
+  cu_Slice objs[200];
+  for (size_t i = 0; i < 200; ++i) {
+    cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(24, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)res.value.ptr % 8);
+    objs[i] = res.value;
+    cu_Memory_memset(objs[i].ptr, (int)i, objs[i].length);
+  }
+  for (size_t i = 0; i < 200; ++i) {
+    unsigned char *p = (unsigned char *)objs[i].ptr;
+    TEST_ASSERT_EQUAL_UINT8((unsigned char)i, p[0]);
+    TEST_ASSERT_EQUAL_UINT8((unsigned char)i, p[23]);
+  }
+
+  void *last = objs[199].ptr;
+  cu_Allocator_Free(alloc, objs[199]);
+  cu_IoSlice_Result again = cu_Allocator_Alloc(alloc, cu_Layout_create(16, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&again));
+  TEST_ASSERT_EQUAL_PTR(last, again.value.ptr);
+  objs[199] = again.value;
+
+  /* everything spilled to the shared list is handed out again */
+  for (size_t i = 0; i < 200; ++i) {
+    cu_Allocator_Free(alloc, objs[i]);
+  }
+  cu_PoolAllocator_flush(&pool);
+  size_t carved = pool.carved;
+  for (size_t i = 0; i < 200; ++i) {
+    cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(24, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    objs[i] = res.value;
+  }
+  TEST_ASSERT_EQUAL_size_t(carved, pool.carved);
+  for (size_t i = 0; i < 200; ++i) {
+    cu_Allocator_Free(alloc, objs[i]);
+  }
+  cu_PoolAllocator_destroy(&pool);
+}
+
+static void PoolAllocator_RejectsOtherLayouts(void) {
+  cu_PoolAllocator pool;
+  cu_PoolAllocator_Config cfg = {0};
+  cfg.layout = cu_Layout_create(32, 8);
+  cu_Allocator alloc = cu_Allocator_PoolAllocator(&pool, cfg);
+
+  cu_IoSlice_Result big = cu_Allocator_Alloc(alloc, cu_Layout_create(33, 8));
+  TEST_ASSERT_FALSE(cu_IoSlice_Result_is_ok(&big));
+  cu_IoSlice_Result aligned =
+      cu_Allocator_Alloc(alloc, cu_Layout_create(8, 64));
+  TEST_ASSERT_FALSE(cu_IoSlice_Result_is_ok(&aligned));
+
+  cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(8, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+  cu_IoSlice_Result grown =
+      cu_Allocator_Grow(alloc, res.value, cu_Layout_create(32, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&grown));
+  TEST_ASSERT_EQUAL_PTR(res.value.ptr, grown.value.ptr);
+  cu_IoSlice_Result too_big =
+      cu_Allocator_Grow(alloc, grown.value, cu_Layout_create(64, 8));
+  TEST_ASSERT_FALSE(cu_IoSlice_Result_is_ok(&too_big));
+  cu_Allocator_Free(alloc, grown.value);
+  cu_PoolAllocator_destroy(&pool);
+}
+
+static void PoolAllocator_DListNodes(void) {
+  cu_PoolAllocator pool;
+  cu_PoolAllocator_Config cfg = {0};
+  cfg.layout = cu_Layout_create(sizeof(struct cu_DList_Node) + sizeof(int),
+      _Alignof(struct cu_DList_Node));
+  cu_Allocator alloc = cu_Allocator_PoolAllocator(&pool, cfg);
+
+  cu_DList_Result res =
+      cu_DList_create(alloc, CU_LAYOUT(int), cu_Destructor_Optional_none());
+  TEST_ASSERT_TRUE(cu_DList_Result_is_ok(&res));
+  cu_DList list = cu_DList_Result_unwrap(&res);
+  for (int i = 0; i < 500; ++i) {
+    cu_DList_Error_Optional err = cu_DList_push_back(&list, &i);
+    TEST_ASSERT_FALSE(cu_DList_Error_Optional_is_some(&err));
+  }
+  for (int i = 0; i < 500; ++i) {
+    int out = -1;
+    cu_DList_Error_Optional err = cu_DList_pop_front(&list, &out);
+    TEST_ASSERT_FALSE(cu_DList_Error_Optional_is_some(&err));
+    TEST_ASSERT_EQUAL_INT(i, out);
+  }
+  cu_DList_destroy(&list);
+  cu_PoolAllocator_destroy(&pool);
+}
+
+static void PoolAllocator_Batch(void) {
+  cu_PoolAllocator pool;
+  cu_PoolAllocator_Config cfg = {0};
+  cfg.layout = cu_Layout_create(16, 8);
+  cu_Allocator alloc = cu_Allocator_PoolAllocator(&pool, cfg);
+
+  cu_Slice objs[300];
+  cu_Io_Error_Optional err =
+      cu_Allocator_AllocBatch(alloc, cu_Layout_create(16, 8), objs, 300);
+  TEST_ASSERT_FALSE(cu_Io_Error_Optional_is_some(&err));
+  for (size_t i = 0; i < 300; ++i) {
+    cu_Memory_memset(objs[i].ptr, (int)i, objs[i].length);
+  }
+  for (size_t i = 0; i < 300; ++i) {
+    unsigned char *p = (unsigned char *)objs[i].ptr;
+    TEST_ASSERT_EQUAL_UINT8((unsigned char)i, p[15]);
+  }
+  cu_Allocator_FreeBatch(alloc, objs, 300);
+
+  size_t carved = pool.carved;
+  err = cu_Allocator_AllocBatch(alloc, cu_Layout_create(16, 8), objs, 300);
+  TEST_ASSERT_FALSE(cu_Io_Error_Optional_is_some(&err));
+  TEST_ASSERT_EQUAL_size_t(carved, pool.carved);
+  cu_Allocator_FreeBatch(alloc, objs, 300);
+
+  err = cu_Allocator_AllocBatch(alloc, cu_Layout_create(32, 8), objs, 4);
+  TEST_ASSERT_TRUE(cu_Io_Error_Optional_is_some(&err));
+  cu_PoolAllocator_destroy(&pool);
+}
+
+typedef struct {
+  cu_Allocator inner;
+  bool fail;
+} pool_flaky;
+
+static cu_IoSlice_Result pool_flaky_alloc(void *self, cu_Layout layout) {
+  pool_flaky *flaky = (pool_flaky *)self;
+  if (flaky->fail) {
+    cu_Io_Error err = {.kind = CU_IO_ERROR_KIND_OUT_OF_MEMORY,
+        .errnum = Size_Optional_none()};
+    return cu_IoSlice_Result_error(err);
+  }
+  return cu_Allocator_Alloc(flaky->inner, layout);
+}
+
+static void pool_flaky_free(void *self, cu_Slice mem) {
+  cu_Allocator_Free(((pool_flaky *)self)->inner, mem);
+}
+
+static void PoolAllocator_ChunkFailure(void) {
+  pool_flaky flaky = {cu_Allocator_CAllocator(), false};
+  cu_Allocator backing = {0};
+  backing.self = &flaky;
+  backing.allocFn = pool_flaky_alloc;
+  backing.freeFn = pool_flaky_free;
+
+  cu_PoolAllocator pool;
+  cu_PoolAllocator_Config cfg = {0};
+  cfg.layout = cu_Layout_create(16, 8);
+  cfg.chunkObjects = 4;
+  cfg.backingAllocator = cu_Allocator_Optional_some(backing);
+  cu_Allocator alloc = cu_Allocator_PoolAllocator(&pool, cfg);
+
+  cu_Slice objs[256];
+  size_t count = 0;
+  while (count < 32) {
+    cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(16, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    objs[count++] = res.value;
+  }
+
+  /* running into a chunk that cannot be allocated reserves nothing in it */
+  flaky.fail = true;
+  for (;;) {
+    cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(16, 8));
+    if (!cu_IoSlice_Result_is_ok(&res)) {
+      break;
+    }
+    objs[count++] = res.value;
+  }
+  TEST_ASSERT_EQUAL_size_t(count + pool.magazines->count, pool.carved);
+
+  flaky.fail = false;
+  while (count < 256) {
+    cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(16, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    objs[count++] = res.value;
+  }
+  TEST_ASSERT_EQUAL_size_t(count + pool.magazines->count, pool.carved);
+  for (size_t i = 0; i < count; ++i) {
+    cu_Allocator_Free(alloc, objs[i]);
+  }
+  cu_PoolAllocator_destroy(&pool);
+}
+
+static void PoolAllocator_ManyPools(void) {
+  enum { POOLS = 7 };
+  cu_PoolAllocator pools[POOLS];
+  cu_Allocator allocs[POOLS];
+  cu_PoolAllocator_Config cfg = {0};
+  cfg.layout = cu_Layout_create(16, 8);
+  for (size_t i = 0; i < POOLS; ++i) {
+    allocs[i] = cu_Allocator_PoolAllocator(&pools[i], cfg);
+  }
+
+  /* more pools than thread slots keeps evicting them */
+  for (size_t round = 0; round < 64; ++round) {
+    for (size_t i = 0; i < POOLS; ++i) {
+      cu_IoSlice_Result res =
+          cu_Allocator_Alloc(allocs[i], cu_Layout_create(16, 8));
+      TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+      cu_Allocator_Free(allocs[i], res.value);
+    }
+  }
+
+  /* the thread keeps a single magazine per pool */
+  for (size_t i = 0; i < POOLS; ++i) {
+    TEST_ASSERT_NOT_NULL(pools[i].magazines);
+    TEST_ASSERT_NULL(pools[i].magazines->next);
+    cu_PoolAllocator_flush(&pools[i]);
+    TEST_ASSERT_EQUAL_size_t(0, pools[i].magazines->count);
+    cu_PoolAllocator_destroy(&pools[i]);
+  }
+}
+
+#if CU_PLAT_POSIX
+#define POOL_THREADS 4
+#define POOL_ROUNDS 20000
+
+struct pool_worker {
+  cu_PoolAllocator *pool;
+  cu_Allocator alloc;
+  bool ok;
+};
+
+static void *pool_worker_run(void *arg) {
+  struct pool_worker *w = (struct pool_worker *)arg;
+  cu_Slice held[64];
+  w->ok = true;
+  for (size_t i = 0; i < POOL_ROUNDS; ++i) {
+    size_t n = 1 + i % 64;
+    for (size_t j = 0; j < n; ++j) {
+      cu_IoSlice_Result res =
+          cu_Allocator_Alloc(w->alloc, cu_Layout_create(48, 8));
+      if (!cu_IoSlice_Result_is_ok(&res)) {
+        w->ok = false;
+        return NULL;
+      }
+      held[j] = res.value;
+      ((size_t *)held[j].ptr)[1] = i ^ j;
+    }
+    for (size_t j = 0; j < n; ++j) {
+      if (((size_t *)held[j].ptr)[1] != (i ^ j)) {
+        w->ok = false;
+      }
+      cu_Allocator_Free(w->alloc, held[j]);
+    }
+  }
+  cu_PoolAllocator_flush(w->pool);
+  return NULL;
+}
+
+static void PoolAllocator_Concurrent(void) {
+  cu_PoolAllocator pool;
+  cu_PoolAllocator_Config cfg = {0};
+  cfg.layout = cu_Layout_create(48, 8);
+  cu_Allocator alloc = cu_Allocator_PoolAllocator(&pool, cfg);
+
+  struct pool_worker workers[POOL_THREADS];
+  pthread_t threads[POOL_THREADS];
+  for (size_t i = 0; i < POOL_THREADS; ++i) {
+    workers[i].pool = &pool;
+    workers[i].alloc = alloc;
+    pthread_create(&threads[i], NULL, pool_worker_run, &workers[i]);
+  }
+  for (size_t i = 0; i < POOL_THREADS; ++i) {
+    pthread_join(threads[i], NULL);
+    TEST_ASSERT_TRUE(workers[i].ok);
+  }
+  /* the working set is bounded, so objects were recycled between threads */
+  TEST_ASSERT_LESS_OR_EQUAL(
+      POOL_THREADS * (64 + CU_POOL_MAGAZINE_SIZE) * 2, pool.carved);
+  cu_PoolAllocator_destroy(&pool);
+}
+#endif
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+#if CU_FREESTANDING || defined(__STDC_NO_ATOMICS__)
+  RUN_TEST(PoolAllocator_Unsupported);
+#else
+  RUN_TEST(PoolAllocator_ReuseAndGrowth);
+  RUN_TEST(PoolAllocator_RejectsOtherLayouts);
+  RUN_TEST(PoolAllocator_DListNodes);
+  RUN_TEST(PoolAllocator_Batch);
+  RUN_TEST(PoolAllocator_ChunkFailure);
+  RUN_TEST(PoolAllocator_ManyPools);
+#if CU_PLAT_POSIX
+  RUN_TEST(PoolAllocator_Concurrent);
+#endif
+#endif
+  return UNITY_END();
+}
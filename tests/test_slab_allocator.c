@@ -136,6 +136,96 @@ static void SlabAllocator_Alignment(void) {
   cu_SlabAllocator_destroy(&slab);
 }
 
+static void SlabAllocator_MultiSlotHoles(void) {
+  cu_FixedAllocator fa;
+  cu_Allocator fa_alloc = cu_Allocator_FixedAllocator(
+      &fa, cu_Slice_create(backing, sizeof(backing)));
+
+  cu_SlabAllocator slab;
+  cu_SlabAllocator_Config cfg = {0};
+  cfg.slabSize = 64;
+  cfg.backingAllocator = cu_Allocator_Optional_some(fa_alloc);
+  cu_Allocator alloc = cu_Allocator_SlabAllocator(&slab, cfg);
+
+  /* fill a few slabs, free every other block and refill the holes */
+  cu_Slice blocks[192];
+  for (size_t i = 0; i < 192; ++i) {
+    cu_IoSlice_Result res =
+        cu_Allocator_Alloc(alloc, cu_Layout_create(16 + (i % 3) * 64, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    blocks[i] = res.value;
+    cu_Memory_memset(blocks[i].ptr, (int)i, blocks[i].length);
+  }
+  for (size_t i = 0; i < 192; i += 2) {
+    cu_Allocator_Free(alloc, blocks[i]);
+  }
+  for (size_t i = 0; i < 192; i += 2) {
+    cu_IoSlice_Result res =
+        cu_Allocator_Alloc(alloc, cu_Layout_create(16 + (i % 3) * 64, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    blocks[i] = res.value;
+    cu_Memory_memset(blocks[i].ptr, (int)i, blocks[i].length);
+  }
+  for (size_t i = 0; i < 192; ++i) {
+    unsigned char *p = (unsigned char *)blocks[i].ptr;
+    TEST_ASSERT_EQUAL(p[0], (unsigned char)i);
+    TEST_ASSERT_EQUAL(p[blocks[i].length - 1], (unsigned char)i);
+  }
+
+  cu_SlabAllocator_destroy(&slab);
+}
+
+static void SlabAllocator_Batch(void) {
+  cu_FixedAllocator fa;
+  cu_Allocator fa_alloc = cu_Allocator_FixedAllocator(
+      &fa, cu_Slice_create(backing, sizeof(backing)));
+
+  cu_SlabAllocator slab;
+  cu_SlabAllocator_Config cfg = {0};
+  cfg.slabSize = 64;
+  cfg.backingAllocator = cu_Allocator_Optional_some(fa_alloc);
+  cu_Allocator alloc = cu_Allocator_SlabAllocator(&slab, cfg);
+
+  /* punch holes into the first slab for the batch to fill */
+  cu_Slice singles[16];
+  for (size_t i = 0; i < 16; ++i) {
+    cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(16, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    singles[i] = res.value;
+  }
+  for (size_t i = 0; i < 16; i += 4) {
+    cu_Allocator_Free(alloc, singles[i]);
+    cu_Allocator_Free(alloc, singles[i + 1]);
+  }
+
+  cu_Slice objs[200];
+  cu_Io_Error_Optional err =
+      cu_Allocator_AllocBatch(alloc, cu_Layout_create(40, 8), objs, 200);
+  TEST_ASSERT_FALSE(cu_Io_Error_Optional_is_some(&err));
+  TEST_ASSERT_EQUAL_PTR(singles[0].ptr, objs[0].ptr);
+  for (size_t i = 0; i < 200; ++i) {
+    TEST_ASSERT_EQUAL(0, (uintptr_t)objs[i].ptr % 8);
+    cu_Memory_memset(objs[i].ptr, (int)i, objs[i].length);
+  }
+  for (size_t i = 0; i < 200; ++i) {
+    unsigned char *p = (unsigned char *)objs[i].ptr;
+    TEST_ASSERT_EQUAL(p[0], (unsigned char)i);
+    TEST_ASSERT_EQUAL(p[objs[i].length - 1], (unsigned char)i);
+  }
+
+  /* freed runs are handed out again without new slabs */
+  struct cu_SlabAllocator_Slab *slabs = slab.slabs;
+  cu_Allocator_FreeBatch(alloc, objs, 200);
+  err = cu_Allocator_AllocBatch(alloc, cu_Layout_create(40, 8), objs, 200);
+  TEST_ASSERT_FALSE(cu_Io_Error_Optional_is_some(&err));
+  TEST_ASSERT_EQUAL_PTR(slabs, slab.slabs);
+  cu_Allocator_FreeBatch(alloc, objs, 200);
+
+  err = cu_Allocator_AllocBatch(alloc, cu_Layout_create(0, 8), objs, 4);
+  TEST_ASSERT_TRUE(cu_Io_Error_Optional_is_some(&err));
+  cu_SlabAllocator_destroy(&slab);
+}
+
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(SlabAllocator_Basic);
@@ -144,5 +234,7 @@ int main(void) {
   RUN_TEST(SlabAllocator_GrowFallback);
   RUN_TEST(SlabAllocator_ReuseFreed);
   RUN_TEST(SlabAllocator_Alignment);
+  RUN_TEST(SlabAllocator_MultiSlotHoles);
+  RUN_TEST(SlabAllocator_Batch);
   return UNITY_END();
 }
@@ -0,0 +1,126 @@
+#if CU_FREESTANDING
+#include "unity.h"
+#include <unity_internals.h>
+static void SmallVector_Unsupported(void) {}
+#else
+#include "collection/small_vector.h"
+#include "memory/allocator.h"
+#include "memory/statsallocator.h"
+#include "test_common.h"
+#include "unity.h"
+#include <unity_internals.h>
+
+CU_SMALLVECTOR_DECL(Int, int, 8)
+CU_SMALLVECTOR_IMPL(Int, int, 8)
+
+static Int_SmallVector make_vector(cu_Allocator alloc) {
+  Int_SmallVector_Result res = Int_SmallVector_create(
+      alloc, Size_Optional_none(), cu_Destructor_Optional_none());
+  TEST_ASSERT_TRUE(Int_SmallVector_Result_is_ok(&res));
+  return Int_SmallVector_Result_unwrap(&res);
+}
+
+static void SmallVector_StaysInline(void) {
+  Int_SmallVector vec = make_vector(test_allocator);
+  TEST_ASSERT_TRUE(Int_SmallVector_is_inline(&vec));
+  TEST_ASSERT_EQUAL_size_t(8, Int_SmallVector_capacity(&vec));
+  for (int i = 0; i < 8; ++i) {
+    cu_Vector_Error_Optional err = Int_SmallVector_push_back(&vec, &i);
+    TEST_ASSERT_TRUE(cu_Vector_Error_Optional_is_none(&err));
+  }
+  TEST_ASSERT_TRUE(Int_SmallVector_is_inline(&vec));
+
+  /* returned by value, the copy still sees its own inline elements */
+  Int_SmallVector_Result res = Int_SmallVector_copy(&vec);
+  TEST_ASSERT_TRUE(Int_SmallVector_Result_is_ok(&res));
+  Int_SmallVector copy = Int_SmallVector_Result_unwrap(&res);
+  int out = 0;
+  Int_SmallVector_pop_front(&vec, &out);
+  TEST_ASSERT_EQUAL(0, out);
+  for (int i = 0; i < 8; ++i) {
+    Ptr_Optional opt = Int_SmallVector_at(&copy, (size_t)i);
+    TEST_ASSERT_EQUAL(i, *(int *)Ptr_Optional_unwrap(&opt));
+  }
+  Int_SmallVector_destroy(&copy);
+  Int_SmallVector_destroy(&vec);
+}
+
+static void SmallVector_SpillsAndReturns(void) {
+  Int_SmallVector vec = make_vector(test_allocator);
+  for (int i = 0; i < 100; ++i) {
+    int v = i;
+    Int_SmallVector_push_back(&vec, &v);
+  }
+  TEST_ASSERT_FALSE(Int_SmallVector_is_inline(&vec));
+  TEST_ASSERT_EQUAL_size_t(100, Int_SmallVector_size(&vec));
+
+  int front = -1;
+  Int_SmallVector_push_front(&vec, &front);
+  size_t index = 0;
+  void *elem;
+  int expected = -1;
+  while (Int_SmallVector_iter(&vec, &index, &elem)) {
+    TEST_ASSERT_EQUAL(expected++, *(int *)elem);
+  }
+  TEST_ASSERT_EQUAL(100, expected);
+
+  int out = 0;
+  for (int i = 99; i >= 4; --i) {
+    Int_SmallVector_pop_back(&vec, &out);
+    TEST_ASSERT_EQUAL(i, out);
+  }
+  /* shrinking below the inline capacity moves the elements back */
+  TEST_ASSERT_EQUAL_size_t(5, Int_SmallVector_size(&vec));
+  cu_Vector_Error_Optional err = Int_SmallVector_shrink_to_fit(&vec);
+  TEST_ASSERT_TRUE(cu_Vector_Error_Optional_is_none(&err));
+  TEST_ASSERT_TRUE(Int_SmallVector_is_inline(&vec));
+  cu_Slice_Optional slice = Int_SmallVector_slice(&vec);
+  TEST_ASSERT_EQUAL_size_t(5 * sizeof(int), slice.value.length);
+  TEST_ASSERT_EQUAL(-1, ((int *)slice.value.ptr)[0]);
+  TEST_ASSERT_EQUAL(3, ((int *)slice.value.ptr)[4]);
+
+  err = Int_SmallVector_resize(&vec, 40);
+  TEST_ASSERT_TRUE(cu_Vector_Error_Optional_is_none(&err));
+  TEST_ASSERT_FALSE(Int_SmallVector_is_inline(&vec));
+  Int_SmallVector_clear(&vec);
+  TEST_ASSERT_TRUE(Int_SmallVector_is_inline(&vec));
+  Int_SmallVector_destroy(&vec);
+}
+
+static void SmallVector_NoAllocationWhileSmall(void) {
+  cu_StatsAllocator stats;
+  cu_StatsAllocator_Config config = {
+      cu_Allocator_Optional_some(test_allocator), NULL};
+  cu_Allocator alloc = cu_Allocator_StatsAllocator(&stats, config);
+  for (int round = 0; round < 1000; ++round) {
+    Int_SmallVector vec = make_vector(alloc);
+    for (int i = 0; i < 8; ++i) {
+      Int_SmallVector_push_back(&vec, &i);
+    }
+    Int_SmallVector_destroy(&vec);
+  }
+  cu_StatsAllocator_Snapshot snapshot = cu_StatsAllocator_snapshot(&stats);
+  TEST_ASSERT_EQUAL_size_t(0, snapshot.allocCount);
+
+  /* the ninth element is the first to reach the allocator */
+  Int_SmallVector vec = make_vector(alloc);
+  for (int i = 0; i < 9; ++i) {
+    Int_SmallVector_push_back(&vec, &i);
+  }
+  Int_SmallVector_destroy(&vec);
+  snapshot = cu_StatsAllocator_snapshot(&stats);
+  TEST_ASSERT_EQUAL_size_t(1, snapshot.allocCount);
+}
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+#if CU_FREESTANDING
+  RUN_TEST(SmallVector_Unsupported);
+#else
+  RUN_TEST(SmallVector_StaysInline);
+  RUN_TEST(SmallVector_SpillsAndReturns);
+  RUN_TEST(SmallVector_NoAllocationWhileSmall);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,127 @@
+#include "io/memstream.h"
+#include "memory/allocator.h"
+#include "memory/statsallocator.h"
+#include "nostd.h"
+#include "unity.h"
+#include <unity_internals.h>
+
+#if defined(__STDC_NO_ATOMICS__)
+static void StatsAllocator_Unsupported(void) {}
+#else
+static uint64_t fake_ticks;
+
+static uint64_t fake_clock(void) {
+  fake_ticks += 5;
+  return fake_ticks;
+}
+
+static void StatsAllocator_Counts(void) {
+  cu_StatsAllocator stats;
+  cu_StatsAllocator_Config cfg = {0};
+  cfg.backingAllocator = cu_Allocator_Optional_some(cu_Allocator_CAllocator());
+  cu_Allocator alloc = cu_Allocator_StatsAllocator(&stats, cfg);
+
+  cu_IoSlice_Result a = cu_Allocator_Alloc(alloc, cu_Layout_create(24, 8));
+  cu_IoSlice_Result b = cu_Allocator_Alloc(alloc, cu_Layout_create(100, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&a));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&b));
+
+  cu_IoSlice_Result g =
+      cu_Allocator_Grow(alloc, b.value, cu_Layout_create(300, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&g));
+  cu_IoSlice_Result s =
+      cu_Allocator_Shrink(alloc, g.value, cu_Layout_create(50, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&s));
+
+  cu_StatsAllocator_Snapshot snap = cu_StatsAllocator_snapshot(&stats);
+  TEST_ASSERT_EQUAL_UINT(2, snap.allocCount);
+  TEST_ASSERT_EQUAL_UINT(1, snap.growCount);
+  TEST_ASSERT_EQUAL_UINT(1, snap.shrinkCount);
+  TEST_ASSERT_EQUAL_UINT(74, snap.bytesLive);
+  TEST_ASSERT_EQUAL_UINT(324, snap.bytesPeak);
+  TEST_ASSERT_EQUAL_UINT(124, snap.bytesTotal);
+  TEST_ASSERT_EQUAL_UINT(1, snap.histogram[5]);
+  TEST_ASSERT_EQUAL_UINT(1, snap.histogram[7]);
+  TEST_ASSERT_EQUAL_UINT(0, snap.latencyTicks);
+
+  cu_Allocator_Free(alloc, a.value);
+  cu_Allocator_Free(alloc, s.value);
+  cu_Allocator_Free(alloc, cu_Slice_create(NULL, 0));
+  snap = cu_StatsAllocator_snapshot(&stats);
+  TEST_ASSERT_EQUAL_UINT(2, snap.freeCount);
+  TEST_ASSERT_EQUAL_UINT(0, snap.bytesLive);
+
+  cu_StatsAllocator_reset(&stats);
+  snap = cu_StatsAllocator_snapshot(&stats);
+  TEST_ASSERT_EQUAL_UINT(0, snap.allocCount);
+  TEST_ASSERT_EQUAL_UINT(0, snap.bytesPeak);
+  TEST_ASSERT_EQUAL_UINT(0, snap.histogram[7]);
+}
+
+static void StatsAllocator_FailuresAndLatency(void) {
+  cu_StatsAllocator stats;
+  cu_StatsAllocator_Config cfg = {0};
+  cfg.backingAllocator =
+      cu_Allocator_Optional_some(cu_Allocator_NullAllocator());
+  cfg.clockFn = fake_clock;
+  cu_Allocator alloc = cu_Allocator_StatsAllocator(&stats, cfg);
+
+  cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(16, 8));
+  TEST_ASSERT_FALSE(cu_IoSlice_Result_is_ok(&res));
+  res = cu_Allocator_Alloc(alloc, cu_Layout_create(16, 8));
+  TEST_ASSERT_FALSE(cu_IoSlice_Result_is_ok(&res));
+
+  cu_StatsAllocator_Snapshot snap = cu_StatsAllocator_snapshot(&stats);
+  TEST_ASSERT_EQUAL_UINT(0, snap.allocCount);
+  TEST_ASSERT_EQUAL_UINT(2, snap.failureCount);
+  TEST_ASSERT_EQUAL_UINT(10, snap.latencyTicks);
+  TEST_ASSERT_EQUAL_UINT(5, snap.latencyMax);
+}
+
+static void StatsAllocator_Write(void) {
+  cu_StatsAllocator stats;
+  cu_StatsAllocator_Config cfg = {0};
+  cfg.backingAllocator = cu_Allocator_Optional_some(cu_Allocator_CAllocator());
+  cu_Allocator alloc = cu_Allocator_StatsAllocator(&stats, cfg);
+
+  cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(8, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+  cu_Allocator_Free(alloc, res.value);
+
+  cu_MemStream_Result msr = cu_MemStream_create(16, cu_Allocator_CAllocator());
+  TEST_ASSERT_TRUE(cu_MemStream_Result_is_ok(&msr));
+  cu_MemStream ms = cu_MemStream_Result_unwrap(&msr);
+  cu_Stream s = cu_MemStream_stream(&ms);
+
+  cu_StatsAllocator_Snapshot snap = cu_StatsAllocator_snapshot(&stats);
+  cu_Io_Error_Optional err = cu_StatsAllocator_Snapshot_write(&snap, &s);
+  TEST_ASSERT_FALSE(cu_Io_Error_Optional_is_some(&err));
+
+  cu_Slice_Optional out = cu_MemStream_slice(&ms);
+  TEST_ASSERT_TRUE(cu_Slice_Optional_is_some(&out));
+  const char head[] = "allocs 1\nfrees 1\n";
+  TEST_ASSERT_TRUE(out.value.length > sizeof(head) - 1);
+  TEST_ASSERT_TRUE(
+      cu_Memory_memcmp(cu_Slice_create(out.value.ptr, sizeof(head) - 1),
+          cu_Slice_create((void *)head, sizeof(head) - 1)));
+  const char tail[] = "size_le_8 1\n";
+  char *end = (char *)out.value.ptr + out.value.length;
+  TEST_ASSERT_TRUE(
+      cu_Memory_memcmp(cu_Slice_create(end - (sizeof(tail) - 1),
+                           sizeof(tail) - 1),
+          cu_Slice_create((void *)tail, sizeof(tail) - 1)));
+  cu_MemStream_close(&ms);
+}
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+#if defined(__STDC_NO_ATOMICS__)
+  RUN_TEST(StatsAllocator_Unsupported);
+#else
+  RUN_TEST(StatsAllocator_Counts);
+  RUN_TEST(StatsAllocator_FailuresAndLatency);
+  RUN_TEST(StatsAllocator_Write);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,100 @@
+#if CU_FREESTANDING
+#include "unity.h"
+#include <unity_internals.h>
+static void StringMap_Unsupported(void) {}
+#else
+#include "collection/stringmap.h"
+#include "memory/allocator.h"
+#include "test_common.h"
+#include "unity.h"
+#include <stdio.h>
+#include <unity_internals.h>
+
+static cu_StringMap make_map(void) {
+  cu_RandomState rng;
+  cu_State st = cu_RandomState_init(&rng, 1);
+  cu_StringMap_Result res = cu_StringMap_create(
+      test_allocator, CU_LAYOUT(int), Size_Optional_none(), st);
+  TEST_ASSERT_TRUE(cu_StringMap_Result_is_ok(&res));
+  return cu_StringMap_Result_unwrap(&res);
+}
+
+static void StringMap_ShortAndLongKeys(void) {
+  cu_StringMap map = make_map();
+  char buf[64];
+  for (int i = 0; i < 300; ++i) {
+    /* alternate between inline keys and arena keys */
+    int n = snprintf(buf, sizeof(buf),
+        i % 2 ? "k%d" : "a rather long symbol name %d", i);
+    cu_HashMap_Error_Optional err =
+        cu_StringMap_insert(&map, cu_Slice_create(buf, (size_t)n), &i);
+    TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  }
+  /* the caller's buffer is reused, lookups must not depend on it */
+  cu_Memory_memset(buf, 'x', sizeof(buf));
+  TEST_ASSERT_EQUAL_size_t(300, cu_StringMap_length(&map));
+
+  for (int i = 0; i < 300; ++i) {
+    int n = snprintf(buf, sizeof(buf),
+        i % 2 ? "k%d" : "a rather long symbol name %d", i);
+    Ptr_Optional opt = cu_StringMap_get(&map, cu_Slice_create(buf, (size_t)n));
+    TEST_ASSERT_TRUE(Ptr_Optional_is_some(&opt));
+    TEST_ASSERT_EQUAL(i, *(int *)Ptr_Optional_unwrap(&opt));
+  }
+  Ptr_Optional miss = cu_StringMap_get(&map, CU_SLICE_CSTR("k0"));
+  TEST_ASSERT_TRUE(Ptr_Optional_is_none(&miss));
+  /* prefixes and the empty key are distinct keys */
+  int zero = 0;
+  cu_StringMap_insert(&map, CU_SLICE_CSTR(""), &zero);
+  miss = cu_StringMap_get(&map, CU_SLICE_CSTR("k"));
+  TEST_ASSERT_TRUE(Ptr_Optional_is_none(&miss));
+  Ptr_Optional empty = cu_StringMap_get(&map, CU_SLICE_CSTR(""));
+  TEST_ASSERT_TRUE(Ptr_Optional_is_some(&empty));
+
+  cu_StringMap_destroy(&map);
+}
+
+static void StringMap_UpdateRemoveIter(void) {
+  cu_StringMap map = make_map();
+  const char *names[] = {"alpha", "beta", "a key well past the inline limit"};
+  for (int i = 0; i < 3; ++i) {
+    cu_StringMap_insert(&map, CU_SLICE_CSTR(names[i]), &i);
+  }
+  int v = 42;
+  cu_StringMap_insert(&map, CU_SLICE_CSTR(names[2]), &v);
+  TEST_ASSERT_EQUAL_size_t(3, cu_StringMap_length(&map));
+
+  int old = 0;
+  cu_HashMap_Error_Optional err =
+      cu_StringMap_remove(&map, CU_SLICE_CSTR(names[2]), &old);
+  TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_none(&err));
+  TEST_ASSERT_EQUAL(42, old);
+  err = cu_StringMap_remove(&map, CU_SLICE_CSTR(names[2]), NULL);
+  TEST_ASSERT_TRUE(cu_HashMap_Error_Optional_is_some(&err));
+
+  size_t idx = 0;
+  cu_Slice key;
+  void *value;
+  size_t bytes = 0;
+  while (cu_StringMap_iter(&map, &idx, &key, &value)) {
+    int i = *(int *)value;
+    TEST_ASSERT_EQUAL_size_t(cu_CString_length(names[i]), key.length);
+    TEST_ASSERT_TRUE(cu_Memory_memcmp(key, CU_SLICE_CSTR(names[i])));
+    bytes += key.length;
+  }
+  TEST_ASSERT_EQUAL_size_t(9, bytes);
+
+  cu_StringMap_destroy(&map);
+}
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+#if CU_FREESTANDING
+  RUN_TEST(StringMap_Unsupported);
+#else
+  RUN_TEST(StringMap_ShortAndLongKeys);
+  RUN_TEST(StringMap_UpdateRemoveIter);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,272 @@
+#include "memory/allocator.h"
+#include "memory/statsallocator.h"
+#include "memory/threadcacheallocator.h"
+#include "nostd.h"
+#include "unity.h"
+#include <stdlib.h>
+#include <unity_internals.h>
+
+#if CU_FREESTANDING
+static void ThreadCacheAllocator_Unsupported(void) {}
+#else
+#if CU_PLAT_POSIX
+#include <pthread.h>
+#endif
+
+static void ThreadCacheAllocator_SmallReuse(void) {
+  cu_ThreadCacheAllocator tc;
+  cu_ThreadCacheAllocator_Config cfg = {0};
+  cu_Allocator alloc = cu_Allocator_ThreadCacheAllocator(&tc, cfg);
+
+  cu_Slice blocks[256];
+  for (size_t i = 0; i < 256; ++i) {
+    cu_IoSlice_Result res =
+        cu_Allocator_Alloc(alloc, cu_Layout_create(1 + i * 7, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)res.value.ptr % 8);
+    blocks[i] = res.value;
+    cu_Memory_memset(blocks[i].ptr, (int)i, blocks[i].length);
+  }
+  for (size_t i = 0; i < 256; ++i) {
+    unsigned char *p = (unsigned char *)blocks[i].ptr;
+    TEST_ASSERT_EQUAL_UINT8((unsigned char)i, p[0]);
+    TEST_ASSERT_EQUAL_UINT8((unsigned char)i, p[blocks[i].length - 1]);
+  }
+
+  void *last = blocks[255].ptr;
+  cu_Allocator_Free(alloc, blocks[255]);
+  cu_IoSlice_Result again =
+      cu_Allocator_Alloc(alloc, cu_Layout_create(blocks[255].length, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&again));
+  TEST_ASSERT_EQUAL_PTR(last, again.value.ptr);
+  blocks[255] = again.value;
+
+  for (size_t i = 0; i < 256; ++i) {
+    cu_Allocator_Free(alloc, blocks[i]);
+  }
+  cu_ThreadCacheAllocator_destroy(&tc);
+}
+
+static void ThreadCacheAllocator_LargeAndAligned(void) {
+  cu_ThreadCacheAllocator tc;
+  cu_ThreadCacheAllocator_Config cfg = {0};
+  cu_Allocator alloc = cu_Allocator_ThreadCacheAllocator(&tc, cfg);
+
+  cu_IoSlice_Result big =
+      cu_Allocator_Alloc(alloc, cu_Layout_create(1024 * 1024, 16));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&big));
+  cu_Memory_memset(big.value.ptr, 0xAB, big.value.length);
+
+  cu_IoSlice_Result page =
+      cu_Allocator_Alloc(alloc, cu_Layout_create(100, 4096));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&page));
+  TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)page.value.ptr % 4096);
+
+  cu_IoSlice_Result huge_align =
+      cu_Allocator_Alloc(alloc, cu_Layout_create(64, 1 << 20));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&huge_align));
+  TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)huge_align.value.ptr % (1 << 20));
+
+  cu_Allocator_Free(alloc, huge_align.value);
+  cu_Allocator_Free(alloc, page.value);
+  cu_Allocator_Free(alloc, big.value);
+  cu_ThreadCacheAllocator_destroy(&tc);
+}
+
+static void ThreadCacheAllocator_GrowShrink(void) {
+  cu_ThreadCacheAllocator tc;
+  cu_ThreadCacheAllocator_Config cfg = {0};
+  cu_Allocator alloc = cu_Allocator_ThreadCacheAllocator(&tc, cfg);
+
+  cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(20, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+  cu_Memory_memset(res.value.ptr, 0x11, res.value.length);
+
+  cu_IoSlice_Result grown =
+      cu_Allocator_Grow(alloc, res.value, cu_Layout_create(32, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&grown));
+  TEST_ASSERT_EQUAL_PTR(res.value.ptr, grown.value.ptr);
+
+  grown = cu_Allocator_Grow(alloc, grown.value, cu_Layout_create(100000, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&grown));
+  TEST_ASSERT_EQUAL_UINT8(0x11, ((unsigned char *)grown.value.ptr)[19]);
+
+  cu_IoSlice_Result shrunk =
+      cu_Allocator_Shrink(alloc, grown.value, cu_Layout_create(10, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&shrunk));
+  TEST_ASSERT_EQUAL_PTR(grown.value.ptr, shrunk.value.ptr);
+  TEST_ASSERT_EQUAL_UINT8(0x11, ((unsigned char *)shrunk.value.ptr)[9]);
+
+  cu_Allocator_Free(alloc, shrunk.value);
+  cu_ThreadCacheAllocator_destroy(&tc);
+}
+
+static void ThreadCacheAllocator_ManyInstances(void) {
+  enum { INSTANCES = 7 };
+  cu_ThreadCacheAllocator tcs[INSTANCES];
+  cu_Allocator allocs[INSTANCES];
+  cu_ThreadCacheAllocator_Config cfg = {0};
+  for (size_t i = 0; i < INSTANCES; ++i) {
+    allocs[i] = cu_Allocator_ThreadCacheAllocator(&tcs[i], cfg);
+  }
+
+  /* more instances than thread slots keeps evicting them */
+  for (size_t round = 0; round < 64; ++round) {
+    for (size_t i = 0; i < INSTANCES; ++i) {
+      cu_IoSlice_Result res =
+          cu_Allocator_Alloc(allocs[i], cu_Layout_create(32, 8));
+      TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+      cu_Allocator_Free(allocs[i], res.value);
+    }
+  }
+
+  /* the thread keeps a single cache per instance */
+  for (size_t i = 0; i < INSTANCES; ++i) {
+    TEST_ASSERT_NOT_NULL(tcs[i].caches);
+    TEST_ASSERT_NULL(tcs[i].caches->next);
+    cu_ThreadCacheAllocator_flush(&tcs[i]);
+    TEST_ASSERT_EQUAL(0, tcs[i].caches->bins[5].count);
+    cu_ThreadCacheAllocator_destroy(&tcs[i]);
+  }
+}
+
+static void ThreadCacheAllocator_SpansShareRegions(void) {
+  cu_StatsAllocator stats;
+  cu_StatsAllocator_Config scfg = {0};
+  scfg.backingAllocator = cu_Allocator_Optional_some(cu_Allocator_CAllocator());
+  cu_Allocator backing = cu_Allocator_StatsAllocator(&stats, scfg);
+
+  cu_ThreadCacheAllocator tc;
+  cu_ThreadCacheAllocator_Config cfg = {0};
+  cfg.spanSize = 4096;
+  cfg.backingAllocator = cu_Allocator_Optional_some(backing);
+  cu_Allocator alloc = cu_Allocator_ThreadCacheAllocator(&tc, cfg);
+
+  /* fill a few regions worth of spans with a handful of objects each */
+  size_t count = 16 * CU_THREADCACHE_REGION_SPANS;
+  cu_Slice *blocks = malloc(sizeof(cu_Slice) * count);
+  for (size_t i = 0; i < count; ++i) {
+    cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(512, 8));
+    TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+    blocks[i] = res.value;
+  }
+  cu_StatsAllocator_Snapshot snap = cu_StatsAllocator_snapshot(&stats);
+  TEST_ASSERT_LESS_THAN(CU_THREADCACHE_REGION_SPANS, snap.allocCount);
+  TEST_ASSERT_NULL(tc.regions ? tc.regions->next : NULL);
+
+  for (size_t i = 0; i < count; ++i) {
+    cu_Allocator_Free(alloc, blocks[i]);
+  }
+  free(blocks);
+  cu_ThreadCacheAllocator_flush(&tc);
+  cu_ThreadCacheAllocator_destroy(&tc);
+  snap = cu_StatsAllocator_snapshot(&stats);
+  TEST_ASSERT_EQUAL(0, snap.bytesLive);
+}
+
+#if CU_PLAT_POSIX
+#define TC_THREADS 4
+#define TC_ROUNDS 2000
+
+struct tc_worker {
+  cu_ThreadCacheAllocator *tc;
+  cu_Allocator alloc;
+  cu_Slice handoff[TC_ROUNDS]; /* allocated here, freed by the next worker */
+  struct tc_worker *peer;
+  bool ok;
+};
+
+static void *tc_worker_alloc(void *arg) {
+  struct tc_worker *w = (struct tc_worker *)arg;
+  w->ok = true;
+  for (size_t i = 0; i < TC_ROUNDS; ++i) {
+    size_t size = 8 + (i * 13) % 700;
+    cu_IoSlice_Result res =
+        cu_Allocator_Alloc(w->alloc, cu_Layout_create(size, 8));
+    if (!cu_IoSlice_Result_is_ok(&res)) {
+      w->ok = false;
+      return NULL;
+    }
+    cu_Memory_memset(res.value.ptr, (int)(i & 0xff), size);
+    w->handoff[i] = res.value;
+
+    cu_IoSlice_Result tmp =
+        cu_Allocator_Alloc(w->alloc, cu_Layout_create(size, 8));
+    if (!cu_IoSlice_Result_is_ok(&tmp)) {
+      w->ok = false;
+      return NULL;
+    }
+    cu_Allocator_Free(w->alloc, tmp.value);
+  }
+  cu_ThreadCacheAllocator_flush(w->tc);
+  return NULL;
+}
+
+static void *tc_worker_free(void *arg) {
+  struct tc_worker *w = (struct tc_worker *)arg;
+  for (size_t i = 0; i < TC_ROUNDS; ++i) {
+    cu_Slice s = w->peer->handoff[i];
+    unsigned char *p = (unsigned char *)s.ptr;
+    if (p[0] != (unsigned char)i || p[s.length - 1] != (unsigned char)i) {
+      w->ok = false;
+    }
+    cu_Allocator_Free(w->alloc, s);
+  }
+  cu_ThreadCacheAllocator_flush(w->tc);
+  return NULL;
+}
+
+static void ThreadCacheAllocator_CrossThreadFree(void) {
+  cu_ThreadCacheAllocator tc;
+  cu_ThreadCacheAllocator_Config cfg = {0};
+  cu_Allocator alloc = cu_Allocator_ThreadCacheAllocator(&tc, cfg);
+
+  static struct tc_worker workers[TC_THREADS];
+  pthread_t threads[TC_THREADS];
+  for (size_t i = 0; i < TC_THREADS; ++i) {
+    workers[i].tc = &tc;
+    workers[i].alloc = alloc;
+    workers[i].peer = &workers[(i + 1) % TC_THREADS];
+  }
+  for (size_t i = 0; i < TC_THREADS; ++i) {
+    pthread_create(&threads[i], NULL, tc_worker_alloc, &workers[i]);
+  }
+  for (size_t i = 0; i < TC_THREADS; ++i) {
+    pthread_join(threads[i], NULL);
+    TEST_ASSERT_TRUE(workers[i].ok);
+  }
+
+  /* every block is released by a thread other than its allocator */
+  for (size_t i = 0; i < TC_THREADS; ++i) {
+    pthread_create(&threads[i], NULL, tc_worker_free, &workers[i]);
+  }
+  for (size_t i = 0; i < TC_THREADS; ++i) {
+    pthread_join(threads[i], NULL);
+    TEST_ASSERT_TRUE(workers[i].ok);
+  }
+
+  /* flushed objects are handed out again */
+  cu_IoSlice_Result res = cu_Allocator_Alloc(alloc, cu_Layout_create(64, 8));
+  TEST_ASSERT_TRUE(cu_IoSlice_Result_is_ok(&res));
+  cu_Allocator_Free(alloc, res.value);
+  cu_ThreadCacheAllocator_destroy(&tc);
+}
+#endif
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+#if CU_FREESTANDING
+  RUN_TEST(ThreadCacheAllocator_Unsupported);
+#else
+  RUN_TEST(ThreadCacheAllocator_SmallReuse);
+  RUN_TEST(ThreadCacheAllocator_LargeAndAligned);
+  RUN_TEST(ThreadCacheAllocator_GrowShrink);
+  RUN_TEST(ThreadCacheAllocator_ManyInstances);
+  RUN_TEST(ThreadCacheAllocator_SpansShareRegions);
+#if CU_PLAT_POSIX
+  RUN_TEST(ThreadCacheAllocator_CrossThreadFree);
+#endif
+#endif
+  return UNITY_END();
+}